@@ -109,6 +109,10 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 
 	int selectResult = select(fMaxNumSockets, &readSet, &writeSet,
 			&exceptionSet, &tv_timeToDelay);
+	// Read the clock once, now, for use by all of the event handling below (via "timeNow()"):
+	beginHandlingEvents();
+	struct timeval iterationStartTime = fTimeNow;
+	if (fEventLoopStats != NULL && selectResult >= 0) fEventLoopStats->noteNumReadySockets(selectResult);
 	if (selectResult < 0) {
 #if defined(__WIN32__) || defined(_WIN32)
 		int err = WSAGetLastError();
@@ -218,7 +222,7 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 			/*
 			 * ¼
 			 */
-			(*handler->handlerProc)(handler->clientData, resultConditionSet);
+			callSocketHandler(handler->handlerProc, handler->clientData, resultConditionSet);
 			break;
 		}
 	}
@@ -246,7 +250,7 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 				fLastHandledSocketNum = sock;
 				// Note: we set "fLastHandledSocketNum" before calling the handler,
 				// in case the handler calls "doEventLoop()" reentrantly.
-				(*handler->handlerProc)(handler->clientData, resultConditionSet);
+				callSocketHandler(handler->handlerProc, handler->clientData, resultConditionSet);
 				break;
 			}
 		}
@@ -279,7 +283,7 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 				/*
 				 * ִ¼
 				 */
-				(*fTriggeredEventHandlers[fLastUsedTriggerNum])(
+				callTriggeredEventHandler(fTriggeredEventHandlers[fLastUsedTriggerNum],
 						fTriggeredEventClientDatas[fLastUsedTriggerNum]);
 			}
 		} else {
@@ -302,7 +306,7 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 						/*
 						 * Ӧ¼
 						 */
-						(*fTriggeredEventHandlers[i])(
+						callTriggeredEventHandler(fTriggeredEventHandlers[i],
 								fTriggeredEventClientDatas[i]);
 					}
 
@@ -318,6 +322,11 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 	 */
 	// Also handle any delayed event that may have come due.
 	fDelayQueue.handleAlarm();
+
+	if (fEventLoopStats != NULL) {
+		fEventLoopStats->noteIterationTime(EventLoopStats::uSecondsBetween(iterationStartTime, refreshTimeNow()));
+	}
+	endHandlingEvents();
 }
 
 void BasicTaskScheduler::setBackgroundHandling(int socketNum, int conditionSet,
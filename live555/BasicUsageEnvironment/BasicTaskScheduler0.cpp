@@ -25,20 +25,48 @@
 
 class AlarmHandler: public DelayQueueEntry {
 public:
-	AlarmHandler(TaskFunc* proc, void* clientData, DelayInterval timeToDelay) :
-		DelayQueueEntry(timeToDelay), fProc(proc), fClientData(clientData) {
+	AlarmHandler(BasicTaskScheduler0& scheduler, TaskFunc* proc, void* clientData, DelayInterval timeToDelay) :
+		DelayQueueEntry(timeToDelay), fScheduler(scheduler), fProc(proc), fClientData(clientData) {
+		if (scheduler.fEventLoopStats != NULL) {
+			// Remember when we're due, so that we can measure how late we actually get run:
+			struct timeval const& timeNow = scheduler.timeNow();
+			fDueTime.tv_sec = timeNow.tv_sec + timeToDelay.seconds();
+			fDueTime.tv_usec = timeNow.tv_usec + timeToDelay.useconds();
+			if (fDueTime.tv_usec >= 1000000) {
+				fDueTime.tv_usec -= 1000000;
+				++fDueTime.tv_sec;
+			}
+		} else {
+			fDueTime.tv_sec = fDueTime.tv_usec = 0;
+		}
 	}
 
 private:
 	// redefined virtual functions
 	virtual void handleTimeout() {
-		(*fProc)(fClientData);
+		EventLoopStats* stats = fScheduler.fEventLoopStats;
+		if (stats == NULL) {
+			(*fProc)(fClientData);
+		} else {
+			struct timeval startTime = fScheduler.timeNow();
+			if (fDueTime.tv_sec != 0) stats->noteTimerLateness(EventLoopStats::uSecondsBetween(fDueTime, startTime));
+
+			TaskFunc* proc = fProc; void* clientData = fClientData; // in case we're deleted by the handler
+			(*proc)(clientData);
+			stats = fScheduler.fEventLoopStats; // in case the handler disabled the stats
+			if (stats != NULL) {
+				stats->noteHandlerExecution(EventLoopStats::DELAYED_TASK, (void*)proc, clientData,
+						startTime, fScheduler.refreshTimeNow());
+			}
+		}
 		DelayQueueEntry::handleTimeout();
 	}
 
 private:
+	BasicTaskScheduler0& fScheduler;
 	TaskFunc* fProc;
 	void* fClientData;
+	struct timeval fDueTime; // used only if event loop stats are enabled
 };
 
 ////////// BasicTaskScheduler0 //////////
@@ -56,7 +84,8 @@ private:
 BasicTaskScheduler0::BasicTaskScheduler0() :
 	fLastHandledSocketNum(-1), fTriggersAwaitingHandling(0),
 			fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS
-					- 1) {
+					- 1), fTimeNowIsCached(False), fEventLoopStats(NULL) {
+	fDelayQueue.setClock(this);
 	fHandlers = new HandlerSet;
 	for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
 		fTriggeredEventHandlers[i] = NULL;
@@ -68,6 +97,7 @@ BasicTaskScheduler0::BasicTaskScheduler0() :
  */
 BasicTaskScheduler0::~BasicTaskScheduler0() {
 	delete fHandlers;
+	delete fEventLoopStats;
 }
 
 TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
@@ -79,7 +109,7 @@ TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
 			(long) (microseconds % 1000000));
 	//delayQueueеһ
 	AlarmHandler* alarmHandler =
-			new AlarmHandler(proc, clientData, timeToDelay);
+			new AlarmHandler(*this, proc, clientData, timeToDelay);
 	//Delayqueue
 	fDelayQueue.addEntry(alarmHandler);
 	//delay taskΨһ־
@@ -172,6 +202,49 @@ void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId,
 	fTriggersAwaitingHandling |= eventTriggerId;
 }
 
+struct timeval const& BasicTaskScheduler0::timeNow() {
+	// Outside "SingleStep()" - e.g., during initialization, or after a (nested) event loop has returned - we
+	// don't know how stale our cached time is, so we read the clock again:
+	return fTimeNowIsCached ? fTimeNow : refreshTimeNow();
+}
+
+void BasicTaskScheduler0::enableEventLoopStats(Boolean enable) {
+	if (enable) {
+		if (fEventLoopStats == NULL) fEventLoopStats = new EventLoopStats;
+	} else {
+		delete fEventLoopStats; fEventLoopStats = NULL;
+	}
+}
+
+void BasicTaskScheduler0::callSocketHandler(BackgroundHandlerProc* handlerProc, void* clientData,
+		int resultConditionSet) {
+	if (fEventLoopStats == NULL) {
+		(*handlerProc)(clientData, resultConditionSet);
+		return;
+	}
+
+	struct timeval startTime = timeNow();
+	(*handlerProc)(clientData, resultConditionSet);
+	if (fEventLoopStats != NULL) { // the handler might have disabled the stats
+		fEventLoopStats->noteHandlerExecution(EventLoopStats::SOCKET_HANDLER, (void*)handlerProc, clientData,
+				startTime, refreshTimeNow());
+	}
+}
+
+void BasicTaskScheduler0::callTriggeredEventHandler(TaskFunc* handlerProc, void* clientData) {
+	if (fEventLoopStats == NULL) {
+		(*handlerProc)(clientData);
+		return;
+	}
+
+	struct timeval startTime = timeNow();
+	(*handlerProc)(clientData);
+	if (fEventLoopStats != NULL) { // the handler might have disabled the stats
+		fEventLoopStats->noteHandlerExecution(EventLoopStats::TRIGGERED_EVENT_HANDLER, (void*)handlerProc, clientData,
+				startTime, refreshTimeNow());
+	}
+}
+
 ////////// HandlerSet (etc.) implementation //////////
 
 HandlerDescriptor::HandlerDescriptor(HandlerDescriptor* nextHandler) :
@@ -19,6 +19,7 @@
 // Implementation
 
 #include "DelayQueue.hh"
+#include "UsageEnvironment.hh"
 #include "GroupsockHelper.hh"
 
 static const int MILLION = 1000000;
@@ -107,7 +108,7 @@ void DelayQueueEntry::handleTimeout() {
 ///// DelayQueue /////
 
 DelayQueue::DelayQueue() :
-	DelayQueueEntry(ETERNITY) {
+	DelayQueueEntry(ETERNITY), fClock(NULL) {
 	fLastSyncTime = TimeNow();
 }
 
@@ -210,7 +211,13 @@ DelayQueueEntry* DelayQueue::findEntryByToken(intptr_t tokenToFind) {
 
 void DelayQueue::synchronize() {
 	// First, figure out how much time has elapsed since the last sync:
-	EventTime timeNow = TimeNow();
+	EventTime timeNow;
+	if (fClock != NULL) {
+		struct timeval const& tvNow = fClock->timeNow();
+		timeNow = EventTime(tvNow.tv_sec, tvNow.tv_usec);
+	} else {
+		timeNow = TimeNow();
+	}
 	if (timeNow < fLastSyncTime) {
 		// The system clock has apparently gone back in time; reset our sync time and return:
 		fLastSyncTime = timeNow;
@@ -0,0 +1,265 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// Statistics about the health of an event loop (optionally gathered by "BasicTaskScheduler0")
+// Implementation
+
+#include "EventLoopStats.hh"
+#include "HashTable.hh"
+#include <stdio.h>
+#include <stdlib.h>
+
+////////// EventLoopHistogram //////////
+
+EventLoopHistogram::EventLoopHistogram() {
+  reset();
+}
+
+void EventLoopHistogram::reset() {
+  for (unsigned i = 0; i < EVENT_LOOP_HISTOGRAM_NUM_BUCKETS; ++i) fBuckets[i] = 0;
+  fCount = fMaxValue = 0;
+  fTotal = 0.0;
+}
+
+void EventLoopHistogram::note(unsigned value) {
+  unsigned bucketNum = 0;
+  for (unsigned v = value; v != 0; v >>= 1) ++bucketNum;
+
+  ++fBuckets[bucketNum];
+  ++fCount;
+  fTotal += value;
+  if (value > fMaxValue) fMaxValue = value;
+}
+
+void EventLoopHistogram::add(EventLoopHistogram const& other) {
+  for (unsigned i = 0; i < EVENT_LOOP_HISTOGRAM_NUM_BUCKETS; ++i) fBuckets[i] += other.fBuckets[i];
+  fCount += other.fCount;
+  fTotal += other.fTotal;
+  if (other.fMaxValue > fMaxValue) fMaxValue = other.fMaxValue;
+}
+
+unsigned EventLoopHistogram::percentile(double fraction) const {
+  if (fCount == 0) return 0;
+
+  double target = fraction*fCount;
+  unsigned cumulativeCount = 0;
+  for (unsigned i = 0; i < EVENT_LOOP_HISTOGRAM_NUM_BUCKETS; ++i) {
+    cumulativeCount += fBuckets[i];
+    if (cumulativeCount >= target) {
+      unsigned bucketLimit = i == 0 ? 0 : i == 32 ? 0xFFFFFFFF : (1u<<i) - 1;
+      return bucketLimit < fMaxValue ? bucketLimit : fMaxValue;
+    }
+  }
+  return fMaxValue;
+}
+
+void EventLoopHistogram::dump(UsageEnvironment& env, char const* title) const {
+  char buf[200];
+  sprintf(buf, "%s: count %u, average %.1f, maximum %u; 50%% <= %u, 90%% <= %u, 99%% <= %u\n",
+	  title, fCount, average(), fMaxValue, percentile(0.5), percentile(0.9), percentile(0.99));
+  env << buf;
+  if (fCount == 0) return;
+
+  env << "\t";
+  for (unsigned i = 0; i < EVENT_LOOP_HISTOGRAM_NUM_BUCKETS; ++i) {
+    if (fBuckets[i] == 0) continue;
+    if (i == 0) {
+      sprintf(buf, "[0]:%u ", fBuckets[i]);
+    } else {
+      sprintf(buf, "[%u-%u]:%u ", 1u<<(i-1), i == 32 ? 0xFFFFFFFF : (1u<<i) - 1, fBuckets[i]);
+    }
+    env << buf;
+  }
+  env << "\n";
+}
+
+
+////////// EventLoopStats //////////
+
+#define HANDLER_KEY_NUM_WORDS (3*sizeof (void*)/sizeof (unsigned))
+
+static void makeHandlerKey(void* key[3], EventLoopStats::HandlerType type, void* handlerProc, void* clientData) {
+  key[0] = (void*)(long)type; key[1] = handlerProc; key[2] = clientData;
+}
+
+static Boolean timeIsBefore(struct timeval const& a, struct timeval const& b) {
+  return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_usec < b.tv_usec);
+}
+
+EventLoopStats::EventLoopStats()
+  : fHandlerTable(HashTable::create(HANDLER_KEY_NUM_WORDS)),
+    fHandlers(NULL), fNumHandlers(0), fHandlersSize(0),
+    fNumExpiredHandlers(0), fNextExpiryCheckTime(0) {
+}
+
+EventLoopStats::~EventLoopStats() {
+  reset();
+  delete fHandlerTable;
+}
+
+void EventLoopStats::reset() {
+  fIterationTime.reset();
+  fTimerLateness.reset();
+  fNumReadySockets.reset();
+
+  while (fHandlerTable->RemoveNext() != NULL) {}
+  for (unsigned i = 0; i < fNumHandlers; ++i) delete fHandlers[i];
+  delete[] fHandlers; fHandlers = NULL;
+  fNumHandlers = fHandlersSize = 0;
+
+  fExpiredHandlersExecutionTime.reset();
+  fNumExpiredHandlers = 0;
+  fNextExpiryCheckTime = 0;
+}
+
+void EventLoopStats::noteHandlerExecution(HandlerType type, void* handlerProc, void* clientData,
+					  struct timeval const& startTime, struct timeval const& endTime) {
+  // Once in a while, stop listing the handlers that haven't run recently (e.g., because their "clientData" has gone):
+  if (startTime.tv_sec >= fNextExpiryCheckTime) {
+    if (fNextExpiryCheckTime != 0) {
+      struct timeval cutoffTime = startTime;
+      cutoffTime.tv_sec -= EVENT_LOOP_STATS_HANDLER_EXPIRY_SECONDS;
+      expireHandlersNotRunSince(cutoffTime);
+    }
+    fNextExpiryCheckTime = startTime.tv_sec + EVENT_LOOP_STATS_HANDLER_EXPIRY_SECONDS;
+  }
+
+  void* key[3];
+  makeHandlerKey(key, type, handlerProc, clientData);
+
+  HandlerStats* stats = (HandlerStats*)(fHandlerTable->Lookup((char const*)key));
+  if (stats == NULL) {
+    // This is the first time (recently) that we've seen this handler.  Create a record for it:
+    if (fNumHandlers == EVENT_LOOP_STATS_MAX_NUM_HANDLERS) makeRoomForNewHandler();
+    stats = new HandlerStats;
+    stats->type = type;
+    stats->handlerProc = handlerProc;
+    stats->clientData = clientData;
+    fHandlerTable->Add((char const*)key, stats);
+
+    if (fNumHandlers == fHandlersSize) {
+      fHandlersSize = fHandlersSize == 0 ? 32 : 2*fHandlersSize;
+      HandlerStats** newHandlers = new HandlerStats*[fHandlersSize];
+      for (unsigned i = 0; i < fNumHandlers; ++i) newHandlers[i] = fHandlers[i];
+      delete[] fHandlers; fHandlers = newHandlers;
+    }
+    fHandlers[fNumHandlers++] = stats;
+  }
+
+  stats->executionTime.note(uSecondsBetween(startTime, endTime));
+  stats->lastExecutionTime = startTime;
+}
+
+void EventLoopStats::expireHandlersNotRunSince(struct timeval const& cutoffTime) {
+  unsigned numKept = 0;
+  for (unsigned i = 0; i < fNumHandlers; ++i) {
+    HandlerStats* stats = fHandlers[i];
+    if (timeIsBefore(stats->lastExecutionTime, cutoffTime)) {
+      expireHandler(stats);
+    } else {
+      fHandlers[numKept++] = stats; // (this keeps the handlers in the order in which they were first seen)
+    }
+  }
+  fNumHandlers = numKept;
+}
+
+static int compareHandlersByLastExecutionTime(void const* a, void const* b) {
+  struct timeval const& timeA = (*(EventLoopStats::HandlerStats const**)a)->lastExecutionTime;
+  struct timeval const& timeB = (*(EventLoopStats::HandlerStats const**)b)->lastExecutionTime;
+
+  return timeIsBefore(timeA, timeB) ? -1 : timeIsBefore(timeB, timeA) ? 1 : 0;
+}
+
+void EventLoopStats::makeRoomForNewHandler() {
+  // Expire the half of our handlers that ran least recently:
+  HandlerStats** sortedHandlers = new HandlerStats*[fNumHandlers];
+  for (unsigned i = 0; i < fNumHandlers; ++i) sortedHandlers[i] = fHandlers[i];
+  qsort(sortedHandlers, fNumHandlers, sizeof (HandlerStats*), compareHandlersByLastExecutionTime);
+  struct timeval cutoffTime = sortedHandlers[fNumHandlers/2]->lastExecutionTime;
+  delete[] sortedHandlers;
+
+  expireHandlersNotRunSince(cutoffTime);
+  if (fNumHandlers == EVENT_LOOP_STATS_MAX_NUM_HANDLERS) {
+    // Most of our handlers last ran at the same (cached) time, so we couldn't choose between them that way.
+    // Instead, expire those that we first saw longest ago:
+    unsigned const numToExpire = fNumHandlers/2;
+    for (unsigned i = 0; i < numToExpire; ++i) expireHandler(fHandlers[i]);
+    for (unsigned i = numToExpire; i < fNumHandlers; ++i) fHandlers[i - numToExpire] = fHandlers[i];
+    fNumHandlers -= numToExpire;
+  }
+}
+
+void EventLoopStats::expireHandler(HandlerStats* stats) {
+  // Note: Our caller removes "stats" from "fHandlers".
+  fExpiredHandlersExecutionTime.add(stats->executionTime);
+  ++fNumExpiredHandlers;
+
+  void* key[3];
+  makeHandlerKey(key, stats->type, stats->handlerProc, stats->clientData);
+  fHandlerTable->Remove((char const*)key);
+  delete stats;
+}
+
+unsigned EventLoopStats::uSecondsBetween(struct timeval const& earlier, struct timeval const& later) {
+  long secsDiff = later.tv_sec - earlier.tv_sec;
+  long uSecsDiff = secsDiff*1000000 + (later.tv_usec - earlier.tv_usec);
+
+  return uSecsDiff <= 0 ? 0 : (unsigned)uSecsDiff;
+}
+
+static int compareHandlersByTotalTime(void const* a, void const* b) {
+  double totalA = (*(EventLoopStats::HandlerStats const**)a)->executionTime.total();
+  double totalB = (*(EventLoopStats::HandlerStats const**)b)->executionTime.total();
+
+  return totalA > totalB ? -1 : totalA < totalB ? 1 : 0;
+}
+
+void EventLoopStats::dump(UsageEnvironment& env, EventHandlerLabelFunc* labelFunc, void* labelClientData) const {
+  env << "Event loop statistics (times are in microseconds):\n";
+  fIterationTime.dump(env, "time spent handling events, per loop iteration");
+  fTimerLateness.dump(env, "lateness of delayed tasks");
+  fNumReadySockets.dump(env, "number of ready sockets, per \"select()\"");
+
+  if (fNumHandlers == 0 && fNumExpiredHandlers == 0) return;
+  env << "Handlers, by decreasing total execution time:\n";
+  HandlerStats const** sortedHandlers = new HandlerStats const*[fNumHandlers];
+  for (unsigned i = 0; i < fNumHandlers; ++i) sortedHandlers[i] = fHandlers[i];
+  qsort(sortedHandlers, fNumHandlers, sizeof (HandlerStats const*), compareHandlersByTotalTime);
+
+  static char const* typeName[] = { "socket handler", "triggered event handler", "delayed task" };
+  for (unsigned i = 0; i < fNumHandlers; ++i) {
+    HandlerStats const& stats = *sortedHandlers[i];
+    char const* label
+      = labelFunc == NULL ? NULL : (*labelFunc)(labelClientData, stats.clientData, stats.lastExecutionTime);
+
+    char buf[300];
+    sprintf(buf, "%s %p, for %p", typeName[stats.type], stats.handlerProc, stats.clientData);
+    env << buf;
+    if (label != NULL) env << " [" << label << "]";
+    sprintf(buf, ": total %.0f", stats.executionTime.total());
+    env << buf;
+    stats.executionTime.dump(env, "");
+  }
+  delete[] sortedHandlers;
+
+  if (fNumExpiredHandlers > 0) {
+    char buf[200];
+    sprintf(buf, "%u handler records that have expired (because they did not run recently): total %.0f",
+	    fNumExpiredHandlers, fExpiredHandlersExecutionTime.total());
+    env << buf;
+    fExpiredHandlersExecutionTime.dump(env, "");
+  }
+}
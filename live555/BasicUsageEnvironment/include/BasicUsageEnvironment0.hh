@@ -32,6 +32,10 @@
 #include "DelayQueue.hh"
 #endif
 
+#ifndef _EVENT_LOOP_STATS_HH
+#include "EventLoopStats.hh"
+#endif
+
 #define RESULT_MSG_BUFFER_MAX 1000
 
 // An abstract base class, useful for subclassing
@@ -89,10 +93,30 @@ public:
 	virtual void deleteEventTrigger(EventTriggerId eventTriggerId);
 	virtual void triggerEvent(EventTriggerId eventTriggerId, void* clientData =
 			NULL);
+	virtual struct timeval const& timeNow();
+	// While an event is being handled (from within "SingleStep()"), this returns the time that was read when
+	// "SingleStep()" began handling the event, rather than reading the clock again.
+
+	// Optional instrumentation of the event loop (disabled by default):
+	void enableEventLoopStats(Boolean enable = True);
+	EventLoopStats* eventLoopStats() const { return fEventLoopStats; } // NULL if not enabled
+	// Note: While enabled, the clock is read again after each handler returns (to measure its execution time).
 
 protected:
 	BasicTaskScheduler0();
 
+	void beginHandlingEvents() { refreshTimeNow(); fTimeNowIsCached = True; }
+	void endHandlingEvents() { fTimeNowIsCached = False; }
+	// Called by "SingleStep()" (in subclasses), so that - while events are being handled - "timeNow()" returns
+	// a cached time.
+
+	void callSocketHandler(BackgroundHandlerProc* handlerProc, void* clientData, int resultConditionSet);
+	void callTriggeredEventHandler(TaskFunc* handlerProc, void* clientData);
+	// Called by "SingleStep()" (in subclasses) to call handlers (recording their execution time, if enabled).
+
+private:
+	friend class AlarmHandler;
+
 protected:
 	// To implement delayed operations:
 	DelayQueue fDelayQueue;
@@ -106,6 +130,12 @@ protected:
 	TaskFunc* fTriggeredEventHandlers[MAX_NUM_EVENT_TRIGGERS];
 	void* fTriggeredEventClientDatas[MAX_NUM_EVENT_TRIGGERS];
 	unsigned fLastUsedTriggerNum; // in the range [0,MAX_NUM_EVENT_TRIGGERS)
+
+	// To implement "timeNow()":
+	Boolean fTimeNowIsCached;
+
+	// To implement (optional) event loop instrumentation:
+	EventLoopStats* fEventLoopStats;
 };
 
 #endif
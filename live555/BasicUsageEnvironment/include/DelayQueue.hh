@@ -157,11 +157,17 @@ private:
 
 ///// DelayQueue /////
 
+class TaskScheduler; // forward
+
 class DelayQueue: public DelayQueueEntry {
 public:
   DelayQueue();
   virtual ~DelayQueue();
 
+  void setClock(TaskScheduler* clock) { fClock = clock; }
+      // If set, we get the current time from "clock->timeNow()" (which may be cached), rather than by reading
+      // the clock ourself each time.
+
   void addEntry(DelayQueueEntry* newEntry); // returns a token for the entry
   void updateEntry(DelayQueueEntry* entry, DelayInterval newDelay);
   void updateEntry(intptr_t tokenToFind, DelayInterval newDelay);
@@ -177,6 +183,7 @@ private:
   void synchronize(); // bring the 'time remaining' fields up-to-date
 
   EventTime fLastSyncTime;
+  TaskScheduler* fClock;
 };
 
 #endif
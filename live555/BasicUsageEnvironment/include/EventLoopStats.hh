@@ -0,0 +1,141 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// Statistics about the health of an event loop (optionally gathered by "BasicTaskScheduler0")
+// C++ header
+
+#ifndef _EVENT_LOOP_STATS_HH
+#define _EVENT_LOOP_STATS_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+
+#define EVENT_LOOP_HISTOGRAM_NUM_BUCKETS 33
+
+// To bound the memory used by a long-running server (whose handlers' "clientData"s come and go), we keep separate statistics
+// for at most this many handlers, and only for handlers that have run recently.  The statistics of other handlers are merged:
+#define EVENT_LOOP_STATS_MAX_NUM_HANDLERS 1000
+#define EVENT_LOOP_STATS_HANDLER_EXPIRY_SECONDS 60
+
+// A histogram of non-negative integer values (e.g., times, in microseconds), with buckets of increasing
+// (power-of-2) size: Bucket 0 counts values of 0; bucket i (for i > 0) counts values in the range [2^(i-1), 2^i).
+
+class EventLoopHistogram {
+public:
+  EventLoopHistogram();
+
+  void reset();
+  void note(unsigned value);
+  void add(EventLoopHistogram const& other); // merges "other"'s values into ours
+
+  unsigned count() const { return fCount; }
+  unsigned maxValue() const { return fMaxValue; }
+  double total() const { return fTotal; }
+  double average() const { return fCount == 0 ? 0.0 : fTotal/fCount; }
+  unsigned bucketCount(unsigned bucketNum) const { return fBuckets[bucketNum]; }
+
+  unsigned percentile(double fraction) const;
+      // Returns an upper bound on the value that is not exceeded by "fraction" (0.0 to 1.0) of the noted values.
+      // (This is the upper limit of the bucket in which the percentile lies - or "maxValue()", if that's smaller.)
+
+  void dump(UsageEnvironment& env, char const* title) const;
+
+private:
+  unsigned fBuckets[EVENT_LOOP_HISTOGRAM_NUM_BUCKETS];
+  unsigned fCount;
+  unsigned fMaxValue;
+  double fTotal;
+};
+
+typedef char const* EventHandlerLabelFunc(void* labelClientData, void* handlerClientData,
+					  struct timeval const& lastExecutionTime);
+    // Returns a descriptive label (e.g., the name of a "Medium") for the object that a handler's "clientData"
+    // points to, or NULL if none is known.  (The "liveMedia" library provides "Medium::eventHandlerLabel()".)
+    // "lastExecutionTime" is when the handler last began running.  Because "handlerClientData" might since have been
+    // freed (and its address reused), a label should be returned only for an object that was created before then.
+
+class EventLoopStats {
+public:
+  EventLoopStats();
+  virtual ~EventLoopStats();
+
+  void reset();
+
+  // Statistics about the event loop as a whole:
+  EventLoopHistogram const& iterationTime() const { return fIterationTime; }
+      // the time (in microseconds) spent handling events in each iteration of the event loop
+      // (not including the time spent waiting - in "select()" - for events to occur)
+  EventLoopHistogram const& timerLateness() const { return fTimerLateness; }
+      // the time (in microseconds) after its due time that each delayed task was run
+  EventLoopHistogram const& numReadySockets() const { return fNumReadySockets; }
+      // the number of ready sockets reported by each "select()"
+
+  // Statistics about each separate handler (identified by its handler function, and its "clientData"):
+  enum HandlerType { SOCKET_HANDLER, TRIGGERED_EVENT_HANDLER, DELAYED_TASK };
+  class HandlerStats {
+  public:
+    HandlerType type;
+    void* handlerProc;
+    void* clientData;
+    EventLoopHistogram executionTime; // microseconds
+    struct timeval lastExecutionTime; // when the handler last began running
+  };
+
+  unsigned numHandlers() const { return fNumHandlers; }
+  HandlerStats const& handler(unsigned i) const { return *fHandlers[i]; } // in the order in which they were first seen
+
+  unsigned numExpiredHandlers() const { return fNumExpiredHandlers; }
+  EventLoopHistogram const& expiredHandlersExecutionTime() const { return fExpiredHandlersExecutionTime; }
+      // The merged statistics of handlers that are no longer listed separately, because they hadn't run for
+      // "EVENT_LOOP_STATS_HANDLER_EXPIRY_SECONDS" (or because they had run least recently, when there were
+      // "EVENT_LOOP_STATS_MAX_NUM_HANDLERS" handlers).  (If such a handler runs again, it's listed again.)
+
+  void dump(UsageEnvironment& env, EventHandlerLabelFunc* labelFunc = NULL, void* labelClientData = NULL) const;
+      // Outputs (to "env") a summary of all of these statistics.  Handlers are listed in decreasing order of
+      // their total execution time.  If "labelFunc" is non-NULL, it's used to describe each handler's "clientData".
+
+  // Used (by "BasicTaskScheduler0") to record the statistics:
+  void noteIterationTime(unsigned uSeconds) { fIterationTime.note(uSeconds); }
+  void noteTimerLateness(unsigned uSeconds) { fTimerLateness.note(uSeconds); }
+  void noteNumReadySockets(unsigned numReadySockets) { fNumReadySockets.note(numReadySockets); }
+  void noteHandlerExecution(HandlerType type, void* handlerProc, void* clientData,
+			    struct timeval const& startTime, struct timeval const& endTime);
+
+  static unsigned uSecondsBetween(struct timeval const& earlier, struct timeval const& later); // 0 if "later" < "earlier"
+
+private:
+  void expireHandlersNotRunSince(struct timeval const& cutoffTime);
+  void makeRoomForNewHandler();
+  void expireHandler(HandlerStats* stats);
+
+private:
+  EventLoopHistogram fIterationTime, fTimerLateness, fNumReadySockets;
+
+  HashTable* fHandlerTable; // maps {type, handlerProc, clientData} to a "HandlerStats*"
+  HandlerStats** fHandlers;
+  unsigned fNumHandlers, fHandlersSize;
+
+  EventLoopHistogram fExpiredHandlersExecutionTime;
+  unsigned fNumExpiredHandlers;
+  long fNextExpiryCheckTime; // seconds
+};
+
+#endif
@@ -18,6 +18,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "UsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "gettimeofday()"
 
 void UsageEnvironment::reclaim() {
   // We delete ourselves only if we have no remainining state:
@@ -39,6 +40,7 @@ void UsageEnvironment::internalError() {
 
 
 TaskScheduler::TaskScheduler() {
+  gettimeofday(&fTimeNow, NULL);
 }
 
 TaskScheduler::~TaskScheduler() {
@@ -51,6 +53,15 @@ void TaskScheduler::rescheduleDelayedTask(TaskToken& task,
   task = scheduleDelayedTask(microseconds, proc, clientData);
 }
 
+struct timeval const& TaskScheduler::timeNow() {
+  return refreshTimeNow();
+}
+
+struct timeval const& TaskScheduler::refreshTimeNow() {
+  gettimeofday(&fTimeNow, NULL);
+  return fTimeNow;
+}
+
 // By default, we handle 'should not occur'-type library errors by calling abort().  Subclasses can redefine this, if desired.
 void TaskScheduler::internalError() {
   abort();
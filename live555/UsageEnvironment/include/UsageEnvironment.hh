@@ -154,6 +154,15 @@ public:
       // The handler function is called with "clientData" as parameter.
       // Note: This function (unlike other library functions) may be called from an external thread - to signal an external event.
 
+  virtual struct timeval const& timeNow();
+      // Returns the current ('wall clock', i.e., "gettimeofday()") time.  A scheduler may cache this - reading the clock
+      // just once for each event that it handles - so that the many parts of the code that need the time while an event
+      // is being handled don't each have to read the clock.  (The default implementation doesn't cache; it just calls
+      // "refreshTimeNow()".)
+  virtual struct timeval const& refreshTimeNow();
+      // Reads the clock (updating any cached time), and returns the result.  Call this instead of "timeNow()" if you
+      // need a precise time - e.g., after doing a lot of work while handling a single event.
+
   // The following two functions are deprecated, and are provided for backwards-compatibility only:
   void turnOnBackgroundReadHandling(int socketNum, BackgroundHandlerProc* handlerProc, void* clientData) {
     setBackgroundHandling(socketNum, SOCKET_READABLE, handlerProc, clientData);
@@ -164,6 +173,8 @@ public:
 
 protected:
   TaskScheduler(); // abstract base class
+
+  struct timeval fTimeNow; // the time most recently read by "refreshTimeNow()"
 };
 
 #endif
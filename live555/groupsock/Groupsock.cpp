@@ -38,6 +38,10 @@ OutputSocket::OutputSocket(UsageEnvironment& env, Port port) :
 	Socket(env, port), fSourcePort(0), fLastSentTTL(0) {
 }
 
+OutputSocket::OutputSocket(UsageEnvironment& env, Socket const& socketToShare) :
+	Socket(env, socketToShare), fSourcePort(0), fLastSentTTL(0) {
+}
+
 OutputSocket::~OutputSocket() {
 }
 
@@ -159,6 +163,16 @@ Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
 		env << *this << ": created\n";
 }
 
+// Constructor for a unicast 'groupsock' that shares another's socket
+Groupsock::Groupsock(UsageEnvironment& env, Groupsock const& socketToShare) :
+	OutputSocket(env, socketToShare), deleteIfNoMembers(False), isSlave(False),
+			fIncomingGroupEId(socketToShare.groupAddress(),
+					socketToShare.port().num(), socketToShare.ttl()), fDests(
+					NULL), fTTL(socketToShare.ttl()) {
+	if (DebugLevel >= 2)
+		env << *this << ": created (sharing socket)\n";
+}
+
 Groupsock::~Groupsock() {
 	if (isSSM()) {
 		if (!socketLeaveGroupSSM(env(), socketNum(), groupAddress().s_addr,
@@ -266,6 +280,26 @@ void Groupsock::removeAllDestinations() {
 	fDests = NULL;
 }
 
+Boolean Groupsock::hasDestination(struct in_addr const& addr,
+		Port const& port) const {
+	for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
+		if (addr.s_addr == dests->fGroupEId.groupAddress().s_addr && port.num()
+				== dests->fPort.num()) {
+			return True;
+		}
+	}
+
+	return False;
+}
+
+Boolean Groupsock::hasDestinationAddress(struct in_addr const& addr) const {
+	for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
+		if (addr.s_addr == dests->fGroupEId.groupAddress().s_addr) return True;
+	}
+
+	return False;
+}
+
 void Groupsock::multicastSendOnly() {
 	// We disable this code for now, because - on some systems - leaving the multicast group seems to cause sent packets
 	// to not be received by other applications (at least, on the same host).
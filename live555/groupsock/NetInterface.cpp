@@ -86,12 +86,18 @@ DirectedNetInterface* DirectedNetInterfaceSet::Iterator::next() {
 int Socket::DebugLevel = 1; // default value
 
 Socket::Socket(UsageEnvironment& env, Port port)
-  : fEnv(DefaultUsageEnvironment != NULL ? *DefaultUsageEnvironment : env), fPort(port) {
+  : fSocketIsShared(False),
+    fEnv(DefaultUsageEnvironment != NULL ? *DefaultUsageEnvironment : env), fPort(port) {
   fSocketNum = setupDatagramSocket(fEnv, port);
 }
 
+Socket::Socket(UsageEnvironment& env, Socket const& socketToShare)
+  : fSocketNum(socketToShare.socketNum()), fSocketIsShared(True),
+    fEnv(DefaultUsageEnvironment != NULL ? *DefaultUsageEnvironment : env), fPort(socketToShare.port()) {
+}
+
 Socket::~Socket() {
-  closeSocket(fSocketNum);
+  if (!fSocketIsShared) closeSocket(fSocketNum);
 }
 
 Boolean Socket::changePort(Port newPort) {
@@ -46,6 +46,7 @@ public:
 
 protected:
   OutputSocket(UsageEnvironment& env, Port port);
+  OutputSocket(UsageEnvironment& env, Socket const& socketToShare);
 
   portNumBits sourcePortNum() const {return fSourcePort.num();}
 
@@ -84,6 +85,10 @@ public:
 	    struct in_addr const& sourceFilterAddr,
 	    Port port);
       // used for a 'source-specific multicast' group
+  Groupsock(UsageEnvironment& env, Groupsock const& socketToShare);
+      // used for a unicast 'groupsock' that sends (and receives) through the same socket
+      // as "socketToShare" (which must not be deleted before us), but that has its own
+      // set of destinations.  (This lets many streams use just one socket.)
   virtual ~Groupsock();
 
   void changeDestinationParameters(struct in_addr const& newDestAddr,
@@ -100,6 +105,8 @@ public:
   void addDestination(struct in_addr const& addr, Port const& port);
   void removeDestination(struct in_addr const& addr, Port const& port);
   void removeAllDestinations();
+  Boolean hasDestination(struct in_addr const& addr, Port const& port) const;
+  Boolean hasDestinationAddress(struct in_addr const& addr) const; // with any port
 
   struct in_addr const& groupAddress() const {
     return fIncomingGroupEId.groupAddress();
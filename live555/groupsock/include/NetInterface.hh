@@ -87,6 +87,8 @@ public:
       // Returns False on error; resultData == NULL if data ignored
 
   int socketNum() const { return fSocketNum; }
+  Boolean socketIsShared() const { return fSocketIsShared; }
+      // True iff we use (but don't own) the socket of some other "Socket"
 
   Port port() const {
     return fPort;
@@ -98,11 +100,14 @@ public:
 
 protected:
   Socket(UsageEnvironment& env, Port port); // virtual base class
+  Socket(UsageEnvironment& env, Socket const& socketToShare);
+      // uses the same socket (and port) as "socketToShare", which must not be deleted before us
 
   Boolean changePort(Port newPort); // will also cause socketNum() to change
 
 private:
   int fSocketNum;
+  Boolean fSocketIsShared;
   UsageEnvironment& fEnv;
   Port fPort;
 };
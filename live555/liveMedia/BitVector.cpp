@@ -92,6 +92,7 @@ unsigned BitVector::getBits(unsigned numBits) {
 
   if (numBits > fTotNumBits - fCurBitIndex) {
     overflowingBits = numBits - (fTotNumBits - fCurBitIndex);
+    if (overflowingBits == numBits) return 0; // all bits overflow (and shifting by MAX_LENGTH, below, would be undefined)
   }
 
   shiftBits(tmpBuf, 0, /* to */
@@ -151,7 +151,7 @@ void ByteStreamFileSource::doReadFromFile() {
   if (fPlayTimePerFrame > 0 && fPreferredFrameSize > 0) {
     if (fPresentationTime.tv_sec == 0 && fPresentationTime.tv_usec == 0) {
       // This is the first frame, so use the current time:
-      gettimeofday(&fPresentationTime, NULL);
+      fPresentationTime = envir().taskScheduler().timeNow();
     } else {
       // Increment by the play time of the previous data:
       unsigned uSeconds	= fPresentationTime.tv_usec + fLastPlayTime;
@@ -165,7 +165,7 @@ void ByteStreamFileSource::doReadFromFile() {
   } else {
     // We don't know a specific play time duration for this data,
     // so just record the current time as being the 'presentation time':
-    gettimeofday(&fPresentationTime, NULL);
+    fPresentationTime = envir().taskScheduler().timeNow();
   }
 
   // Inform the reader that he has data:
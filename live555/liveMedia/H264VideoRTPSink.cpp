@@ -127,8 +127,7 @@ Boolean H264VideoRTPSink::continuePlaying()
     if (fOurFragmenter == NULL)
     {
         //һ࣬RTP 
-        fOurFragmenter = new H264FUAFragmenter(envir(), fSource, OutPacketBuffer::maxSize,
-                                               ourMaxPacketSize() - 12/*RTP hdr size*/);
+        fOurFragmenter = new H264FUAFragmenter(envir(), fSource, ourMaxPacketSize() - 12/*RTP hdr size*/);
     }
     else
     {
@@ -140,21 +139,39 @@ Boolean H264VideoRTPSink::continuePlaying()
     return MultiFramedRTPSink::continuePlaying();
 }
 
-void H264VideoRTPSink::doSpecialFrameHandling(unsigned /*fragmentationOffset*/,
+unsigned H264VideoRTPSink::specialHeaderSize() const
+{
+    // The first (or only) fragment of a NAL unit already begins with its FU indicator and FU header (if needed).
+    // Each subsequent fragment gets a 2-byte special header: its FU indicator and FU header.
+    return (curFragmentationOffset() == 0) ? 0 : 2;
+}
+
+void H264VideoRTPSink::doSpecialFrameHandling(unsigned fragmentationOffset,
         unsigned char* /*frameStart*/,
         unsigned /*numBytesInFrame*/,
         struct timeval framePresentationTime,
-        unsigned /*numRemainingBytes*/)
+        unsigned numRemainingBytes)
 {
+    if (fragmentationOffset > 0 && fOurFragmenter != NULL)
+    {
+        // This is a subsequent fragment of a FU-A NAL unit.  Fill in its FU indicator and FU header
+        // (with the E bit set iff this is the last fragment):
+        u_int8_t fuHeaderBytes[2];
+        fuHeaderBytes[0] = fOurFragmenter->fuIndicator();
+        fuHeaderBytes[1] = fOurFragmenter->fuHeader();
+        if (numRemainingBytes == 0) fuHeaderBytes[1] |= 0x40;
+        setSpecialHeaderBytes(fuHeaderBytes, 2);
+    }
+
     // Set the RTP 'M' (marker) bit iff
-    // 1/ The most recently delivered fragment was the end of (or the only fragment of) an NAL unit, and
+    // 1/ This fragment was the end of (or the only fragment of) an NAL unit, and
     // 2/ This NAL unit was the last NAL unit of an 'access unit' (i.e. video frame).
     if (fOurFragmenter != NULL)
     {
         H264VideoStreamFramer* framerSource
             = (H264VideoStreamFramer*)(fOurFragmenter->inputSource());
         // This relies on our fragmenter's source being a "H264VideoStreamFramer".
-        if (fOurFragmenter->lastFragmentCompletedNALUnit()
+        if (numRemainingBytes == 0
                 && framerSource != NULL && framerSource->pictureEndMarker())
         {
             setMarkerBit();
@@ -231,128 +248,32 @@ char const* H264VideoRTPSink::auxSDPLine()
 
 H264FUAFragmenter::H264FUAFragmenter(UsageEnvironment& env,
                                      FramedSource* inputSource,
-                                     unsigned inputBufferMax,
                                      unsigned maxOutputPacketSize)
     : FramedFilter(env, inputSource),
-      fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize),
-      fNumValidDataBytes(1), fCurDataOffset(1), fSaveNumTruncatedBytes(0),
-      fLastFragmentCompletedNALUnit(True)
+      fMaxOutputPacketSize(maxOutputPacketSize), fFUIndicator(0), fFUHeader(0)
 {
-    fInputBuffer = new unsigned char[fInputBufferSize];
 }
 
 H264FUAFragmenter::~H264FUAFragmenter()
 {
-    delete[] fInputBuffer;
     detachInputSource(); // so that the subsequent ~FramedFilter() doesn't delete it
 }
 
 void H264FUAFragmenter::doGetNextFrame()
 {
-	/*
-	 *	H264FUAFragmenter::doGetNextFrameһִʱִ1Ҫ
-	 *	MPEGVideoStreamFrame::doGetNextFrameȡһµframe
-	 */
-    if (fNumValidDataBytes == 1)/*ʼΪ1 afterGettingFrame1 */
+    if (fMaxSize < 2)   // shouldn't happen
     {
-        //ȡһµframe
-        // We have no NAL unit data currently in the buffer.  Read a new one:
-        fInputSource->getNextFrame(&fInputBuffer[1], fInputBufferSize - 1,
-                                   afterGettingFrame, this,
-                                   FramedSource::handleClosure, this);
+        envir() << "H264FUAFragmenter::doGetNextFrame(): fMaxSize ("
+                << fMaxSize << ") is smaller than expected\n";
+        handleClosure(this);
+        return;
     }
-    else
-    {
-        //bufferѾNALUˣҪ
-        //1. һµNALU㹻СͶݸRTP sink.
-        //2. һµNALU,ǱRTP sink ҪİˣͶݵһƬΪһFU-A packet,
-        //    һͷӽ
-        //3. NALUݣͶһƬΪһFU-A socket,2ֽ
-
-        // We have NAL unit data in the buffer.  There are three cases to consider:
-        // 1. There is a new NAL unit in the buffer, and it's small enough to deliver
-        //    to the RTP sink (as is).
-        // 2. There is a new NAL unit in the buffer, but it's too large to deliver to
-        //    the RTP sink in its entirety.  Deliver the first fragment of this data,
-        //    as a FU-A packet, with one extra preceding header byte.
-        // 3. There is a NAL unit in the buffer, and we've already delivered some
-        //    fragment(s) of this.  Deliver the next fragment of this data,
-        //    as a FU-A packet, with two extra preceding header bytes.
-
-        if (fMaxSize < fMaxOutputPacketSize)   // shouldn't happen
-        {
-            envir() << "H264FUAFragmenter::doGetNextFrame(): fMaxSize ("
-                    << fMaxSize << ") is smaller than expected\n";
-        }
-        else
-        {
-            fMaxSize = fMaxOutputPacketSize;
-        }
-
-        fLastFragmentCompletedNALUnit = True; // by default
-        if (fCurDataOffset == 1)   // case 1 or 2
-        {
-            if (fNumValidDataBytes - 1 <= fMaxSize)   // case 1
-            {
-                //1NALU
-                memmove(fTo, &fInputBuffer[1], fNumValidDataBytes - 1);
-                fFrameSize = fNumValidDataBytes - 1;
-                fCurDataOffset = fNumValidDataBytes;
-            }
-            else     // case 2
-            {
-                //2 NALUĵһƬע⣬FUָʾFUͷӽ(with S bit)ǰ
-                //ѾڵNAL,ͷӽΪFU ͷӽ
-                // We need to send the NAL unit data as FU-A packets.  Deliver the first
-                // packet now.  Note that we add FU indicator and FU header bytes to the front
-                // of the packet (reusing the existing NAL header byte for the FU header).
-                fInputBuffer[0] = (fInputBuffer[1] & 0xE0) | 28; // FU indicator
-                fInputBuffer[1] = 0x80 | (fInputBuffer[1] & 0x1F); // FU header (with S bit)
-                memmove(fTo, fInputBuffer, fMaxSize);
-                fFrameSize = fMaxSize;
-                fCurDataOffset += fMaxSize - 1;
-                fLastFragmentCompletedNALUnit = False;
-            }
-        }
-        else     // case 3
-        {
-            //3ǵ1ƬҪFUָʾFUͷ(˵1 
-            //ƬеֽڣҪ5λ ڴһƬE λ)
-            // We are sending this NAL unit data as FU-A packets.  We've already sent the
-            // first packet (fragment).  Now, send the next fragment.  Note that we add
-            // FU indicator and FU header bytes to the front.  (We reuse these bytes that
-            // we already sent for the first fragment, but clear the S bit, and add the E
-            // bit if this is the last fragment.)
-            fInputBuffer[fCurDataOffset-2] = fInputBuffer[0]; // FU indicator
-            fInputBuffer[fCurDataOffset-1] = fInputBuffer[1]&~0x80; // FU header (no S bit)
-            unsigned numBytesToSend = 2 + fNumValidDataBytes - fCurDataOffset;
-            if (numBytesToSend > fMaxSize)
-            {
-                // We can't send all of the remaining data this time:
-                numBytesToSend = fMaxSize;
-                fLastFragmentCompletedNALUnit = False;
-            }
-            else
-            {
-                //һƬҪFU ͷE ־λ
-                // This is the last fragment:
-                fInputBuffer[fCurDataOffset-1] |= 0x40; // set the E bit in the FU header
-                fNumTruncatedBytes = fSaveNumTruncatedBytes;
-            }
-            memmove(fTo, &fInputBuffer[fCurDataOffset-2], numBytesToSend);
-            fFrameSize = numBytesToSend;
-            fCurDataOffset += numBytesToSend - 2;
-        }
-
-        if (fCurDataOffset >= fNumValidDataBytes)
-        {
-            // We're done with this data.  Reset the pointers for receiving new data:
-            fNumValidDataBytes = fCurDataOffset = 1;
-        }
 
-        // Complete delivery to the client:
-        FramedSource::afterGetting(this);
-    }
+    // Read the next NAL unit directly into our client's buffer (i.e., the RTP sink's output buffer), leaving
+    // one byte at the front, in case we need to add a FU indicator:
+    fInputSource->getNextFrame(fTo + 1, fMaxSize - 1,
+                               afterGettingFrame, this,
+                               FramedSource::handleClosure, this);
 }
 
 void H264FUAFragmenter::afterGettingFrame(void* clientData, unsigned frameSize,
@@ -365,25 +286,32 @@ void H264FUAFragmenter::afterGettingFrame(void* clientData, unsigned frameSize,
                                    durationInMicroseconds);
 }
 
-/*
- *	Ĵȼ¼ݵԱУfNumValidDataBytesҪʾȡframe+1.
- *	ȻһεH264FUAFragmenter::doGetNextFrame(),ｫH264FUAFragmenter::doGetNextFrame
- *	еĵڶ֧ѭúװԺˡ
- *	H264FUAFragmenter::doGetNextFrameеڶ֧УH264RTPƬ⣬ﰴRFC3984
- *	RTPװġӦע⵽ƪ¡RTPĴ뷢͡УҲ˷ƬĴ(MultiFramedRTPSink
- *	::packFrame)ֱӰMTUĳ֡ΪʲôH264ҪԶһRTPı׼أʱҲ
- *	Ǻ
- */
 void H264FUAFragmenter::afterGettingFrame1(unsigned frameSize,
         unsigned numTruncatedBytes,
         struct timeval presentationTime,
         unsigned durationInMicroseconds)
 {
-    fNumValidDataBytes += frameSize;
-    fSaveNumTruncatedBytes = numTruncatedBytes;
+    if (frameSize <= fMaxOutputPacketSize)
+    {
+        // Common case: The NAL unit will fit in a single RTP packet.  Move it back into place:
+        memmove(fTo, fTo + 1, frameSize);
+        fFrameSize = frameSize;
+    }
+    else
+    {
+        // We need to send the NAL unit data as FU-A packets.  Turn the NAL header byte into the FU header
+        // (with the S bit), and add the FU indicator in front of it.  Our RTP sink will then fragment this data,
+        // adding FU indicator and FU header bytes (without the S bit) to the front of each subsequent fragment.
+        fFUIndicator = (fTo[1] & 0xE0) | 28;
+        fFUHeader = fTo[1] & 0x1F;
+        fTo[0] = fFUIndicator;
+        fTo[1] = 0x80 | fFUHeader;
+        fFrameSize = frameSize + 1;
+    }
+    fNumTruncatedBytes = numTruncatedBytes;
     fPresentationTime = presentationTime;
     fDurationInMicroseconds = durationInMicroseconds;
 
-    // Deliver data to the client:
-    doGetNextFrame();
+    // Complete delivery to the client:
+    FramedSource::afterGetting(this);
 }
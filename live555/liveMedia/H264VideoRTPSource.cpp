@@ -56,7 +56,8 @@ H264VideoRTPSource
 		     unsigned char rtpPayloadFormat,
 		     unsigned rtpTimestampFrequency)
   : MultiFramedRTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency,
-			 new H264BufferedPacketFactory) {
+			 new H264BufferedPacketFactory),
+    fDeliverAccessUnits(False), fAccessUnitIsInProgress(False), fCurAccessUnitRTPTimestamp(0) {
 }
 
 H264VideoRTPSource::~H264VideoRTPSource() {
@@ -74,6 +75,7 @@ Boolean H264VideoRTPSource
 
   // Check if the type field is 28 (FU-A) or 29 (FU-B)
   fCurPacketNALUnitType = (headerStart[0]&0x1F);
+  fCurPacketBeginsNALUnit = True;
   switch (fCurPacketNALUnitType) {
   case 24: { // STAP-A
     expectedHeaderSize = 1; // discard the type byte
@@ -100,6 +102,7 @@ Boolean H264VideoRTPSource
       expectedHeaderSize = 2;
       if (packetSize < expectedHeaderSize) return False;
       fCurrentPacketBeginsFrame = False;
+      fCurPacketBeginsNALUnit = False;
     }
     fCurrentPacketCompletesFrame = (endBit != 0);
     break;
@@ -111,6 +114,15 @@ Boolean H264VideoRTPSource
   }
   }
 
+  if (fDeliverAccessUnits) {
+    // A 'frame' is an access unit instead.  A packet begins one if it begins a NAL unit, and has a new timestamp
+    // (or follows the end of the previous access unit).  Whether it ends one is decided (for each NAL unit that we
+    // deliver from it) in "H264BufferedPacket::nextEnclosedFrameSize()":
+    fCurrentPacketBeginsFrame = fCurPacketBeginsNALUnit
+      && (!fAccessUnitIsInProgress || packet->rtpTimestamp() != fCurAccessUnitRTPTimestamp);
+    fCurrentPacketCompletesFrame = False;
+  }
+
   resultSpecialHeaderSize = expectedHeaderSize;
   return True;
 }
@@ -163,9 +175,20 @@ H264BufferedPacket::~H264BufferedPacket() {
 
 unsigned H264BufferedPacket
 ::nextEnclosedFrameSize(unsigned char*& framePtr, unsigned dataSize) {
+  H264VideoRTPSource& src = fOurSource;
+  if (src.fDeliverAccessUnits && src.fAccessUnitIsInProgress
+      && rtpTimestamp() != src.fCurAccessUnitRTPTimestamp && src.fFrameSize > 0) {
+    // The previous access unit ended without a packet with the 'M' bit set.  Deliver it now (using none of this
+    // packet's data yet; we'll return to this packet for the next access unit):
+    src.fAccessUnitIsInProgress = False;
+    src.fCurrentPacketCompletesFrame = True;
+    return 0;
+  }
+
+  unsigned char* const origFramePtr = framePtr;
   unsigned resultNALUSize = 0; // if an error occurs
 
-  switch (fOurSource.fCurPacketNALUnitType) {
+  switch (src.fCurPacketNALUnitType) {
   case 24: case 25: { // STAP-A or STAP-B
     // The first two bytes are NALU size:
     if (dataSize < 2) break;
@@ -189,11 +212,30 @@ unsigned H264BufferedPacket
   }
   default: {
     // Common case: We use the entire packet data:
-    return dataSize;
+    resultNALUSize = dataSize;
+    break;
+  }
   }
+  unsigned const maxNALUSize = dataSize - (framePtr - origFramePtr);
+  if (resultNALUSize > maxNALUSize) resultNALUSize = maxNALUSize;
+  if (!src.fDeliverAccessUnits) return resultNALUSize;
+
+  // We're delivering access units:
+  if (src.fCurPacketBeginsNALUnit && resultNALUSize > 0) {
+    // Precede the NAL unit with a start code.  We write this directly in front of the NAL unit (so that it gets copied
+    // along with it), over data that's no longer needed: the RTP header (or FU indicator), a STAP NAL unit size, or
+    // the end of the previous NAL unit in this packet (which has already been delivered):
+    framePtr -= 4;
+    framePtr[0] = 0; framePtr[1] = 0; framePtr[2] = 0; framePtr[3] = 1;
+    resultNALUSize += 4;
   }
 
-  return (resultNALUSize <= dataSize) ? resultNALUSize : dataSize;
+  // This is the last data in the access unit if it's the last data in a packet that has the 'M' bit set:
+  src.fCurrentPacketCompletesFrame = framePtr + resultNALUSize >= origFramePtr + dataSize && rtpMarkerBit();
+  src.fAccessUnitIsInProgress = !src.fCurrentPacketCompletesFrame;
+  src.fCurAccessUnitRTPTimestamp = rtpTimestamp();
+
+  return resultNALUSize;
 }
 
 BufferedPacket* H264BufferedPacketFactory
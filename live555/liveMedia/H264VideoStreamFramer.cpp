@@ -20,7 +20,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "H264VideoStreamFramer.hh"
 #include "MPEGVideoStreamParser.hh"
-#include "BitVector.hh"
+#include "BitReader.hh"
+#include "NALUnitEmulationPrevention.hh"
 #include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
 
 ////////// H264VideoStreamParser definition //////////
@@ -44,10 +45,10 @@ private:
     void removeEmulationBytes(u_int8_t* nalUnitCopy, unsigned maxSize, unsigned& nalUnitCopySize);
 
     void analyze_seq_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale, unsigned& fixed_frame_rate_flag);
-    void analyze_vui_parameters(BitVector& bv,
+    void analyze_vui_parameters(BitReader& bv,
                                 unsigned& num_units_in_tick, unsigned& time_scale, unsigned& fixed_frame_rate_flag);
 #ifdef DO_FULL_SPS_PARSING
-    void analyze_hrd_parameters(BitVector& bv);
+    void analyze_hrd_parameters(BitReader& bv);
 #endif
     void analyze_sei_data();
     void analyze_slice_header(u_int8_t* start, u_int8_t* end, u_int8_t nal_unit_type,
@@ -154,21 +155,7 @@ H264VideoStreamParser::~H264VideoStreamParser()
 void H264VideoStreamParser::removeEmulationBytes(u_int8_t* nalUnitCopy, unsigned maxSize, unsigned& nalUnitCopySize)
 {
     u_int8_t* nalUnitOrig = fStartOfFrame + fOutputStartCodeSize;
-    unsigned const NumBytesInNALunit = fTo - nalUnitOrig;
-    nalUnitCopySize = 0;
-    if (NumBytesInNALunit > maxSize) return;
-    for (unsigned i = 0; i < NumBytesInNALunit; ++i)
-    {
-        if (i+2 < NumBytesInNALunit && nalUnitOrig[i] == 0 && nalUnitOrig[i+1] == 0 && nalUnitOrig[i+2] == 3)
-        {
-            nalUnitCopy[nalUnitCopySize++] = nalUnitOrig[i++];
-            nalUnitCopy[nalUnitCopySize++] = nalUnitOrig[i++];
-        }
-        else
-        {
-            nalUnitCopy[nalUnitCopySize++] = nalUnitOrig[i];
-        }
-    }
+    nalUnitCopySize = removeEmulationPreventionBytes(nalUnitCopy, maxSize, nalUnitOrig, fTo - nalUnitOrig);
 }
 
 #ifdef DEBUG
@@ -235,7 +222,7 @@ public:
 #endif
 
 #ifdef DO_FULL_SPS_PARSING
-void H264VideoStreamParser::analyze_hrd_parameters(BitVector& bv)
+void H264VideoStreamParser::analyze_hrd_parameters(BitReader& bv)
 {
     DEBUG_STR("BEGIN hrd_parameters");
     unsigned cpb_cnt_minus1 = bv.get_expGolomb();
@@ -267,7 +254,7 @@ void H264VideoStreamParser::analyze_hrd_parameters(BitVector& bv)
 #endif
 
 void H264VideoStreamParser
-::analyze_vui_parameters(BitVector& bv,
+::analyze_vui_parameters(BitReader& bv,
                          unsigned& num_units_in_tick, unsigned& time_scale, unsigned& fixed_frame_rate_flag)
 {
     DEBUG_STR("BEGIN vui_parameters");
@@ -369,7 +356,7 @@ void H264VideoStreamParser
     unsigned spsSize;
     removeEmulationBytes(sps, sizeof sps, spsSize);
 
-    BitVector bv(sps, 0, 8*spsSize);
+    BitReader bv(sps, 0, 8*spsSize);
 
     bv.skipBits(8); // forbidden_zero_bit; nal_ref_idc; nal_unit_type
     unsigned profile_idc = bv.getBits(8);
@@ -544,6 +531,10 @@ char const* sei_payloadType_description[MAX_SEI_PAYLOAD_TYPE_DESCRIPTION+1] =
 
 void H264VideoStreamParser::analyze_sei_data()
 {
+#ifdef DEBUG
+    // We currently only report the SEI payload types (which are byte-aligned), so, unless we're debugging, there's no point in
+    // copying the NAL unit data (which can be large) just to walk over it:
+
     // Begin by making a copy of the NAL unit data, removing any 'emulation prevention' bytes:
     u_int8_t sei[SEI_MAX_SIZE];
     unsigned seiSize;
@@ -568,25 +559,29 @@ void H264VideoStreamParser::analyze_sei_data()
         while (sei[j++] == 255 && j < seiSize);
         if (j >= seiSize) break;
 
-#ifdef DEBUG
         unsigned descriptionNum = payloadType <= MAX_SEI_PAYLOAD_TYPE_DESCRIPTION ? payloadType : MAX_SEI_PAYLOAD_TYPE_DESCRIPTION;
         fprintf(stderr, "\tpayloadType %d (\"%s\"); payloadSize %d\n", payloadType, sei_payloadType_description[descriptionNum], payloadSize);
-#endif
         j += payloadSize;
     }
+#endif
 }
 
+#define SLICE_HEADER_MAX_SIZE 32 // more than enough for the "slice_header" fields that we parse
+
 void H264VideoStreamParser
 ::analyze_slice_header(u_int8_t* start, u_int8_t* end, u_int8_t nal_unit_type,
                        unsigned &frame_num, unsigned &pic_parameter_set_id, unsigned& idr_pic_id,
                        Boolean& field_pic_flag, Boolean& bottom_field_flag)
 {
-    BitVector bv(start, 0, 8*(end-start));
+    // Begin by making a copy of (the start of) the NAL unit data, removing any 'emulation prevention' bytes:
+    u_int8_t header[SLICE_HEADER_MAX_SIZE];
+    unsigned headerSize = removeEmulationPreventionBytes(header, sizeof header, start, end - start);
+
+    BitReader bv(header, 0, 8*headerSize);
 
     // Some of the result parameters might not be present in the header; set them to default values:
     field_pic_flag = bottom_field_flag = 0;
 
-    // Note: We assume that there aren't any 'emulation prevention' bytes here to worry about...
     bv.skipBits(8); // forbidden_zero_bit; nal_ref_idc; nal_unit_type
     unsigned first_mb_in_slice = bv.get_expGolomb();
     DEBUG_PRINT(first_mb_in_slice);
@@ -709,11 +704,18 @@ unsigned H264VideoStreamParser::parse()
                 // We save at least some of "next4Bytes".
                 if ((unsigned)(next4Bytes&0xFF) > 1)
                 {
-                    //һοԱ4ֽڣҪһһֽڶԱȣǵ˽β
-					// Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it:
-                    save4Bytes(next4Bytes);      
+                    // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it,
+                    // and then search (in bulk) for the next 0x000001, saving all of the data that precedes it.
+                    // (If that 0x000001 is preceded by 0x00 - i.e., is a 0x00000001 - then we leave that 0x00 unsaved for now.)
+                    save4Bytes(next4Bytes);
                     skipBytes(4);
-                } 
+                    setParseState(); // ensures forward progress
+
+                    Boolean foundStartCode;
+                    unsigned numBytesToSave = scanForStartCode(foundStartCode);
+                    if (foundStartCode && numBytesToSave > 0) --numBytesToSave;
+                    saveBytes(numBytesToSave);
+                }
                 else
                 {
                     // Save the first byte, and continue testing the rest:
@@ -0,0 +1,117 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that creates new, unicast, "RTPSink"s
+// on demand, from an H265 video track within a Matroska file.
+// Implementation
+
+#include "H265VideoMatroskaFileServerMediaSubsession.hh"
+#include "H265VideoStreamDiscreteFramer.hh"
+#include "MatroskaDemuxedTrack.hh"
+
+H265VideoMatroskaFileServerMediaSubsession* H265VideoMatroskaFileServerMediaSubsession
+::createNew(MatroskaFileServerDemux& demux, unsigned trackNumber) {
+  return new H265VideoMatroskaFileServerMediaSubsession(demux, trackNumber);
+}
+
+#define checkPtr if (ptr >= limit) return;
+#define numBytesRemaining (unsigned)(limit - ptr)
+
+H265VideoMatroskaFileServerMediaSubsession
+::H265VideoMatroskaFileServerMediaSubsession(MatroskaFileServerDemux& demux, unsigned trackNumber)
+  : H265VideoFileServerMediaSubsession(demux.envir(), demux.fileName(), False),
+    fOurDemux(demux), fTrackNumber(trackNumber),
+    fVPSSize(0), fVPS(NULL), fSPSSize(0), fSPS(NULL), fPPSSize(0), fPPS(NULL) {
+  // Use our track's 'Codec Private' data (a "HEVCDecoderConfigurationRecord"): Byte 21 contains the size of NAL unit
+  // lengths, and bytes 22 and beyond contain arrays of NAL units (including VPS, SPS and PPSs):
+  MatroskaTrack* track = fOurDemux.lookup(fTrackNumber);
+  if (track->codecPrivateSize >= 22) track->subframeSizeSize = ((track->codecPrivate[21])&0x3) + 1;
+  if (track->codecPrivateSize < 23) return;
+
+  u_int8_t* ptr = &track->codecPrivate[22];
+  u_int8_t* limit = &track->codecPrivate[track->codecPrivateSize];
+
+  // Extract, from these arrays, one VPS NAL unit, one SPS NAL unit, and one PPS NAL unit.
+  // (I hope one is all we need of each.)
+  unsigned numOfArrays = *ptr++; checkPtr;
+  for (unsigned j = 0; j < numOfArrays; ++j) {
+    u_int8_t nal_unit_type = (*ptr++)&0x3F; checkPtr;
+    unsigned numNalus = (*ptr++)<<8; checkPtr;
+    numNalus |= *ptr++; checkPtr;
+
+    for (unsigned i = 0; i < numNalus; ++i) {
+      unsigned nalUnitLength = (*ptr++)<<8; checkPtr;
+      nalUnitLength |= *ptr++;
+      if (nalUnitLength > numBytesRemaining) return;
+
+      if (i == 0) { // save the first one (of each type)
+	if (nal_unit_type == 32/*VPS*/ && fVPS == NULL) {
+	  fVPSSize = nalUnitLength;
+	  fVPS = new u_int8_t[nalUnitLength];
+	  memmove(fVPS, ptr, nalUnitLength);
+	} else if (nal_unit_type == 33/*SPS*/ && fSPS == NULL) {
+	  fSPSSize = nalUnitLength;
+	  fSPS = new u_int8_t[nalUnitLength];
+	  memmove(fSPS, ptr, nalUnitLength);
+	} else if (nal_unit_type == 34/*PPS*/ && fPPS == NULL) {
+	  fPPSSize = nalUnitLength;
+	  fPPS = new u_int8_t[nalUnitLength];
+	  memmove(fPPS, ptr, nalUnitLength);
+	}
+      }
+      ptr += nalUnitLength;
+      if (j + 1 < numOfArrays || i + 1 < numNalus) checkPtr;
+    }
+  }
+}
+
+H265VideoMatroskaFileServerMediaSubsession
+::~H265VideoMatroskaFileServerMediaSubsession() {
+  delete[] fVPS;
+  delete[] fSPS;
+  delete[] fPPS;
+}
+
+float H265VideoMatroskaFileServerMediaSubsession::duration() const { return fOurDemux.fileDuration(); }
+
+void H265VideoMatroskaFileServerMediaSubsession
+::seekStreamSource(FramedSource* inputSource, double& seekNPT, double /*streamDuration*/, u_int64_t& /*numBytes*/) {
+  // "inputSource" is a framer. *Its* source is the demuxed track that we seek on:
+  H265VideoStreamFramer* framer = (H265VideoStreamFramer*)inputSource;
+
+  MatroskaDemuxedTrack* demuxedTrack = (MatroskaDemuxedTrack*)(framer->inputSource());
+  demuxedTrack->seekToTime(seekNPT);
+}
+
+FramedSource* H265VideoMatroskaFileServerMediaSubsession
+::createNewStreamSource(unsigned clientSessionId, unsigned& estBitrate) {
+  // Allow for the possibility of very large NAL units being fed to our "RTPSink" objects:
+  OutPacketBuffer::maxSize = 300000; // bytes
+  estBitrate = 500; // kbps, estimate
+
+  // Create the video source:
+  FramedSource* baseH265VideoSource = fOurDemux.newDemuxedTrack(clientSessionId, fTrackNumber);
+  if (baseH265VideoSource == NULL) return NULL;
+
+  // Create a framer for the Video stream:
+  H265VideoStreamFramer* framer = H265VideoStreamDiscreteFramer::createNew(envir(), baseH265VideoSource);
+  if (fVPS != NULL && fSPS != NULL && fPPS != NULL) {
+    framer->setVPSandSPSandPPS(fVPS, fVPSSize, fSPS, fSPSSize, fPPS, fPPSSize);
+  }
+
+  return framer;
+}
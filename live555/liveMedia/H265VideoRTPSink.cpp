@@ -0,0 +1,496 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// RTP sink for H.265 video (RFC 7798)
+// Implementation
+
+#include "H265VideoRTPSink.hh"
+#include "H265VideoStreamFramer.hh"
+#include "Base64.hh"
+#include "NALUnitEmulationPrevention.hh"
+#include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
+
+////////// H265VideoRTPSink implementation //////////
+
+static u_int8_t* copyOfNALUnit(u_int8_t const* nalUnit, unsigned size) {
+  if (nalUnit == NULL) return NULL;
+
+  u_int8_t* result = new u_int8_t[size];
+  memmove(result, nalUnit, size);
+  return result;
+}
+
+H265VideoRTPSink
+::H265VideoRTPSink(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
+		   u_int8_t const* vps, unsigned vpsSize,
+		   u_int8_t const* sps, unsigned spsSize,
+		   u_int8_t const* pps, unsigned ppsSize)
+  : VideoRTPSink(env, RTPgs, rtpPayloadFormat, 90000, "H265"),
+    fOurFragmenter(NULL), fFmtpSDPLine(NULL) {
+  fVPS = copyOfNALUnit(vps, vpsSize); fVPSSize = vps == NULL ? 0 : vpsSize;
+  fSPS = copyOfNALUnit(sps, spsSize); fSPSSize = sps == NULL ? 0 : spsSize;
+  fPPS = copyOfNALUnit(pps, ppsSize); fPPSSize = pps == NULL ? 0 : ppsSize;
+}
+
+H265VideoRTPSink::~H265VideoRTPSink() {
+  fSource = fOurFragmenter; // hack: in case "fSource" had gotten set to NULL before we were called
+  delete[] fFmtpSDPLine;
+  delete[] fVPS; delete[] fSPS; delete[] fPPS;
+  stopPlaying(); // call this now, because we won't have our 'FU fragmenter' when the base class destructor calls it later.
+
+  // Close our 'FU fragmenter' as well:
+  Medium::close(fOurFragmenter);
+  fSource = NULL; // for the base class destructor, which gets called next
+}
+
+H265VideoRTPSink*
+H265VideoRTPSink::createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat) {
+  return new H265VideoRTPSink(env, RTPgs, rtpPayloadFormat);
+}
+
+H265VideoRTPSink*
+H265VideoRTPSink::createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
+			    u_int8_t const* vps, unsigned vpsSize,
+			    u_int8_t const* sps, unsigned spsSize,
+			    u_int8_t const* pps, unsigned ppsSize) {
+  return new H265VideoRTPSink(env, RTPgs, rtpPayloadFormat, vps, vpsSize, sps, spsSize, pps, ppsSize);
+}
+
+H265VideoRTPSink*
+H265VideoRTPSink::createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
+			    char const* sPropVPSStr, char const* sPropSPSStr, char const* sPropPPSStr) {
+  u_int8_t* vps = NULL; unsigned vpsSize = 0;
+  u_int8_t* sps = NULL; unsigned spsSize = 0;
+  u_int8_t* pps = NULL; unsigned ppsSize = 0;
+
+  // Parse each 'sProp' string, extracting and then classifying the NAL unit(s) from each one.
+  // We're 'liberal in what we accept'; it's OK if the strings don't contain the NAL unit type
+  // implied by their names (or if one or more of the strings encode multiple NAL units).
+  SPropRecord* sPropRecords[3];
+  unsigned numSPropRecords[3];
+  sPropRecords[0] = parseSPropParameterSets(sPropVPSStr, numSPropRecords[0]);
+  sPropRecords[1] = parseSPropParameterSets(sPropSPSStr, numSPropRecords[1]);
+  sPropRecords[2] = parseSPropParameterSets(sPropPPSStr, numSPropRecords[2]);
+
+  for (unsigned j = 0; j < 3; ++j) {
+    SPropRecord* records = sPropRecords[j];
+    unsigned numRecords = numSPropRecords[j];
+
+    for (unsigned i = 0; i < numRecords; ++i) {
+      if (records[i].sPropLength < 2) continue; // bad data
+      u_int8_t nal_unit_type = ((records[i].sPropBytes[0])&0x7E)>>1;
+      if (nal_unit_type == 32/*VPS*/) {
+	vps = records[i].sPropBytes;
+	vpsSize = records[i].sPropLength;
+      } else if (nal_unit_type == 33/*SPS*/) {
+	sps = records[i].sPropBytes;
+	spsSize = records[i].sPropLength;
+      } else if (nal_unit_type == 34/*PPS*/) {
+	pps = records[i].sPropBytes;
+	ppsSize = records[i].sPropLength;
+      }
+    }
+  }
+
+  H265VideoRTPSink* result
+    = new H265VideoRTPSink(env, RTPgs, rtpPayloadFormat, vps, vpsSize, sps, spsSize, pps, ppsSize);
+  delete[] sPropRecords[0]; delete[] sPropRecords[1]; delete[] sPropRecords[2];
+
+  return result;
+}
+
+Boolean H265VideoRTPSink::sourceIsCompatibleWithUs(MediaSource& source) {
+  // Our source must be an appropriate framer:
+  return source.isH265VideoStreamFramer();
+}
+
+Boolean H265VideoRTPSink::continuePlaying() {
+  // First, check whether we have a 'fragmenter' class set up yet.
+  // If not, create it now:
+  if (fOurFragmenter == NULL) {
+    fOurFragmenter = new H265FUFragmenter(envir(), fSource, ourMaxPacketSize() - 12/*RTP hdr size*/);
+  } else {
+    fOurFragmenter->reassignInputSource(fSource);
+  }
+  fSource = fOurFragmenter;
+
+  // Then call the parent class's implementation:
+  return MultiFramedRTPSink::continuePlaying();
+}
+
+unsigned H265VideoRTPSink::specialHeaderSize() const {
+  // The first (or only) fragment of a NAL unit already begins with its payload header and FU header (if needed).
+  // Each subsequent fragment gets a 3-byte special header: its payload header and FU header.
+  return (curFragmentationOffset() == 0) ? 0 : 3;
+}
+
+void H265VideoRTPSink::doSpecialFrameHandling(unsigned fragmentationOffset,
+					      unsigned char* /*frameStart*/,
+					      unsigned /*numBytesInFrame*/,
+					      struct timeval framePresentationTime,
+					      unsigned numRemainingBytes) {
+  if (fragmentationOffset > 0 && fOurFragmenter != NULL) {
+    // This is a subsequent fragment of a FU NAL unit.  Fill in its payload header and FU header
+    // (with the E bit set iff this is the last fragment):
+    u_int8_t fuHeaderBytes[3];
+    fuHeaderBytes[0] = fOurFragmenter->payloadHeader()[0];
+    fuHeaderBytes[1] = fOurFragmenter->payloadHeader()[1];
+    fuHeaderBytes[2] = fOurFragmenter->fuHeader();
+    if (numRemainingBytes == 0) fuHeaderBytes[2] |= 0x40;
+    setSpecialHeaderBytes(fuHeaderBytes, 3);
+  }
+
+  // Set the RTP 'M' (marker) bit iff
+  // 1/ This fragment was the end of (or the only fragment of) an NAL unit (or AP), and
+  // 2/ This NAL unit (or AP) was the last of an 'access unit' (i.e. video frame).
+  // (Because our fragmenter may have read ahead, we ask it - rather than our framer source - about this.)
+  if (fOurFragmenter != NULL && numRemainingBytes == 0 && fOurFragmenter->lastDeliveryEndedAccessUnit()) {
+    setMarkerBit();
+  }
+
+  setTimestamp(framePresentationTime);
+}
+
+Boolean H265VideoRTPSink
+::frameCanAppearAfterPacketStart(unsigned char const* /*frameStart*/,
+				 unsigned /*numBytesInFrame*/) const {
+  return False;
+}
+
+#define PROFILE_TIER_LEVEL_OFFSET_IN_VPS 6
+#define PROFILE_TIER_LEVEL_SIZE 12
+
+char const* H265VideoRTPSink::auxSDPLine() {
+  // Generate a new "a=fmtp:" line each time, using our VPS, SPS and PPS (if we have them),
+  // otherwise parameters from our framer source (in case they've changed since the last time that
+  // we were called):
+  u_int8_t* vps = fVPS; unsigned vpsSize = fVPSSize;
+  u_int8_t* sps = fSPS; unsigned spsSize = fSPSSize;
+  u_int8_t* pps = fPPS; unsigned ppsSize = fPPSSize;
+  if (vps == NULL || sps == NULL || pps == NULL) {
+    // We need to get VPS, SPS and PPS from our framer source:
+    if (fOurFragmenter == NULL) return NULL; // we don't yet have a fragmenter (and therefore not a source)
+    H265VideoStreamFramer* framerSource = (H265VideoStreamFramer*)(fOurFragmenter->inputSource());
+    if (framerSource == NULL) return NULL; // we don't yet have a source
+
+    framerSource->getVPSandSPSandPPS(vps, vpsSize, sps, spsSize, pps, ppsSize);
+    if (vps == NULL || sps == NULL || pps == NULL) return NULL; // our source isn't ready
+  }
+
+  // The profile, tier and level parameters come from the VPS's "profile_tier_level()", which is byte-aligned.
+  // (We need to remove any 'emulation prevention' bytes first.)
+  u_int8_t vpsRBSP[PROFILE_TIER_LEVEL_OFFSET_IN_VPS + PROFILE_TIER_LEVEL_SIZE];
+  unsigned vpsRBSPSize = removeEmulationPreventionBytes(vpsRBSP, sizeof vpsRBSP, vps, vpsSize);
+  if (vpsRBSPSize < sizeof vpsRBSP) { // sanity check
+    memset(&vpsRBSP[vpsRBSPSize], 0, sizeof vpsRBSP - vpsRBSPSize);
+  }
+  u_int8_t const* profileTierLevel = &vpsRBSP[PROFILE_TIER_LEVEL_OFFSET_IN_VPS];
+
+  unsigned profileSpace = profileTierLevel[0]>>6; // general_profile_space
+  unsigned profileId = profileTierLevel[0]&0x1F; // general_profile_idc
+  unsigned tierFlag = (profileTierLevel[0]>>5)&0x1; // general_tier_flag
+  unsigned levelId = profileTierLevel[11]; // general_level_idc
+  u_int8_t const* interop_constraints = &profileTierLevel[5];
+  char interopConstraintsStr[13];
+  sprintf(interopConstraintsStr, "%02X%02X%02X%02X%02X%02X",
+	  interop_constraints[0], interop_constraints[1], interop_constraints[2],
+	  interop_constraints[3], interop_constraints[4], interop_constraints[5]);
+
+  // Set up the "a=fmtp:" SDP line for this stream:
+  char* sprop_vps = base64Encode((char*)vps, vpsSize);
+  char* sprop_sps = base64Encode((char*)sps, spsSize);
+  char* sprop_pps = base64Encode((char*)pps, ppsSize);
+  char const* fmtpFmt =
+    "a=fmtp:%d profile-space=%u"
+    ";profile-id=%u"
+    ";tier-flag=%u"
+    ";level-id=%u"
+    ";interop-constraints=%s"
+    ";sprop-vps=%s"
+    ";sprop-sps=%s"
+    ";sprop-pps=%s\r\n";
+  unsigned fmtpFmtSize = strlen(fmtpFmt)
+    + 3 /* max num chars: rtpPayloadType */ + 20 /* max num chars: profile_space */
+    + 20 /* max num chars: profile_id */
+    + 20 /* max num chars: tier_flag */
+    + 20 /* max num chars: level_id */
+    + strlen(interopConstraintsStr)
+    + strlen(sprop_vps)
+    + strlen(sprop_sps)
+    + strlen(sprop_pps);
+  char* fmtp = new char[fmtpFmtSize];
+  sprintf(fmtp, fmtpFmt,
+          rtpPayloadType(), profileSpace,
+	  profileId,
+	  tierFlag,
+	  levelId,
+	  interopConstraintsStr,
+	  sprop_vps,
+	  sprop_sps,
+	  sprop_pps);
+  delete[] sprop_vps;
+  delete[] sprop_sps;
+  delete[] sprop_pps;
+
+  delete[] fFmtpSDPLine;
+  fFmtpSDPLine = fmtp;
+  return fFmtpSDPLine;
+}
+
+
+////////// H265FUFragmenter implementation //////////
+
+H265FUFragmenter::H265FUFragmenter(UsageEnvironment& env,
+				   FramedSource* inputSource,
+				   unsigned maxOutputPacketSize)
+  : FramedFilter(env, inputSource),
+    fMaxOutputPacketSize(maxOutputPacketSize), fFUHeader(0), fLastDeliveryEndedAccessUnit(False),
+    fAPSize(0), fNumNALUnitsInAP(0), fAPEndsAccessUnit(False),
+    fHeldNALUnit(NULL), fHeldNALUnitBufferSize(0), fHeldNALUnitSize(0), fHeldNumTruncatedBytes(0),
+    fHeldDurationInMicroseconds(0), fHeldNALUnitEndsAccessUnit(False),
+    fHaveHeldNALUnit(False), fInputSourceHasClosed(False) {
+  fPayloadHeader[0] = fPayloadHeader[1] = 0;
+  fHeldPresentationTime.tv_sec = fHeldPresentationTime.tv_usec = 0;
+}
+
+H265FUFragmenter::~H265FUFragmenter() {
+  delete[] fHeldNALUnit;
+  detachInputSource(); // so that the subsequent ~FramedFilter() doesn't delete it
+}
+
+void H265FUFragmenter::doGetNextFrame() {
+  if (fMaxSize < 3) { // shouldn't happen
+    envir() << "H265FUFragmenter::doGetNextFrame(): fMaxSize ("
+	    << fMaxSize << ") is smaller than expected\n";
+    handleClosure(this);
+    return;
+  }
+
+  if (fHaveHeldNALUnit) {
+    // Deliver the NAL unit that we read (in advance) last time:
+    fHaveHeldNALUnit = False;
+    unsigned frameSize = fHeldNALUnitSize;
+    fNumTruncatedBytes = fHeldNumTruncatedBytes;
+    if (frameSize > fMaxSize - 1) {
+      fNumTruncatedBytes += frameSize - (fMaxSize - 1);
+      frameSize = fMaxSize - 1;
+    }
+    memmove(fTo + 1, fHeldNALUnit, frameSize);
+    fPresentationTime = fHeldPresentationTime;
+    fDurationInMicroseconds = fHeldDurationInMicroseconds;
+    fLastDeliveryEndedAccessUnit = fHeldNALUnitEndsAccessUnit;
+    deliverNALUnit(frameSize);
+  } else if (fInputSourceHasClosed) {
+    // Our input source closed while we were reading ahead:
+    fInputSourceHasClosed = False;
+    handleClosure(this);
+  } else {
+    // Read the next NAL unit directly into our client's buffer (i.e., the RTP sink's output buffer), leaving
+    // one byte at the front, in case we need to add a FU payload header:
+    fAPSize = 0;
+    readNextNALUnit(fTo + 1, fMaxSize - 1);
+  }
+}
+
+void H265FUFragmenter::doStopGettingFrames() {
+  // Discard any read-ahead state:
+  fAPSize = 0;
+  fHaveHeldNALUnit = fInputSourceHasClosed = False;
+
+  FramedFilter::doStopGettingFrames();
+}
+
+void H265FUFragmenter::readNextNALUnit(unsigned char* to, unsigned maxSize) {
+  fInputSource->getNextFrame(to, maxSize,
+			     afterGettingFrame, this,
+			     onSourceClosure, this);
+}
+
+void H265FUFragmenter::afterGettingFrame(void* clientData, unsigned frameSize,
+					 unsigned numTruncatedBytes,
+					 struct timeval presentationTime,
+					 unsigned durationInMicroseconds) {
+  H265FUFragmenter* fragmenter = (H265FUFragmenter*)clientData;
+  fragmenter->afterGettingFrame1(frameSize, numTruncatedBytes, presentationTime,
+				 durationInMicroseconds);
+}
+
+// NAL units that we'll try to combine into an AP.  (These are all small, and are usually followed by another NAL unit
+// with the same presentation time.)
+static Boolean canBeAggregated(u_int8_t const* nalUnit, unsigned nalUnitSize) {
+  if (nalUnitSize < 2) return False;
+
+  u_int8_t nal_unit_type = (nalUnit[0]&0x7E)>>1;
+  return (nal_unit_type >= 32 && nal_unit_type <= 35) // VPS, SPS, PPS, or access unit delimiter
+    || nal_unit_type == 39; // prefix SEI
+}
+
+#define AP_HEADER_SIZE 2
+#define AP_NAL_UNIT_SIZE_FIELD_SIZE 2
+
+void H265FUFragmenter::afterGettingFrame1(unsigned frameSize,
+					  unsigned numTruncatedBytes,
+					  struct timeval presentationTime,
+					  unsigned durationInMicroseconds) {
+  Boolean const endsAccessUnit = inputEndedAccessUnit();
+
+  if (fAPSize == 0) {
+    // This NAL unit has been read at "fTo + 1".  If it's small enough, and of a type that's worth aggregating,
+    // then begin an AP with it:
+    fPresentationTime = presentationTime;
+    fDurationInMicroseconds = durationInMicroseconds;
+    unsigned const apSize = AP_HEADER_SIZE + AP_NAL_UNIT_SIZE_FIELD_SIZE + frameSize;
+    unsigned const minNextNALUnitSize = AP_NAL_UNIT_SIZE_FIELD_SIZE + 2;
+    if (numTruncatedBytes == 0 && !endsAccessUnit && canBeAggregated(fTo + 1, frameSize)
+	&& apSize + minNextNALUnitSize <= fMaxOutputPacketSize && apSize + minNextNALUnitSize < fMaxSize) {
+      memmove(&fTo[AP_HEADER_SIZE + AP_NAL_UNIT_SIZE_FIELD_SIZE], fTo + 1, frameSize);
+      fTo[AP_HEADER_SIZE] = frameSize>>8; fTo[AP_HEADER_SIZE+1] = frameSize;
+      fAPSize = apSize;
+      fNumNALUnitsInAP = 1;
+      fAPEndsAccessUnit = False;
+
+      // Read the next NAL unit (in advance), after this one:
+      readNextNALUnit(&fTo[fAPSize + AP_NAL_UNIT_SIZE_FIELD_SIZE], fMaxSize - fAPSize - AP_NAL_UNIT_SIZE_FIELD_SIZE);
+      return;
+    }
+
+    fNumTruncatedBytes = numTruncatedBytes;
+    fLastDeliveryEndedAccessUnit = endsAccessUnit;
+    deliverNALUnit(frameSize);
+    return;
+  }
+
+  // Otherwise, we've just read (in advance) a NAL unit that follows the AP that we're building.
+  // If it can also be aggregated (and will fit), then add it to the AP:
+  u_int8_t* nalUnit = &fTo[fAPSize + AP_NAL_UNIT_SIZE_FIELD_SIZE];
+  unsigned const newAPSize = fAPSize + AP_NAL_UNIT_SIZE_FIELD_SIZE + frameSize;
+  if (numTruncatedBytes == 0 && canBeAggregated(nalUnit, frameSize)
+      && presentationTime.tv_sec == fPresentationTime.tv_sec
+      && presentationTime.tv_usec == fPresentationTime.tv_usec
+      && newAPSize <= fMaxOutputPacketSize) {
+    fTo[fAPSize] = frameSize>>8; fTo[fAPSize+1] = frameSize;
+    fAPSize = newAPSize;
+    ++fNumNALUnitsInAP;
+    fAPEndsAccessUnit = endsAccessUnit;
+
+    unsigned const minNextNALUnitSize = AP_NAL_UNIT_SIZE_FIELD_SIZE + 2;
+    if (endsAccessUnit || fAPSize + minNextNALUnitSize > fMaxOutputPacketSize || fAPSize + minNextNALUnitSize >= fMaxSize) {
+      deliverAggregationPacket();
+    } else {
+      readNextNALUnit(&fTo[fAPSize + AP_NAL_UNIT_SIZE_FIELD_SIZE], fMaxSize - fAPSize - AP_NAL_UNIT_SIZE_FIELD_SIZE);
+    }
+    return;
+  }
+
+  // This NAL unit doesn't belong in the AP, so hold on to a copy of it (for our next delivery), and deliver the AP now:
+  if (frameSize > fHeldNALUnitBufferSize) {
+    delete[] fHeldNALUnit;
+    fHeldNALUnitBufferSize = fMaxSize;
+    if (fHeldNALUnitBufferSize < frameSize) fHeldNALUnitBufferSize = frameSize;
+    fHeldNALUnit = new u_int8_t[fHeldNALUnitBufferSize];
+  }
+  memmove(fHeldNALUnit, nalUnit, frameSize);
+  fHeldNALUnitSize = frameSize;
+  fHeldNumTruncatedBytes = numTruncatedBytes;
+  fHeldPresentationTime = presentationTime;
+  fHeldDurationInMicroseconds = durationInMicroseconds;
+  fHeldNALUnitEndsAccessUnit = endsAccessUnit;
+  fHaveHeldNALUnit = True;
+
+  deliverAggregationPacket();
+}
+
+void H265FUFragmenter::onSourceClosure(void* clientData) {
+  H265FUFragmenter* fragmenter = (H265FUFragmenter*)clientData;
+  fragmenter->onSourceClosure1();
+}
+
+void H265FUFragmenter::onSourceClosure1() {
+  if (fAPSize > 0) {
+    // Our input source closed while we were reading ahead.  Deliver the AP that we've built so far;
+    // we'll handle the closure the next time that we're asked for data:
+    fInputSourceHasClosed = True;
+    fAPEndsAccessUnit = True;
+    deliverAggregationPacket();
+  } else {
+    handleClosure(this);
+  }
+}
+
+Boolean H265FUFragmenter::inputEndedAccessUnit() {
+  // This relies on our input source being a "H265VideoStreamFramer":
+  H265VideoStreamFramer* framerSource = (H265VideoStreamFramer*)fInputSource;
+  if (framerSource == NULL || !framerSource->pictureEndMarker()) return False;
+
+  framerSource->pictureEndMarker() = False;
+  return True;
+}
+
+void H265FUFragmenter::deliverNALUnit(unsigned frameSize) {
+  if (frameSize <= fMaxOutputPacketSize || frameSize < 2) {
+    // Common case: The NAL unit will fit in a single RTP packet.  Move it back into place:
+    memmove(fTo, fTo + 1, frameSize);
+    fFrameSize = frameSize;
+  } else {
+    // We need to send the NAL unit data as FU packets.  Turn the 2-byte NAL unit header into the (2-byte) payload
+    // header (with type 49) and the FU header (with the S bit).  Our RTP sink will then fragment this data, adding
+    // payload header and FU header bytes (without the S bit) to the front of each subsequent fragment.
+    u_int8_t const nalUnitHeader0 = fTo[1];
+    u_int8_t const nalUnitHeader1 = fTo[2];
+    fPayloadHeader[0] = (nalUnitHeader0&0x81) | (49<<1); // F bit; type 49; high bit of LayerId
+    fPayloadHeader[1] = nalUnitHeader1; // rest of LayerId; TID
+    fFUHeader = (nalUnitHeader0&0x7E)>>1;
+    fTo[0] = fPayloadHeader[0];
+    fTo[1] = fPayloadHeader[1];
+    fTo[2] = 0x80 | fFUHeader;
+    fFrameSize = frameSize + 1;
+  }
+
+  // Complete delivery to the client:
+  FramedSource::afterGetting(this);
+}
+
+void H265FUFragmenter::deliverAggregationPacket() {
+  if (fNumNALUnitsInAP == 1) {
+    // There's no point in sending a single NAL unit as an AP.  Just move it back into place:
+    unsigned const nalUnitSize = fAPSize - (AP_HEADER_SIZE + AP_NAL_UNIT_SIZE_FIELD_SIZE);
+    memmove(fTo, &fTo[AP_HEADER_SIZE + AP_NAL_UNIT_SIZE_FIELD_SIZE], nalUnitSize);
+    fFrameSize = nalUnitSize;
+  } else {
+    // Fill in the AP's payload header: The F bit is the OR of - and the LayerId and TID are the lowest of - those of
+    // the aggregated NAL units:
+    u_int8_t fBit = 0, layerId = 0x3F, tid = 0x7;
+    for (unsigned i = AP_HEADER_SIZE; i + AP_NAL_UNIT_SIZE_FIELD_SIZE + 2 <= fAPSize; ) {
+      unsigned const nalUnitSize = (fTo[i]<<8)|fTo[i+1];
+      u_int8_t const* nalUnit = &fTo[i + AP_NAL_UNIT_SIZE_FIELD_SIZE];
+      fBit |= nalUnit[0]&0x80;
+      u_int8_t const nalLayerId = ((nalUnit[0]&0x01)<<5)|(nalUnit[1]>>3);
+      if (nalLayerId < layerId) layerId = nalLayerId;
+      if ((nalUnit[1]&0x07) < tid) tid = nalUnit[1]&0x07;
+      i += AP_NAL_UNIT_SIZE_FIELD_SIZE + nalUnitSize;
+    }
+    fTo[0] = fBit | (48<<1) | (layerId>>5);
+    fTo[1] = ((layerId&0x1F)<<3) | tid;
+    fFrameSize = fAPSize;
+  }
+  fNumTruncatedBytes = 0;
+  fLastDeliveryEndedAccessUnit = fAPEndsAccessUnit;
+  fAPSize = 0;
+
+  // Complete delivery to the client:
+  FramedSource::afterGetting(this);
+}
@@ -0,0 +1,194 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// H.265 Video RTP Sources
+// Implementation
+
+#include "H265VideoRTPSource.hh"
+
+////////// H265BufferedPacket and H265BufferedPacketFactory //////////
+
+class H265BufferedPacket: public BufferedPacket {
+public:
+  H265BufferedPacket(H265VideoRTPSource& ourSource);
+  virtual ~H265BufferedPacket();
+
+private: // redefined virtual functions
+  virtual unsigned nextEnclosedFrameSize(unsigned char*& framePtr,
+					 unsigned dataSize);
+private:
+  H265VideoRTPSource& fOurSource;
+};
+
+class H265BufferedPacketFactory: public BufferedPacketFactory {
+private: // redefined virtual functions
+  virtual BufferedPacket* createNewPacket(MultiFramedRTPSource* ourSource);
+};
+
+
+///////// H265VideoRTPSource implementation ////////
+
+H265VideoRTPSource*
+H265VideoRTPSource::createNew(UsageEnvironment& env, Groupsock* RTPgs,
+			      unsigned char rtpPayloadFormat,
+			      Boolean expectDONFields,
+			      unsigned rtpTimestampFrequency) {
+  return new H265VideoRTPSource(env, RTPgs, rtpPayloadFormat,
+				expectDONFields, rtpTimestampFrequency);
+}
+
+H265VideoRTPSource
+::H265VideoRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
+		     unsigned char rtpPayloadFormat,
+		     Boolean expectDONFields,
+		     unsigned rtpTimestampFrequency)
+  : MultiFramedRTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency,
+			 new H265BufferedPacketFactory),
+    fExpectDONFields(expectDONFields), fCurPacketNALUnitType(0), fCurPacketIsFirstAPUnit(False),
+    fCurrentNALUnitAbsDon(0) {
+}
+
+H265VideoRTPSource::~H265VideoRTPSource() {
+}
+
+Boolean H265VideoRTPSource
+::processSpecialHeader(BufferedPacket* packet,
+                       unsigned& resultSpecialHeaderSize) {
+  unsigned char* headerStart = packet->data();
+  unsigned packetSize = packet->dataSize();
+  if (packetSize < 2) return False;
+
+  // The header has a minimum size of 0, since the 2-byte NAL unit header is used
+  // as a payload header
+  unsigned expectedHeaderSize = 0;
+
+  fCurPacketNALUnitType = (headerStart[0]&0x7E)>>1;
+  switch (fCurPacketNALUnitType) {
+  case 48: { // Aggregation Packet (AP)
+    // We skip over the 2-byte payload header; each aggregated NAL unit (and its size, and DON field, if any)
+    // is handled in "H265BufferedPacket::nextEnclosedFrameSize()":
+    expectedHeaderSize = 2;
+    fCurPacketIsFirstAPUnit = True;
+    fCurrentPacketBeginsFrame = fCurrentPacketCompletesFrame = True;
+    break;
+  }
+  case 49: { // Fragmentation Unit (FU)
+    // For these NALUs, the first three bytes are the payload header and the FU header; these are followed
+    // (in the first fragment only) by a 2-byte DONL field, if we're expecting DON fields.
+    // If the start bit is set, we reconstruct the original NAL unit header, in front of the payload:
+    if (packetSize < 3) return False;
+    u_int8_t startBit = headerStart[2]&0x80;
+    u_int8_t endBit = headerStart[2]&0x40;
+    if (startBit) {
+      u_int8_t const nal_unit_type = headerStart[2]&0x3F;
+      u_int8_t const nalUnitHeader0 = (headerStart[0]&0x81)|(nal_unit_type<<1);
+      u_int8_t const nalUnitHeader1 = headerStart[1];
+      if (fExpectDONFields) {
+	expectedHeaderSize = 3;
+	if (packetSize < expectedHeaderSize + 2) return False;
+	fCurrentNALUnitAbsDon = (headerStart[3]<<8)|headerStart[4];
+      } else {
+	expectedHeaderSize = 1;
+      }
+      headerStart[expectedHeaderSize] = nalUnitHeader0;
+      headerStart[expectedHeaderSize+1] = nalUnitHeader1;
+      fCurrentPacketBeginsFrame = True;
+    } else {
+      // If the startbit is not set, both the payload header and the FU header can be discarded
+      expectedHeaderSize = 3;
+      fCurrentPacketBeginsFrame = False;
+    }
+    fCurrentPacketCompletesFrame = (endBit != 0);
+    break;
+  }
+  case 50: { // PACI (Payload Content Information) packet
+    // We don't support these; ignore the packet:
+    return False;
+  }
+  default: {
+    // This packet contains a single complete, decodable NAL unit.  If we're expecting DON fields, then the NAL unit
+    // header is followed by a 2-byte DONL field, which we remove (by moving the NAL unit header forward over it):
+    if (fExpectDONFields) {
+      if (packetSize < 4) return False;
+      fCurrentNALUnitAbsDon = (headerStart[2]<<8)|headerStart[3];
+      headerStart[3] = headerStart[1];
+      headerStart[2] = headerStart[0];
+      expectedHeaderSize = 2;
+    }
+    fCurrentPacketBeginsFrame = fCurrentPacketCompletesFrame = True;
+    break;
+  }
+  }
+
+  resultSpecialHeaderSize = expectedHeaderSize;
+  return True;
+}
+
+char const* H265VideoRTPSource::MIMEtype() const {
+  return "video/H265";
+}
+
+
+////////// H265BufferedPacket and H265BufferedPacketFactory implementation //////////
+
+H265BufferedPacket::H265BufferedPacket(H265VideoRTPSource& ourSource)
+  : fOurSource(ourSource) {
+}
+
+H265BufferedPacket::~H265BufferedPacket() {
+}
+
+unsigned H265BufferedPacket
+::nextEnclosedFrameSize(unsigned char*& framePtr, unsigned dataSize) {
+  H265VideoRTPSource& src = fOurSource;
+  unsigned char* const origFramePtr = framePtr;
+  unsigned resultNALUSize = 0; // if an error occurs
+
+  if (src.fCurPacketNALUnitType == 48) { // AP
+    if (src.fExpectDONFields) {
+      // The NAL unit size is preceded by a 2-byte DONL field (for the first NAL unit), or a 1-byte DOND field (otherwise):
+      if (src.fCurPacketIsFirstAPUnit) {
+	if (dataSize < 4) return 0;
+	src.fCurrentNALUnitAbsDon = (framePtr[0]<<8)|framePtr[1];
+	framePtr += 2;
+      } else {
+	if (dataSize < 3) return 0;
+	src.fCurrentNALUnitAbsDon += framePtr[0] + 1;
+	framePtr += 1;
+      }
+    } else {
+      if (dataSize < 2) return 0;
+    }
+    src.fCurPacketIsFirstAPUnit = False;
+
+    // The next two bytes are the NALU size:
+    resultNALUSize = (framePtr[0]<<8)|framePtr[1];
+    framePtr += 2;
+  } else {
+    // Common case: We use the entire packet data:
+    resultNALUSize = dataSize;
+  }
+
+  unsigned const maxNALUSize = dataSize - (framePtr - origFramePtr);
+  if (resultNALUSize > maxNALUSize) resultNALUSize = maxNALUSize;
+  return resultNALUSize;
+}
+
+BufferedPacket* H265BufferedPacketFactory
+::createNewPacket(MultiFramedRTPSource* ourSource) {
+  return new H265BufferedPacket((H265VideoRTPSource&)(*ourSource));
+}
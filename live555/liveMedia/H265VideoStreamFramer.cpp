@@ -0,0 +1,579 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A filter that breaks up a H.265 Video Elementary Stream into NAL units.
+// Implementation
+
+#include "H265VideoStreamFramer.hh"
+#include "MPEGVideoStreamParser.hh"
+#include "BitReader.hh"
+#include "NALUnitEmulationPrevention.hh"
+#include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
+
+////////// H265VideoStreamParser definition //////////
+
+class H265VideoStreamParser: public MPEGVideoStreamParser {
+public:
+  H265VideoStreamParser(H265VideoStreamFramer* usingSource, FramedSource* inputSource, Boolean includeStartCodeInOutput);
+  virtual ~H265VideoStreamParser();
+
+private: // redefined virtual functions:
+  virtual void flushInput();
+  virtual unsigned parse();
+
+private:
+  H265VideoStreamFramer* usingSource() {
+    return (H265VideoStreamFramer*)fUsingSource;
+  }
+
+  void removeEmulationBytes(u_int8_t* nalUnitCopy, unsigned maxSize, unsigned& nalUnitCopySize);
+
+  void profile_tier_level(BitReader& bv, unsigned max_sub_layers_minus1);
+  void analyze_video_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale);
+  void analyze_seq_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale);
+  void analyze_vui_parameters(BitReader& bv, unsigned& num_units_in_tick, unsigned& time_scale);
+
+private:
+  unsigned fOutputStartCodeSize;
+  Boolean fHaveSeenFirstStartCode, fHaveSeenFirstByteOfNALUnit;
+  u_int8_t fFirstByteOfNALUnit;
+};
+
+
+////////// H265VideoStreamFramer implementation //////////
+
+H265VideoStreamFramer* H265VideoStreamFramer
+::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean includeStartCodeInOutput) {
+  return new H265VideoStreamFramer(env, inputSource, True, includeStartCodeInOutput);
+}
+
+H265VideoStreamFramer
+::H265VideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource, Boolean createParser, Boolean includeStartCodeInOutput)
+  : MPEGVideoStreamFramer(env, inputSource),
+    fLastSeenVPS(NULL), fLastSeenVPSSize(0), fLastSeenSPS(NULL), fLastSeenSPSSize(0), fLastSeenPPS(NULL), fLastSeenPPSSize(0) {
+  fParser = createParser
+    ? new H265VideoStreamParser(this, inputSource, includeStartCodeInOutput)
+    : NULL;
+  fNextPresentationTime = fPresentationTimeBase;
+  fFrameRate = 25.0; // We assume a frame rate of 25 fps, unless we learn otherwise (from parsing a VPS or SPS NAL unit)
+}
+
+H265VideoStreamFramer::~H265VideoStreamFramer() {
+  delete[] fLastSeenVPS;
+  delete[] fLastSeenSPS;
+  delete[] fLastSeenPPS;
+}
+
+void H265VideoStreamFramer
+::setVPSandSPSandPPS(char const* sPropVPSStr, char const* sPropSPSStr, char const* sPropPPSStr) {
+  char const* sPropStrs[3] = { sPropVPSStr, sPropSPSStr, sPropPPSStr };
+  for (unsigned j = 0; j < 3; ++j) {
+    unsigned numSPropRecords;
+    SPropRecord* sPropRecords = parseSPropParameterSets(sPropStrs[j], numSPropRecords);
+    for (unsigned i = 0; i < numSPropRecords; ++i) {
+      if (sPropRecords[i].sPropLength < 2) continue; // bad data
+      u_int8_t nal_unit_type = ((sPropRecords[i].sPropBytes[0])&0x7E)>>1;
+      if (nal_unit_type == 32/*VPS*/) {
+	saveCopyOfVPS(sPropRecords[i].sPropBytes, sPropRecords[i].sPropLength);
+      } else if (nal_unit_type == 33/*SPS*/) {
+	saveCopyOfSPS(sPropRecords[i].sPropBytes, sPropRecords[i].sPropLength);
+      } else if (nal_unit_type == 34/*PPS*/) {
+	saveCopyOfPPS(sPropRecords[i].sPropBytes, sPropRecords[i].sPropLength);
+      }
+    }
+    delete[] sPropRecords;
+  }
+}
+
+void H265VideoStreamFramer::saveCopyOfVPS(u_int8_t* from, unsigned size) {
+  delete[] fLastSeenVPS;
+  fLastSeenVPS = new u_int8_t[size];
+  memmove(fLastSeenVPS, from, size);
+
+  fLastSeenVPSSize = size;
+}
+
+void H265VideoStreamFramer::saveCopyOfSPS(u_int8_t* from, unsigned size) {
+  delete[] fLastSeenSPS;
+  fLastSeenSPS = new u_int8_t[size];
+  memmove(fLastSeenSPS, from, size);
+
+  fLastSeenSPSSize = size;
+}
+
+void H265VideoStreamFramer::saveCopyOfPPS(u_int8_t* from, unsigned size) {
+  delete[] fLastSeenPPS;
+  fLastSeenPPS = new u_int8_t[size];
+  memmove(fLastSeenPPS, from, size);
+
+  fLastSeenPPSSize = size;
+}
+
+Boolean H265VideoStreamFramer::isH265VideoStreamFramer() const {
+  return True;
+}
+
+
+////////// H265VideoStreamParser implementation //////////
+
+H265VideoStreamParser
+::H265VideoStreamParser(H265VideoStreamFramer* usingSource, FramedSource* inputSource, Boolean includeStartCodeInOutput)
+  : MPEGVideoStreamParser(usingSource, inputSource),
+    fOutputStartCodeSize(includeStartCodeInOutput ? 4 : 0), fHaveSeenFirstStartCode(False), fHaveSeenFirstByteOfNALUnit(False) {
+}
+
+H265VideoStreamParser::~H265VideoStreamParser() {
+}
+
+void H265VideoStreamParser::removeEmulationBytes(u_int8_t* nalUnitCopy, unsigned maxSize, unsigned& nalUnitCopySize) {
+  u_int8_t* nalUnitOrig = fStartOfFrame + fOutputStartCodeSize;
+  nalUnitCopySize = removeEmulationPreventionBytes(nalUnitCopy, maxSize, nalUnitOrig, fTo - nalUnitOrig);
+}
+
+#ifdef DEBUG
+#define DEBUG_PRINT(x) do { fprintf(stderr, "\t%s: %d\n", #x, x); } while (0)
+#else
+#define DEBUG_PRINT(x) do {x = x;} while (0)
+// Note: the "x=x;" statement is intended to eliminate "unused variable" compiler warning messages
+#endif
+
+void H265VideoStreamParser::profile_tier_level(BitReader& bv, unsigned max_sub_layers_minus1) {
+  // general_profile_space, general_tier_flag, general_profile_idc, general_profile_compatibility_flag[32],
+  // general_progressive_source_flag, general_interlaced_source_flag, general_non_packed_constraint_flag,
+  // general_frame_only_constraint_flag, general_reserved_zero_44bits, general_level_idc:
+  bv.skipBits(96);
+
+  Boolean sub_layer_profile_present_flag[7], sub_layer_level_present_flag[7];
+  unsigned i;
+  for (i = 0; i < max_sub_layers_minus1; ++i) {
+    sub_layer_profile_present_flag[i] = bv.get1BitBoolean();
+    sub_layer_level_present_flag[i] = bv.get1BitBoolean();
+  }
+  if (max_sub_layers_minus1 > 0) {
+    bv.skipBits(2*(8-max_sub_layers_minus1)); // reserved_zero_2bits
+  }
+  for (i = 0; i < max_sub_layers_minus1; ++i) {
+    if (sub_layer_profile_present_flag[i]) {
+      bv.skipBits(88); // sub_layer_profile_space ... sub_layer_reserved_zero_44bits
+    }
+    if (sub_layer_level_present_flag[i]) {
+      bv.skipBits(8); // sub_layer_level_idc
+    }
+  }
+}
+
+#define VPS_MAX_SIZE 1000 // larger than the largest possible VPS (Video Parameter Set) NAL unit
+
+void H265VideoStreamParser
+::analyze_video_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale) {
+  num_units_in_tick = time_scale = 0; // default values
+
+  // Begin by making a copy of the NAL unit data, removing any 'emulation prevention' bytes:
+  u_int8_t vps[VPS_MAX_SIZE];
+  unsigned vpsSize;
+  removeEmulationBytes(vps, sizeof vps, vpsSize);
+
+  BitReader bv(vps, 0, 8*vpsSize);
+
+  unsigned i;
+
+  bv.skipBits(28); // nal_unit_header, vps_video_parameter_set_id, vps_reserved_three_2bits, vps_max_layers_minus1
+  unsigned vps_max_sub_layers_minus1 = bv.getBits(3);
+  DEBUG_PRINT(vps_max_sub_layers_minus1);
+  if (vps_max_sub_layers_minus1 > 6) return; // bad data
+  bv.skipBits(17); // vps_temporal_id_nesting_flag, vps_reserved_0xffff_16bits
+  profile_tier_level(bv, vps_max_sub_layers_minus1);
+  Boolean vps_sub_layer_ordering_info_present_flag = bv.get1BitBoolean();
+  for (i = vps_sub_layer_ordering_info_present_flag ? 0 : vps_max_sub_layers_minus1;
+       i <= vps_max_sub_layers_minus1; ++i) {
+    (void)bv.get_expGolomb(); // vps_max_dec_pic_buffering_minus1[i]
+    (void)bv.get_expGolomb(); // vps_max_num_reorder_pics[i]
+    (void)bv.get_expGolomb(); // vps_max_latency_increase_plus1[i]
+  }
+  unsigned vps_max_layer_id = bv.getBits(6);
+  unsigned vps_num_layer_sets_minus1 = bv.get_expGolomb();
+  if (vps_num_layer_sets_minus1 > 1023) return; // bad data
+  bv.skipBits(vps_num_layer_sets_minus1*(vps_max_layer_id+1)); // layer_id_included_flag[][]
+  unsigned vps_timing_info_present_flag = bv.get1Bit();
+  DEBUG_PRINT(vps_timing_info_present_flag);
+  if (vps_timing_info_present_flag) {
+    num_units_in_tick = bv.getBits(32);
+    DEBUG_PRINT(num_units_in_tick);
+    time_scale = bv.getBits(32);
+    DEBUG_PRINT(time_scale);
+  }
+}
+
+#define SPS_MAX_SIZE 1000 // larger than the largest possible SPS (Sequence Parameter Set) NAL unit
+#define MAX_NUM_SHORT_TERM_REF_PIC_SETS 64
+#define MAX_NUM_DELTA_POCS 32 // (in fact, at most 16 are allowed)
+
+void H265VideoStreamParser
+::analyze_seq_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale) {
+  num_units_in_tick = time_scale = 0; // default values
+
+  // Begin by making a copy of the NAL unit data, removing any 'emulation prevention' bytes:
+  u_int8_t sps[SPS_MAX_SIZE];
+  unsigned spsSize;
+  removeEmulationBytes(sps, sizeof sps, spsSize);
+
+  BitReader bv(sps, 0, 8*spsSize);
+
+  unsigned i;
+
+  bv.skipBits(20); // nal_unit_header, sps_video_parameter_set_id
+  unsigned sps_max_sub_layers_minus1 = bv.getBits(3);
+  DEBUG_PRINT(sps_max_sub_layers_minus1);
+  if (sps_max_sub_layers_minus1 > 6) return; // bad data
+  bv.skipBits(1); // sps_temporal_id_nesting_flag
+  profile_tier_level(bv, sps_max_sub_layers_minus1);
+  (void)bv.get_expGolomb(); // sps_seq_parameter_set_id
+  unsigned chroma_format_idc = bv.get_expGolomb();
+  if (chroma_format_idc == 3) bv.skipBits(1); // separate_colour_plane_flag
+  unsigned pic_width_in_luma_samples = bv.get_expGolomb();
+  DEBUG_PRINT(pic_width_in_luma_samples);
+  unsigned pic_height_in_luma_samples = bv.get_expGolomb();
+  DEBUG_PRINT(pic_height_in_luma_samples);
+  Boolean conformance_window_flag = bv.get1BitBoolean();
+  if (conformance_window_flag) {
+    for (i = 0; i < 4; ++i) (void)bv.get_expGolomb(); // conf_win_{left,right,top,bottom}_offset
+  }
+  (void)bv.get_expGolomb(); // bit_depth_luma_minus8
+  (void)bv.get_expGolomb(); // bit_depth_chroma_minus8
+  unsigned log2_max_pic_order_cnt_lsb_minus4 = bv.get_expGolomb();
+  Boolean sps_sub_layer_ordering_info_present_flag = bv.get1BitBoolean();
+  for (i = sps_sub_layer_ordering_info_present_flag ? 0 : sps_max_sub_layers_minus1;
+       i <= sps_max_sub_layers_minus1; ++i) {
+    (void)bv.get_expGolomb(); // sps_max_dec_pic_buffering_minus1[i]
+    (void)bv.get_expGolomb(); // sps_max_num_reorder_pics[i]
+    (void)bv.get_expGolomb(); // sps_max_latency_increase_plus1[i]
+  }
+  (void)bv.get_expGolomb(); // log2_min_luma_coding_block_size_minus3
+  (void)bv.get_expGolomb(); // log2_diff_max_min_luma_coding_block_size
+  (void)bv.get_expGolomb(); // log2_min_luma_transform_block_size_minus2
+  (void)bv.get_expGolomb(); // log2_diff_max_min_luma_transform_block_size
+  (void)bv.get_expGolomb(); // max_transform_hierarchy_depth_inter
+  (void)bv.get_expGolomb(); // max_transform_hierarchy_depth_intra
+  Boolean scaling_list_enabled_flag = bv.get1BitBoolean();
+  if (scaling_list_enabled_flag) {
+    Boolean sps_scaling_list_data_present_flag = bv.get1BitBoolean();
+    if (sps_scaling_list_data_present_flag) {
+      // scaling_list_data():
+      for (unsigned sizeId = 0; sizeId < 4; ++sizeId) {
+	for (unsigned matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1) {
+	  Boolean scaling_list_pred_mode_flag = bv.get1BitBoolean();
+	  if (!scaling_list_pred_mode_flag) {
+	    (void)bv.get_expGolomb(); // scaling_list_pred_matrix_id_delta[sizeId][matrixId]
+	  } else {
+	    unsigned const coefNum = sizeId == 0 ? 16 : 64;
+	    if (sizeId > 1) {
+	      (void)bv.get_expGolomb(); // scaling_list_dc_coef_minus8[sizeId-2][matrixId]
+	    }
+	    for (i = 0; i < coefNum; ++i) {
+	      (void)bv.get_expGolomb(); // scaling_list_delta_coef
+	    }
+	  }
+	}
+      }
+    }
+  }
+  bv.skipBits(2); // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+  Boolean pcm_enabled_flag = bv.get1BitBoolean();
+  if (pcm_enabled_flag) {
+    bv.skipBits(8); // pcm_sample_bit_depth_luma_minus1, pcm_sample_bit_depth_chroma_minus1
+    (void)bv.get_expGolomb(); // log2_min_pcm_luma_coding_block_size_minus3
+    (void)bv.get_expGolomb(); // log2_diff_max_min_pcm_luma_coding_block_size
+    bv.skipBits(1); // pcm_loop_filter_disabled_flag
+  }
+  unsigned num_short_term_ref_pic_sets = bv.get_expGolomb();
+  DEBUG_PRINT(num_short_term_ref_pic_sets);
+  if (num_short_term_ref_pic_sets > MAX_NUM_SHORT_TERM_REF_PIC_SETS) return; // bad data
+  unsigned num_negative_pics = 0, prev_num_negative_pics = 0;
+  unsigned num_positive_pics = 0, prev_num_positive_pics = 0;
+  for (i = 0; i < num_short_term_ref_pic_sets; ++i) {
+    // st_ref_pic_set(i):
+    Boolean inter_ref_pic_set_prediction_flag = False;
+    if (i != 0) inter_ref_pic_set_prediction_flag = bv.get1BitBoolean();
+    if (inter_ref_pic_set_prediction_flag) {
+      // (In a SPS, the reference set is always the previous one.)
+      bv.skipBits(1); // delta_rps_sign
+      (void)bv.get_expGolomb(); // abs_delta_rps_minus1
+      unsigned numDeltaPocs = 0;
+      for (unsigned j = 0; j <= prev_num_negative_pics + prev_num_positive_pics; ++j) {
+	Boolean used_by_curr_pic_flag = bv.get1BitBoolean();
+	Boolean use_delta_flag = True;
+	if (!used_by_curr_pic_flag) use_delta_flag = bv.get1BitBoolean();
+	if (use_delta_flag) ++numDeltaPocs;
+      }
+      // We don't need the exact split between negative and positive pictures; just their total:
+      num_negative_pics = numDeltaPocs;
+      num_positive_pics = 0;
+    } else {
+      num_negative_pics = bv.get_expGolomb();
+      num_positive_pics = bv.get_expGolomb();
+      if (num_negative_pics > MAX_NUM_DELTA_POCS || num_positive_pics > MAX_NUM_DELTA_POCS) return; // bad data
+      for (unsigned j = 0; j < num_negative_pics + num_positive_pics; ++j) {
+	(void)bv.get_expGolomb(); // delta_poc_s0_minus1[j] (or delta_poc_s1_minus1[j])
+	bv.skipBits(1); // used_by_curr_pic_s0_flag[j] (or used_by_curr_pic_s1_flag[j])
+      }
+    }
+    if (num_negative_pics + num_positive_pics > MAX_NUM_DELTA_POCS) return; // bad data
+    prev_num_negative_pics = num_negative_pics;
+    prev_num_positive_pics = num_positive_pics;
+  }
+  Boolean long_term_ref_pics_present_flag = bv.get1BitBoolean();
+  if (long_term_ref_pics_present_flag) {
+    unsigned num_long_term_ref_pics_sps = bv.get_expGolomb();
+    if (num_long_term_ref_pics_sps > 32) return; // bad data
+    for (i = 0; i < num_long_term_ref_pics_sps; ++i) {
+      bv.skipBits(log2_max_pic_order_cnt_lsb_minus4 + 4); // lt_ref_pic_poc_lsb_sps[i]
+      bv.skipBits(1); // used_by_curr_pic_lt_sps_flag[i]
+    }
+  }
+  bv.skipBits(2); // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+  unsigned vui_parameters_present_flag = bv.get1Bit();
+  DEBUG_PRINT(vui_parameters_present_flag);
+  if (vui_parameters_present_flag) {
+    analyze_vui_parameters(bv, num_units_in_tick, time_scale);
+  }
+}
+
+void H265VideoStreamParser
+::analyze_vui_parameters(BitReader& bv, unsigned& num_units_in_tick, unsigned& time_scale) {
+  unsigned aspect_ratio_info_present_flag = bv.get1Bit();
+  if (aspect_ratio_info_present_flag) {
+    unsigned aspect_ratio_idc = bv.getBits(8);
+    if (aspect_ratio_idc == 255/*Extended_SAR*/) {
+      bv.skipBits(32); // sar_width; sar_height
+    }
+  }
+  unsigned overscan_info_present_flag = bv.get1Bit();
+  if (overscan_info_present_flag) {
+    bv.skipBits(1); // overscan_appropriate_flag
+  }
+  unsigned video_signal_type_present_flag = bv.get1Bit();
+  if (video_signal_type_present_flag) {
+    bv.skipBits(4); // video_format; video_full_range_flag
+    unsigned colour_description_present_flag = bv.get1Bit();
+    if (colour_description_present_flag) {
+      bv.skipBits(24); // colour_primaries; transfer_characteristics; matrix_coeffs
+    }
+  }
+  unsigned chroma_loc_info_present_flag = bv.get1Bit();
+  if (chroma_loc_info_present_flag) {
+    (void)bv.get_expGolomb(); // chroma_sample_loc_type_top_field
+    (void)bv.get_expGolomb(); // chroma_sample_loc_type_bottom_field
+  }
+  bv.skipBits(3); // neutral_chroma_indication_flag, field_seq_flag, frame_field_info_present_flag
+  unsigned default_display_window_flag = bv.get1Bit();
+  if (default_display_window_flag) {
+    (void)bv.get_expGolomb(); // def_disp_win_left_offset
+    (void)bv.get_expGolomb(); // def_disp_win_right_offset
+    (void)bv.get_expGolomb(); // def_disp_win_top_offset
+    (void)bv.get_expGolomb(); // def_disp_win_bottom_offset
+  }
+  unsigned vui_timing_info_present_flag = bv.get1Bit();
+  DEBUG_PRINT(vui_timing_info_present_flag);
+  if (vui_timing_info_present_flag) {
+    num_units_in_tick = bv.getBits(32);
+    DEBUG_PRINT(num_units_in_tick);
+    time_scale = bv.getBits(32);
+    DEBUG_PRINT(time_scale);
+  }
+  // We don't parse any more of the "vui_parameters", because we don't need the remaining fields (for our purpose)
+}
+
+void H265VideoStreamParser::flushInput() {
+  fHaveSeenFirstStartCode = False;
+  fHaveSeenFirstByteOfNALUnit = False;
+
+  StreamParser::flushInput();
+}
+
+// Whether a NAL unit of type "nal_unit_type" - when it follows a VCL NAL unit - begins a new 'access unit'.
+// (For VCL NAL units, this also depends on "first_slice_segment_in_pic_flag"; see section 7.4.2.4.4 of the
+// H.265 specification.)
+static Boolean nalUnitBeginsAccessUnit(u_int8_t nal_unit_type, u_int8_t firstByteAfterNALUnitHeader) {
+  if (nal_unit_type < 32) { // VCL
+    return (firstByteAfterNALUnitHeader&0x80) != 0; // first_slice_segment_in_pic_flag
+  }
+  return (nal_unit_type >= 32 && nal_unit_type <= 35) // VPS, SPS, PPS, or access unit delimiter
+    || nal_unit_type == 39 // prefix SEI
+    || (nal_unit_type >= 41 && nal_unit_type <= 44)
+    || (nal_unit_type >= 48 && nal_unit_type <= 55);
+}
+
+unsigned H265VideoStreamParser::parse() {
+  try {
+    // The stream must start with a 0x00000001:
+    if (!fHaveSeenFirstStartCode) {
+      // Skip over any input bytes that precede the first 0x00000001:
+      u_int32_t first4Bytes;
+      while ((first4Bytes = test4Bytes()) != 0x00000001) {
+	get1Byte(); setParseState(); // ensures that we progress over bad data
+      }
+      skipBytes(4); // skip this initial code
+
+      setParseState();
+      fHaveSeenFirstStartCode = True; // from now on
+    }
+
+    if (fOutputStartCodeSize > 0 && curFrameSize() == 0 && !haveSeenEOF()) {
+      // Include a start code in the output:
+      save4Bytes(0x00000001);
+    }
+
+    // Then save everything up until the next 0x00000001 (4 bytes) or 0x000001 (3 bytes), or we hit EOF.
+    // Also make note of the first byte, because it contains the "nal_unit_type":
+    if (haveSeenEOF()) {
+      // We hit EOF the last time that we tried to parse this data, so we know that any remaining unparsed data
+      // forms a complete NAL unit, and that there's no 'start code' at the end:
+      unsigned remainingDataSize = totNumValidBytes() - curOffset();
+      if (remainingDataSize > 0 && !fHaveSeenFirstByteOfNALUnit) {
+	testBytes(&fFirstByteOfNALUnit, 1);
+	fHaveSeenFirstByteOfNALUnit = True;
+      }
+      saveBytes(remainingDataSize);
+
+      (void)get1Byte(); // forces another read, which will cause EOF to get handled for real this time
+      return 0;
+    } else {
+      u_int32_t next4Bytes = test4Bytes();
+      if (!fHaveSeenFirstByteOfNALUnit) {
+	fFirstByteOfNALUnit = next4Bytes>>24;
+	fHaveSeenFirstByteOfNALUnit = True;
+      }
+      while (next4Bytes != 0x00000001 && (next4Bytes&0xFFFFFF00) != 0x00000100) {
+	// We save at least some of "next4Bytes".
+	if ((unsigned)(next4Bytes&0xFF) > 1) {
+	  // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it,
+	  // and then search (in bulk) for the next 0x000001, saving all of the data that precedes it.
+	  // (If that 0x000001 is preceded by 0x00 - i.e., is a 0x00000001 - then we leave that 0x00 unsaved for now.)
+	  save4Bytes(next4Bytes);
+	  skipBytes(4);
+	  setParseState(); // ensures forward progress
+
+	  Boolean foundStartCode;
+	  unsigned numBytesToSave = scanForStartCode(foundStartCode);
+	  if (foundStartCode && numBytesToSave > 0) --numBytesToSave;
+	  saveBytes(numBytesToSave);
+	} else {
+	  // Save the first byte, and continue testing the rest:
+	  saveByte(next4Bytes>>24);
+	  skipBytes(1);
+	}
+	setParseState(); // ensures forward progress
+	next4Bytes = test4Bytes();
+      }
+      // Assert: next4Bytes starts with 0x00000001 or 0x000001, and we've saved all previous bytes (forming a complete NAL unit).
+      // Skip over these remaining bytes, up until the start of the next NAL unit:
+      if (next4Bytes == 0x00000001) {
+	skipBytes(4);
+      } else {
+	skipBytes(3);
+      }
+    }
+
+    u_int8_t nal_unit_type = (fFirstByteOfNALUnit&0x7E)>>1;
+    fHaveSeenFirstByteOfNALUnit = False; // for the next NAL unit that we parse
+#ifdef DEBUG
+    fprintf(stderr, "Parsed %d-byte NAL-unit (nal_unit_type: %d)\n", curFrameSize()-fOutputStartCodeSize, nal_unit_type);
+#endif
+
+    unsigned num_units_in_tick = 0, time_scale = 0;
+    switch (nal_unit_type) {
+      case 32: { // Video parameter set (VPS)
+	// First, save a copy of this NAL unit, in case the downstream object wants to see it:
+	usingSource()->saveCopyOfVPS(fStartOfFrame + fOutputStartCodeSize, fTo - fStartOfFrame - fOutputStartCodeSize);
+
+	// Parse this NAL unit to check whether frame rate information is present:
+	analyze_video_parameter_set_data(num_units_in_tick, time_scale);
+	break;
+      }
+      case 33: { // Sequence parameter set (SPS)
+	// First, save a copy of this NAL unit, in case the downstream object wants to see it:
+	usingSource()->saveCopyOfSPS(fStartOfFrame + fOutputStartCodeSize, fTo - fStartOfFrame - fOutputStartCodeSize);
+
+	// Parse this NAL unit to check whether frame rate information is present:
+	analyze_seq_parameter_set_data(num_units_in_tick, time_scale);
+	break;
+      }
+      case 34: { // Picture parameter set (PPS)
+	// Save a copy of this NAL unit, in case the downstream object wants to see it:
+	usingSource()->saveCopyOfPPS(fStartOfFrame + fOutputStartCodeSize, fTo - fStartOfFrame - fOutputStartCodeSize);
+	break;
+      }
+    }
+    if (time_scale > 0 && num_units_in_tick > 0) {
+      // (Unlike H.264, these values give the picture - not field - rate directly.)
+      usingSource()->fFrameRate = time_scale/(double)num_units_in_tick;
+#ifdef DEBUG
+      fprintf(stderr, "Set frame rate to %f fps\n", usingSource()->fFrameRate);
+#endif
+    }
+
+    usingSource()->setPresentationTime();
+#ifdef DEBUG
+    unsigned long secs = (unsigned long)usingSource()->fPresentationTime.tv_sec;
+    unsigned uSecs = (unsigned)usingSource()->fPresentationTime.tv_usec;
+    fprintf(stderr, "\tPresentation time: %lu.%06u\n", secs, uSecs);
+#endif
+
+    // If this NAL unit is one that can come after the first VCL NAL unit of an 'access unit' (i.e., a VCL NAL unit,
+    // or a NAL unit that can only follow one), then we also look at the start of the next NAL unit, to determine whether
+    // this NAL unit ends the current 'access unit'.  We need this information to figure out when to increment
+    // "fPresentationTime".  (RTP streamers also need to know this in order to figure out whether or not to set the "M" bit.)
+    Boolean thisNALUnitEndsAccessUnit = False; // until we learn otherwise
+    if (haveSeenEOF()) {
+      // There is no next NAL unit, so we assume that this one ends the current 'access unit':
+      thisNALUnitEndsAccessUnit = True;
+    } else if (nal_unit_type == 36/*end of sequence*/ || nal_unit_type == 37/*end of bitstream*/) {
+      // These NAL units are always the last in an 'access unit':
+      thisNALUnitEndsAccessUnit = True;
+    } else if (nal_unit_type < 32/*VCL*/ || nal_unit_type == 38/*filler data*/ || nal_unit_type == 40/*suffix SEI*/
+	       || (nal_unit_type >= 45 && nal_unit_type <= 47) || nal_unit_type >= 56) {
+      u_int8_t startOfNextNALUnit[3]; // the 2-byte NAL unit header, plus the next byte
+      testBytes(startOfNextNALUnit, sizeof startOfNextNALUnit);
+      u_int8_t next_nal_unit_type = (startOfNextNALUnit[0]&0x7E)>>1;
+      thisNALUnitEndsAccessUnit = nalUnitBeginsAccessUnit(next_nal_unit_type, startOfNextNALUnit[2]);
+    }
+
+    if (thisNALUnitEndsAccessUnit) {
+#ifdef DEBUG
+      fprintf(stderr, "*****This NAL unit ends the current access unit*****\n");
+#endif
+      usingSource()->fPictureEndMarker = True;
+      ++usingSource()->fPictureCount;
+
+      // Note that the presentation time for the next NAL unit will be different:
+      struct timeval& nextPT = usingSource()->fNextPresentationTime; // alias
+      nextPT = usingSource()->fPresentationTime;
+      double nextFraction = nextPT.tv_usec/1000000.0 + 1/usingSource()->fFrameRate;
+      unsigned nextSecsIncrement = (long)nextFraction;
+      nextPT.tv_sec += (long)nextSecsIncrement;
+      nextPT.tv_usec = (long)((nextFraction - nextSecsIncrement)*1000000);
+    }
+    setParseState();
+
+    return curFrameSize();
+  } catch (int /*e*/) {
+#ifdef DEBUG
+    fprintf(stderr, "H265VideoStreamParser::parse() EXCEPTION (This is normal behavior - *not* an error)\n");
+#endif
+    return 0;  // the parsing got interrupted
+  }
+}
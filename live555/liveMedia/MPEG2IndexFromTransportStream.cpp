@@ -34,6 +34,13 @@ enum RecordType {
   RECORD_NAL_NON_IFRAME = 8, // H.264	
   RECORD_NAL_IFRAME = 9, // H.264	
   RECORD_NAL_OTHER = 10, // H.264	
+  RECORD_NAL_H265_VPS = 11, // H.265
+  RECORD_NAL_H265_SPS = 12, // H.265
+  RECORD_NAL_H265_PPS = 13, // H.265
+  RECORD_NAL_H265_SEI = 14, // H.265
+  RECORD_NAL_H265_NON_IFRAME = 15, // H.265
+  RECORD_NAL_H265_IFRAME = 16, // H.265
+  RECORD_NAL_H265_OTHER = 17, // H.265
   RECORD_JUNK
 };
 
@@ -80,6 +87,13 @@ static char const* recordTypeStr[] = {
   "H.264 non-I-frame",
   "H.264 I-frame",
   "other NAL unit (H.264)",
+  "VPS (H.265)",
+  "SPS (H.265)",
+  "PPS (H.265)",
+  "SEI (H.265)",
+  "H.265 non-I-frame",
+  "H.265 I-frame",
+  "other NAL unit (H.265)",
   "JUNK"
 };
 UsageEnvironment& operator<<(UsageEnvironment& env, IndexRecord& r) {
@@ -113,12 +127,12 @@ MPEG2IFrameIndexFromTransportStream
 ::MPEG2IFrameIndexFromTransportStream(UsageEnvironment& env,
 				      FramedSource* inputSource)
   : FramedFilter(env, inputSource),
-    fIsH264(False), fInputTransportPacketCounter((unsigned)-1), fClosureNumber(0),
+    fIsH264(False), fIsH265(False), fInputTransportPacketCounter((unsigned)-1), fClosureNumber(0),
     fLastContinuityCounter(~0),
     fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False),
     fPMT_PID(0x10), fVideo_PID(0xE0), // default values
     fParseBufferSize(PARSE_BUFFER_SIZE),
-    fParseBufferFrameStart(0), fParseBufferParseEnd(4), fParseBufferDataEnd(0),
+    fParseBufferFrameStart(0), fParseBufferParseEnd(4), fParseBufferDataEnd(0), fNumInitialBadBytes(0),
     fHeadIndexRecord(NULL), fTailIndexRecord(NULL) {
   fParseBuffer = new unsigned char[fParseBufferSize];
 }
@@ -140,15 +154,10 @@ void MPEG2IFrameIndexFromTransportStream::doGetNextFrame() {
   }
 
   // We need to read some more Transport Stream packets.  Check whether we have room:
-  if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
-    // There's no room left.  Compact the buffer, and check again:
-    compactParseBuffer();
-    if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
-      envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
-      // Treat this as if the input source ended:
-      handleInputClosure1();
-      return;
-    }
+  if (!haveRoomForPacket()) {
+    // Treat this as if the input source ended:
+    handleInputClosure1();
+    return;
   }
 
   // Arrange to read a new Transport Stream packet:
@@ -175,7 +184,7 @@ void MPEG2IFrameIndexFromTransportStream
 		     unsigned numTruncatedBytes,
 		     struct timeval presentationTime,
 		     unsigned durationInMicroseconds) {
-  if (frameSize < TRANSPORT_PACKET_SIZE || fInputBuffer[0] != TRANSPORT_SYNC_BYTE) {
+  if (frameSize < TRANSPORT_PACKET_SIZE) {
     if (fInputBuffer[0] != TRANSPORT_SYNC_BYTE) {
       envir() << "Bad TS sync byte: 0x" << fInputBuffer[0] << "\n";
     }
@@ -184,22 +193,39 @@ void MPEG2IFrameIndexFromTransportStream
     return;
   }
 
+  if (!addTransportPacket(fInputBuffer)) {
+    // Handle this as if the source ended:
+    handleInputClosure1();
+    return;
+  }
+
+  // Try again:
+  doGetNextFrame();
+}
+
+Boolean MPEG2IFrameIndexFromTransportStream::addTransportPacket(unsigned char const* pkt) {
+  if (pkt[0] != TRANSPORT_SYNC_BYTE) {
+    envir() << "Bad TS sync byte: 0x" << pkt[0] << "\n";
+    return False;
+  }
+  if (pkt != fInputBuffer && !haveRoomForPacket()) return False;
+
   ++fInputTransportPacketCounter;
 
   // Figure out how much of this Transport Packet contains PES data:
-  u_int8_t adaptation_field_control = (fInputBuffer[3]&0x30)>>4;
+  u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
   u_int8_t totalHeaderSize
-    = adaptation_field_control == 1 ? 4 : 5 + fInputBuffer[4];
+    = adaptation_field_control == 1 ? 4 : 5 + pkt[4];
 
   // Check for a PCR:
-  if (totalHeaderSize > 5 && (fInputBuffer[5]&0x10) != 0) {
+  if (totalHeaderSize > 5 && (pkt[5]&0x10) != 0) {
     // There's a PCR:
     u_int32_t pcrBaseHigh
-      = (fInputBuffer[6]<<24)|(fInputBuffer[7]<<16)
-      |(fInputBuffer[8]<<8)|fInputBuffer[9];
+      = (pkt[6]<<24)|(pkt[7]<<16)
+      |(pkt[8]<<8)|pkt[9];
     float pcr = pcrBaseHigh/45000.0f;
-    if ((fInputBuffer[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
-    unsigned short pcrExt = ((fInputBuffer[10]&0x01)<<8) | fInputBuffer[11];
+    if ((pkt[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
+    unsigned short pcrExt = ((pkt[10]&0x01)<<8) | pkt[11];
     pcr += pcrExt/27000000.0f;
 
     if (!fHaveSeenFirstPCR) {
@@ -216,51 +242,96 @@ void MPEG2IFrameIndexFromTransportStream
   }
 
   // Get the PID from the packet, and check for special tables: the PAT and PMT:
-  u_int16_t PID = ((fInputBuffer[1]&0x1F)<<8) | fInputBuffer[2];
+  u_int16_t PID = ((pkt[1]&0x1F)<<8) | pkt[2];
   if (PID == PAT_PID) {
-    analyzePAT(&fInputBuffer[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+    analyzePAT(&pkt[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
   } else if (PID == fPMT_PID) {
-    analyzePMT(&fInputBuffer[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+    analyzePMT(&pkt[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
   }
 
   // Ignore transport packets for non-video programs,
   // or packets with no data, or packets that duplicate the previous packet:
-  u_int8_t continuity_counter = fInputBuffer[3]&0x0F;
+  u_int8_t continuity_counter = pkt[3]&0x0F;
   if ((PID != fVideo_PID) ||
       !(adaptation_field_control == 1  || adaptation_field_control == 3) ||
       continuity_counter == fLastContinuityCounter) {
-    doGetNextFrame();
-    return;
+    return True;
   }
   fLastContinuityCounter = continuity_counter;
 
   // Also, if this is the start of a PES packet, then skip over the PES header:
-  Boolean payload_unit_start_indicator = (fInputBuffer[1]&0x40) != 0;
+  Boolean payload_unit_start_indicator = (pkt[1]&0x40) != 0;
   //fprintf(stderr, "PUSI: %d\n", payload_unit_start_indicator);//#####
   if (payload_unit_start_indicator) {
     // Note: The following works only for MPEG-2 data #####
-    u_int8_t PES_header_data_length = fInputBuffer[totalHeaderSize+8];
+    u_int8_t PES_header_data_length = pkt[totalHeaderSize+8];
     //fprintf(stderr, "PES_header_data_length: %d\n", PES_header_data_length);//#####
     totalHeaderSize += 9 + PES_header_data_length;
     if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) {
       envir() << "Unexpectedly large PES header size: " << PES_header_data_length << "\n";
-      // Handle this as if the source ended:
-      handleInputClosure1();
-      return;
+      return False;
     }
   }
 
   // The remaining data is Video Elementary Stream data.  Add it to our parse buffer:
   unsigned vesSize = TRANSPORT_PACKET_SIZE - totalHeaderSize;
-  memmove(&fParseBuffer[fParseBufferDataEnd], &fInputBuffer[totalHeaderSize], vesSize);
+  memmove(&fParseBuffer[fParseBufferDataEnd], &pkt[totalHeaderSize], vesSize);
   fParseBufferDataEnd += vesSize;
 
   // And add a new index record noting where it came from:
   addToTail(new IndexRecord(totalHeaderSize, vesSize, fInputTransportPacketCounter,
 			    fLastPCR - fFirstPCR));
+  return True;
+}
 
-  // Try again:
-  doGetNextFrame();
+Boolean MPEG2IFrameIndexFromTransportStream::getNextIndexRecord(u_int8_t* to) {
+  while (1) {
+    // Begin by trying to return an index record (for an already-parsed frame):
+    IndexRecord* record = dequeueIndexRecord();
+    if (record != NULL) {
+      packIndexRecord(*record, to);
+      delete record;
+      return True;
+    }
+
+    // No more index records are left, so try to parse a new frame:
+    if (!parseFrame()) return False; // we need more data
+  }
+}
+
+void MPEG2IFrameIndexFromTransportStream::noteEndOfInput() {
+  addEndOfInputCode();
+}
+
+void MPEG2IFrameIndexFromTransportStream::getParseState(ParseState& state) const {
+  state.isH264 = fIsH264; state.isH265 = fIsH265;
+  state.PMT_PID = fPMT_PID; state.video_PID = fVideo_PID;
+  state.lastContinuityCounter = fLastContinuityCounter;
+  state.haveSeenFirstPCR = fHaveSeenFirstPCR;
+  state.firstPCR = fFirstPCR; state.lastPCR = fLastPCR;
+}
+
+void MPEG2IFrameIndexFromTransportStream
+::setParseState(ParseState const& state, unsigned long nextTransportPacketNumber) {
+  fIsH264 = state.isH264; fIsH265 = state.isH265;
+  fPMT_PID = state.PMT_PID; fVideo_PID = state.video_PID;
+  fLastContinuityCounter = state.lastContinuityCounter;
+  fHaveSeenFirstPCR = state.haveSeenFirstPCR;
+  fFirstPCR = state.firstPCR; fLastPCR = state.lastPCR;
+  fInputTransportPacketCounter = nextTransportPacketNumber - 1;
+}
+
+Boolean MPEG2IFrameIndexFromTransportStream::haveRoomForPacket() {
+  if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
+    // There's no room left.  Compact the buffer, and check again:
+    compactParseBuffer();
+    if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
+      envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
+      return False;
+    }
+  }
+
+  return True;
 }
 
 void MPEG2IFrameIndexFromTransportStream::handleInputClosure(void* clientData) {
@@ -277,26 +348,33 @@ void MPEG2IFrameIndexFromTransportStream::handleInputClosure(void* clientData) {
 #define VOP_START_CODE 0xB6			// MPEG-4
 
 void MPEG2IFrameIndexFromTransportStream::handleInputClosure1() {
+  if (addEndOfInputCode()) {
+    // Try again:
+    doGetNextFrame();
+  } else {
+    // Handle closure in the regular way:
+    FramedSource::handleClosure(this);
+  }
+}
+
+Boolean MPEG2IFrameIndexFromTransportStream::addEndOfInputCode() {
   if (++fClosureNumber == 1 && fParseBufferDataEnd > fParseBufferFrameStart
       && fParseBufferDataEnd <= fParseBufferSize - 4) {
     // This is the first time we saw EOF, and there's still data remaining to be
     // parsed.  Hack: Append a Picture Header code to the end of the unparsed
-    // data, and try again.  This should use up all of the unparsed data.
+    // data.  This should use up all of the unparsed data.
     fParseBuffer[fParseBufferDataEnd++] = 0;
     fParseBuffer[fParseBufferDataEnd++] = 0;
     fParseBuffer[fParseBufferDataEnd++] = 1;
     fParseBuffer[fParseBufferDataEnd++] = PICTURE_START_CODE;
-
-    // Try again:
-    doGetNextFrame();
-  } else {
-    // Handle closure in the regular way:
-    FramedSource::handleClosure(this);
+    return True;
   }
+
+  return False;
 }
 
 void MPEG2IFrameIndexFromTransportStream
-::analyzePAT(unsigned char* pkt, unsigned size) {
+::analyzePAT(unsigned char const* pkt, unsigned size) {
   // Get the PMT_PID:
   while (size >= 17) { // The table is large enough
     u_int16_t program_number = (pkt[9]<<8) | pkt[10];
@@ -310,7 +388,7 @@ void MPEG2IFrameIndexFromTransportStream
 }
 
 void MPEG2IFrameIndexFromTransportStream
-::analyzePMT(unsigned char* pkt, unsigned size) {
+::analyzePMT(unsigned char const* pkt, unsigned size) {
   // Scan the "elementary_PID"s in the map, until we see the first video stream.
 
   // First, get the "section_length", to get the table's size:
@@ -329,8 +407,9 @@ void MPEG2IFrameIndexFromTransportStream
   while (size >= 9) {
     u_int8_t stream_type = pkt[0];
     u_int16_t elementary_PID = ((pkt[1]&0x1F)<<8) | pkt[2];
-    if (stream_type == 1 || stream_type == 2 || stream_type == 0x1B/*H.264 video*/) {
+    if (stream_type == 1 || stream_type == 2 || stream_type == 0x1B/*H.264 video*/ || stream_type == 0x24/*H.265 video*/) {
 	if (stream_type == 0x1B) fIsH264 = True;
+	else if (stream_type == 0x24) fIsH265 = True;
 	fVideo_PID = elementary_PID;
       return;
     }
@@ -343,28 +422,9 @@ void MPEG2IFrameIndexFromTransportStream
 }
 
 Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecord() {
-  IndexRecord* head = fHeadIndexRecord;
+  IndexRecord* head = dequeueIndexRecord();
   if (head == NULL) return False;
 
-  // Check whether the head record has been parsed yet:
-  if (head->recordType() == RECORD_UNPARSED) return False;
-
-  // Remove the head record (the one whose data we'll be delivering):
-  IndexRecord* next = head->next();
-  head->unlink();
-  if (next == head) {
-    fHeadIndexRecord = fTailIndexRecord = NULL;
-  } else {
-    fHeadIndexRecord = next;
-  }
-
-  if (head->recordType() == RECORD_JUNK) {
-    // Don't actually deliver the data to the client:
-    delete head;
-    // Try to deliver the next record instead:
-    return deliverIndexRecord();
-  }
-
   // Deliver data from the head record:
 #ifdef DEBUG
   envir() << "delivering: " << *head << "\n";
@@ -372,23 +432,7 @@ Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecord() {
   if (fMaxSize < 11) {
     fFrameSize = 0;
   } else {
-    fTo[0] = (u_int8_t)(head->recordType());
-    fTo[1] = head->startOffset();
-    fTo[2] = head->size();
-    // Deliver the PCR, as 24 bits (integer part; little endian) + 8 bits (fractional part)
-    float pcr = head->pcr();
-    unsigned pcr_int = (unsigned)pcr;
-    u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
-    fTo[3] = (unsigned char)(pcr_int);
-    fTo[4] = (unsigned char)(pcr_int>>8);
-    fTo[5] = (unsigned char)(pcr_int>>16);
-    fTo[6] = (unsigned char)(pcr_frac);
-    // Deliver the transport packet number (in little-endian order):
-    unsigned long tpn = head->transportPacketNumber();
-    fTo[7] = (unsigned char)(tpn);
-    fTo[8] = (unsigned char)(tpn>>8);
-    fTo[9] = (unsigned char)(tpn>>16);
-    fTo[10] = (unsigned char)(tpn>>24);
+    packIndexRecord(*head, fTo);
     fFrameSize = 11;
   }
 
@@ -400,17 +444,60 @@ Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecord() {
   return True;
 }
 
+IndexRecord* MPEG2IFrameIndexFromTransportStream::dequeueIndexRecord() {
+  while (1) {
+    IndexRecord* head = fHeadIndexRecord;
+    if (head == NULL) return NULL;
+
+    // Check whether the head record has been parsed yet:
+    if (head->recordType() == RECORD_UNPARSED) return NULL;
+
+    // Remove the head record:
+    IndexRecord* next = head->next();
+    head->unlink();
+    if (next == head) {
+      fHeadIndexRecord = fTailIndexRecord = NULL;
+    } else {
+      fHeadIndexRecord = next;
+    }
+
+    if (head->recordType() != RECORD_JUNK) return head;
+
+    // Don't return 'junk' records; try the next record instead:
+    delete head;
+  }
+}
+
+void MPEG2IFrameIndexFromTransportStream::packIndexRecord(IndexRecord& record, u_int8_t* to) {
+  to[0] = (u_int8_t)(record.recordType());
+  to[1] = record.startOffset();
+  to[2] = record.size();
+  // Deliver the PCR, as 24 bits (integer part; little endian) + 8 bits (fractional part)
+  float pcr = record.pcr();
+  unsigned pcr_int = (unsigned)pcr;
+  u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
+  to[3] = (unsigned char)(pcr_int);
+  to[4] = (unsigned char)(pcr_int>>8);
+  to[5] = (unsigned char)(pcr_int>>16);
+  to[6] = (unsigned char)(pcr_frac);
+  // Deliver the transport packet number (in little-endian order):
+  unsigned long tpn = record.transportPacketNumber();
+  to[7] = (unsigned char)(tpn);
+  to[8] = (unsigned char)(tpn>>8);
+  to[9] = (unsigned char)(tpn>>16);
+  to[10] = (unsigned char)(tpn>>24);
+}
+
 Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
   // At this point, we have a queue of >=0 (unparsed) index records, representing
   // the data in the parse buffer from "fParseBufferFrameStart"
   // to "fParseBufferDataEnd".  We now parse through this data, looking for
   // a complete 'frame', where a 'frame', in this case, means:
   // 	for MPEG video: a Video Sequence Header, GOP Header, Picture Header, or Slice
-  // 	for H.264 video: a NAL unit
+  // 	for H.264 or H.265 video: a NAL unit
 
   // Inspect the frame's initial 4-byte code, to make sure it starts with a system code:
   if (fParseBufferDataEnd-fParseBufferFrameStart < 4) return False; // not enough data
-  unsigned numInitialBadBytes = 0;
   unsigned char const* p = &fParseBuffer[fParseBufferFrameStart];
   if (!(p[0] == 0 && p[1] == 0 && p[2] == 1)) {
     // There's no system code at the beginning.  Parse until we find one:
@@ -421,8 +508,13 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
     unsigned char nextCode;
     if (!parseToNextCode(nextCode)) return False;
 
-    numInitialBadBytes = fParseBufferParseEnd - fParseBufferFrameStart;
-    //fprintf(stderr, "#####numInitialBadBytes: %d (0x%x)\n", numInitialBadBytes, numInitialBadBytes);
+    // Note: We remember the number of these 'bad' bytes, because we might not finish parsing this frame until a later call.
+    // (Before we did this, a file whose video data doesn't begin with a start code - e.g., a recording of a stream that
+    // was joined mid-way - usually had every later record boundary shifted by this number of bytes, so the index of such
+    // a file now differs from what earlier versions of this code produced.  Files that begin with a start code are
+    // indexed as before.)
+    fNumInitialBadBytes = fParseBufferParseEnd - fParseBufferFrameStart;
+    //fprintf(stderr, "#####numInitialBadBytes: %d (0x%x)\n", fNumInitialBadBytes, fNumInitialBadBytes);
     fParseBufferFrameStart = fParseBufferParseEnd;
     fParseBufferParseEnd += 4; // skip over the code that we just saw
     p = &fParseBuffer[fParseBufferFrameStart];
@@ -430,9 +522,29 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
 
   unsigned char curCode = p[3];
   if (fIsH264) curCode &= 0x1F; // nal_unit_type
+  else if (fIsH265) curCode = (curCode&0x7E)>>1; // nal_unit_type
   RecordType curRecordType;
   unsigned char nextCode;
-  switch (curCode) {
+  if (fIsH265) {
+    // H.265 "nal_unit_type"s overlap the codes below, so we handle them separately:
+    if (curCode == 32) curRecordType = RECORD_NAL_H265_VPS; // Video parameter set (VPS)
+    else if (curCode == 33) curRecordType = RECORD_NAL_H265_SPS; // Sequence parameter set (SPS)
+    else if (curCode == 34) curRecordType = RECORD_NAL_H265_PPS; // Picture parameter set (PPS)
+    else if (curCode >= 16 && curCode <= 23) curRecordType = RECORD_NAL_H265_IFRAME; // Coded slice segment of an IRAP picture
+    else if (curCode <= 9) curRecordType = RECORD_NAL_H265_NON_IFRAME; // Coded slice segment of some other picture
+    else if (curCode == 39 || curCode == 40) curRecordType = RECORD_NAL_H265_SEI; // Supplemental enhancement information (SEI)
+    else curRecordType = RECORD_NAL_H265_OTHER;
+    if (!parseToNextCode(nextCode)) return False;
+  } else if (fIsH264) {
+    // (Note: Only H.264 streams get checked for these codes, because, in MPEG-1 or 2, they are the codes of slices.)
+    if (curCode == 1) curRecordType = RECORD_NAL_NON_IFRAME; // Coded slice of a non-IDR picture
+    else if (curCode == 5) curRecordType = RECORD_NAL_IFRAME; // Coded slice of an IDR picture
+    else if (curCode == 6) curRecordType = RECORD_NAL_SEI; // Supplemental enhancement information (SEI)
+    else if (curCode == 7) curRecordType = RECORD_NAL_SPS; // Sequence parameter set (SPS)
+    else if (curCode == 8) curRecordType = RECORD_NAL_PPS; // Picture parameter set (PPS)
+    else curRecordType = RECORD_NAL_OTHER;
+    if (!parseToNextCode(nextCode)) return False;
+  } else switch (curCode) {
   case VIDEO_SEQUENCE_START_CODE:
   case VISUAL_OBJECT_SEQUENCE_START_CODE: {
     curRecordType = RECORD_VSH;
@@ -454,39 +566,14 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
     }
     break;
   }
-  case 1: // Coded slice of a non-IDR picture (H.264)
-    curRecordType = RECORD_NAL_NON_IFRAME;
-    if (!parseToNextCode(nextCode)) return False;
-    break;
-  case 5: // Coded slice of an IDR picture (H.264) 
-    curRecordType = RECORD_NAL_IFRAME;
-    if (!parseToNextCode(nextCode)) return False;
-    break;
-  case 6: // Supplemental enhancement information (SEI) (H.264)
-    curRecordType = RECORD_NAL_SEI;
-    if (!parseToNextCode(nextCode)) return False;
-    break;
-  case 7: // Sequence parameter set (SPS) (H.264)
-    curRecordType = RECORD_NAL_SPS;
-    if (!parseToNextCode(nextCode)) return False;
-    break;
-  case 8: // Picture parameter set (PPS) (H.264)
-    curRecordType = RECORD_NAL_PPS;
-    if (!parseToNextCode(nextCode)) return False;
-    break;
-  default: { // picture (including slices), or some other H.264 NAL unit
-    if (fIsH264) {
-      curRecordType = RECORD_NAL_OTHER;
+  default: { // picture (including slices)
+    curRecordType = RECORD_PIC_NON_IFRAME; // may get changed to IFRAME later
+    while (1) {
       if (!parseToNextCode(nextCode)) return False;
-    } else {
-      curRecordType = RECORD_PIC_NON_IFRAME; // may get changed to IFRAME later
-      while (1) {
-        if (!parseToNextCode(nextCode)) return False;
-        if (nextCode == VIDEO_SEQUENCE_START_CODE || nextCode == VISUAL_OBJECT_SEQUENCE_START_CODE ||
-	    nextCode == GROUP_START_CODE || nextCode == GROUP_VOP_START_CODE ||
-	    nextCode == PICTURE_START_CODE || nextCode == VOP_START_CODE) break;
-        fParseBufferParseEnd += 4; // skip over the code that we just saw
-      }
+      if (nextCode == VIDEO_SEQUENCE_START_CODE || nextCode == VISUAL_OBJECT_SEQUENCE_START_CODE ||
+	  nextCode == GROUP_START_CODE || nextCode == GROUP_VOP_START_CODE ||
+	  nextCode == PICTURE_START_CODE || nextCode == VOP_START_CODE) break;
+      fParseBufferParseEnd += 4; // skip over the code that we just saw
     }
     break;
   }
@@ -510,20 +597,27 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
 
   // There is now a parsed 'frame', from "fParseBufferFrameStart"
   // to "fParseBufferParseEnd". Tag the corresponding index records to note this:
+  unsigned numInitialBadBytes = fNumInitialBadBytes;
+  fNumInitialBadBytes = 0;
   unsigned frameSize = fParseBufferParseEnd - fParseBufferFrameStart + numInitialBadBytes;
 #ifdef DEBUG
   envir() << "parsed " << recordTypeStr[curRecordType] << "; length "
 	  << frameSize << "\n";
 #endif
+  Boolean isFirstRecord = True;
   for (IndexRecord* r = fHeadIndexRecord; ; r = r->next()) {
     if (numInitialBadBytes >= r->size()) {
       r->recordType() = RECORD_JUNK;
       numInitialBadBytes -= r->size();
     } else {
       r->recordType() = curRecordType;
+      if (isFirstRecord) {
+	r->setFirstFlag();
+	// indicates that this is the first record for this frame
+	// (Note: 'junk' records - which are never delivered - don't get this flag.)
+	isFirstRecord = False;
+      }
     }
-    if (r == fHeadIndexRecord) r->setFirstFlag();
-    // indicates that this is the first record for this frame
 
     if (r->size() > frameSize) {
       // This record contains extra data that's not part of the frame.
@@ -610,6 +704,26 @@ void MPEG2IFrameIndexFromTransportStream::addToTail(IndexRecord* newIndexRecord)
   }
 }
 
+////////// MPEG2IFrameIndexFromTransportStream::ParseState implementation //////////
+
+MPEG2IFrameIndexFromTransportStream::ParseState::ParseState()
+  : isH264(False), isH265(False),
+    PMT_PID(0x10), video_PID(0xE0), // default values
+    lastContinuityCounter(~0),
+    haveSeenFirstPCR(False), firstPCR(0.0), lastPCR(0.0) {
+}
+
+Boolean MPEG2IFrameIndexFromTransportStream::ParseState::parsesLike(ParseState const& other) const {
+  return isH264 == other.isH264 && isH265 == other.isH265
+    && PMT_PID == other.PMT_PID && video_PID == other.video_PID
+    && lastContinuityCounter == other.lastContinuityCounter;
+}
+
+Boolean MPEG2IFrameIndexFromTransportStream::ParseState::operator==(ParseState const& other) const {
+  return parsesLike(other) && haveSeenFirstPCR == other.haveSeenFirstPCR
+    && firstPCR == other.firstPCR && lastPCR == other.lastPCR;
+}
+
 ////////// IndexRecord implementation //////////
 
 IndexRecord::IndexRecord(u_int8_t startOffset, u_int8_t size,
@@ -21,6 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MPEG2TransportFileServerMediaSubsession.hh"
 #include "SimpleRTPSink.hh"
+#include "InputFile.hh"
 
 MPEG2TransportFileServerMediaSubsession*
 MPEG2TransportFileServerMediaSubsession::createNew(UsageEnvironment& env,
@@ -45,10 +46,12 @@ MPEG2TransportFileServerMediaSubsession
 					  MPEG2TransportStreamIndexFile* indexFile,
 					  Boolean reuseFirstSource)
   : FileServerMediaSubsession(env, fileName, reuseFirstSource),
-    fIndexFile(indexFile), fDuration(0.0), fClientSessionHashTable(NULL) {
+    fIndexFile(indexFile), fDuration(0.0), fClientSessionHashTable(NULL),
+    fNumTrickPlayFiles(0), fTrickPlayFileScales(NULL), fTrickPlayFileNames(NULL), fTrickPlayIndexFiles(NULL) {
   if (fIndexFile != NULL) { // we support 'trick play'
     fDuration = fIndexFile->getPlayingDuration();
     fClientSessionHashTable = HashTable::create(ONE_WORD_HASH_KEYS);
+    findTrickPlayFiles();
   }
 }
 
@@ -66,6 +69,82 @@ MPEG2TransportFileServerMediaSubsession
     }
     delete fClientSessionHashTable;
   }
+
+  for (unsigned i = 0; i < fNumTrickPlayFiles; ++i) {
+    delete[] fTrickPlayFileNames[i];
+    Medium::close(fTrickPlayIndexFiles[i]);
+  }
+  delete[] fTrickPlayFileScales; delete[] fTrickPlayFileNames; delete[] fTrickPlayIndexFiles;
+}
+
+char* MPEG2TransportFileServerMediaSubsession::trickPlayFileName(char const* dataFileName, int scale) {
+  // Remove the data file name's ".ts" suffix (if any):
+  unsigned prefixLen = strlen(dataFileName);
+  if (prefixLen > 3 && strcmp(&dataFileName[prefixLen-3], ".ts") == 0) prefixLen -= 3;
+
+  char* fileName = new char[prefixLen + 20];
+  sprintf(fileName, "%.*s.%s%d.ts", prefixLen, dataFileName, scale > 0 ? "ff" : "rw", scale > 0 ? scale : -scale);
+  return fileName;
+}
+
+Boolean MPEG2TransportFileServerMediaSubsession
+::lookupTrickPlayFile(int scale, char const*& fileName, MPEG2TransportStreamIndexFile*& indexFile) const {
+  for (unsigned i = 0; i < fNumTrickPlayFiles; ++i) {
+    if (fTrickPlayFileScales[i] == scale) {
+      fileName = fTrickPlayFileNames[i];
+      indexFile = fTrickPlayIndexFiles[i];
+      return True;
+    }
+  }
+
+  return False;
+}
+
+void MPEG2TransportFileServerMediaSubsession::findTrickPlayFiles() {
+  // Look for precomputed 'trick play' files (and their index files) for each possible scale:
+  unsigned const maxNumTrickPlayFiles = 2*(MAX_PRECOMPUTED_TRICK_PLAY_SCALE-1);
+  for (int scale = -MAX_PRECOMPUTED_TRICK_PLAY_SCALE; scale <= MAX_PRECOMPUTED_TRICK_PLAY_SCALE; ++scale) {
+    if (scale >= -1 && scale <= 1) continue;
+
+    char* fileName = trickPlayFileName(fFileName, scale);
+    MPEG2TransportStreamIndexFile* indexFile = NULL;
+    if (GetFileSize(fileName, NULL) > 0) {
+      char* indexFileName = new char[strlen(fileName) + 2]; // allow for trailing x\0
+      sprintf(indexFileName, "%sx", fileName);
+      indexFile = MPEG2TransportStreamIndexFile::createNew(envir(), indexFileName);
+      delete[] indexFileName;
+    }
+    if (indexFile == NULL) {
+      delete[] fileName;
+      continue;
+    }
+
+    if (fNumTrickPlayFiles == 0) {
+      fTrickPlayFileScales = new int[maxNumTrickPlayFiles];
+      fTrickPlayFileNames = new char*[maxNumTrickPlayFiles];
+      fTrickPlayIndexFiles = new MPEG2TransportStreamIndexFile*[maxNumTrickPlayFiles];
+    }
+    fTrickPlayFileScales[fNumTrickPlayFiles] = scale;
+    fTrickPlayFileNames[fNumTrickPlayFiles] = fileName;
+    fTrickPlayIndexFiles[fNumTrickPlayFiles] = indexFile;
+    ++fNumTrickPlayFiles;
+  }
+}
+
+int MPEG2TransportFileServerMediaSubsession::nearestTrickPlayFileScale(int scale) const {
+  int nearestScale = 0;
+  for (unsigned i = 0; i < fNumTrickPlayFiles; ++i) {
+    int const fileScale = fTrickPlayFileScales[i];
+    if ((fileScale > 0) != (scale > 0)) continue; // it's in the other direction
+
+    int const diff = fileScale > scale ? fileScale - scale : scale - fileScale;
+    int const nearestDiff = nearestScale > scale ? nearestScale - scale : scale - nearestScale;
+    if (nearestScale == 0 || diff < nearestDiff) nearestScale = fileScale;
+        // Note: Because scales are checked in increasing order, a tie goes to the smaller absolute scale if negative,
+        // and to the smaller scale if positive
+  }
+
+  return nearestScale;
 }
 
 #define TRANSPORT_PACKET_SIZE 188
@@ -149,10 +228,17 @@ void MPEG2TransportFileServerMediaSubsession
 
   // Call the original, default version of this routine:
   OnDemandServerMediaSubsession::deleteStream(clientSessionId, streamToken);
+
+  if (fIndexFile != NULL && streamToken == NULL) { // the stream (including its source) has been deleted
+    ClientTrickPlayState* client = lookupClient(clientSessionId);
+    if (client != NULL) {
+      client->handleStreamDeletion();
+    }
+  }
 }
 
 ClientTrickPlayState* MPEG2TransportFileServerMediaSubsession::newClientTrickPlayState() {
-  return new ClientTrickPlayState(fIndexFile);
+  return new ClientTrickPlayState(fIndexFile, this);
 }
 
 FramedSource* MPEG2TransportFileServerMediaSubsession
@@ -166,6 +252,7 @@ FramedSource* MPEG2TransportFileServerMediaSubsession
   fFileSize = fileSource->fileSize();
 
   // Use the file size and the duration to estimate the stream's bitrate:
+  if (fIndexFile != NULL) fDuration = fIndexFile->getPlayingDuration(); // in case the file is still being recorded
   if (fFileSize > 0 && fDuration > 0.0) {
     estBitrate = (unsigned)((int64_t)fFileSize/(125*fDuration) + 0.5); // kbps, rounded
   } else {
@@ -204,6 +291,11 @@ void MPEG2TransportFileServerMediaSubsession::testScaleFactor(float& scale) {
     // We support any integral scale, other than 0
     int iScale = scale < 0.0 ? (int)(scale - 0.5f) : (int)(scale + 0.5f); // round
     if (iScale == 0) iScale = 1;
+    if (iScale != 1) {
+      // If there are precomputed 'trick play' files (in this direction), then use the scale of the nearest one:
+      int const trickPlayFileScale = nearestTrickPlayFileScale(iScale);
+      if (trickPlayFileScale != 0) iScale = trickPlayFileScale;
+    }
     scale = (float)iScale;
   } else {
     scale = 1.0f;
@@ -211,6 +303,10 @@ void MPEG2TransportFileServerMediaSubsession::testScaleFactor(float& scale) {
 }
 
 float MPEG2TransportFileServerMediaSubsession::duration() const {
+  // If the Transport Stream (and its index file) is still being recorded, then its duration keeps growing, so we
+  // get the current duration from the index file each time:
+  if (fIndexFile != NULL) return fIndexFile->getPlayingDuration();
+
   return fDuration;
 }
 
@@ -222,13 +318,16 @@ ClientTrickPlayState* MPEG2TransportFileServerMediaSubsession
 
 ////////// ClientTrickPlayState implementation //////////
 
-ClientTrickPlayState::ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile)
-  : fIndexFile(indexFile),
+ClientTrickPlayState::ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile,
+					   MPEG2TransportFileServerMediaSubsession* subsession)
+  : fIndexFile(indexFile), fSubsession(subsession),
     fOriginalTransportStreamSource(NULL),
     fTrickModeFilter(NULL), fTrickPlaySource(NULL),
     fFramer(NULL),
     fScale(1.0f), fNextScale(1.0f), fNPT(0.0f),
-    fTSRecordNum(0), fIxRecordNum(0) {
+    fTSRecordNum(0), fIxRecordNum(0),
+    fTrickPlayFileSource(NULL), fTrickPlayIndexFile(NULL), fTrickPlayFileScale(1),
+    fTrickPlayFileOriginNPT(0.0f), fTrickPlayFileTSRecordNum(0) {
 }
 
 unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double streamDuration) {
@@ -250,6 +349,10 @@ unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double stream
 
     fFramer->clearPIDStatusTable();
   }
+  if (fTrickPlayFileSource != NULL) {
+    // We're streaming from a precomputed 'trick play' file.  Seeking within this is easy, so do it:
+    reseekTrickPlayFile();
+  }
 
   unsigned long numTSRecordsToStream = 0;
   float pcrLimit = 0.0;
@@ -275,6 +378,14 @@ unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double stream
 	// limit in the trick play stream.  (We rely upon the fact that PCRs in the trick play stream start at 0.0)
 	int direction = fNextScale < 0.0 ? -1 : 1;
 	pcrLimit = (float)(streamDuration/(fNextScale*direction));
+
+	char const* trickPlayFileName; MPEG2TransportStreamIndexFile* trickPlayIndexFile; // dummy
+	if (fSubsession != NULL
+	    && fSubsession->lookupTrickPlayFile(int(fNextScale), trickPlayFileName, trickPlayIndexFile)) {
+	  // We'll be streaming from a precomputed 'trick play' file, in which PCRs start at 0.0 at the start of the
+	  // file (rather than at our current position):
+	  pcrLimit += trickPlayFileNPT(fNPT, int(fNextScale));
+	}
       }
     }
   }
@@ -289,14 +400,12 @@ void ClientTrickPlayState::updateStateOnScaleChange() {
 
   // Change our source objects to reflect the change in scale:
   // First, close the existing trick play source (if any):
-  if (fTrickPlaySource != NULL) {
-    fTrickModeFilter->forgetInputSource();
-        // so that the underlying Transport Stream source doesn't get deleted by:
-    Medium::close(fTrickPlaySource);
-    fTrickPlaySource = NULL;
-    fTrickModeFilter = NULL;
-  }
-  if (fNextScale != 1.0f) {
+  closeTrickPlaySource();
+  if (fNextScale != 1.0f && openTrickPlayFile(int(fNextScale))) {
+    // Stream from the precomputed 'trick play' file (beginning from the position that corresponds to "fNPT"):
+    reseekTrickPlayFile();
+    fFramer->changeInputSource(fTrickPlayFileSource);
+  } else if (fNextScale != 1.0f) {
     // Create a new trick play filter from the original Transport Stream source:
     UsageEnvironment& env = fIndexFile->envir(); // alias
     fTrickModeFilter = MPEG2TransportStreamTrickModeFilter
@@ -317,7 +426,18 @@ void ClientTrickPlayState::updateStateOnScaleChange() {
 
 void ClientTrickPlayState::updateStateOnPlayChange(Boolean reverseToPreviousVSH) {
   updateTSRecordNum();
-  if (fTrickPlaySource == NULL) {
+  if (fTrickPlayFileSource != NULL) {
+    // We were streaming from a precomputed 'trick play' file.  Use its index file to find the NPT that we've
+    // reached, and map this back to the original file:
+    if (fFramer != NULL) fTrickPlayFileTSRecordNum += (unsigned long)(fFramer->tsPacketCount());
+    unsigned long trickPlayFileTSRecordNum = fTrickPlayFileTSRecordNum, trickPlayFileIxRecordNum;
+    float trickPlayFileNPT;
+    fTrickPlayIndexFile->lookupPCRFromTSPacketNum(trickPlayFileTSRecordNum, False,
+						  trickPlayFileNPT, trickPlayFileIxRecordNum);
+    fNPT = originalNPT(trickPlayFileNPT);
+    if (fNPT < 0.0f) fNPT = 0.0f;
+    fIndexFile->lookupTSPacketNumFromNPT(fNPT, fTSRecordNum, fIxRecordNum);
+  } else if (fTrickPlaySource == NULL) {
     // We were in regular (1x) play. Use the index file to look up the
     // index record number and npt from the current transport number:
     fIndexFile->lookupPCRFromTSPacketNum(fTSRecordNum, reverseToPreviousVSH, fNPT, fIxRecordNum);
@@ -350,3 +470,73 @@ void ClientTrickPlayState::reseekOriginalTransportStreamSource() {
   u_int64_t tsRecordNum64 = (u_int64_t)fTSRecordNum;
   fOriginalTransportStreamSource->seekToByteAbsolute(tsRecordNum64*TRANSPORT_PACKET_SIZE);
 }
+
+void ClientTrickPlayState::handleStreamDeletion() {
+  // Our framer - and the source that it was reading from - has been closed.  If that source was a precomputed
+  // 'trick play' file, then the original Transport Stream source still needs to be closed:
+  if (fTrickPlayFileSource != NULL) {
+    Medium::close(fOriginalTransportStreamSource);
+    fTrickPlayFileSource = NULL;
+  }
+  fOriginalTransportStreamSource = NULL;
+  fTrickModeFilter = NULL; fTrickPlaySource = NULL;
+  fFramer = NULL;
+}
+
+void ClientTrickPlayState::closeTrickPlaySource() {
+  if (fTrickPlaySource != NULL) {
+    fTrickModeFilter->forgetInputSource();
+        // so that the underlying Transport Stream source doesn't get deleted by:
+    Medium::close(fTrickPlaySource);
+    fTrickPlaySource = NULL;
+    fTrickModeFilter = NULL;
+  }
+
+  if (fTrickPlayFileSource != NULL) {
+    Medium::close(fTrickPlayFileSource);
+    fTrickPlayFileSource = NULL;
+    fTrickPlayIndexFile = NULL;
+  }
+}
+
+Boolean ClientTrickPlayState::openTrickPlayFile(int scale) {
+  char const* fileName;
+  MPEG2TransportStreamIndexFile* indexFile;
+  if (fSubsession == NULL || !fSubsession->lookupTrickPlayFile(scale, fileName, indexFile)) return False;
+
+  unsigned const inputDataChunkSize
+    = TRANSPORT_PACKETS_PER_NETWORK_PACKET*TRANSPORT_PACKET_SIZE;
+  fTrickPlayFileSource = ByteStreamFileSource::createNew(fIndexFile->envir(), fileName, inputDataChunkSize);
+  if (fTrickPlayFileSource == NULL) return False;
+
+  fTrickPlayIndexFile = indexFile;
+  fTrickPlayFileScale = scale;
+  fTrickPlayFileOriginNPT = trickPlayFileOriginNPT(scale);
+  return True;
+}
+
+void ClientTrickPlayState::reseekTrickPlayFile() {
+  // Seek to the position in the 'trick play' file that corresponds to "fNPT" in the original file:
+  float trickPlayFileNPT = this->trickPlayFileNPT(fNPT, fTrickPlayFileScale);
+  unsigned long trickPlayFileIxRecordNum; // dummy
+  fTrickPlayIndexFile->lookupTSPacketNumFromNPT(trickPlayFileNPT, fTrickPlayFileTSRecordNum, trickPlayFileIxRecordNum);
+
+  u_int64_t tsRecordNum64 = (u_int64_t)fTrickPlayFileTSRecordNum;
+  fTrickPlayFileSource->seekToByteAbsolute(tsRecordNum64*TRANSPORT_PACKET_SIZE);
+
+  // Our framer's count of the packets that it has streamed - which we add to "fTrickPlayFileTSRecordNum" later - isn't
+  // reset by seeking, so allow for it here:
+  if (fFramer != NULL) fTrickPlayFileTSRecordNum -= (unsigned long)(fFramer->tsPacketCount());
+}
+
+float ClientTrickPlayState::trickPlayFileOriginNPT(int scale) const {
+  // A fast forward 'trick play' file starts at the first index record of the original file; a reverse play file
+  // starts at the last one:
+  if (scale < 0) return fIndexFile->getPlayingDuration();
+
+  unsigned long transportRecordNum;
+  float pcr;
+  u_int8_t offset, size, recordType; // all dummy
+  if (!fIndexFile->readIndexRecordValues(0, transportRecordNum, offset, size, pcr, recordType)) return 0.0f;
+  return pcr;
+}
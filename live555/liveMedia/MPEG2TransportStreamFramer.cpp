@@ -174,8 +174,7 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
 
   // Scan through the TS packets that we read, and update our estimate of
   // the duration of each packet:
-  struct timeval tvNow;
-  gettimeofday(&tvNow, NULL);
+  struct timeval const& tvNow = envir().taskScheduler().timeNow();
   double timeNow = tvNow.tv_sec + tvNow.tv_usec/1000000.0;
   for (unsigned i = 0; i < numTSPackets; ++i) {
     if (!updateTSPacketDurationEstimate(&fTo[i*TRANSPORT_PACKET_SIZE], timeNow)) {
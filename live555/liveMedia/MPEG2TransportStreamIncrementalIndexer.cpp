@@ -0,0 +1,172 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A filter that passes through (unchanged) a MPEG-2 Transport Stream that's being recorded, while also writing -
+// incrementally - the corresponding index file.  This lets the recording be served (with 'trick play' operations)
+// while it's still in progress.
+// Implementation
+
+#include "MPEG2TransportStreamIncrementalIndexer.hh"
+#include "MPEG2TransportStreamIndexFile.hh"
+#include "OutputFile.hh"
+#include <string.h>
+
+MPEG2TransportStreamIncrementalIndexer* MPEG2TransportStreamIncrementalIndexer
+::createNew(UsageEnvironment& env, FramedSource* inputSource, char const* indexFileName) {
+  FILE* indexFid = OpenOutputFile(env, indexFileName);
+  if (indexFid == NULL) return NULL;
+
+  return new MPEG2TransportStreamIncrementalIndexer(env, inputSource, indexFid);
+}
+
+MPEG2TransportStreamIncrementalIndexer
+::MPEG2TransportStreamIncrementalIndexer(UsageEnvironment& env, FramedSource* inputSource, FILE* indexFid)
+  : FramedFilter(env, inputSource),
+    fIndexFid(indexFid), fPartialPacketSize(0),
+    fPendingIndexRecords(NULL), fNumPendingIndexRecords(0), fMaxNumPendingIndexRecords(0),
+    fNumIndexRecordsWritten(0) {
+  // We do the actual indexing by feeding each packet to a "MPEG2IFrameIndexFromTransportStream" (with no input source):
+  fIndexer = MPEG2IFrameIndexFromTransportStream::createNew(env, NULL);
+}
+
+MPEG2TransportStreamIncrementalIndexer::~MPEG2TransportStreamIncrementalIndexer() {
+  // Index (and write) whatever data remains, because all of the data that we've delivered has been handled by now:
+  stopIndexing();
+  writePendingIndexRecords();
+
+  delete[] fPendingIndexRecords;
+  CloseOutputFile(fIndexFid);
+}
+
+void MPEG2TransportStreamIncrementalIndexer::doGetNextFrame() {
+  // Our client has handled (e.g., written to the Transport Stream file) all of the data that we've delivered so far,
+  // so it's now safe to write the index records for this data:
+  writePendingIndexRecords();
+
+  // Read directly from our input source into our client's buffer:
+  fInputSource->getNextFrame(fTo, fMaxSize,
+			     afterGettingFrame, this,
+			     handleInputClosure, this);
+}
+
+void MPEG2TransportStreamIncrementalIndexer
+::afterGettingFrame(void* clientData, unsigned frameSize,
+		    unsigned numTruncatedBytes,
+		    struct timeval presentationTime,
+		    unsigned durationInMicroseconds) {
+  MPEG2TransportStreamIncrementalIndexer* indexer = (MPEG2TransportStreamIncrementalIndexer*)clientData;
+  indexer->afterGettingFrame1(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+}
+
+void MPEG2TransportStreamIncrementalIndexer
+::afterGettingFrame1(unsigned frameSize,
+		     unsigned numTruncatedBytes,
+		     struct timeval presentationTime,
+		     unsigned durationInMicroseconds) {
+  indexData(fTo, frameSize);
+
+  // Deliver the data (unchanged) to our client.  (We write the corresponding index records - which are now in
+  // "fPendingIndexRecords" - only after our client has handled the data, so that someone reading the index file
+  // never sees a record for data that's not yet in the Transport Stream file.)
+  fFrameSize = frameSize;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = durationInMicroseconds;
+  afterGetting(this);
+}
+
+void MPEG2TransportStreamIncrementalIndexer::handleInputClosure(void* clientData) {
+  MPEG2TransportStreamIncrementalIndexer* indexer = (MPEG2TransportStreamIncrementalIndexer*)clientData;
+  indexer->handleInputClosure1();
+}
+
+void MPEG2TransportStreamIncrementalIndexer::handleInputClosure1() {
+  // The recording has ended.  Index the remaining data, and write out all of the remaining index records:
+  stopIndexing();
+  writePendingIndexRecords();
+
+  handleClosure(this);
+}
+
+void MPEG2TransportStreamIncrementalIndexer::indexData(unsigned char const* data, unsigned dataSize) {
+  if (fIndexer == NULL) return; // we've stopped indexing
+
+  while (dataSize > 0) {
+    unsigned char const* pkt;
+    if (fPartialPacketSize > 0 || dataSize < TRANSPORT_PACKET_SIZE) {
+      // Assemble the packet in "fPartialPacket" (because it's split between frames):
+      unsigned numBytesToCopy = TRANSPORT_PACKET_SIZE - fPartialPacketSize;
+      if (numBytesToCopy > dataSize) numBytesToCopy = dataSize;
+      memmove(&fPartialPacket[fPartialPacketSize], data, numBytesToCopy);
+      fPartialPacketSize += numBytesToCopy;
+      data += numBytesToCopy; dataSize -= numBytesToCopy;
+      if (fPartialPacketSize < TRANSPORT_PACKET_SIZE) break; // we don't yet have a complete packet
+
+      pkt = fPartialPacket;
+      fPartialPacketSize = 0;
+    } else {
+      pkt = data;
+      data += TRANSPORT_PACKET_SIZE; dataSize -= TRANSPORT_PACKET_SIZE;
+    }
+
+    if (!fIndexer->addTransportPacket(pkt)) {
+      envir() << "MPEG2TransportStreamIncrementalIndexer: Bad Transport Stream data; no longer indexing it\n";
+      stopIndexing();
+      return;
+    }
+    getIndexRecords();
+  }
+}
+
+void MPEG2TransportStreamIncrementalIndexer::getIndexRecords() {
+  while (1) {
+    if (fNumPendingIndexRecords == fMaxNumPendingIndexRecords) {
+      // Enlarge our array of pending records:
+      unsigned newMaxNumPendingIndexRecords = fMaxNumPendingIndexRecords == 0 ? 100 : 2*fMaxNumPendingIndexRecords;
+      u_int8_t* newPendingIndexRecords = new u_int8_t[newMaxNumPendingIndexRecords*INDEX_RECORD_SIZE];
+      if (fPendingIndexRecords != NULL) {
+	memmove(newPendingIndexRecords, fPendingIndexRecords, fNumPendingIndexRecords*INDEX_RECORD_SIZE);
+	delete[] fPendingIndexRecords;
+      }
+      fPendingIndexRecords = newPendingIndexRecords;
+      fMaxNumPendingIndexRecords = newMaxNumPendingIndexRecords;
+    }
+
+    if (!fIndexer->getNextIndexRecord(&fPendingIndexRecords[fNumPendingIndexRecords*INDEX_RECORD_SIZE])) break;
+    ++fNumPendingIndexRecords;
+  }
+}
+
+void MPEG2TransportStreamIncrementalIndexer::stopIndexing() {
+  if (fIndexer == NULL) return; // we've already stopped
+
+  // Get the index records for the data that's left in the indexer's parse buffer:
+  fIndexer->noteEndOfInput();
+  getIndexRecords();
+
+  Medium::close(fIndexer);
+  fIndexer = NULL;
+}
+
+void MPEG2TransportStreamIncrementalIndexer::writePendingIndexRecords() {
+  if (fNumPendingIndexRecords == 0) return;
+
+  fwrite(fPendingIndexRecords, INDEX_RECORD_SIZE, fNumPendingIndexRecords, fIndexFid);
+  fflush(fIndexFid); // so that readers of the index file see the new records right away
+  fNumIndexRecordsWritten += fNumPendingIndexRecords;
+  fNumPendingIndexRecords = 0;
+}
@@ -23,12 +23,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MPEG2TransportStreamIndexFile.hh"
 #include "InputFile.hh"
+#include <string.h>
 
 MPEG2TransportStreamIndexFile
-::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName)
+::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName, Boolean holdInMemory)
   : Medium(env),
     fFileName(strDup(indexFileName)), fFid(NULL), fMPEGVersion(0), fCurrentIndexRecordNum(0),
-    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0) {
+    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0),
+    fLastIndexFileSizeCheckTime(env.taskScheduler().timeNow().tv_sec),
+    fIndexData(NULL), fRecordPCRs(NULL), fRecordTSPacketNums(NULL), fIndexDataCapacity(0) {
   // Get the file size, to determine how many index records it contains:
   u_int64_t indexFileSize = GetFileSize(indexFileName, NULL);
   if (indexFileSize % INDEX_RECORD_SIZE != 0) {
@@ -38,13 +41,15 @@ MPEG2TransportStreamIndexFile
 	<< INDEX_RECORD_SIZE << ")\n";
   }
   fNumIndexRecords = (unsigned long)(indexFileSize/INDEX_RECORD_SIZE);
+
+  if (holdInMemory) loadIndexData();
 }
 
 MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
-::createNew(UsageEnvironment& env, char const* indexFileName) {
+::createNew(UsageEnvironment& env, char const* indexFileName, Boolean holdInMemory) {
   if (indexFileName == NULL) return NULL;
   MPEG2TransportStreamIndexFile* indexFile
-    = new MPEG2TransportStreamIndexFile(env, indexFileName);
+    = new MPEG2TransportStreamIndexFile(env, indexFileName, holdInMemory);
 
   // Reject empty or non-existent index files:
   if (indexFile->getPlayingDuration() == 0.0f) {
@@ -57,12 +62,31 @@ MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
 
 MPEG2TransportStreamIndexFile::~MPEG2TransportStreamIndexFile() {
   closeFid();
+  freeIndexData();
   delete[] fFileName;
 }
 
+template <class T>
+static unsigned long firstIndexAtOrAbove(T const* values, unsigned long numValues, T key) {
+  // Returns the index of the first of "values" (which are in non-decreasing order) that is >= "key" (or "numValues", if none).
+  // This is a 'branch-free' binary search: The loop always runs log2("numValues") times, and its comparison compiles
+  // to a conditional move, rather than to a (hard to predict) branch.
+  if (numValues == 0) return 0;
+
+  T const* base = values;
+  while (numValues > 1) {
+    unsigned long half = numValues/2;
+    base = base[half] < key ? base + half : base;
+    numValues -= half;
+  }
+
+  return (base - values) + (*base < key);
+}
+
 void MPEG2TransportStreamIndexFile
 ::lookupTSPacketNumFromNPT(float& npt, unsigned long& tsPacketNumber,
 			   unsigned long& indexRecordNumber) {
+  updateNumIndexRecords();
   if (npt <= 0.0 || fNumIndexRecords == 0) { // Fast-track a common case:
     npt = 0.0f;
     tsPacketNumber = indexRecordNumber = 0;
@@ -77,10 +101,29 @@ void MPEG2TransportStreamIndexFile
   }
 
   // Search for the pair of neighboring index records whose PCR values span "npt".
-  // Use the 'regula-falsi' method.
+  // (Record 0 is treated as if its PCR were 0.)
   Boolean success = False;
   unsigned long ixFound = 0;
   do {
+    if (fIndexData != NULL) {
+      // Do a binary search over our in-memory array of PCR values:
+      if (fRecordPCRs == NULL) buildSearchArrays();
+      float const pcrLast = fRecordPCRs[fNumIndexRecords-1];
+      if (npt > pcrLast) npt = pcrLast;
+          // handle "npt" too large by seeking to the last frame of the file
+
+      if (fNumIndexRecords > 1) {
+	ixFound = 1 + firstIndexAtOrAbove(&fRecordPCRs[1], fNumIndexRecords-1, npt);
+	if (ixFound >= fNumIndexRecords || fRecordPCRs[ixFound] < npt
+	    || (ixFound > 1 && fRecordPCRs[ixFound-1] >= npt)) break; // bad PCR values in index file?
+      }
+
+      // "Rewind' until we reach the start of a Video Sequence or GOP header:
+      success = rewindToCleanPoint(ixFound);
+      break;
+    }
+
+    // Otherwise, read records from the index file, using the 'regula-falsi' method:
     unsigned long ixLeft = 0, ixRight = fNumIndexRecords-1;
     float pcrLeft = 0.0f, pcrRight;
     if (!readIndexRecord(ixRight)) break;
@@ -128,6 +171,7 @@ void MPEG2TransportStreamIndexFile
 void MPEG2TransportStreamIndexFile
 ::lookupPCRFromTSPacketNum(unsigned long& tsPacketNumber, Boolean reverseToPreviousCleanPoint,
 			   float& pcr, unsigned long& indexRecordNumber) {
+  updateNumIndexRecords();
   if (tsPacketNumber == 0 || fNumIndexRecords == 0) { // Fast-track a common case:
     pcr = 0.0f;
     indexRecordNumber = 0;
@@ -142,10 +186,34 @@ void MPEG2TransportStreamIndexFile
   }
 
   // Search for the pair of neighboring index records whose TS packet #s span "tsPacketNumber".
-  // Use the 'regula-falsi' method.
+  // (Record 0 is treated as if its TS packet # were 0.)
   Boolean success = False;
   unsigned long ixFound = 0;
   do {
+    if (fIndexData != NULL) {
+      // Do a binary search over our in-memory array of TS packet #s:
+      if (fRecordTSPacketNums == NULL) buildSearchArrays();
+      unsigned long const tsLast = fRecordTSPacketNums[fNumIndexRecords-1];
+      if (tsPacketNumber > tsLast) tsPacketNumber = tsLast;
+          // handle "tsPacketNumber" too large by seeking to the last frame of the file
+
+      if (fNumIndexRecords > 1) {
+	u_int32_t const key = (u_int32_t)tsPacketNumber;
+	ixFound = 1 + firstIndexAtOrAbove(&fRecordTSPacketNums[1], fNumIndexRecords-1, key);
+	if (ixFound >= fNumIndexRecords || fRecordTSPacketNums[ixFound] < key
+	    || (ixFound > 1 && fRecordTSPacketNums[ixFound-1] >= key)) break; // bad TS packet #s in index file?
+      }
+
+      if (reverseToPreviousCleanPoint) {
+	// "Rewind' until we reach the start of a Video Sequence or GOP header:
+	success = rewindToCleanPoint(ixFound);
+      } else {
+	success = True;
+      }
+      break;
+    }
+
+    // Otherwise, read records from the index file, using the 'regula-falsi' method:
     unsigned long ixLeft = 0, ixRight = fNumIndexRecords-1;
     unsigned long tsLeft = 0, tsRight;
     if (!readIndexRecord(ixRight)) break;
@@ -210,6 +278,7 @@ Boolean MPEG2TransportStreamIndexFile
 }
 
 float MPEG2TransportStreamIndexFile::getPlayingDuration() {
+  updateNumIndexRecords();
   if (fNumIndexRecords == 0 || !readOneIndexRecord(fNumIndexRecords-1)) return 0.0f;
 
   return pcrFromBuf();
@@ -246,6 +315,15 @@ Boolean MPEG2TransportStreamIndexFile::seekToIndexRecord(unsigned long indexReco
 }
 
 Boolean MPEG2TransportStreamIndexFile::readIndexRecord(unsigned long indexRecordNum) {
+  if (indexRecordNum >= fNumIndexRecords) updateNumIndexRecords(); // the record might have been added since
+
+  if (fIndexData != NULL) {
+    if (indexRecordNum >= fNumIndexRecords) return False;
+
+    memcpy(fBuf, &fIndexData[indexRecordNum*INDEX_RECORD_SIZE], INDEX_RECORD_SIZE);
+    return True;
+  }
+
   do {
     if (!seekToIndexRecord(indexRecordNum)) break;
     if (fread(fBuf, INDEX_RECORD_SIZE, 1, fFid) != 1) break;
@@ -271,14 +349,111 @@ void MPEG2TransportStreamIndexFile::closeFid() {
   }
 }
 
-float MPEG2TransportStreamIndexFile::pcrFromBuf() {
-  unsigned pcr_int = (fBuf[5]<<16) | (fBuf[4]<<8) | fBuf[3];
-  u_int8_t pcr_frac = fBuf[6];
+void MPEG2TransportStreamIndexFile::updateNumIndexRecords() {
+  // Getting the index file's size costs us a system call, so (because we're called on every lookup) we do this at most
+  // once per second.  (A growing recording's newest records might therefore be seen up to a second later.)
+  long const timeNow = envir().taskScheduler().timeNow().tv_sec;
+  if (timeNow == fLastIndexFileSizeCheckTime) return;
+  fLastIndexFileSizeCheckTime = timeNow;
+
+  // Note: We count only complete records, in case the last record is still being written:
+  unsigned long newNumIndexRecords = (unsigned long)(GetFileSize(fFileName, NULL)/INDEX_RECORD_SIZE);
+  if (newNumIndexRecords <= fNumIndexRecords) return; // the index file hasn't grown
+
+  if (fIndexData != NULL && !extendIndexData(newNumIndexRecords)) {
+    // Fall back to reading records from the file, as needed:
+    freeIndexData();
+  }
+  unsigned long const numExistingRecords = fNumIndexRecords;
+  fNumIndexRecords = newNumIndexRecords;
+  if (fRecordPCRs != NULL) buildSearchArrays(numExistingRecords);
+}
+
+void MPEG2TransportStreamIndexFile::loadIndexData() {
+  // Note: We read the index file into our own buffer, rather than memory-mapping it, because the file might later be
+  // truncated or regenerated (while we're still using it), and accessing a mapping past the new end of file would
+  // raise SIGBUS.
+  if (fNumIndexRecords == 0 || !openFid()) return;
+  unsigned long const dataSize = fNumIndexRecords*INDEX_RECORD_SIZE;
+
+  fIndexData = new u_int8_t[dataSize];
+  fIndexDataCapacity = fNumIndexRecords;
+  if (fread(fIndexData, 1, dataSize, fFid) != dataSize) {
+    // Fall back to reading records from the file, as needed:
+    freeIndexData();
+  }
+
+  // We don't need to keep the file open any more:
+  closeFid();
+}
+
+Boolean MPEG2TransportStreamIndexFile::extendIndexData(unsigned long newNumIndexRecords) {
+  // Read the new records from the index file onto the end of "fIndexData".  (This doesn't change "fNumIndexRecords".)
+  if (newNumIndexRecords > fIndexDataCapacity) {
+    // We need bigger arrays.  We (at least) double their size, so that - as the index file keeps growing - the cost of
+    // copying what we already have stays proportional to the total number of records:
+    unsigned long newCapacity = 2*fIndexDataCapacity;
+    if (newCapacity < newNumIndexRecords) newCapacity = newNumIndexRecords;
+
+    u_int8_t* newIndexData = new u_int8_t[newCapacity*INDEX_RECORD_SIZE];
+    memcpy(newIndexData, fIndexData, fNumIndexRecords*INDEX_RECORD_SIZE);
+    delete[] fIndexData; fIndexData = newIndexData;
+
+    if (fRecordPCRs != NULL) {
+      float* newRecordPCRs = new float[newCapacity];
+      memcpy(newRecordPCRs, fRecordPCRs, fNumIndexRecords*sizeof (float));
+      delete[] fRecordPCRs; fRecordPCRs = newRecordPCRs;
+
+      u_int32_t* newRecordTSPacketNums = new u_int32_t[newCapacity];
+      memcpy(newRecordTSPacketNums, fRecordTSPacketNums, fNumIndexRecords*sizeof (u_int32_t));
+      delete[] fRecordTSPacketNums; fRecordTSPacketNums = newRecordTSPacketNums;
+    }
+    fIndexDataCapacity = newCapacity;
+  }
+
+  if (!openFid()) return False;
+  unsigned long const dataSize = fNumIndexRecords*INDEX_RECORD_SIZE;
+  unsigned long const newDataSize = newNumIndexRecords*INDEX_RECORD_SIZE;
+  Boolean result = SeekFile64(fFid, (int64_t)dataSize, SEEK_SET) == 0
+    && fread(&fIndexData[dataSize], 1, newDataSize - dataSize, fFid) == newDataSize - dataSize;
+  closeFid();
+
+  return result;
+}
+
+void MPEG2TransportStreamIndexFile::freeIndexData() {
+  delete[] fIndexData; fIndexData = NULL;
+
+  delete[] fRecordPCRs; fRecordPCRs = NULL;
+  delete[] fRecordTSPacketNums; fRecordTSPacketNums = NULL;
+  fIndexDataCapacity = 0;
+}
+
+void MPEG2TransportStreamIndexFile::buildSearchArrays(unsigned long numExistingRecords) {
+  // Copy the keys that we search on - each record's PCR and TS packet number - into separate, contiguous arrays.
+  // (This way, a binary search touches only a few cache lines, rather than one (or two) per 11-byte record.)
+  // The arrays are the same size as "fIndexData", so - as the index file grows - new records are added in place.
+  if (fRecordPCRs == NULL) {
+    fRecordPCRs = new float[fIndexDataCapacity];
+    fRecordTSPacketNums = new u_int32_t[fIndexDataCapacity];
+    numExistingRecords = 0;
+  }
+
+  u_int8_t const* record = &fIndexData[numExistingRecords*INDEX_RECORD_SIZE];
+  for (unsigned long i = numExistingRecords; i < fNumIndexRecords; ++i, record += INDEX_RECORD_SIZE) {
+    fRecordPCRs[i] = pcrFromRecord(record);
+    fRecordTSPacketNums[i] = (u_int32_t)tsPacketNumFromRecord(record);
+  }
+}
+
+float MPEG2TransportStreamIndexFile::pcrFromRecord(u_int8_t const* record) {
+  unsigned pcr_int = (record[5]<<16) | (record[4]<<8) | record[3];
+  u_int8_t pcr_frac = record[6];
   return pcr_int + pcr_frac/256.0f;
 }
 
-unsigned long MPEG2TransportStreamIndexFile::tsPacketNumFromBuf() {
-  return (fBuf[10]<<24) | (fBuf[9]<<16) | (fBuf[8]<<8) | fBuf[7];
+unsigned long MPEG2TransportStreamIndexFile::tsPacketNumFromRecord(u_int8_t const* record) {
+  return (record[10]<<24) | (record[9]<<16) | (record[8]<<8) | record[7];
 }
 
 void MPEG2TransportStreamIndexFile::setMPEGVersionFromRecordType(u_int8_t recordType) {
@@ -287,6 +462,7 @@ void MPEG2TransportStreamIndexFile::setMPEGVersionFromRecordType(u_int8_t record
   u_int8_t const recordTypeWithoutStartBit = recordType&~0x80;
   if (recordTypeWithoutStartBit >= 1 && recordTypeWithoutStartBit <= 4) fMPEGVersion = 2;
   else if (recordTypeWithoutStartBit >= 5 && recordTypeWithoutStartBit <= 10) fMPEGVersion = 5; // represents H.264
+  else if (recordTypeWithoutStartBit >= 11 && recordTypeWithoutStartBit <= 17) fMPEGVersion = 6; // represents H.265
 }
 
 Boolean MPEG2TransportStreamIndexFile::rewindToCleanPoint(unsigned long&ixFound) {
@@ -299,7 +475,7 @@ Boolean MPEG2TransportStreamIndexFile::rewindToCleanPoint(unsigned long&ixFound)
     setMPEGVersionFromRecordType(recordType);
 
     // A 'clean point' is the start of a 'frame' from which a decoder can cleanly resume handling the stream:
-    // For H.264, this is a SPS.  For MPEG-2, this is a Video Sequence Header, or a GOP. 
+    // For H.264, this is a SPS (for H.265, a VPS).  For MPEG-2, this is a Video Sequence Header, or a GOP. 
 
     if ((recordType&0x80) != 0) { // This is the start of a 'frame'
       recordType &=~ 0x80; // remove the 'start of frame' bit
@@ -308,6 +484,11 @@ Boolean MPEG2TransportStreamIndexFile::rewindToCleanPoint(unsigned long&ixFound)
 	  success = True;
 	  break;
 	}
+      } else if (fMPEGVersion == 6/*H.265*/) {
+        if (recordType == 11/*VPS*/) {
+	  success = True;
+	  break;
+	}
       } else {
 	if (recordType == 1/*VSH*/) {
 	  success = True;
@@ -36,7 +36,8 @@ MPEG2TransportStreamMultiplexor
     fPreviousInputProgramMapVersion(0xFF), fCurrentInputProgramMapVersion(0xFF),
     fPCR_PID(0), fCurrentPID(0),
     fInputBuffer(NULL), fInputBufferSize(0), fInputBufferBytesUsed(0),
-    fIsFirstAdaptationField(True) {
+    fIsFirstAdaptationField(True), fPATIsSet(False), fPMTIsCurrent(False),
+    fMaxNumTSPacketsPerDelivery(DEFAULT_MAX_NUM_TS_PACKETS_PER_DELIVERY), fNumDeliveries(0) {
   for (unsigned i = 0; i < PID_TABLE_SIZE; ++i) {
     fPIDState[i].counter = 0;
     fPIDState[i].streamType = 0;
@@ -47,6 +48,11 @@ MPEG2TransportStreamMultiplexor::~MPEG2TransportStreamMultiplexor() {
 }
 
 void MPEG2TransportStreamMultiplexor::doGetNextFrame() {
+  fFrameSize = 0; // we'll add Transport Stream packets to the client's buffer, one at a time
+  deliverPackets();
+}
+
+void MPEG2TransportStreamMultiplexor::deliverPackets() {
   if (fInputBufferBytesUsed >= fInputBufferSize) {
     // No more bytes are available from the current buffer.
     // Arrange to read a new one.
@@ -54,33 +60,20 @@ void MPEG2TransportStreamMultiplexor::doGetNextFrame() {
     return;
   }
 
+  // Fill the client's buffer with as many Transport Stream packets as will fit (up to our limit) - but only from the
+  // data that we have now.  (We don't wait for more input data, because that would delay the packets that we've
+  // already made.)
+  unsigned maxFrameSize = fMaxSize;
+  if (fMaxNumTSPacketsPerDelivery > 0 && fMaxNumTSPacketsPerDelivery*TRANSPORT_PACKET_SIZE < maxFrameSize) {
+    maxFrameSize = fMaxNumTSPacketsPerDelivery*TRANSPORT_PACKET_SIZE;
+  }
   do {
-    // Periodically return a Program Association Table packet instead:
-    if (fOutgoingPacketCounter++ % PAT_PERIOD == 0) {
-      deliverPATPacket();
-      break;
-    }
-
-    // Periodically (or when we see a new PID) return a Program Map Table instead:
-    Boolean programMapHasChanged = fPIDState[fCurrentPID].counter == 0
-      || fCurrentInputProgramMapVersion != fPreviousInputProgramMapVersion;
-    if (fOutgoingPacketCounter % PMT_PERIOD == 0 || programMapHasChanged) {
-      if (programMapHasChanged) { // reset values for next time:
-	fPIDState[fCurrentPID].counter = 1;
-	fPreviousInputProgramMapVersion = fCurrentInputProgramMapVersion;
-      }
-      deliverPMTPacket(programMapHasChanged);
-      break;
-    }
-
-    // Normal case: Deliver (or continue delivering) the recently-read data:
-    deliverDataToClient(fCurrentPID, fInputBuffer, fInputBufferSize,
-			fInputBufferBytesUsed);
-  } while (0);
+    deliverPacket();
+  } while (fInputBufferBytesUsed < fInputBufferSize && maxFrameSize - fFrameSize >= TRANSPORT_PACKET_SIZE);
 
   // NEED TO SET fPresentationTime, durationInMicroseconds #####
   // Complete the delivery to the client:
-  if ((fOutgoingPacketCounter%10) == 0) {
+  if ((++fNumDeliveries%10) == 0) {
     // To avoid excessive recursion (and stack overflow) caused by excessively large input frames,
     // occasionally return to the event loop to do this:
     envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
@@ -89,6 +82,30 @@ void MPEG2TransportStreamMultiplexor::doGetNextFrame() {
   }
 }
 
+void MPEG2TransportStreamMultiplexor::deliverPacket() {
+  // Periodically return a Program Association Table packet instead:
+  if (fOutgoingPacketCounter++ % PAT_PERIOD == 0) {
+    deliverPATPacket();
+    return;
+  }
+
+  // Periodically (or when we see a new PID) return a Program Map Table instead:
+  Boolean programMapHasChanged = fPIDState[fCurrentPID].counter == 0
+    || fCurrentInputProgramMapVersion != fPreviousInputProgramMapVersion;
+  if (fOutgoingPacketCounter % PMT_PERIOD == 0 || programMapHasChanged) {
+    if (programMapHasChanged) { // reset values for next time:
+      fPIDState[fCurrentPID].counter = 1;
+      fPreviousInputProgramMapVersion = fCurrentInputProgramMapVersion;
+    }
+    deliverPMTPacket(programMapHasChanged);
+    return;
+  }
+
+  // Normal case: Deliver (or continue delivering) the recently-read data:
+  deliverDataToClient(fCurrentPID, fInputBuffer, fInputBufferSize,
+		      fInputBufferBytesUsed);
+}
+
 void MPEG2TransportStreamMultiplexor
 ::handleNewBuffer(unsigned char* buffer, unsigned bufferSize,
 		  int mpegVersion, MPEG1or2Demux::SCR scr) {
@@ -112,10 +129,12 @@ void MPEG2TransportStreamMultiplexor
     u_int8_t& streamType = fPIDState[fCurrentPID].streamType; // alias
 
     if (streamType == 0) {
+      fPMTIsCurrent = False; // because we're adding a stream to it
+
       // Instead, set the stream's type to default values, based on whether
       // the stream is audio or video, and whether it's MPEG-1 or MPEG-2:
       if ((stream_id&0xF0) == 0xE0) { // video
-	streamType = mpegVersion == 1 ? 1 : mpegVersion == 2 ? 2 : mpegVersion == 4 ? 0x10 : 0x1B;
+	streamType = mpegVersion == 1 ? 1 : mpegVersion == 2 ? 2 : mpegVersion == 4 ? 0x10 : mpegVersion == 5 ? 0x1B : 0x24;
       } else if ((stream_id&0xE0) == 0xC0) { // audio
 	streamType = mpegVersion == 1 ? 3 : mpegVersion == 2 ? 4 : 0xF;
       } else if (stream_id == 0xBD) { // private_stream1 (usually AC-3)
@@ -127,8 +146,9 @@ void MPEG2TransportStreamMultiplexor
 
     if (fPCR_PID == 0) { // set it to this stream, if it's appropriate:
       if ((!fHaveVideoStreams && (streamType == 3 || streamType == 4 || streamType == 0xF))/* audio stream */ ||
-	  (streamType == 1 || streamType == 2 || streamType == 0x10 || streamType == 0x1B)/* video stream */) {
+	  (streamType == 1 || streamType == 2 || streamType == 0x10 || streamType == 0x1B || streamType == 0x24)/* video stream */) {
 	fPCR_PID = fCurrentPID; // use this stream's SCR for PCR
+	fPMTIsCurrent = False;
       }
     }
     if (fCurrentPID == fPCR_PID) {
@@ -138,18 +158,16 @@ void MPEG2TransportStreamMultiplexor
   }
 
   // Now that we have new input data, retry the last delivery to the client:
-  doGetNextFrame();
+  deliverPackets();
 }
 
 void MPEG2TransportStreamMultiplexor
 ::deliverDataToClient(u_int8_t pid, unsigned char* buffer, unsigned bufferSize,
 		      unsigned& startPositionInBuffer) {
-  // Construct a new Transport packet, and deliver it to the client:
-  if (fMaxSize < TRANSPORT_PACKET_SIZE) {
-    fFrameSize = 0; // the client hasn't given us enough space; deliver nothing
-    fNumTruncatedBytes = TRANSPORT_PACKET_SIZE;
+  // Construct a new Transport packet, and add it to the client's buffer:
+  if (fMaxSize - fFrameSize < TRANSPORT_PACKET_SIZE) {
+    fNumTruncatedBytes += TRANSPORT_PACKET_SIZE; // the client hasn't given us enough space; deliver nothing
   } else {
-    fFrameSize = TRANSPORT_PACKET_SIZE;
     Boolean willAddPCR = pid == fPCR_PID && startPositionInBuffer == 0
       && !(fPCR.highBit == 0 && fPCR.remainingBits == 0 && fPCR.extension == 0);
     unsigned const numBytesAvailable = bufferSize - startPositionInBuffer;
@@ -187,7 +205,7 @@ void MPEG2TransportStreamMultiplexor
     //         == TRANSPORT_PACKET_SIZE
 
     // Fill in the header of the Transport Stream packet:
-    unsigned char* header = fTo;
+    unsigned char* header = &fTo[fFrameSize];
     *header++ = 0x47; // sync_byte
     *header++ = (startPositionInBuffer == 0) ? 0x40 : 0x00;
       // transport_error_indicator, payload_unit_start_indicator, transport_priority,
@@ -230,6 +248,7 @@ void MPEG2TransportStreamMultiplexor
     // Finally, add the data bytes:
     memmove(header, &buffer[startPositionInBuffer], numDataBytes);
     startPositionInBuffer += numDataBytes;
+    fFrameSize += TRANSPORT_PACKET_SIZE;
   }
 }
 
@@ -240,87 +259,83 @@ static u_int32_t calculateCRC(u_int8_t* data, unsigned dataLength); // forward
 #define OUR_PROGRAM_MAP_PID 0x30
 
 void MPEG2TransportStreamMultiplexor::deliverPATPacket() {
-  // First, create a new buffer for the PAT packet:
-  unsigned const patSize = TRANSPORT_PACKET_SIZE - 4; // allow for the 4-byte header
-  unsigned char* patBuffer = new unsigned char[patSize];
-
-  // and fill it in:
-  unsigned char* pat = patBuffer;
-  *pat++ = 0; // pointer_field
-  *pat++ = 0; // table_id
-  *pat++ = 0xB0; // section_syntax_indicator; 0; reserved, section_length (high)
-  *pat++ = 13; // section_length (low)
-  *pat++ = 0; *pat++ = 1; // transport_stream_id
-  *pat++ = 0xC3; // reserved; version_number; current_next_indicator
-  *pat++ = 0; // section_number
-  *pat++ = 0; // last_section_number
-  *pat++ = OUR_PROGRAM_NUMBER>>8; *pat++ = OUR_PROGRAM_NUMBER; // program_number
-  *pat++ = 0xE0|(OUR_PROGRAM_MAP_PID>>8); // reserved; program_map_PID (high)
-  *pat++ = OUR_PROGRAM_MAP_PID; // program_map_PID (low)
-
-  // Compute the CRC from the bytes we currently have (not including "pointer_field"):
-  u_int32_t crc = calculateCRC(patBuffer+1, pat - (patBuffer+1));
-  *pat++ = crc>>24; *pat++ = crc>>16; *pat++ = crc>>8; *pat++ = crc;
-
-  // Fill in the rest of the packet with padding bytes:
-  while (pat < &patBuffer[patSize]) *pat++ = 0xFF;
+  // Our Program Association Table never changes, so we construct it just once:
+  unsigned char* patBuffer = fPATBuffer; // alias
+  if (!fPATIsSet) {
+    unsigned char* pat = patBuffer;
+    *pat++ = 0; // pointer_field
+    *pat++ = 0; // table_id
+    *pat++ = 0xB0; // section_syntax_indicator; 0; reserved, section_length (high)
+    *pat++ = 13; // section_length (low)
+    *pat++ = 0; *pat++ = 1; // transport_stream_id
+    *pat++ = 0xC3; // reserved; version_number; current_next_indicator
+    *pat++ = 0; // section_number
+    *pat++ = 0; // last_section_number
+    *pat++ = OUR_PROGRAM_NUMBER>>8; *pat++ = OUR_PROGRAM_NUMBER; // program_number
+    *pat++ = 0xE0|(OUR_PROGRAM_MAP_PID>>8); // reserved; program_map_PID (high)
+    *pat++ = OUR_PROGRAM_MAP_PID; // program_map_PID (low)
+
+    // Compute the CRC from the bytes we currently have (not including "pointer_field"):
+    u_int32_t crc = calculateCRC(patBuffer+1, pat - (patBuffer+1));
+    *pat++ = crc>>24; *pat++ = crc>>16; *pat++ = crc>>8; *pat++ = crc;
+
+    // Fill in the rest of the packet with padding bytes:
+    while (pat < &patBuffer[PSI_TABLE_PAYLOAD_SIZE]) *pat++ = 0xFF;
+    fPATIsSet = True;
+  }
 
   // Deliver the packet:
   unsigned startPosition = 0;
-  deliverDataToClient(PAT_PID, patBuffer, patSize, startPosition);
-
-  // Finally, remove the new buffer:
-  delete[] patBuffer;
+  deliverDataToClient(PAT_PID, patBuffer, PSI_TABLE_PAYLOAD_SIZE, startPosition);
 }
 
 void MPEG2TransportStreamMultiplexor::deliverPMTPacket(Boolean hasChanged) {
-  if (hasChanged) ++fProgramMapVersion;
-
-  // First, create a new buffer for the PMT packet:
-  unsigned const pmtSize = TRANSPORT_PACKET_SIZE - 4; // allow for the 4-byte header
-  unsigned char* pmtBuffer = new unsigned char[pmtSize];
-
-  // and fill it in:
-  unsigned char* pmt = pmtBuffer;
-  *pmt++ = 0; // pointer_field
-  *pmt++ = 2; // table_id
-  *pmt++ = 0xB0; // section_syntax_indicator; 0; reserved, section_length (high)
-  unsigned char* section_lengthPtr = pmt; // save for later
-  *pmt++ = 0; // section_length (low) (fill in later)
-  *pmt++ = OUR_PROGRAM_NUMBER>>8; *pmt++ = OUR_PROGRAM_NUMBER; // program_number
-  *pmt++ = 0xC1|((fProgramMapVersion&0x1F)<<1); // reserved; version_number; current_next_indicator
-  *pmt++ = 0; // section_number
-  *pmt++ = 0; // last_section_number
-  *pmt++ = 0xE0; // reserved; PCR_PID (high)
-  *pmt++ = fPCR_PID; // PCR_PID (low)
-  *pmt++ = 0xF0; // reserved; program_info_length (high)
-  *pmt++ = 0; // program_info_length (low)
-  for (int pid = 0; pid < PID_TABLE_SIZE; ++pid) {
-    if (fPIDState[pid].streamType != 0) {
-      // This PID gets recorded in the table
-      *pmt++ = fPIDState[pid].streamType;
-      *pmt++ = 0xE0; // reserved; elementary_pid (high)
-      *pmt++ = pid; // elementary_pid (low)
-      *pmt++ = 0xF0; // reserved; ES_info_length (high)
-      *pmt++ = 0; // ES_info_length (low)
-    }
+  if (hasChanged) {
+    ++fProgramMapVersion;
+    fPMTIsCurrent = False;
   }
-  unsigned section_length = pmt - (section_lengthPtr+1) + 4 /*for CRC*/;
-  *section_lengthPtr = section_length;
 
-  // Compute the CRC from the bytes we currently have (not including "pointer_field"):
-  u_int32_t crc = calculateCRC(pmtBuffer+1, pmt - (pmtBuffer+1));
-  *pmt++ = crc>>24; *pmt++ = crc>>16; *pmt++ = crc>>8; *pmt++ = crc;
+  // We (re)construct our Program Map Table only when its contents have changed:
+  if (!fPMTIsCurrent) {
+    unsigned char* pmt = fPMTBuffer;
+    *pmt++ = 0; // pointer_field
+    *pmt++ = 2; // table_id
+    *pmt++ = 0xB0; // section_syntax_indicator; 0; reserved, section_length (high)
+    unsigned char* section_lengthPtr = pmt; // save for later
+    *pmt++ = 0; // section_length (low) (fill in later)
+    *pmt++ = OUR_PROGRAM_NUMBER>>8; *pmt++ = OUR_PROGRAM_NUMBER; // program_number
+    *pmt++ = 0xC1|((fProgramMapVersion&0x1F)<<1); // reserved; version_number; current_next_indicator
+    *pmt++ = 0; // section_number
+    *pmt++ = 0; // last_section_number
+    *pmt++ = 0xE0; // reserved; PCR_PID (high)
+    *pmt++ = fPCR_PID; // PCR_PID (low)
+    *pmt++ = 0xF0; // reserved; program_info_length (high)
+    *pmt++ = 0; // program_info_length (low)
+    for (int pid = 0; pid < PID_TABLE_SIZE; ++pid) {
+      if (fPIDState[pid].streamType != 0) {
+	// This PID gets recorded in the table
+	*pmt++ = fPIDState[pid].streamType;
+	*pmt++ = 0xE0; // reserved; elementary_pid (high)
+	*pmt++ = pid; // elementary_pid (low)
+	*pmt++ = 0xF0; // reserved; ES_info_length (high)
+	*pmt++ = 0; // ES_info_length (low)
+      }
+    }
+    unsigned section_length = pmt - (section_lengthPtr+1) + 4 /*for CRC*/;
+    *section_lengthPtr = section_length;
+
+    // Compute the CRC from the bytes we currently have (not including "pointer_field"):
+    u_int32_t crc = calculateCRC(fPMTBuffer+1, pmt - (fPMTBuffer+1));
+    *pmt++ = crc>>24; *pmt++ = crc>>16; *pmt++ = crc>>8; *pmt++ = crc;
 
-  // Fill in the rest of the packet with padding bytes:
-  while (pmt < &pmtBuffer[pmtSize]) *pmt++ = 0xFF;
+    // Fill in the rest of the packet with padding bytes:
+    while (pmt < &fPMTBuffer[PSI_TABLE_PAYLOAD_SIZE]) *pmt++ = 0xFF;
+    fPMTIsCurrent = True;
+  }
 
   // Deliver the packet:
   unsigned startPosition = 0;
-  deliverDataToClient(OUR_PROGRAM_MAP_PID, pmtBuffer, pmtSize, startPosition);
-
-  // Finally, remove the new buffer:
-  delete[] pmtBuffer;
+  deliverDataToClient(OUR_PROGRAM_MAP_PID, fPMTBuffer, PSI_TABLE_PAYLOAD_SIZE, startPosition);
 }
 
 void MPEG2TransportStreamMultiplexor::setProgramStreamMap(unsigned frameSize) {
@@ -335,6 +350,7 @@ void MPEG2TransportStreamMultiplexor::setProgramStreamMap(unsigned frameSize) {
   u_int8_t versionByte = fInputBuffer[6];
   if ((versionByte&0x80) == 0) return; // "current_next_indicator" is not set
   fCurrentInputProgramMapVersion = versionByte&0x1F;
+  fPMTIsCurrent = False; // because we might change stream types (below)
 
   u_int16_t program_stream_info_length = (fInputBuffer[8]<<8) | fInputBuffer[9];
   unsigned offset = 10 + program_stream_info_length; // skip over 'descriptors'
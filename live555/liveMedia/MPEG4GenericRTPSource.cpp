@@ -19,7 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MPEG4GenericRTPSource.hh"
-#include "BitVector.hh"
+#include "BitReader.hh"
 #include "MPEG4LATMAudioRTPSource.hh" // for parseGeneralConfigStr()
 
 ////////// MPEG4GenericBufferedPacket and MPEG4GenericBufferedPacketFactory
@@ -144,7 +144,7 @@ Boolean MPEG4GenericRTPSource
     if (fNumAUHeaders > 0) {
       fAUHeaders = new AUHeader[fNumAUHeaders];
       // Fill in each header:
-      BitVector bv(&headerStart[2], 0, AU_headers_length);
+      BitReader bv(&headerStart[2], 0, AU_headers_length);
       fAUHeaders[0].size = bv.getBits(fSizeLength);
       fAUHeaders[0].index = bv.getBits(fIndexLength);
 
@@ -70,6 +70,54 @@ protected:
     *fTo++ = word>>24; *fTo++ = word>>16; *fTo++ = word>>8; *fTo++ = word;
   }
 
+  // Record the next "numBytes" bytes of input data in the current output frame (and advance past them):
+  void saveBytes(unsigned numBytes) {
+    unsigned numBytesToCopy = numBytes;
+    if (fTo + numBytesToCopy > fLimit) { // there's not enough space left
+      numBytesToCopy = fLimit - fTo;
+      fNumTruncatedBytes += numBytes - numBytesToCopy;
+    }
+
+    testBytes(fTo, numBytesToCopy);
+    fTo += numBytesToCopy;
+    skipBytes(numBytes);
+  }
+
+  // Save (or skip) all data that precedes the next 0x000001.  If we run out of input data while doing this, then - when we're
+  // restarted - we resume from where we got to, rather than scanning (and copying) the same data again:
+  void saveBytesToNextCode() {
+    unsigned scanStartOffset = curOffset();
+    void const* scanTag = fTo; // identifies this scan
+    unsigned numBytesAlreadySaved = previousScanProgress(scanTag);
+    if (numBytesAlreadySaved > 0) {
+      // These bytes are already in our output frame (or were truncated); just advance past them:
+      unsigned numBytesInFrame = numBytesAlreadySaved;
+      if (fTo + numBytesInFrame > fLimit) {
+	numBytesInFrame = fLimit - fTo;
+	fNumTruncatedBytes += numBytesAlreadySaved - numBytesInFrame;
+      }
+      fTo += numBytesInFrame;
+      skipBytes(numBytesAlreadySaved);
+    }
+
+    Boolean foundSyncWord;
+    do {
+      saveBytes(scanForStartCode(foundSyncWord));
+      noteScanProgress(scanStartOffset, scanTag);
+    } while (!foundSyncWord);
+  }
+  void skipBytesToNextCode() {
+    unsigned scanStartOffset = curOffset();
+    void const* scanTag = this; // identifies this scan (and can't be confused with an output pointer)
+    skipBytes(previousScanProgress(scanTag));
+
+    Boolean foundSyncWord;
+    do {
+      skipBytes(scanForStartCode(foundSyncWord));
+      noteScanProgress(scanStartOffset, scanTag);
+    } while (!foundSyncWord);
+  }
+
   // Save data until we see a sync word (0x000001xx):
   void saveToNextCode(u_int32_t& curWord) {
     saveByte(curWord>>24);
@@ -78,6 +126,8 @@ protected:
       if ((unsigned)(curWord&0xFF) > 1) {
 	// a sync word definitely doesn't begin anywhere in "curWord"
 	save4Bytes(curWord);
+	// so search (in bulk) for the next sync word, saving all data up to it:
+	saveBytesToNextCode();
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -94,6 +144,8 @@ protected:
     while ((curWord&0xFFFFFF00) != 0x00000100) {
       if ((unsigned)(curWord&0xFF) > 1) {
 	// a sync word definitely doesn't begin anywhere in "curWord"
+	// so search (in bulk) for the next sync word, skipping all data up to it:
+	skipBytesToNextCode();
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -21,6 +21,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MatroskaFileParser.hh"
 #include "MatroskaDemuxedTrack.hh"
 #include <ByteStreamFileSource.hh>
+#include "InputFile.hh"
+#include "OutputFile.hh"
 
 ////////// CuePoint definition //////////
 
@@ -37,6 +39,8 @@ public:
   Boolean lookup(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster);
 
   static void fprintf(FILE* fid, CuePoint* cuePoint); // used for debugging; it's static to allow for "cuePoint == NULL"
+  static Boolean writeIndexRecords(FILE* fid, CuePoint* cuePoint);
+    // writes the tree (in order of cue time) as index file records; it's static to allow for "cuePoint == NULL"
 
 private:
   // The "CuePoint" tree is implemented as an AVL Tree, to keep it balanced (for efficient lookup).
@@ -54,24 +58,52 @@ private:
 
 UsageEnvironment& operator<<(UsageEnvironment& env, const CuePoint* cuePoint); // used for debugging
 
+// An index file begins with a header: the 4 bytes "MKVX", then the size of the indexed Matroska file (8 bytes, big-endian),
+// then (the low 32 bits of) its modification time, in seconds (4 bytes, big-endian).  This is followed by a sequence of records, in increasing order of cue time, each containing
+// (big-endian) the cue time in microseconds (8 bytes), the cluster's position in the file (8 bytes), and the (1-based)
+// block number within the cluster (4 bytes):
+#define INDEX_FILE_HEADER_SIZE 16
+#define INDEX_FILE_RECORD_SIZE 20
+
+static void putBigEndian(u_int8_t* to, u_int64_t value, unsigned numBytes) {
+  while (numBytes-- > 0) {
+    to[numBytes] = (u_int8_t)value;
+    value >>= 8;
+  }
+}
+
+static u_int64_t getBigEndian(u_int8_t const* from, unsigned numBytes) {
+  u_int64_t result = 0;
+  for (unsigned i = 0; i < numBytes; ++i) result = (result<<8)|from[i];
+  return result;
+}
+
 
 ////////// MatroskaFile implementation //////////
 
 void MatroskaFile
 ::createNew(UsageEnvironment& env, char const* fileName, onCreationFunc* onCreation, void* onCreationClientData,
-	    char const* preferredLanguage) {
-  new MatroskaFile(env, fileName, onCreation, onCreationClientData, preferredLanguage);
+	    char const* preferredLanguage, Boolean createIndexFileIfAbsent) {
+  new MatroskaFile(env, fileName, onCreation, onCreationClientData, preferredLanguage, createIndexFileIfAbsent);
 }
 
 MatroskaFile::MatroskaFile(UsageEnvironment& env, char const* fileName, onCreationFunc* onCreation, void* onCreationClientData,
-			   char const* preferredLanguage)
+			   char const* preferredLanguage, Boolean createIndexFileIfAbsent)
   : Medium(env),
     fFileName(strDup(fileName)), fOnCreation(onCreation), fOnCreationClientData(onCreationClientData),
     fPreferredLanguage(strDup(preferredLanguage)),
     fTimecodeScale(1000000), fSegmentDuration(0.0), fSegmentDataOffset(0), fClusterOffset(0), fCuesOffset(0), fCuePoints(NULL),
-    fChosenVideoTrackNumber(0), fChosenAudioTrackNumber(0), fChosenSubtitleTrackNumber(0) {
+    fChosenVideoTrackNumber(0), fChosenAudioTrackNumber(0), fChosenSubtitleTrackNumber(0),
+    fCreateIndexFileIfAbsent(createIndexFileIfAbsent), fHaveReadIndexFile(False), fParserForIndexing(NULL),
+    fAfterIndexing(NULL), fAfterIndexingClientData(NULL) {
   fDemuxesTable = HashTable::create(ONE_WORD_HASH_KEYS);
 
+  // Our index file name is the same as our file name, except with an extra 'x' at the end:
+  fIndexFileName = new char[strlen(fileName) + 2]; // allow for the trailing x\0
+  sprintf(fIndexFileName, "%sx", fileName);
+  fHaveIndexFile = indexFileIsUpToDate();
+    // If so, we'll get our cue points from the index file (lazily), rather than by parsing the file's 'Cues'
+
   FramedSource* inputSource = ByteStreamFileSource::createNew(envir(), fileName);
   if (inputSource == NULL) {
     // The specified input file does not exist!
@@ -85,6 +117,7 @@ MatroskaFile::MatroskaFile(UsageEnvironment& env, char const* fileName, onCreati
 
 MatroskaFile::~MatroskaFile() {
   delete fParserForInitialization;
+  delete fParserForIndexing;
   delete fCuePoints;
 
   // Delete any outstanding "MatroskaDemux"s, and the table for them:
@@ -94,6 +127,7 @@ MatroskaFile::~MatroskaFile() {
   }
   delete fDemuxesTable;
 
+  delete[] fIndexFileName;
   delete[] (char*)fPreferredLanguage;
   delete[] (char*)fFileName;
 }
@@ -175,10 +209,61 @@ void MatroskaFile::handleEndOfTrackHeaderParsing() {
   // Delete our parser, because it's done its job now:
   delete fParserForInitialization; fParserForInitialization = NULL;
 
+  if (fCreateIndexFileIfAbsent && !fHaveIndexFile && numTracks > 0) {
+    if (fCuePoints != NULL) {
+      // We've just parsed the file's 'Cues', so write our index file from these, for next time:
+      fHaveIndexFile = writeIndexFile();
+    } else {
+      // The file has no 'Cues', so we need to scan the whole file to create our index file.
+      // We'll signal our caller after this has been done:
+      createIndexFile(afterCreatingIndexFile, NULL);
+      return;
+    }
+  }
+
   // Finally, signal our caller that we've been created and initialized:
   if (fOnCreation != NULL) (*fOnCreation)(this, fOnCreationClientData);
 }
 
+void MatroskaFile::createIndexFile(afterIndexingFunc* afterIndexing, void* afterIndexingClientData) {
+  fAfterIndexing = afterIndexing;
+  fAfterIndexingClientData = afterIndexingClientData;
+
+  delete fParserForIndexing; fParserForIndexing = NULL; // in case we were already indexing
+
+  FramedSource* inputSource = ByteStreamFileSource::createNew(envir(), fFileName);
+  if (inputSource == NULL) {
+    // The file no longer exists!
+    if (fAfterIndexing != NULL) (*fAfterIndexing)(this, False, fAfterIndexingClientData);
+    return;
+  }
+
+  // Our existing cue points (if any) get replaced by those that we find while scanning.
+  // (Also, we no longer use any existing index file, because it's about to be overwritten.)
+  delete fCuePoints; fCuePoints = NULL;
+  fHaveReadIndexFile = True;
+
+  fParserForIndexing = new MatroskaFileParser(*this, inputSource, handleEndOfIndexing, this, NULL, True/*for indexing*/);
+}
+
+void MatroskaFile::handleEndOfIndexing(void* clientData) {
+  ((MatroskaFile*)clientData)->handleEndOfIndexing();
+}
+
+void MatroskaFile::handleEndOfIndexing() {
+  // We've scanned the whole file, so delete our parser, and write our index file:
+  fParserForIndexing->finishIndexing();
+  delete fParserForIndexing; fParserForIndexing = NULL;
+
+  fHaveIndexFile = fCuePoints != NULL && writeIndexFile();
+  if (fAfterIndexing != NULL) (*fAfterIndexing)(this, fHaveIndexFile, fAfterIndexingClientData);
+}
+
+void MatroskaFile::afterCreatingIndexFile(MatroskaFile* file, Boolean /*success*/, void* /*clientData*/) {
+  // We were creating an index file during initialization.  Now that this is done, signal our caller:
+  if (file->fOnCreation != NULL) (*file->fOnCreation)(file, file->fOnCreationClientData);
+}
+
 MatroskaDemux* MatroskaFile::newDemux() {
   MatroskaDemux* demux = new MatroskaDemux(*this);
   fDemuxesTable->Add((char const*)demux, demux);
@@ -191,7 +276,8 @@ void MatroskaFile::removeDemux(MatroskaDemux* demux) {
 }
 
 float MatroskaFile::fileDuration() {
-  if (fCuePoints == NULL) return 0.0; // Hack, because the RTSP server code assumes that duration > 0 => seekable. (fix this) #####
+  // (If we have an index file, then we read it now, in case it turns out to be unusable.)
+  if (!haveCuePoints()) return 0.0; // Hack, because the RTSP server code assumes that duration > 0 => seekable. (fix this) #####
 
   return segmentDuration()*(timecodeScale()/1000000000.0f);
 }
@@ -202,7 +288,7 @@ void MatroskaFile::addCuePoint(double cueTime, u_int64_t clusterOffsetInFile, un
 }
 
 Boolean MatroskaFile::lookupCuePoint(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster) {
-  if (fCuePoints == NULL) return False;
+  if (!haveCuePoints()) return False;
 
   (void)fCuePoints->lookup(cueTime, resultClusterOffsetInFile, resultBlockNumWithinCluster);
   return True;
@@ -212,6 +298,73 @@ void MatroskaFile::printCuePoints(FILE* fid) {
   CuePoint::fprintf(fid, fCuePoints);
 }
 
+Boolean MatroskaFile::haveCuePoints() {
+  if (fCuePoints == NULL && fHaveIndexFile && !fHaveReadIndexFile) {
+    // This is the first time that our cue points are needed, so read them from our index file:
+    fHaveReadIndexFile = True;
+    if (!readIndexFile()) fHaveIndexFile = False;
+  }
+
+  return fCuePoints != NULL;
+}
+
+Boolean MatroskaFile::indexFileIsUpToDate() {
+  // Check that our index file exists, is well-formed, and was made from a file of the same size and modification time
+  // as ours:
+  u_int64_t indexFileSize = GetFileSize(fIndexFileName, NULL);
+  if (indexFileSize <= INDEX_FILE_HEADER_SIZE || (indexFileSize - INDEX_FILE_HEADER_SIZE)%INDEX_FILE_RECORD_SIZE != 0) return False;
+
+  FILE* fid = OpenInputFile(envir(), fIndexFileName);
+  if (fid == NULL) return False;
+
+  u_int8_t header[INDEX_FILE_HEADER_SIZE];
+  Boolean result = fread(header, INDEX_FILE_HEADER_SIZE, 1, fid) == 1
+    && memcmp(header, "MKVX", 4) == 0
+    && getBigEndian(&header[4], 8) == GetFileSize(fFileName, NULL)
+    && getBigEndian(&header[12], 4) == (u_int32_t)GetFileModificationTime(fFileName);
+  CloseInputFile(fid);
+
+  return result;
+}
+
+Boolean MatroskaFile::readIndexFile() {
+  FILE* fid = OpenInputFile(envir(), fIndexFileName);
+  if (fid == NULL) return False;
+
+  if (SeekFile64(fid, INDEX_FILE_HEADER_SIZE, SEEK_SET) == 0) {
+    u_int8_t record[INDEX_FILE_RECORD_SIZE];
+    while (fread(record, INDEX_FILE_RECORD_SIZE, 1, fid) == 1) {
+      double cueTime = getBigEndian(&record[0], 8)/1000000.0;
+      u_int64_t clusterOffsetInFile = getBigEndian(&record[8], 8);
+      unsigned blockNumWithinCluster = (unsigned)getBigEndian(&record[16], 4);
+
+      addCuePoint(cueTime, clusterOffsetInFile, blockNumWithinCluster);
+    }
+  }
+  CloseInputFile(fid);
+#ifdef DEBUG
+  fprintf(stderr, "Read cue points from index file \"%s\"\n", fIndexFileName);
+#endif
+
+  return fCuePoints != NULL;
+}
+
+Boolean MatroskaFile::writeIndexFile() {
+  FILE* fid = OpenOutputFile(envir(), fIndexFileName);
+  if (fid == NULL) return False;
+
+  u_int8_t header[INDEX_FILE_HEADER_SIZE];
+  memcpy(header, "MKVX", 4);
+  putBigEndian(&header[4], GetFileSize(fFileName, NULL), 8);
+  putBigEndian(&header[12], (u_int32_t)GetFileModificationTime(fFileName), 4);
+
+  Boolean result = fwrite(header, INDEX_FILE_HEADER_SIZE, 1, fid) == 1 && CuePoint::writeIndexRecords(fid, fCuePoints);
+  CloseOutputFile(fid);
+
+  if (!result) remove(fIndexFileName); // don't leave a partially-written index file behind
+  return result;
+}
+
 
 ////////// MatroskaFile::TrackTable implementation //////////
 
@@ -453,6 +606,20 @@ void CuePoint::fprintf(FILE* fid, CuePoint* cuePoint) {
   }
 }
 
+Boolean CuePoint::writeIndexRecords(FILE* fid, CuePoint* cuePoint) {
+  if (cuePoint == NULL) return True;
+
+  if (!writeIndexRecords(fid, cuePoint->left())) return False;
+
+  u_int8_t record[INDEX_FILE_RECORD_SIZE];
+  putBigEndian(&record[0], (u_int64_t)(cuePoint->fCueTime*1000000.0 + 0.5), 8);
+  putBigEndian(&record[8], cuePoint->fClusterOffsetInFile, 8);
+  putBigEndian(&record[16], cuePoint->fBlockNumWithinCluster + 1, 4);
+  if (fwrite(record, INDEX_FILE_RECORD_SIZE, 1, fid) != 1) return False;
+
+  return writeIndexRecords(fid, cuePoint->right());
+}
+
 void CuePoint::rotate(unsigned direction/*0 => left; 1 => right*/, CuePoint*& root) {
   CuePoint* pivot = root->fSubTree[1-direction]; // ASSERT: pivot != NULL
   root->fSubTree[1-direction] = pivot->fSubTree[direction];
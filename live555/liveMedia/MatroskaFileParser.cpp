@@ -25,7 +25,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 MatroskaFileParser::MatroskaFileParser(MatroskaFile& ourFile, FramedSource* inputSource,
 				       FramedSource::onCloseFunc* onEndFunc, void* onEndClientData,
-				       MatroskaDemux* ourDemux)
+				       MatroskaDemux* ourDemux, Boolean forIndexing)
   : StreamParser(inputSource, onEndFunc, onEndClientData, continueParsing, this),
     fOurFile(ourFile), fInputSource(inputSource),
     fOnEndFunc(onEndFunc), fOnEndClientData(onEndClientData),
@@ -33,8 +33,17 @@ MatroskaFileParser::MatroskaFileParser(MatroskaFile& ourFile, FramedSource* inpu
     fCurOffsetInFile(0), fSavedCurOffsetInFile(0), fLimitOffsetInFile(0),
     fClusterTimecode(0), fBlockTimecode(0),
     fFrameSizesWithinBlock(NULL),
-    fPresentationTimeOffset(0.0) {
-  if (ourDemux == NULL) {
+    fPresentationTimeOffset(0.0),
+    fIndexClusterOffsetInFile(0), fIndexNumBlocksWithinCluster(0), fIndexHaveCuePointForCluster(False),
+    fIndexNumBytesToSkip(0), fIndexBlockGroupEndOffsetInFile(0), fIndexPendingCueTime(0.0), fIndexPendingCueBlockNumber(0) {
+  // When indexing, we note the key frames of the chosen video track (or, if there's no video, the chosen audio track):
+  fIndexTrackNumber = ourFile.chosenVideoTrackNumber() != 0 ? ourFile.chosenVideoTrackNumber() : ourFile.chosenAudioTrackNumber();
+
+  if (forIndexing) {
+    // Scan the whole file (from the start), noting cue points as we go:
+    fCurrentParseState = INDEXING_FILE;
+    continueParsing();
+  } else if (ourDemux == NULL) {
     // Initialization
     fCurrentParseState = PARSING_START_OF_FILE;
     continueParsing();
@@ -120,8 +129,9 @@ Boolean MatroskaFileParser::parse() {
 	}
         case PARSING_TRACK: {
 	  areDone = parseTrack();
-	  if (areDone && fOurFile.fCuesOffset > 0) {
-	    // We've finished parsing the 'Track' information.  There are also 'Cues' in the file, so parse those before finishing:
+	  if (areDone && fOurFile.fCuesOffset > 0 && !fOurFile.fHaveIndexFile) {
+	    // We've finished parsing the 'Track' information.  There are also 'Cues' in the file (and we don't have an
+	    // up-to-date index file that we could use instead), so parse those before finishing:
 	    // Seek to the specified position in the file.  We were already told that the 'Cues' begins there:
 #ifdef DEBUG
 	    fprintf(stderr, "Seeking to file position %llu (the previously-reported location of 'Cues')\n", fOurFile.fCuesOffset);
@@ -164,6 +174,10 @@ Boolean MatroskaFileParser::parse() {
 	  return False; // Halt parsing for now.  A new 'read' from downstream will cause parsing to resume.
 	  break;
 	}
+        case INDEXING_FILE: {
+	  indexFile();
+	  break;
+	}
       }
     } while (!areDone);
 
@@ -728,6 +742,116 @@ Boolean MatroskaFileParser::parseCues() {
   return True; // we're done parsing Cues
 }
 
+void MatroskaFileParser::indexFile() {
+  // Read and skip over (or enter) each Matroska header, noting the position and time of the first key frame (in our
+  // 'index track') within each 'Cluster'.  We continue doing this until we reach the end of the file.
+  // (Because we don't seek while doing this, "fCurOffsetInFile" is always the absolute position within the file.)
+  EBMLId id;
+  EBMLDataSize size;
+  while (1) {
+    // First, skip over any data that remains from the previous header:
+    while (fIndexNumBytesToSkip > 0) {
+      unsigned numBytesToSkip = numAvailableBytes(fIndexNumBytesToSkip > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned)fIndexNumBytesToSkip);
+      skipBytes(numBytesToSkip);
+      fCurOffsetInFile += numBytesToSkip;
+      fIndexNumBytesToSkip -= numBytesToSkip;
+      setParseState();
+    }
+
+    while (!parseEBMLIdAndSize(id, size)) {}
+    u_int64_t headerOffsetInFile = fCurOffsetInFile - id.len - size.len;
+    if (fIndexBlockGroupEndOffsetInFile > 0
+	&& (headerOffsetInFile >= fIndexBlockGroupEndOffsetInFile
+	    || id == MATROSKA_ID_BLOCK_GROUP || id == MATROSKA_ID_CLUSTER)) {
+      indexEndOfBlockGroup(); // we've moved past the previous 'Block Group'
+    }
+    switch (id.val()) {
+      case MATROSKA_ID_SEGMENT: { // 'Segment' header: enter this
+	break;
+      }
+      case MATROSKA_ID_BLOCK_GROUP: { // 'Block Group' header: enter this, noting where it ends
+	fIndexBlockGroupEndOffsetInFile = fCurOffsetInFile + size.val();
+	break;
+      }
+      case MATROSKA_ID_REFERENCE_BLOCK: { // 'Reference Block' header: the 'Block' in this 'Block Group' isn't a key frame
+	fIndexPendingCueBlockNumber = 0;
+	fIndexNumBytesToSkip = size.val();
+	break;
+      }
+      case MATROSKA_ID_CLUSTER: { // 'Cluster' header: enter this, noting its position
+	fIndexClusterOffsetInFile = headerOffsetInFile;
+	fIndexNumBlocksWithinCluster = 0;
+	fIndexHaveCuePointForCluster = False;
+	break;
+      }
+      case MATROSKA_ID_TIMECODE: { // 'Timecode' header: get this value
+	unsigned timecode;
+	if (parseEBMLVal_unsigned(size, timecode)) fClusterTimecode = timecode;
+	break;
+      }
+      case MATROSKA_ID_SIMPLEBLOCK:
+      case MATROSKA_ID_BLOCK: { // 'SimpleBlock' or 'Block' header: check its track number, timecode and flags
+	u_int64_t blockEndOffsetInFile = fCurOffsetInFile + size.val();
+
+	EBMLNumber trackNumber;
+	if (parseEBMLNumber(trackNumber)) {
+	  short blockTimecode = (get1Byte()<<8)|get1Byte();
+	  u_int8_t flags = get1Byte();
+	  fCurOffsetInFile += 3;
+	  ++fIndexNumBlocksWithinCluster;
+
+	  if (!fIndexHaveCuePointForCluster && fIndexPendingCueBlockNumber == 0
+	      && (fIndexTrackNumber == 0 || trackNumber.val() == fIndexTrackNumber)) {
+	    int timecode = (int)fClusterTimecode + blockTimecode;
+	    double cueTime = timecode <= 0 ? 0.0 : timecode*(fOurFile.fTimecodeScale/1000000000.0);
+
+	    if (id == MATROSKA_ID_SIMPLEBLOCK) {
+	      // A 'SimpleBlock' tells us whether it's a key frame:
+	      if ((flags&0x80) != 0) {
+#ifdef DEBUG
+		fprintf(stderr, "\tindexed cue point: time %f, cluster position %llu, block number %d\n", cueTime, fIndexClusterOffsetInFile, fIndexNumBlocksWithinCluster);
+#endif
+		fOurFile.addCuePoint(cueTime, fIndexClusterOffsetInFile, fIndexNumBlocksWithinCluster);
+		fIndexHaveCuePointForCluster = True;
+	      }
+	    } else if (fIndexBlockGroupEndOffsetInFile > 0) {
+	      // A 'Block' is a key frame unless its 'Block Group' also contains a 'Reference Block' (which may come after
+	      // it), so we don't know yet:
+	      fIndexPendingCueTime = cueTime;
+	      fIndexPendingCueBlockNumber = fIndexNumBlocksWithinCluster;
+	    }
+	  }
+	}
+	if (blockEndOffsetInFile > fCurOffsetInFile) fIndexNumBytesToSkip = blockEndOffsetInFile - fCurOffsetInFile;
+	break;
+      }
+      default: { // skip over this header
+	fIndexNumBytesToSkip = size.val();
+	break;
+      }
+    }
+    setParseState();
+  }
+}
+
+void MatroskaFileParser::indexEndOfBlockGroup() {
+  if (fIndexPendingCueBlockNumber > 0) {
+    // The 'Block' in this 'Block Group' had no 'Reference Block', so it's a key frame:
+#ifdef DEBUG
+    fprintf(stderr, "\tindexed cue point: time %f, cluster position %llu, block number %d\n", fIndexPendingCueTime, fIndexClusterOffsetInFile, fIndexPendingCueBlockNumber);
+#endif
+    fOurFile.addCuePoint(fIndexPendingCueTime, fIndexClusterOffsetInFile, fIndexPendingCueBlockNumber);
+    fIndexHaveCuePointForCluster = True;
+    fIndexPendingCueBlockNumber = 0;
+  }
+  fIndexBlockGroupEndOffsetInFile = 0;
+}
+
+void MatroskaFileParser::finishIndexing() {
+  // The file might have ended with a 'Block Group':
+  if (fIndexBlockGroupEndOffsetInFile > 0) indexEndOfBlockGroup();
+}
+
 typedef enum { NoLacing, XiphLacing, FixedSizeLacing, EBMLLacing } MatroskaLacingType;
 
 void MatroskaFileParser::parseBlock() {
@@ -987,10 +1111,9 @@ void MatroskaFileParser::deliverFrameBytes() {
     MatroskaDemuxedTrack* demuxedTrack = fOurDemux->lookupDemuxedTrack(fBlockTrackNumber);
     if (demuxedTrack == NULL) break; // shouldn't happen
 
-    unsigned const BANK_SIZE = bankSize();
     while (fCurFrameNumBytesToGet > 0) {
-      // Hack: We can get no more than BANK_SIZE bytes at a time:
-      unsigned numBytesToGet = fCurFrameNumBytesToGet > BANK_SIZE ? BANK_SIZE : fCurFrameNumBytesToGet;
+      // Copy whatever frame data we have now (rather than waiting until we've read all of it):
+      unsigned numBytesToGet = numAvailableBytes(fCurFrameNumBytesToGet);
       getBytes(fCurFrameTo, numBytesToGet);
       fCurFrameTo += numBytesToGet;
       fCurFrameNumBytesToGet -= numBytesToGet;
@@ -998,8 +1121,7 @@ void MatroskaFileParser::deliverFrameBytes() {
       setParseState();
     }
     while (fCurFrameNumBytesToSkip > 0) {
-      // Hack: We can skip no more than BANK_SIZE bytes at a time:
-      unsigned numBytesToSkip = fCurFrameNumBytesToSkip > BANK_SIZE ? BANK_SIZE : fCurFrameNumBytesToSkip;
+      unsigned numBytesToSkip = numAvailableBytes(fCurFrameNumBytesToSkip);
       skipBytes(numBytesToSkip);
       fCurFrameNumBytesToSkip -= numBytesToSkip;
       fCurOffsetWithinFrame += numBytesToSkip;
@@ -40,17 +40,19 @@ enum MatroskaParseState {
   LOOKING_FOR_BLOCK,
   PARSING_BLOCK,
   DELIVERING_FRAME_WITHIN_BLOCK,
-  DELIVERING_FRAME_BYTES
+  DELIVERING_FRAME_BYTES,
+  INDEXING_FILE
 };
 
 class MatroskaFileParser: public StreamParser {
 public:
   MatroskaFileParser(MatroskaFile& ourFile, FramedSource* inputSource,
 		     FramedSource::onCloseFunc* onEndFunc, void* onEndClientData,
-		     MatroskaDemux* ourDemux = NULL);
+		     MatroskaDemux* ourDemux = NULL, Boolean forIndexing = False);
   virtual ~MatroskaFileParser();
 
   void seekToTime(double& seekNPT);
+  void finishIndexing(); // called (when indexing) at the end of the file
 
   // StreamParser 'client continue' function:
   static void continueParsing(void* clientData, unsigned char* ptr, unsigned size, struct timeval presentationTime);
@@ -71,6 +73,9 @@ private:
   Boolean deliverFrameWithinBlock();
   void deliverFrameBytes();
 
+  void indexFile();
+  void indexEndOfBlockGroup();
+
   void getCommonFrameBytes(MatroskaTrack* track, u_int8_t* to, unsigned numBytesToGet, unsigned numBytesToSkip);
 
   Boolean parseEBMLNumber(EBMLNumber& num);
@@ -125,6 +130,16 @@ private:
   u_int8_t* fCurFrameTo;
   unsigned fCurFrameNumBytesToGet;
   unsigned fCurFrameNumBytesToSkip;
+
+  // State used when scanning the file to create an index file:
+  unsigned fIndexTrackNumber;
+  u_int64_t fIndexClusterOffsetInFile;
+  unsigned fIndexNumBlocksWithinCluster;
+  Boolean fIndexHaveCuePointForCluster;
+  u_int64_t fIndexNumBytesToSkip;
+  u_int64_t fIndexBlockGroupEndOffsetInFile; // 0 if we're not within a 'Block Group'
+  double fIndexPendingCueTime;
+  unsigned fIndexPendingCueBlockNumber; // 0 if none; otherwise, a 'Block' that's a key frame unless its 'Block Group' says not
 };
 
 #endif
@@ -24,6 +24,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "AC3AudioMatroskaFileServerMediaSubsession.hh"
 #include "VorbisAudioMatroskaFileServerMediaSubsession.hh"
 #include "H264VideoMatroskaFileServerMediaSubsession.hh"
+#include "H265VideoMatroskaFileServerMediaSubsession.hh"
 #include "VP8VideoMatroskaFileServerMediaSubsession.hh"
 #include "T140TextMatroskaFileServerMediaSubsession.hh"
 
@@ -68,6 +69,9 @@ ServerMediaSubsession* MatroskaFileServerDemux::newServerMediaSubsession(unsigne
   } else if (strcmp(track->codecID, "V_MPEG4/ISO/AVC") == 0) {
     track->mimeType = "video/H264";
     result = H264VideoMatroskaFileServerMediaSubsession::createNew(*this, track->trackNumber);
+  } else if (strcmp(track->codecID, "V_MPEGH/ISO/HEVC") == 0) {
+    track->mimeType = "video/H265";
+    result = H265VideoMatroskaFileServerMediaSubsession::createNew(*this, track->trackNumber);
   } else if (strncmp(track->codecID, "V_VP8", 5) == 0) {
     track->mimeType = "video/VP8";
     result = VP8VideoMatroskaFileServerMediaSubsession::createNew(*this, track->trackNumber);
@@ -24,7 +24,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 ////////// Medium //////////
 
 Medium::Medium(UsageEnvironment& env)
-	: fEnviron(env), fNextTask(NULL) {
+	: fEnviron(env), fNextTask(NULL), fCreationTime(env.taskScheduler().timeNow()) {
   // First generate a name for the new medium:
   MediaLookupTable::ourMedia(env)->generateNewName(fMediumName, mediumNameMaxLen);
   env.setResultMsg(fMediumName);
@@ -91,6 +91,39 @@ Boolean Medium::isDarwinInjector() const {
   return False; // default implementation
 }
 
+char const* Medium::eventHandlerLabel(void* env, void* handlerClientData,
+				      struct timeval const& lastExecutionTime) {
+  if (env == NULL || handlerClientData == NULL) return NULL;
+  _Tables* ourTables = _Tables::getOurTables(*(UsageEnvironment*)env, False);
+  if (ourTables == NULL || ourTables->mediaTable == NULL) return NULL;
+
+  // Look for a "Medium" with this address.  (We use the address only as a key, so "handlerClientData" need not
+  // be a "Medium".)
+  Medium* medium = ourTables->mediaTable->lookupByAddress(handlerClientData);
+  if (medium == NULL) return NULL;
+
+  // Check that the "Medium" already existed when the handler last ran.  (Creation times are read from the scheduler's
+  // cached clock, so a "Medium" created during the same event loop iteration is treated as newer.)
+  struct timeval const& creationTime = medium->fCreationTime;
+  if (creationTime.tv_sec > lastExecutionTime.tv_sec
+      || (creationTime.tv_sec == lastExecutionTime.tv_sec && creationTime.tv_usec >= lastExecutionTime.tv_usec)) {
+    return NULL;
+  }
+
+  char const* kind
+    = medium->isRTCPInstance() ? "RTCPInstance"
+    : medium->isRTSPServer() ? "RTSPServer"
+    : medium->isRTSPClient() ? "RTSPClient"
+    : medium->isServerMediaSession() ? "ServerMediaSession"
+    : medium->isMediaSession() ? "MediaSession"
+    : medium->isSink() ? "MediaSink"
+    : medium->isSource() ? "MediaSource"
+    : "Medium";
+  static char label[mediumNameMaxLen + 30];
+  sprintf(label, "%s (%s)", medium->name(), kind);
+  return label;
+}
+
 
 ////////// _Tables implementation //////////
 
@@ -102,14 +135,14 @@ _Tables* _Tables::getOurTables(UsageEnvironment& env, Boolean createIfNotPresent
 }
 
 void _Tables::reclaimIfPossible() {
-  if (mediaTable == NULL && socketTable == NULL) {
+  if (mediaTable == NULL && socketTable == NULL && sharedSocketTable == NULL) {
     fEnv.liveMediaPriv = NULL;
     delete this;
   }
 }
 
 _Tables::_Tables(UsageEnvironment& env)
-  : mediaTable(NULL), socketTable(NULL), fEnv(env) {
+  : mediaTable(NULL), socketTable(NULL), sharedSocketTable(NULL), fEnv(env) {
 }
 
 _Tables::~_Tables() {
@@ -132,14 +165,20 @@ Medium* MediaLookupTable::lookup(char const* name) const {
   return (Medium*)(fTable->Lookup(name));
 }
 
+Medium* MediaLookupTable::lookupByAddress(void* address) const {
+  return (Medium*)(fTableByAddress->Lookup((char const*)address));
+}
+
 void MediaLookupTable::addNew(Medium* medium, char* mediumName) {
   fTable->Add(mediumName, (void*)medium);
+  fTableByAddress->Add((char const*)medium, (void*)medium);
 }
 
 void MediaLookupTable::remove(char const* name) {
   Medium* medium = lookup(name);
   if (medium != NULL) {
     fTable->Remove(name);
+    fTableByAddress->Remove((char const*)medium);
     if (fTable->IsEmpty()) {
       // We can also delete ourselves (to reclaim space):
       _Tables* ourTables = _Tables::getOurTables(fEnv);
@@ -159,9 +198,11 @@ void MediaLookupTable::generateNewName(char* mediumName,
 }
 
 MediaLookupTable::MediaLookupTable(UsageEnvironment& env)
-  : fEnv(env), fTable(HashTable::create(STRING_HASH_KEYS)), fNameGenerator(0) {
+  : fEnv(env), fTable(HashTable::create(STRING_HASH_KEYS)), fTableByAddress(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fNameGenerator(0) {
 }
 
 MediaLookupTable::~MediaLookupTable() {
+  delete fTableByAddress;
   delete fTable;
 }
@@ -212,6 +212,8 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
       if (subsession->parseSDPAttribute_source_filter(sdpLine)) continue;
       if (subsession->parseSDPAttribute_x_dimensions(sdpLine)) continue;
       if (subsession->parseSDPAttribute_framerate(sdpLine)) continue;
+      if (subsession->parseSDPAttribute_rtcpmux(sdpLine)) continue;
+      if (subsession->parseSDPAttribute_rtcpfb(sdpLine)) continue;
 
       // (Later, check for malformed lines, and other valid SDP lines#####)
     }
@@ -583,11 +585,13 @@ MediaSubsession::MediaSubsession(MediaSession& parent)
     fCRC(0), fCtsdeltalength(0), fDe_interleavebuffersize(0), fDtsdeltalength(0),
     fIndexdeltalength(0), fIndexlength(0), fInterleaving(0), fMaxdisplacement(0),
     fObjecttype(0), fOctetalign(0), fProfile_level_id(0), fRobustsorting(0),
-    fSizelength(0), fStreamstateindication(0), fStreamtype(0),
+    fSizelength(0), fStreamstateindication(0), fStreamtype(0), fSpropMaxDonDiff(0),
     fCpresent(False), fRandomaccessindication(False),
-    fConfig(NULL), fMode(NULL), fSpropParameterSets(NULL), fEmphasis(NULL), fChannelOrder(NULL),
+    fConfig(NULL), fMode(NULL), fSpropParameterSets(NULL), fSpropVPS(NULL), fSpropSPS(NULL), fSpropPPS(NULL),
+    fEmphasis(NULL), fChannelOrder(NULL),
     fPlayStartTime(0.0), fPlayEndTime(0.0), fAbsStartTime(NULL), fAbsEndTime(NULL),
-    fVideoWidth(0), fVideoHeight(0), fVideoFPS(0), fNumChannels(1), fScale(1.0f), fNPT_PTS_Offset(0.0f),
+    fVideoWidth(0), fVideoHeight(0), fVideoFPS(0), fNumChannels(1), fScale(1.0f), fMultiplexRTCPWithRTP(False),
+    fUseNACKs(False), fRTXPayloadFormat(0), fNPT_PTS_Offset(0.0f),
     fRTPSocket(NULL), fRTCPSocket(NULL),
     fRTPSource(NULL), fRTCPInstance(NULL), fReadSource(NULL),
     fReceiveRawMP3ADUs(False), fReceiveRawJPEGFrames(False),
@@ -602,6 +606,7 @@ MediaSubsession::~MediaSubsession() {
   delete[] fMediumName; delete[] fCodecName; delete[] fProtocolName;
   delete[] fControlPath;
   delete[] fConfig; delete[] fMode; delete[] fSpropParameterSets; delete[] fEmphasis; delete[] fChannelOrder;
+  delete[] fSpropVPS; delete[] fSpropSPS; delete[] fSpropPPS;
   delete[] fAbsStartTime; delete[] fAbsEndTime;
   delete[] fSessionId;
 
@@ -662,7 +667,7 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
     if (fClientPortNum != 0  && (honorSDPPortChoice || IsMulticastAddress(tempAddr.s_addr))) {
       // This is a multicast stream, and the sockets' port numbers were specified for us.  Use these:
       Boolean const protocolIsRTP = strcmp(fProtocolName, "RTP") == 0;
-      if (protocolIsRTP) {
+      if (protocolIsRTP && !fMultiplexRTCPWithRTP) {
 	fClientPortNum = fClientPortNum&~1; // use an even-numbered port for RTP, and the next (odd-numbered) port for RTCP
       }
       if (isSSM()) {
@@ -676,12 +681,17 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
       }
       
       if (protocolIsRTP) {
-	// Set our RTCP port to be the RTP port +1
-	portNumBits const rtcpPortNum = fClientPortNum|1;
-	if (isSSM()) {
-	  fRTCPSocket = new Groupsock(env(), tempAddr, fSourceFilterAddr, rtcpPortNum);
+	if (fMultiplexRTCPWithRTP) {
+	  // Use the same socket for RTCP as for RTP:
+	  fRTCPSocket = fRTPSocket;
 	} else {
-	  fRTCPSocket = new Groupsock(env(), tempAddr, rtcpPortNum, 255);
+	  // Set our RTCP port to be the RTP port +1
+	  portNumBits const rtcpPortNum = fClientPortNum|1;
+	  if (isSSM()) {
+	    fRTCPSocket = new Groupsock(env(), tempAddr, fSourceFilterAddr, rtcpPortNum);
+	  } else {
+	    fRTCPSocket = new Groupsock(env(), tempAddr, rtcpPortNum, 255);
+	  }
 	}
       }
     } else {
@@ -712,6 +722,12 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
 	  break;
 	}
 	fClientPortNum = ntohs(clientPort.num()); 
+	if (fMultiplexRTCPWithRTP) {
+	  // RTCP will use the same socket as RTP, so any port number will do:
+	  fRTCPSocket = fRTPSocket;
+	  success = True;
+	  break;
+	}
 	if ((fClientPortNum&1) != 0) { // it's odd
 	  // Record this socket in our table, and keep trying:
 	  unsigned key = (unsigned)fClientPortNum;
@@ -789,13 +805,19 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
 	env().setResultMsg("Failed to create RTCP instance");
 	break;
       }
+
+      if (fUseNACKs) {
+	// (Each "RTPSource" that we create is a "MultiFramedRTPSource".)
+	((MultiFramedRTPSource*)fRTPSource)->enableNACKs(fRTCPInstance, fRTXPayloadFormat);
+      }
     }
 
     return True;
   } while (0);
 
+  if (fRTCPSocket != fRTPSocket) delete fRTCPSocket;
+  fRTCPSocket = NULL;
   delete fRTPSocket; fRTPSocket = NULL;
-  delete fRTCPSocket; fRTCPSocket = NULL;
   Medium::close(fRTCPInstance); fRTCPInstance = NULL;
   Medium::close(fReadSource); fReadSource = fRTPSource = NULL;
   fClientPortNum = 0;
@@ -809,7 +831,8 @@ void MediaSubsession::deInitiate() {
   Medium::close(fReadSource); // this is assumed to also close fRTPSource
   fReadSource = NULL; fRTPSource = NULL;
 
-  delete fRTCPSocket; delete fRTPSocket;
+  if (fRTCPSocket != fRTPSocket) delete fRTCPSocket;
+  delete fRTPSocket;
   fRTCPSocket = fRTPSocket = NULL;
 }
 
@@ -857,8 +880,9 @@ void MediaSubsession::setDestinations(netAddressBits defaultDestAddress) {
     Port destPort(serverPortNum);
     fRTPSocket->changeDestinationParameters(destAddr, destPort, destTTL);
   }
-  if (fRTCPSocket != NULL && !isSSM()) {
+  if (fRTCPSocket != NULL && fRTCPSocket != fRTPSocket && !isSSM()) {
     // Note: For SSM sessions, the dest address for RTCP was already set.
+    // (If RTCP is multiplexed with RTP, its destination is the one that we just set for RTP.)
     Port destPort(serverPortNum+1);
     fRTCPSocket->changeDestinationParameters(destAddr, destPort, destTTL);
   }
@@ -954,6 +978,10 @@ Boolean MediaSubsession::parseSDPAttribute_rtpmap(char const* sdpLine) {
       delete[] fCodecName; fCodecName = strDup(codecName);
       fRTPTimestampFrequency = rtpTimestampFrequency;
       fNumChannels = numChannels;
+    } else if (strcmp(codecName, "rtx") == 0 || strcmp(codecName, "RTX") == 0) {
+      // This describes a 'RTX' retransmission stream (RFC 4588) for our payload format.
+      // (We assume that it's for our payload format - the one that we use - without checking its "apt" parameter.)
+      fRTXPayloadFormat = (unsigned char)rtpmapPayloadFormat;
     }
   }
   delete[] codecName;
@@ -1061,6 +1089,8 @@ Boolean MediaSubsession::parseSDPAttribute_fmtp(char const* sdpLine) {
 	fStreamstateindication = u;
       } else if (sscanf(line, " streamtype = %u", &u) == 1) {
 	fStreamtype = u;
+      } else if (sscanf(line, " sprop-max-don-diff = %u", &u) == 1) {
+	fSpropMaxDonDiff = u;
       } else if (sscanf(line, " cpresent = %u", &u) == 1) {
 	fCpresent = u != 0;
       } else if (sscanf(line, " randomaccessindication = %u", &u) == 1) {
@@ -1074,6 +1104,15 @@ Boolean MediaSubsession::parseSDPAttribute_fmtp(char const* sdpLine) {
       } else if (sscanf(sdpLine, " sprop-parameter-sets = %[^; \t\r\n]", valueStr) == 1) {
 	// Note: We used "sdpLine" here, because the value is case-sensitive.
 	delete[] fSpropParameterSets; fSpropParameterSets = strDup(valueStr);
+      } else if (sscanf(sdpLine, " sprop-vps = %[^; \t\r\n]", valueStr) == 1) {
+	// Note: We used "sdpLine" here, because the value is case-sensitive.
+	delete[] fSpropVPS; fSpropVPS = strDup(valueStr);
+      } else if (sscanf(sdpLine, " sprop-sps = %[^; \t\r\n]", valueStr) == 1) {
+	// Note: We used "sdpLine" here, because the value is case-sensitive.
+	delete[] fSpropSPS; fSpropSPS = strDup(valueStr);
+      } else if (sscanf(sdpLine, " sprop-pps = %[^; \t\r\n]", valueStr) == 1) {
+	// Note: We used "sdpLine" here, because the value is case-sensitive.
+	delete[] fSpropPPS; fSpropPPS = strDup(valueStr);
       } else if (sscanf(line, " emphasis = %[^; \t\r\n]", valueStr) == 1) {
 	delete[] fEmphasis; fEmphasis = strDup(valueStr);
       } else if (sscanf(sdpLine, " channel-order = %[^; \t\r\n]", valueStr) == 1) {
@@ -1157,6 +1196,34 @@ Boolean MediaSubsession::parseSDPAttribute_framerate(char const* sdpLine) {
   return parseSuccess;
 }
 
+Boolean MediaSubsession::parseSDPAttribute_rtcpmux(char const* sdpLine) {
+  // Check for a "a=rtcp-mux" line (RFC 5761):
+  if (strncmp(sdpLine, "a=rtcp-mux", 10) == 0) {
+    fMultiplexRTCPWithRTP = True;
+    return True;
+  }
+
+  return False;
+}
+
+Boolean MediaSubsession::parseSDPAttribute_rtcpfb(char const* sdpLine) {
+  // Check for a "a=rtcp-fb:<fmt> nack" line (RFC 4585), where <fmt> is our payload format, or "*".
+  // (Note that "nack" must not be followed by a parameter; e.g., "nack pli" is something else.)
+  char* fmt = strDupSize(sdpLine); // ensures we have enough space
+  char* feedbackType = strDupSize(sdpLine);
+  Boolean parseSuccess = False;
+  if (sscanf(sdpLine, "a=rtcp-fb: %s %[^\r\n]", fmt, feedbackType) == 2) {
+    parseSuccess = True;
+    if (strcmp(feedbackType, "nack") == 0
+	&& (strcmp(fmt, "*") == 0 || (unsigned)atoi(fmt) == fRTPPayloadFormat)) {
+      fUseNACKs = True;
+    }
+  }
+  delete[] feedbackType; delete[] fmt;
+
+  return parseSuccess;
+}
+
 Boolean MediaSubsession::createSourceObjects(int useSpecialRTPoffset) {
   do {
     // First, check "fProtocolName"
@@ -1288,6 +1355,13 @@ Boolean MediaSubsession::createSourceObjects(int useSpecialRTPoffset) {
 	  = H264VideoRTPSource::createNew(env(), fRTPSocket,
 					  fRTPPayloadFormat,
 					  fRTPTimestampFrequency);
+      } else if (strcmp(fCodecName, "H265") == 0) {
+	Boolean expectDONFields = fSpropMaxDonDiff > 0;
+	fReadSource = fRTPSource
+	  = H265VideoRTPSource::createNew(env(), fRTPSocket,
+					  fRTPPayloadFormat,
+					  expectDONFields,
+					  fRTPTimestampFrequency);
       } else if (strcmp(fCodecName, "DV") == 0) {
 	fReadSource = fRTPSource
 	  = DVVideoRTPSource::createNew(env(), fRTPSocket,
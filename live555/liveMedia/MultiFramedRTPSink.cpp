@@ -44,7 +44,7 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
     : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
               rtpPayloadFormatName, numChannels),
     fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
-    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL)
+    fPaceOutgoingPackets(True), fOnSendErrorFunc(NULL), fOnSendErrorData(NULL)
 {
     setPacketSizes(1000, 1448);
     // Default max packet size (1500, minus allowance for IP, UDP, UMTP headers)
@@ -304,7 +304,15 @@ void MultiFramedRTPSink
     {
         //һpacket¼µǰʱ
         // Record the fact that we're starting to play now:
-        gettimeofday(&fNextSendTime, NULL);
+        if (fPaceOutgoingPackets)
+        {
+            fNextSendTime = envir().taskScheduler().refreshTimeNow();
+        }
+        else
+        {
+            // We're not pacing our packets, so measure our 'send times' from the start of the stream instead:
+            fNextSendTime.tv_sec = fNextSendTime.tv_usec = 0;
+        }
     }
 
     fMostRecentPresentationTime = presentationTime;
@@ -473,6 +481,8 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
                 // if failure handler has been specified, call it
                 if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);//
             }
+        // Remember the packet, in case we're asked to retransmit it:
+        noteSentPacket(fOutBuf->packet(), fOutBuf->curPacketSize());
         ++fPacketCount;
         fTotalOctetCount += fOutBuf->curPacketSize();
         fOctetCount += fOutBuf->curPacketSize()
@@ -482,7 +492,8 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
     }
 
     if (fOutBuf->haveOverflowData()
-            && fOutBuf->totalBytesAvailable() > fOutBuf->totalBufferSize()/2)
+            && (fOutBuf->totalBytesAvailable() > fOutBuf->totalBufferSize()/2
+                || isTooBigForAPacket(fOutBuf->overflowDataSize())))
     {
         /*
          * ΪЧʣֱbufferеsocketʼλãͲҪһoverflowˡ
@@ -492,8 +503,11 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
         // the overflow data (allowing for the RTP header and special headers),
         // so that we probably don't have to "memmove()" the overflow data
         // into place when building the next packet:
+        // (We do this whenever the overflow data will fill the next packet by itself - e.g., when fragmenting a large
+        // frame - because then no new frame will get read into the rest of the buffer.  Note that we use the special
+        // header size for the *next* packet, because this can differ for the first fragment of a frame.)
         unsigned newPacketStart = fOutBuf->curPacketSize()
-                                  - (rtpHeaderSize + fSpecialHeaderSize + frameSpecificHeaderSize());
+                                  - (rtpHeaderSize + specialHeaderSize() + frameSpecificHeaderSize());
         fOutBuf->adjustPacketStart(newPacketStart);
     }
     else
@@ -520,11 +534,11 @@ void MultiFramedRTPSink::sendPacketIfNecessary()
         // We have more frames left to send.  Figure out when the next frame
         // is due to start playing, then make sure that we wait this long before
         // sending the next packet.
-        struct timeval timeNow;
-        gettimeofday(&timeNow, NULL);
+        struct timeval const& timeNow = envir().taskScheduler().timeNow();
         int secsDiff = fNextSendTime.tv_sec - timeNow.tv_sec;
         int64_t uSecondsToGo = secsDiff*1000000 + (fNextSendTime.tv_usec - timeNow.tv_usec);
-        if (uSecondsToGo < 0 || secsDiff < 0)   // sanity check: Make sure that the time-to-delay is non-negative:
+        if (uSecondsToGo < 0 || secsDiff < 0   // sanity check: Make sure that the time-to-delay is non-negative:
+                || !fPaceOutgoingPackets)
         {
             uSecondsToGo = 0;
         }
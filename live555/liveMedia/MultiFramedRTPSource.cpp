@@ -21,10 +21,39 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MultiFramedRTPSource.hh"
 #include "GroupsockHelper.hh"
+#include "RTCP.hh"
 #include <string.h>
 
 ////////// ReorderingPacketBuffer definition //////////
 
+// The maximum number of sequence numbers - beyond the one that we're waiting for - that we can hold packets for.
+// (This must be a power of 2.)
+#define REORDERING_WINDOW_SIZE 1024
+
+// The maximum number of missing packets that we keep asking to be retransmitted (see "enableNACKs()").
+// Gaps larger than this are treated as ordinary packet loss:
+#define MAX_PENDING_NACKS 256
+
+// A pool of packet data buffers, in sizes that are multiples of PACKET_BUFFER_SIZE_UNIT bytes.  Buffers are carved
+// from larger 'slabs', and are recycled (rather than being freed) when they're no longer needed.
+#define PACKET_BUFFER_SIZE_UNIT 512
+#define PACKET_BUFFER_SLAB_SIZE 32768
+
+class PacketBufferSlabs {
+public:
+  PacketBufferSlabs();
+  virtual ~PacketBufferSlabs();
+
+  unsigned char* allocate(unsigned& bufferSize);
+      // "bufferSize" is rounded up to the actual size of the returned buffer
+  void release(unsigned char* buffer, unsigned bufferSize);
+
+private:
+  unsigned char** fFreeBuffers; // one list (linked through the buffers themselves) for each buffer size
+  unsigned fNumBufferSizes;
+  unsigned char* fSlabs; // linked through the first bytes of each slab
+};
+
 class ReorderingPacketBuffer {
 public:
   ReorderingPacketBuffer(BufferedPacketFactory* packetFactory);
@@ -33,30 +62,52 @@ public:
 
   BufferedPacket* getFreePacket(MultiFramedRTPSource* ourSource);
   Boolean storePacket(BufferedPacket* bPacket);
-  BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
+  BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded, struct timeval const& timeNow);
+      // "timeNow" is used (only) to check whether we've waited too long for a missing packet
   void releaseUsedPacket(BufferedPacket* packet);
-  void freePacket(BufferedPacket* packet) {
-    if (packet != fSavedPacket) {
-      delete packet;
-    } else {
-      fSavedPacketFree = True;
-    }
-  }
-  Boolean isEmpty() const { return fHeadPacket == NULL; }
+  void freePacket(BufferedPacket* packet);
+  Boolean isEmpty() const { return fNumStoredPackets == 0; }
 
   void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
   void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
+  Boolean haveSeenFirstPacket() const { return fHaveSeenFirstPacket; }
+  unsigned short highestSeqNoReceived() const { return fHighestSeqNoReceived; }
+  Boolean isAwaiting(unsigned short rtpSeqNo);
+      // whether we're still waiting for the packet with this sequence number (i.e., we'd be able to use it)
+
+  unsigned numReorderedPackets() const { return fNumReorderedPackets; }
+  unsigned maxReorderingDepth() const { return fMaxReorderingDepth; }
+  double aveReorderingDepth() const {
+    return fNumReorderedPackets == 0 ? 0.0 : fTotReorderingDepth/(double)fNumReorderedPackets;
+  }
+  unsigned numDuplicatePackets() const { return fNumDuplicatePackets; }
+  unsigned numLatePackets() const { return fNumLatePackets; }
+
+private:
+  BufferedPacket*& slotFor(unsigned short rtpSeqNo) { return fSlots[rtpSeqNo&(REORDERING_WINDOW_SIZE-1)]; }
+  void discardStoredPackets();
+  void moveToSlabBuffer(BufferedPacket* packet, MultiFramedRTPSource* ourSource);
 
 private:
   BufferedPacketFactory* fPacketFactory;
   unsigned fThresholdTime; // uSeconds
   Boolean fHaveSeenFirstPacket; // used to set initial "fNextExpectedSeqNo"
   unsigned short fNextExpectedSeqNo;
-  BufferedPacket* fHeadPacket;
-  BufferedPacket* fTailPacket;
-  BufferedPacket* fSavedPacket;
-      // to avoid calling new/free in the common case
-  Boolean fSavedPacketFree;
+  unsigned short fHighestSeqNoReceived; // used to measure reordering
+  BufferedPacket* fSlots[REORDERING_WINDOW_SIZE];
+      // indexed by RTP sequence number (modulo the window size); all stored packets
+      // have sequence numbers in [fNextExpectedSeqNo, fNextExpectedSeqNo+REORDERING_WINDOW_SIZE)
+  unsigned fNumStoredPackets;
+  BufferedPacket* fHeadPacket; // the stored packet with the lowest sequence number
+  BufferedPacket* fReceptionPacket;
+      // a packet with a full-size buffer, which we read into (to avoid calling new/free in the common case)
+  Boolean fReceptionPacketFree;
+  BufferedPacket* fFreeSlabPackets; // packets (without buffers) that we can reuse in "moveToSlabBuffer()"
+  PacketBufferSlabs fSlabs;
+
+  // Statistics:
+  unsigned fNumReorderedPackets, fMaxReorderingDepth, fNumDuplicatePackets, fNumLatePackets;
+  u_int64_t fTotReorderingDepth;
 };
 
 
@@ -67,7 +118,13 @@ MultiFramedRTPSource
 		       unsigned char rtpPayloadFormat,
 		       unsigned rtpTimestampFrequency,
 		       BufferedPacketFactory* packetFactory)
-  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
+  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency),
+    fUseJitterBuffer(False), fMinPlayoutDelay(0.0), fMaxPlayoutDelay(0.0), fPlayoutDelay(0.0),
+    fPlayoutTask(NULL), fNumPacketsPlayedOut(0), fNumPacketsPastPlayoutTime(0), fTotBufferingTime(0.0),
+    fNACKRTCPInstance(NULL), fRTXPayloadFormat(0), fMaxNumNACKsPerPacket(0), fNACKIntervalUS(0),
+    fPendingNACKs(NULL), fNumPendingNACKs(0), fNACKTask(NULL),
+    fNumPacketsNACKed(0), fNumRetransmittedPacketsReceived(0),
+    fIncomingPacketHandler(NULL), fIncomingPacketHandlerClientData(NULL) {
   reset();
   fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
 
@@ -82,11 +139,16 @@ void MultiFramedRTPSource::reset() {
   fPacketReadInProgress = NULL;
   fNeedDelivery = False;
   fPacketLossInFragmentedFrame = False;
+  fHaveTransitTime = False;
+  fNumPendingNACKs = 0;
 }
 
 MultiFramedRTPSource::~MultiFramedRTPSource() {
+  envir().taskScheduler().unscheduleDelayedTask(fPlayoutTask);
+  envir().taskScheduler().unscheduleDelayedTask(fNACKTask);
   fRTPInterface.stopNetworkReading();
   delete fReorderingBuffer;
+  delete[] fPendingNACKs;
 }
 
 Boolean MultiFramedRTPSource
@@ -97,6 +159,26 @@ Boolean MultiFramedRTPSource
   return True;
 }
 
+unsigned MultiFramedRTPSource::numReorderedPackets() const {
+  return fReorderingBuffer->numReorderedPackets();
+}
+
+unsigned MultiFramedRTPSource::maxReorderingDepth() const {
+  return fReorderingBuffer->maxReorderingDepth();
+}
+
+double MultiFramedRTPSource::aveReorderingDepth() const {
+  return fReorderingBuffer->aveReorderingDepth();
+}
+
+unsigned MultiFramedRTPSource::numDuplicatePackets() const {
+  return fReorderingBuffer->numDuplicatePackets();
+}
+
+unsigned MultiFramedRTPSource::numLatePackets() const {
+  return fReorderingBuffer->numLatePackets();
+}
+
 Boolean MultiFramedRTPSource
 ::packetIsUsableInJitterCalculation(unsigned char* /*packet*/,
 				    unsigned /*packetSize*/) {
@@ -104,7 +186,20 @@ Boolean MultiFramedRTPSource
   return True;
 }
 
+void MultiFramedRTPSource
+::enableAdaptiveJitterBuffer(unsigned minPlayoutDelayUS, unsigned maxPlayoutDelayUS) {
+  if (maxPlayoutDelayUS < minPlayoutDelayUS) maxPlayoutDelayUS = minPlayoutDelayUS;
+
+  fUseJitterBuffer = True;
+  fMinPlayoutDelay = minPlayoutDelayUS;
+  fMaxPlayoutDelay = maxPlayoutDelayUS;
+  fPlayoutDelay = fMinPlayoutDelay; // initially
+  fReorderingBuffer->setThresholdTime((unsigned)fPlayoutDelay);
+}
+
 void MultiFramedRTPSource::doStopGettingFrames() {
+  envir().taskScheduler().unscheduleDelayedTask(fPlayoutTask);
+  envir().taskScheduler().unscheduleDelayedTask(fNACKTask);
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
   fRTPInterface.stopNetworkReading();
   fReorderingBuffer->reset();
@@ -132,8 +227,13 @@ void MultiFramedRTPSource::doGetNextFrame1() {
     // If we already have packet data available, then deliver it now.
     Boolean packetLossPrecededThis;
     BufferedPacket* nextPacket
-      = fReorderingBuffer->getNextCompletedPacket(packetLossPrecededThis);
+      = fReorderingBuffer->getNextCompletedPacket(packetLossPrecededThis, envir().taskScheduler().timeNow());
     if (nextPacket == NULL) break;
+    if (nextPacket->useCount() > 0) packetLossPrecededThis = False; // we've already taken account of any loss
+
+    if (fUseJitterBuffer && nextPacket->useCount() == 0 && !packetIsDueForPlayout(nextPacket)) {
+      break; // we'll try again (from "playoutTimerHandler()") when it's due
+    }
 
     fNeedDelivery = False;
 
@@ -232,8 +332,9 @@ void MultiFramedRTPSource::networkReadHandler1() {
   // Read the network packet, and perform sanity checks on the RTP header:
   Boolean readSuccess = False;
   do {
+    struct sockaddr_in fromAddress;
     Boolean packetReadWasIncomplete = fPacketReadInProgress != NULL;
-    if (!bPacket->fillInData(fRTPInterface, packetReadWasIncomplete)) {
+    if (!bPacket->fillInData(fRTPInterface, fromAddress, packetReadWasIncomplete)) {
       if (bPacket->bytesAvailable() == 0) {
 	envir() << "MultiFramedRTPSource error: Hit limit when reading incoming packet over TCP. Increase \"MAX_PACKET_SIZE\"\n";
       }
@@ -253,6 +354,29 @@ void MultiFramedRTPSource::networkReadHandler1() {
     if ((our_random()%10) == 0) break; // simulate 10% packet loss
 #endif
 
+    if (fRTCPInstanceForMultiplexedRTCPPackets != NULL && bPacket->dataSize() >= 4) {
+      // RTCP is multiplexed with RTP on our socket (RFC 5761).  Check the second byte of the packet;
+      // values 192 through 223 denote a RTCP packet type (and are never used as RTP payload types, with the marker bit):
+      u_int8_t const secondByte = bPacket->data()[1];
+      if (secondByte >= 192 && secondByte <= 223) {
+	fRTCPInstanceForMultiplexedRTCPPackets->injectReport(bPacket->data(), bPacket->dataSize(), fromAddress);
+	break; // we're done with this packet
+      }
+    }
+
+    readSuccess = processIncomingPacket(bPacket, False);
+  } while (0);
+  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+
+  doGetNextFrame1();
+  // If we didn't get proper data this time, we'll get another chance
+}
+
+Boolean MultiFramedRTPSource::processIncomingPacket(BufferedPacket* bPacket, Boolean wasInjected) {
+  unsigned char const* packetStart = bPacket->data();
+  unsigned const packetSize = bPacket->dataSize();
+
+  do {
     // Check for the 12-byte RTP header:
     if (bPacket->dataSize() < 12) break;
     unsigned rtpHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
@@ -286,9 +410,22 @@ void MultiFramedRTPSource::networkReadHandler1() {
       bPacket->removePadding(numPaddingBytes);
     }
     // Check the Payload Type.
-    if ((unsigned char)((rtpHdr&0x007F0000)>>16)
-	!= rtpPayloadFormat()) {
-      break;
+    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
+    Boolean isRetransmission = False;
+    unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
+    if (rtpPayloadType != rtpPayloadFormat()) {
+      if (fRTXPayloadFormat == 0 || rtpPayloadType != fRTXPayloadFormat) break;
+
+      // This is a retransmitted packet, from a 'RTX' stream (RFC 4588).  Its payload begins with the original packet's
+      // sequence number; the rest is the original packet's payload.  (Its SSRC and sequence number are the RTX stream's own.)
+      if (bPacket->dataSize() < 2) break;
+      rtpSeqNo = (bPacket->data()[0]<<8)|bPacket->data()[1]; ADVANCE(2);
+      if (!fReorderingBuffer->isAwaiting(rtpSeqNo)) break; // we didn't need it (or we've since stopped waiting for it)
+      rtpSSRC = fLastReceivedSSRC; // treat it as being part of our original stream (but see below)
+      isRetransmission = True;
+    } else if (fIncomingPacketHandler != NULL && !wasInjected) {
+      // Let our handler see (a copy of) this packet:
+      (*fIncomingPacketHandler)(fIncomingPacketHandlerClientData, packetStart, packetSize);
     }
 
     // The rest of the packet is the usable data.  Record and save it:
@@ -298,32 +435,235 @@ void MultiFramedRTPSource::networkReadHandler1() {
       fLastReceivedSSRC = rtpSSRC;
       fReorderingBuffer->resetHaveSeenFirstPacket();
     }
-    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
-    Boolean usableInJitterCalculation
-      = packetIsUsableInJitterCalculation((bPacket->data()),
-						  bPacket->dataSize());
     struct timeval presentationTime; // computed by:
     Boolean hasBeenSyncedUsingRTCP; // computed by:
-    receptionStatsDB()
-      .noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
-			  timestampFrequency(),
-			  usableInJitterCalculation, presentationTime,
-			  hasBeenSyncedUsingRTCP, bPacket->dataSize());
+    struct timeval const& timeNow = envir().taskScheduler().timeNow(); // (read when the event loop saw the packet arrive)
+    if (isRetransmission) {
+      // Don't count a retransmitted packet in the reception stats (which would otherwise understate packet loss, and
+      // skew the jitter), but get its presentation time from the original stream's timestamp mapping:
+      receptionStatsDB()
+	.computePresentationTime(rtpSSRC, rtpTimestamp, timestampFrequency(),
+				 presentationTime, hasBeenSyncedUsingRTCP, &timeNow);
+    } else {
+      Boolean usableInJitterCalculation
+	= !wasInjected && packetIsUsableInJitterCalculation((bPacket->data()),
+							    bPacket->dataSize());
+      receptionStatsDB()
+	.noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
+			    timestampFrequency(),
+			    usableInJitterCalculation, presentationTime,
+			    hasBeenSyncedUsingRTCP, bPacket->dataSize(), &timeNow);
+    }
 
     // Fill in the rest of the packet descriptor, and store it:
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
     bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
 			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
 			      timeNow);
+    Boolean haveSeenFirstPacket = fReorderingBuffer->haveSeenFirstPacket();
+    unsigned short prevHighestSeqNoReceived = fReorderingBuffer->highestSeqNoReceived();
     if (!fReorderingBuffer->storePacket(bPacket)) break;
+    if (fUseJitterBuffer && !isRetransmission && !wasInjected) {
+      // (The arrival time of a retransmitted or recovered packet reflects how long it took us to notice the loss, and get
+      // the packet again - not the network's jitter - so we don't let these packets change our playout delay.)
+      updatePlayoutDelay(bPacket);
+    }
+
+    if (fNACKRTCPInstance != NULL && haveSeenFirstPacket) {
+      if (seqNumLT(prevHighestSeqNoReceived, rtpSeqNo)) {
+	// Ask for any packets that we skipped over to be retransmitted:
+	unsigned short numMissingPackets = rtpSeqNo - prevHighestSeqNoReceived - 1;
+	if (numMissingPackets > 0) requestRetransmissions(prevHighestSeqNoReceived + 1, numMissingPackets);
+      } else if (fNumPendingNACKs > 0) {
+	noteReceivedPendingNACK(rtpSeqNo);
+      }
+    }
+    if (isRetransmission) ++fNumRetransmittedPacketsReceived;
 
-    readSuccess = True;
+    return True;
   } while (0);
-  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+
+  return False; // the packet was bad, or unusable
+}
+
+Boolean MultiFramedRTPSource::injectPacket(unsigned char const* packet, unsigned packetSize) {
+  if (packetSize < 12 || fPacketReadInProgress != NULL) return False;
+
+  // Check whether we're still waiting for this packet:
+  unsigned short rtpSeqNo = (packet[2]<<8)|packet[3];
+  if (!fReorderingBuffer->isAwaiting(rtpSeqNo)) return False;
+
+  BufferedPacket* bPacket = fReorderingBuffer->getFreePacket(this);
+  if (!bPacket->fillInData(packet, packetSize) || !processIncomingPacket(bPacket, True)) {
+    fReorderingBuffer->freePacket(bPacket);
+    return False;
+  }
 
   doGetNextFrame1();
-  // If we didn't get proper data this time, we'll get another chance
+  return True;
+}
+
+
+void MultiFramedRTPSource::updatePlayoutDelay(BufferedPacket* packet) {
+  // Compute this packet's 'transit time' (its arrival time, minus its presentation time).  Apart from a constant offset
+  // (between the sender's and our clocks), this is the packet's network delay:
+  struct timeval const& timeReceived = packet->timeReceived();
+  struct timeval const& presentationTime = packet->presentationTime();
+  double transitTime = (timeReceived.tv_sec - presentationTime.tv_sec)*1000000.0
+    + (timeReceived.tv_usec - presentationTime.tv_usec);
+
+  if (!fHaveTransitTime || packet->hasBeenSyncedUsingRTCP() != fTransitTimeIsSyncedUsingRTCP) {
+    // This is the first packet (or the presentation times have just been synchronized using RTCP, which changes the offset):
+    fMinTransitTime = transitTime;
+    fHaveTransitTime = True;
+    fTransitTimeIsSyncedUsingRTCP = packet->hasBeenSyncedUsingRTCP();
+  } else if (transitTime < fMinTransitTime) {
+    fMinTransitTime = transitTime;
+  } else {
+    // Let the minimum creep up slowly, to allow for drift between the sender's clock and ours:
+    fMinTransitTime += (transitTime - fMinTransitTime)/1024;
+  }
+
+  // This packet was delayed (beyond the fastest packets) by:
+  double excessDelay = transitTime - fMinTransitTime;
+  if (excessDelay > fPlayoutDelay) ++fNumPacketsPastPlayoutTime;
+
+  // Our target playout delay covers (a multiple of) the estimated network jitter, and also this packet's delay:
+  double targetDelay = fMinPlayoutDelay;
+  RTPReceptionStats* stats = receptionStatsDB().lookup(fLastReceivedSSRC);
+  if (stats != NULL && timestampFrequency() > 0) {
+    double jitter = stats->jitter()*1000000.0/timestampFrequency(); // uSeconds
+    if (4*jitter > targetDelay) targetDelay = 4*jitter;
+  }
+  if (excessDelay > targetDelay) targetDelay = excessDelay;
+  if (targetDelay > fMaxPlayoutDelay) targetDelay = fMaxPlayoutDelay;
+
+  // Grow the playout delay immediately, but shrink it only very slowly (over many seconds), because each change
+  // in the delay is itself seen - by our reader - as jitter:
+  if (targetDelay > fPlayoutDelay) {
+    fPlayoutDelay = targetDelay;
+  } else {
+    fPlayoutDelay -= (fPlayoutDelay - targetDelay)/1024;
+  }
+
+  // Wait (up to) the same time for any missing packets to arrive:
+  fReorderingBuffer->setThresholdTime((unsigned)fPlayoutDelay);
+}
+
+Boolean MultiFramedRTPSource::packetIsDueForPlayout(BufferedPacket* packet) {
+  if (!fHaveTransitTime) return True; // the packet arrived before the jitter buffer was enabled
+
+  struct timeval const& timeNow = envir().taskScheduler().timeNow();
+
+  struct timeval const& presentationTime = packet->presentationTime();
+  double uSecondsUntilPlayout
+    = (presentationTime.tv_sec - timeNow.tv_sec)*1000000.0 + (presentationTime.tv_usec - timeNow.tv_usec)
+    + fMinTransitTime + fPlayoutDelay;
+  if (uSecondsUntilPlayout > fMaxPlayoutDelay) {
+    // This shouldn't happen (perhaps the presentation times jumped); don't hold the packet any longer than this:
+    uSecondsUntilPlayout = fMaxPlayoutDelay;
+  }
+
+  if (uSecondsUntilPlayout > 0.0) {
+    // Try again when the packet is due:
+    envir().taskScheduler().unscheduleDelayedTask(fPlayoutTask);
+    fPlayoutTask = envir().taskScheduler().scheduleDelayedTask((int64_t)uSecondsUntilPlayout,
+							       (TaskFunc*)playoutTimerHandler, this);
+    return False;
+  }
+
+  // The packet is due.  Note how long we held it:
+  struct timeval const& timeReceived = packet->timeReceived();
+  fTotBufferingTime += (timeNow.tv_sec - timeReceived.tv_sec)*1000000.0 + (timeNow.tv_usec - timeReceived.tv_usec);
+  ++fNumPacketsPlayedOut;
+  return True;
+}
+
+void MultiFramedRTPSource::playoutTimerHandler(MultiFramedRTPSource* source) {
+  source->fPlayoutTask = NULL;
+  source->doGetNextFrame1();
+}
+
+void MultiFramedRTPSource
+::setIncomingPacketHandler(incomingPacketHandlerFunc* handler, void* clientData) {
+  fIncomingPacketHandler = handler;
+  fIncomingPacketHandlerClientData = clientData;
+}
+
+void MultiFramedRTPSource
+::enableNACKs(RTCPInstance* rtcpInstance, unsigned char rtxPayloadFormat,
+	      unsigned maxNumRequestsPerPacket, unsigned requestIntervalUS) {
+  envir().taskScheduler().unscheduleDelayedTask(fNACKTask);
+  fNumPendingNACKs = 0;
+
+  fNACKRTCPInstance = rtcpInstance;
+  fRTXPayloadFormat = rtcpInstance == NULL ? 0 : rtxPayloadFormat;
+  fMaxNumNACKsPerPacket = maxNumRequestsPerPacket;
+  fNACKIntervalUS = requestIntervalUS;
+  if (fPendingNACKs == NULL && rtcpInstance != NULL) fPendingNACKs = new PendingNACK[MAX_PENDING_NACKS];
+}
+
+void MultiFramedRTPSource::requestRetransmissions(unsigned short firstSeqNo, unsigned numPackets) {
+  if (numPackets > MAX_PENDING_NACKS) return; // too large a gap; this isn't the kind of loss that NACKs can repair
+  if (fMaxNumNACKsPerPacket == 0) return;
+
+  // Note the missing packets (as long as we have room for them):
+  unsigned short seqNos[MAX_PENDING_NACKS];
+  unsigned numToRequest = 0;
+  for (unsigned i = 0; i < numPackets && fNumPendingNACKs < MAX_PENDING_NACKS; ++i) {
+    unsigned short seqNo = firstSeqNo + i;
+    fPendingNACKs[fNumPendingNACKs].seqNo = seqNo;
+    fPendingNACKs[fNumPendingNACKs].numRequests = 1;
+    ++fNumPendingNACKs;
+    seqNos[numToRequest++] = seqNo;
+  }
+  if (numToRequest == 0) return;
+
+  // Ask for these packets now:
+  fNACKRTCPInstance->sendNACK(fLastReceivedSSRC, seqNos, numToRequest);
+  fNumPacketsNACKed += numToRequest;
+
+  // Then, ask again later, if they haven't arrived by then:
+  if (fNACKTask == NULL) {
+    fNACKTask = envir().taskScheduler().scheduleDelayedTask(fNACKIntervalUS, (TaskFunc*)nackTimerHandler, this);
+  }
+}
+
+void MultiFramedRTPSource::noteReceivedPendingNACK(unsigned short rtpSeqNo) {
+  for (unsigned i = 0; i < fNumPendingNACKs; ++i) {
+    if (fPendingNACKs[i].seqNo == rtpSeqNo) {
+      // Remove this entry (keeping the remaining entries in order):
+      memmove(&fPendingNACKs[i], &fPendingNACKs[i+1], (fNumPendingNACKs-i-1)*sizeof(PendingNACK));
+      --fNumPendingNACKs;
+      break;
+    }
+  }
+}
+
+void MultiFramedRTPSource::resendNACKs() {
+  // Forget the packets that we've stopped waiting for (or have asked for too many times already),
+  // and ask (again) for the rest:
+  unsigned short seqNos[MAX_PENDING_NACKS];
+  unsigned numToRequest = 0;
+  unsigned numRemaining = 0;
+  for (unsigned i = 0; i < fNumPendingNACKs; ++i) {
+    PendingNACK& nack = fPendingNACKs[i];
+    if (nack.numRequests >= fMaxNumNACKsPerPacket || !fReorderingBuffer->isAwaiting(nack.seqNo)) continue;
+
+    ++nack.numRequests;
+    seqNos[numToRequest++] = nack.seqNo;
+    fPendingNACKs[numRemaining++] = nack;
+  }
+  fNumPendingNACKs = numRemaining;
+
+  if (numToRequest > 0) fNACKRTCPInstance->sendNACK(fLastReceivedSSRC, seqNos, numToRequest);
+  if (fNumPendingNACKs > 0) {
+    fNACKTask = envir().taskScheduler().scheduleDelayedTask(fNACKIntervalUS, (TaskFunc*)nackTimerHandler, this);
+  }
+}
+
+void MultiFramedRTPSource::nackTimerHandler(MultiFramedRTPSource* source) {
+  source->fNACKTask = NULL;
+  source->resendNACKs();
 }
 
 
@@ -332,14 +672,13 @@ void MultiFramedRTPSource::networkReadHandler1() {
 #define MAX_PACKET_SIZE 20000
 
 BufferedPacket::BufferedPacket()
-  : fPacketSize(MAX_PACKET_SIZE),
-    fBuf(new unsigned char[MAX_PACKET_SIZE]),
-    fNextPacket(NULL) {
+  : fPacketSize(0), fBuf(NULL), // our buffer gets allocated later
+    fNextPacket(NULL), fBufIsFromSlab(False) {
 }
 
 BufferedPacket::~BufferedPacket() {
   delete fNextPacket;
-  delete[] fBuf;
+  if (!fBufIsFromSlab) delete[] fBuf;
 }
 
 void BufferedPacket::reset() {
@@ -372,11 +711,15 @@ void BufferedPacket
   frameDurationInMicroseconds = 0; // by default.  Subclasses should correct this.
 }
 
-Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, Boolean& packetReadWasIncomplete) {
+Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress,
+				   Boolean& packetReadWasIncomplete) {
+  if (fBuf == NULL) {
+    fBuf = new unsigned char[MAX_PACKET_SIZE];
+    fPacketSize = MAX_PACKET_SIZE;
+  }
   if (!packetReadWasIncomplete) reset();
 
   unsigned numBytesRead;
-  struct sockaddr_in fromAddress;
   unsigned const maxBytesToRead = bytesAvailable();
   if (maxBytesToRead == 0) return False; // exceeded buffer size when reading over TCP
   if (!rtpInterface.handleRead(&fBuf[fTail], maxBytesToRead, numBytesRead, fromAddress, packetReadWasIncomplete)) {
@@ -386,6 +729,19 @@ Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, Boolean& packetRe
   return True;
 }
 
+Boolean BufferedPacket::fillInData(unsigned char const* data, unsigned dataSize) {
+  if (fBuf == NULL) {
+    fBuf = new unsigned char[MAX_PACKET_SIZE];
+    fPacketSize = MAX_PACKET_SIZE;
+  }
+  reset();
+
+  if (dataSize > bytesAvailable()) return False;
+  memmove(&fBuf[fTail], data, dataSize);
+  fTail += dataSize;
+  return True;
+}
+
 void BufferedPacket
 ::assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 		   struct timeval presentationTime,
@@ -464,117 +820,248 @@ BufferedPacket* BufferedPacketFactory
 }
 
 
+////////// PacketBufferSlabs implementation //////////
+
+#define PACKET_BUFFER_SLAB_HEADER_SIZE 16 // room for the slab link pointer, keeping the buffers aligned
+
+PacketBufferSlabs::PacketBufferSlabs()
+  : fNumBufferSizes((MAX_PACKET_SIZE + PACKET_BUFFER_SIZE_UNIT - 1)/PACKET_BUFFER_SIZE_UNIT), fSlabs(NULL) {
+  fFreeBuffers = new unsigned char*[fNumBufferSizes];
+  for (unsigned i = 0; i < fNumBufferSizes; ++i) fFreeBuffers[i] = NULL;
+}
+
+PacketBufferSlabs::~PacketBufferSlabs() {
+  while (fSlabs != NULL) {
+    unsigned char* nextSlab = *(unsigned char**)fSlabs;
+    delete[] fSlabs;
+    fSlabs = nextSlab;
+  }
+  delete[] fFreeBuffers;
+}
+
+unsigned char* PacketBufferSlabs::allocate(unsigned& bufferSize) {
+  if (bufferSize == 0) bufferSize = 1;
+  else if (bufferSize > MAX_PACKET_SIZE) bufferSize = MAX_PACKET_SIZE;
+  unsigned sizeIndex = (bufferSize + PACKET_BUFFER_SIZE_UNIT - 1)/PACKET_BUFFER_SIZE_UNIT - 1;
+  bufferSize = (sizeIndex + 1)*PACKET_BUFFER_SIZE_UNIT;
+
+  if (fFreeBuffers[sizeIndex] == NULL) {
+    // Carve a new slab into buffers of this size:
+    unsigned numBuffers = PACKET_BUFFER_SLAB_SIZE/bufferSize;
+    if (numBuffers == 0) numBuffers = 1;
+    unsigned char* slab = new unsigned char[PACKET_BUFFER_SLAB_HEADER_SIZE + numBuffers*bufferSize];
+    *(unsigned char**)slab = fSlabs;
+    fSlabs = slab;
+
+    for (unsigned i = 0; i < numBuffers; ++i) {
+      release(&slab[PACKET_BUFFER_SLAB_HEADER_SIZE + i*bufferSize], bufferSize);
+    }
+  }
+
+  unsigned char* buffer = fFreeBuffers[sizeIndex];
+  fFreeBuffers[sizeIndex] = *(unsigned char**)buffer;
+  return buffer;
+}
+
+void PacketBufferSlabs::release(unsigned char* buffer, unsigned bufferSize) {
+  unsigned sizeIndex = bufferSize/PACKET_BUFFER_SIZE_UNIT - 1;
+  *(unsigned char**)buffer = fFreeBuffers[sizeIndex];
+  fFreeBuffers[sizeIndex] = buffer;
+}
+
+
 ////////// ReorderingPacketBuffer implementation //////////
 
 ReorderingPacketBuffer
 ::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
   : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+    fHaveSeenFirstPacket(False), fNumStoredPackets(0), fHeadPacket(NULL),
+    fReceptionPacket(NULL), fReceptionPacketFree(True), fFreeSlabPackets(NULL),
+    fNumReorderedPackets(0), fMaxReorderingDepth(0), fNumDuplicatePackets(0), fNumLatePackets(0),
+    fTotReorderingDepth(0) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
+  for (unsigned i = 0; i < REORDERING_WINDOW_SIZE; ++i) fSlots[i] = NULL;
 }
 
 ReorderingPacketBuffer::~ReorderingPacketBuffer() {
   reset();
+  delete fReceptionPacket;
+  while (fFreeSlabPackets != NULL) {
+    BufferedPacket* packet = fFreeSlabPackets;
+    fFreeSlabPackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    delete packet;
+  }
   delete fPacketFactory;
 }
 
 void ReorderingPacketBuffer::reset() {
-  if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not in the list
-  delete fHeadPacket; // will also delete fSavedPacket if it's in the list
+  discardStoredPackets();
+  fReceptionPacketFree = True; // even if a (TCP) read into it was in progress
   resetHaveSeenFirstPacket();
-  fHeadPacket = fTailPacket = fSavedPacket = NULL;
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
-  if (fSavedPacket == NULL) { // we're being called for the first time
-    fSavedPacket = fPacketFactory->createNewPacket(ourSource);
-    fSavedPacketFree = True;
+  if (fReceptionPacket == NULL) { // we're being called for the first time
+    fReceptionPacket = fPacketFactory->createNewPacket(ourSource);
+    fReceptionPacketFree = True;
+  }
+
+  if (!fReceptionPacketFree) {
+    // Our reception packet is still stored, waiting to be delivered.  Unless some of its data has already been delivered,
+    // move this data to a (right-sized) slab buffer, so that we can read into the reception packet again:
+    if (fReceptionPacket->useCount() > 0) {
+      // Rare case: Use a new full-size packet instead (it'll get deleted when we're done with it):
+      return fPacketFactory->createNewPacket(ourSource);
+    }
+    moveToSlabBuffer(fReceptionPacket, ourSource);
+  }
+
+  fReceptionPacketFree = False;
+  return fReceptionPacket;
+}
+
+void ReorderingPacketBuffer::freePacket(BufferedPacket* packet) {
+  if (packet == fReceptionPacket) {
+    fReceptionPacketFree = True;
+  } else if (packet->fBufIsFromSlab) {
+    // Return the packet's buffer to our slabs, and keep the packet for reuse:
+    fSlabs.release(packet->fBuf, packet->fPacketSize);
+    packet->fBuf = NULL; packet->fPacketSize = 0;
+    packet->fBufIsFromSlab = False;
+
+    packet->nextPacket() = fFreeSlabPackets;
+    fFreeSlabPackets = packet;
+  } else {
+    delete packet;
   }
+}
 
-  if (fSavedPacketFree == True) {
-    fSavedPacketFree = False;
-    return fSavedPacket;
+void ReorderingPacketBuffer::moveToSlabBuffer(BufferedPacket* packet, MultiFramedRTPSource* ourSource) {
+  BufferedPacket* slabPacket = fFreeSlabPackets;
+  if (slabPacket != NULL) {
+    fFreeSlabPackets = slabPacket->nextPacket();
+    slabPacket->nextPacket() = NULL;
   } else {
-    return fPacketFactory->createNewPacket(ourSource);
+    slabPacket = fPacketFactory->createNewPacket(ourSource); // Note: This doesn't allocate a buffer
   }
+
+  // Leave some spare room at the end of the buffer, because some subclasses' "processSpecialHeader()"
+  // (or "nextEnclosedFrameSize()") can make the data grow:
+  unsigned bufferSize = packet->fTail + packet->fTail/4 + 128;
+  slabPacket->fBuf = fSlabs.allocate(bufferSize);
+  slabPacket->fPacketSize = bufferSize;
+  slabPacket->fBufIsFromSlab = True;
+
+  // Copy the data (at the same offset, because some subclasses keep space for a header in front of it):
+  slabPacket->fHead = packet->fHead;
+  slabPacket->fTail = packet->fTail;
+  memmove(&slabPacket->fBuf[slabPacket->fHead], &packet->fBuf[packet->fHead], packet->fTail - packet->fHead);
+  slabPacket->fUseCount = 0;
+  slabPacket->assignMiscParams(packet->fRTPSeqNo, packet->fRTPTimestamp, packet->fPresentationTime,
+			       packet->fHasBeenSyncedUsingRTCP, packet->fRTPMarkerBit, packet->fTimeReceived);
+  slabPacket->fIsFirstPacket = packet->fIsFirstPacket;
+
+  // Replace the original packet with the new one:
+  slotFor(packet->rtpSeqNo()) = slabPacket;
+  if (fHeadPacket == packet) fHeadPacket = slabPacket;
+}
+
+void ReorderingPacketBuffer::discardStoredPackets() {
+  if (fNumStoredPackets > 0) {
+    for (unsigned i = 0; i < REORDERING_WINDOW_SIZE; ++i) {
+      BufferedPacket* packet = fSlots[i];
+      if (packet != NULL) {
+	fSlots[i] = NULL;
+	freePacket(packet);
+      }
+    }
+    fNumStoredPackets = 0;
+  }
+  fHeadPacket = NULL;
 }
 
 Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
   unsigned short rtpSeqNo = bPacket->rtpSeqNo();
 
   if (!fHaveSeenFirstPacket) {
-    fNextExpectedSeqNo = rtpSeqNo; // initialization
+    // Forget any packets that we're still holding from before (e.g., from a previous SSRC):
+    discardStoredPackets();
+
+    fNextExpectedSeqNo = fHighestSeqNoReceived = rtpSeqNo; // initialization
     bPacket->isFirstPacket() = True;
     fHaveSeenFirstPacket = True;
   }
 
   // Ignore this packet if its sequence number is less than the one
   // that we're looking for (in this case, it's been excessively delayed).
-  if (seqNumLT(rtpSeqNo, fNextExpectedSeqNo)) return False;
-
-  if (fTailPacket == NULL) {
-    // Common case: There are no packets in the queue; this will be the first one:
-    bPacket->nextPacket() = NULL;
-    fHeadPacket = fTailPacket = bPacket;
-    return True;
-  }
-
-  if (seqNumLT(fTailPacket->rtpSeqNo(), rtpSeqNo)) {
-    // The next-most common case: There are packets already in the queue; this packet arrived in order => put it at the tail:
-    bPacket->nextPacket() = NULL;
-    fTailPacket->nextPacket() = bPacket;
-    fTailPacket = bPacket;
-    return True;
-  } 
-
-  if (rtpSeqNo == fTailPacket->rtpSeqNo()) {
-    // This is a duplicate packet - ignore it
+  if (seqNumLT(rtpSeqNo, fNextExpectedSeqNo)) {
+    ++fNumLatePackets;
     return False;
   }
 
-  // Rare case: This packet is out-of-order.  Run through the list (from the head), to figure out where it belongs:
-  BufferedPacket* beforePtr = NULL;
-  BufferedPacket* afterPtr = fHeadPacket;
-  while (afterPtr != NULL) {
-    if (seqNumLT(rtpSeqNo, afterPtr->rtpSeqNo())) break; // it comes here
-    if (rtpSeqNo == afterPtr->rtpSeqNo()) {
-      // This is a duplicate packet - ignore it
-      return False;
-    }
+  if ((unsigned short)(rtpSeqNo - fNextExpectedSeqNo) >= REORDERING_WINDOW_SIZE) {
+    // This packet is too far ahead of the one that we're waiting for to fit in our window.
+    // If we're still holding packets, ignore it; we'll accept such packets again once we've delivered
+    // (or given up on) the ones that we hold:
+    if (fNumStoredPackets > 0) return False;
 
-    beforePtr = afterPtr;
-    afterPtr = afterPtr->nextPacket();
+    // Otherwise, jump ahead to this packet.  (The gap is treated like packet loss.)
+    fNextExpectedSeqNo = fHighestSeqNoReceived = rtpSeqNo;
+    bPacket->isFirstPacket() = True; // so that it's treated as having been preceded by packet loss
   }
 
-  // Link our new packet between "beforePtr" and "afterPtr":
-  bPacket->nextPacket() = afterPtr;
-  if (beforePtr == NULL) {
-    fHeadPacket = bPacket;
+  BufferedPacket*& slot = slotFor(rtpSeqNo);
+  if (slot != NULL) {
+    // This is a duplicate packet - ignore it
+    // (All stored packets are within our window, so the slot's packet has the same sequence number.)
+    ++fNumDuplicatePackets;
+    return False;
+  }
+  bPacket->nextPacket() = NULL;
+  slot = bPacket;
+  ++fNumStoredPackets;
+  if (fHeadPacket == NULL || seqNumLT(rtpSeqNo, fHeadPacket->rtpSeqNo())) fHeadPacket = bPacket;
+
+  if (seqNumLT(rtpSeqNo, fHighestSeqNoReceived)) {
+    // This packet arrived out of order.  Note how late it was:
+    unsigned reorderingDepth = (unsigned short)(fHighestSeqNoReceived - rtpSeqNo);
+    ++fNumReorderedPackets;
+    fTotReorderingDepth += reorderingDepth;
+    if (reorderingDepth > fMaxReorderingDepth) fMaxReorderingDepth = reorderingDepth;
   } else {
-    beforePtr->nextPacket() = bPacket;
+    fHighestSeqNoReceived = rtpSeqNo;
   }
 
   return True;
 }
 
+Boolean ReorderingPacketBuffer::isAwaiting(unsigned short rtpSeqNo) {
+  return fHaveSeenFirstPacket && !seqNumLT(rtpSeqNo, fNextExpectedSeqNo)
+    && (unsigned short)(rtpSeqNo - fNextExpectedSeqNo) < REORDERING_WINDOW_SIZE
+    && slotFor(rtpSeqNo) == NULL;
+}
+
 void ReorderingPacketBuffer::releaseUsedPacket(BufferedPacket* packet) {
   // ASSERT: packet == fHeadPacket
   // ASSERT: fNextExpectedSeqNo == packet->rtpSeqNo()
+  slotFor(packet->rtpSeqNo()) = NULL;
+  --fNumStoredPackets;
   ++fNextExpectedSeqNo; // because we're finished with this packet now
 
-  fHeadPacket = fHeadPacket->nextPacket();
-  if (!fHeadPacket) { 
-    fTailPacket = NULL;
+  // Find the new head packet (if any).  (It's within our window, so this search is bounded.)
+  fHeadPacket = NULL;
+  if (fNumStoredPackets > 0) {
+    for (unsigned short seqNo = fNextExpectedSeqNo; (fHeadPacket = slotFor(seqNo)) == NULL; ++seqNo) {}
   }
-  packet->nextPacket() = NULL;
 
   freePacket(packet);
 }
 
 BufferedPacket* ReorderingPacketBuffer
-::getNextCompletedPacket(Boolean& packetLossPreceded) {
+::getNextCompletedPacket(Boolean& packetLossPreceded, struct timeval const& timeNow) {
   if (fHeadPacket == NULL) return NULL;
 
   // Check whether the next packet we want is already at the head
@@ -593,8 +1080,6 @@ BufferedPacket* ReorderingPacketBuffer
   if (fThresholdTime == 0) {
     timeThresholdHasBeenExceeded = True; // optimization
   } else {
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
     unsigned uSecondsSinceReceived
       = (timeNow.tv_sec - fHeadPacket->timeReceived().tv_sec)*1000000
       + (timeNow.tv_usec - fHeadPacket->timeReceived().tv_usec);
@@ -0,0 +1,149 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// Removing and adding the 'emulation prevention' bytes of H.264 (or H.265) NAL units
+// Implementation
+
+#include "NALUnitEmulationPrevention.hh"
+#include "Boolean.hh"
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static inline unsigned countTrailingZeros(unsigned x) { // "x" != 0
+#ifdef __GNUC__
+  return __builtin_ctz(x);
+#else
+  unsigned result = 0;
+  while ((x&1) == 0) { x >>= 1; ++result; }
+  return result;
+#endif
+}
+#endif
+
+unsigned findEmulationPreventionCandidate(u_int8_t const* ptr, unsigned size) {
+  unsigned i = 0;
+
+  // Compare many candidate positions at once: Position "j" is a candidate iff
+  // ptr[j] == 0 && ptr[j+1] == 0 && ptr[j+2] <= 3
+  // (We test the last condition as min(ptr[j+2], 3) == ptr[j+2], because there's no unsigned byte comparison.)
+#if defined(__AVX2__)
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const three = _mm256_set1_epi8(3);
+  for (; i + 32 + 2 <= size; i += 32) {
+    __m256i b0 = _mm256_loadu_si256((__m256i const*)&ptr[i]);
+    __m256i b1 = _mm256_loadu_si256((__m256i const*)&ptr[i+1]);
+    __m256i b2 = _mm256_loadu_si256((__m256i const*)&ptr[i+2]);
+    __m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+				     _mm256_cmpeq_epi8(_mm256_min_epu8(b2, three), b2));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(match);
+    if (mask != 0) return i + countTrailingZeros(mask);
+  }
+#elif defined(__SSE2__)
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const three = _mm_set1_epi8(3);
+  for (; i + 16 + 2 <= size; i += 16) {
+    __m128i b0 = _mm_loadu_si128((__m128i const*)&ptr[i]);
+    __m128i b1 = _mm_loadu_si128((__m128i const*)&ptr[i+1]);
+    __m128i b2 = _mm_loadu_si128((__m128i const*)&ptr[i+2]);
+    __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+				  _mm_cmpeq_epi8(_mm_min_epu8(b2, three), b2));
+    unsigned mask = (unsigned)_mm_movemask_epi8(match);
+    if (mask != 0) return i + countTrailingZeros(mask);
+  }
+#endif
+
+  // Check any remaining positions (or all positions, if we don't have SIMD instructions).
+  // We look at every third byte: If it's > 3, then no candidate can begin at it, or at either of the two previous bytes:
+  while (i + 3 <= size) {
+    u_int8_t c = ptr[i+2];
+    if (c > 3) {
+      i += 3;
+    } else if (ptr[i] == 0 && ptr[i+1] == 0) {
+      return i;
+    } else if (c != 0) {
+      i += 3; // a candidate can't begin at i+1 or i+2, because ptr[i+2] != 0
+    } else {
+      ++i;
+    }
+  }
+
+  return size;
+}
+
+unsigned removeEmulationPreventionBytes(u_int8_t* to, unsigned toMaxSize,
+					u_int8_t const* from, unsigned fromSize) {
+  unsigned toSize = 0, i = 0;
+
+  while (i < fromSize && toSize < toMaxSize) {
+    unsigned const room = toMaxSize - toSize;
+
+    // Don't scan any further than we need to, to fill "to":
+    unsigned scanSize = fromSize - i;
+    if (scanSize > room && scanSize - room > 2) scanSize = room + 2;
+
+    unsigned k = findEmulationPreventionCandidate(&from[i], scanSize);
+    unsigned numToCopy, numConsumed;
+    if (k == scanSize) {
+      // There are no more 'emulation prevention' bytes (that we care about):
+      numToCopy = numConsumed = fromSize - i;
+    } else if (from[i+k+2] == 3) {
+      // Copy up to and including the two 0x00 bytes, but skip the 0x03 that follows them:
+      numToCopy = k + 2;
+      numConsumed = k + 3;
+    } else {
+      // Not a valid NAL unit (e.g., it contains 0x00 0x00 0x00).  Copy the first 0x00, and continue from the second:
+      numToCopy = numConsumed = k + 1;
+    }
+
+    if (numToCopy > room) numToCopy = room;
+    memmove(&to[toSize], &from[i], numToCopy); // "to" may be the same as "from"
+    toSize += numToCopy;
+    i += numConsumed;
+  }
+
+  return toSize;
+}
+
+unsigned addEmulationPreventionBytes(u_int8_t* to, unsigned toMaxSize,
+				     u_int8_t const* from, unsigned fromSize) {
+  unsigned toSize = 0, i = 0;
+
+  while (i < fromSize) {
+    unsigned k = findEmulationPreventionCandidate(&from[i], fromSize - i);
+    Boolean const needsEmulationPreventionByte = k < fromSize - i;
+    unsigned numToCopy = needsEmulationPreventionByte ? k + 2 : fromSize - i;
+
+    if (numToCopy > toMaxSize - toSize) numToCopy = toMaxSize - toSize;
+    memcpy(&to[toSize], &from[i], numToCopy);
+    toSize += numToCopy;
+    i += numToCopy;
+    if (!needsEmulationPreventionByte) break;
+    if (toSize == toMaxSize) return toSize;
+
+    to[toSize++] = 3;
+  }
+
+  // If the data ends with 0x00 0x00 (i.e., with a "cabac_zero_word"), then a final 0x03 must also be added:
+  if (toSize >= 2 && to[toSize-1] == 0 && to[toSize-2] == 0 && toSize < toMaxSize) to[toSize++] = 3;
+
+  return toSize;
+}
@@ -22,12 +22,354 @@
 #include "OnDemandServerMediaSubsession.hh"
 #include <GroupsockHelper.hh>
 
+////////// ServerPortPairAllocator //////////
+
+// A process-wide record of the server RTP/RTCP port pairs that are currently in use by our streams.
+// Each pair (an even RTP port number 'p', and RTCP port number 'p+1') is one bit in a bitmap, so finding
+// a free pair is a word-at-a-time scan, rather than a sequence of "socket()"+"bind()" attempts on ports that
+// are already in use by our own earlier streams.  Pairs are returned to the bitmap (for reuse) when their
+// stream is reclaimed.  A pair that we fail to bind (because some other program is using it) is left marked
+// as in use, so that we don't try it again.
+class ServerPortPairAllocator
+{
+public:
+    static portNumBits allocate(portNumBits initialPortNum);
+    // returns the RTP port number of the lowest free pair at or above "initialPortNum", or 0 if none is free
+    static void release(portNumBits rtpPortNum);
+
+private:
+    enum { NUM_PAIRS = 32768, BITS_PER_WORD = 32, NUM_WORDS = NUM_PAIRS / BITS_PER_WORD };
+    static u_int32_t fPairIsInUse[NUM_WORDS];
+};
+
+u_int32_t ServerPortPairAllocator::fPairIsInUse[NUM_WORDS];
+
+portNumBits ServerPortPairAllocator::allocate(portNumBits initialPortNum)
+{
+    unsigned pairNum = (initialPortNum + 1) / 2; // RTP port numbers are always even
+    if (pairNum == 0)
+        pairNum = 1; // don't hand out port 0
+
+    // Treat the pairs below "pairNum" (in its word) as being in use:
+    unsigned wordNum = pairNum / BITS_PER_WORD;
+    u_int32_t inUse = fPairIsInUse[wordNum]
+                      | ((1u << (pairNum % BITS_PER_WORD)) - 1);
+    while (inUse == 0xFFFFFFFF)
+    {
+        if (++wordNum == NUM_WORDS)
+            return 0; // all pairs are in use
+        inUse = fPairIsInUse[wordNum];
+    }
+
+    unsigned bitNum = 0;
+    for (u_int32_t notInUse = ~inUse; (notInUse & 1) == 0; notInUse >>= 1)
+        ++bitNum;
+    fPairIsInUse[wordNum] |= 1u << bitNum;
+
+    return (portNumBits) ((wordNum * BITS_PER_WORD + bitNum) * 2);
+}
+
+void ServerPortPairAllocator::release(portNumBits rtpPortNum)
+{
+    unsigned pairNum = rtpPortNum / 2;
+    fPairIsInUse[pairNum / BITS_PER_WORD] &= ~(1u << (pairNum % BITS_PER_WORD));
+}
+
+// The number of port pairs that we try to bind (skipping over those that some other program is using) before
+// giving up, and letting the OS choose the port numbers instead:
+#define MAX_NUM_PORT_PAIR_BIND_ATTEMPTS 100
+
+// Creates a pair of 'groupsocks' (RTP and RTCP), with adjacent port numbers (RTP port number even), bound to the
+// lowest free port pair at or above "initialPortNum".  If every pair is in use (or we fail to bind too many pairs),
+// we let the OS choose the port numbers.
+// Returns True iff the port pair came from "ServerPortPairAllocator" (and so must later be released to it).
+static Boolean createServerGroupsockPair(UsageEnvironment& env,
+                                         portNumBits initialPortNum,
+                                         Groupsock*& rtpGroupsock, Groupsock*& rtcpGroupsock,
+                                         Port& serverRTPPort, Port& serverRTCPPort)
+{
+    // We get each candidate pair from "ServerPortPairAllocator" (rather than trying every pair,
+    // starting from "initialPortNum"), so we normally bind on the first attempt.
+    NoReuse dummy(env); // ensures that we skip over ports that are already in use
+    struct in_addr dummyAddr;
+    dummyAddr.s_addr = 0;
+    for (unsigned i = 0; i < MAX_NUM_PORT_PAIR_BIND_ATTEMPTS; ++i)
+    {
+        portNumBits serverPortNum = ServerPortPairAllocator::allocate(initialPortNum);
+        if (serverPortNum == 0)
+            break; // all pairs are in use
+
+        serverRTPPort = serverPortNum;
+        rtpGroupsock = new Groupsock(env, dummyAddr, serverRTPPort, 255);
+        if (rtpGroupsock->socketNum() < 0)
+        {
+            delete rtpGroupsock;
+            continue; // try again
+        }
+
+        serverRTCPPort = serverPortNum + 1;
+        rtcpGroupsock = new Groupsock(env, dummyAddr, serverRTCPPort, 255);
+        if (rtcpGroupsock->socketNum() < 0)
+        {
+            delete rtpGroupsock;
+            delete rtcpGroupsock;
+            continue; // try again
+        }
+
+        return True; // success
+    }
+
+    rtpGroupsock = new Groupsock(env, dummyAddr, 0, 255);
+    rtcpGroupsock = new Groupsock(env, dummyAddr, 0, 255);
+    getSourcePort(env, rtpGroupsock->socketNum(), serverRTPPort);
+    getSourcePort(env, rtcpGroupsock->socketNum(), serverRTCPPort);
+    return False;
+}
+
+// Creates a single 'groupsock' - for raw UDP, or for RTP with RTCP multiplexed on the same port - bound to the
+// RTP port of the lowest free port pair at or above "initialPortNum" (so that it gets released like any other pair).
+// As above, we fall back to an OS-chosen port, and return True iff the port came from "ServerPortPairAllocator".
+static Boolean createServerGroupsock(UsageEnvironment& env,
+                                     portNumBits initialPortNum,
+                                     Groupsock*& groupsock, Port& serverPort)
+{
+    NoReuse dummy(env); // ensures that we skip over ports that are already in use
+    struct in_addr dummyAddr;
+    dummyAddr.s_addr = 0;
+    for (unsigned i = 0; i < MAX_NUM_PORT_PAIR_BIND_ATTEMPTS; ++i)
+    {
+        portNumBits serverPortNum = ServerPortPairAllocator::allocate(initialPortNum);
+        if (serverPortNum == 0)
+            break; // all pairs are in use
+
+        serverPort = serverPortNum;
+        groupsock = new Groupsock(env, dummyAddr, serverPort, 255);
+        if (groupsock->socketNum() >= 0)
+            return True; // success
+        delete groupsock; // the port is in use by some other program; try another
+    }
+
+    groupsock = new Groupsock(env, dummyAddr, 0, 255);
+    getSourcePort(env, groupsock->socketNum(), serverPort);
+    return False;
+}
+
+////////// SharedServerSockets //////////
+
+// The RTP/RTCP socket pairs that are shared by all streams (in one environment) from subsessions that called
+// "useSharedServerSockets()".  Each such stream still gets its own pair of 'groupsocks' (each with its own
+// destinations), but these send and receive through one of our socket pairs, chosen in turn.  (Incoming RTCP
+// packets are handed to the right stream's "RTCPInstance" by "RTPInterface".)  We're deleted - closing our
+// sockets - when the last such stream is reclaimed.
+class SharedServerSockets
+{
+public:
+    static SharedServerSockets* lookup(UsageEnvironment& env,
+                                       unsigned numSocketPairs, portNumBits initialPortNum);
+    // creates a new pool if none exists yet
+    static void release(UsageEnvironment& env);
+    // called when a stream that used "createGroupsocks()" is reclaimed (after deleting its 'groupsocks')
+
+    static Boolean registerSubsession(UsageEnvironment& env, unsigned numSocketPairs, portNumBits initialPortNum);
+    // called by each subsession that will use our sockets.  Returns False (and sets the result message) if a
+    // subsession that is already registered (in this environment) has different parameters
+    static void deregisterSubsession(UsageEnvironment& env);
+
+    void createGroupsocks(Groupsock*& rtpGroupsock, Groupsock*& rtcpGroupsock,
+                          Port& serverRTPPort, Port& serverRTCPPort);
+    void createGroupsock(Groupsock*& rtpGroupsock, Port& serverRTPPort);
+    // used if RTCP is multiplexed with RTP: a single 'groupsock', on one of our RTP sockets
+
+private:
+    SharedServerSockets(UsageEnvironment& env, unsigned numSocketPairs,
+                        portNumBits initialPortNum);
+    virtual ~SharedServerSockets();
+
+private:
+    UsageEnvironment& fEnv;
+    unsigned fNumSocketPairs;
+    Groupsock** fRTPGroupsocks;
+    Groupsock** fRTCPGroupsocks;
+    portNumBits* fRTPPortNums; // in host byte order
+    portNumBits* fRTCPPortNums;
+    Boolean* fPortsAreFromAllocator;
+    unsigned fNextSocketPair;
+    unsigned fNumStreams;
+};
+
+static HashTable* sharedServerSocketsTable = NULL; // "UsageEnvironment" -> "SharedServerSockets"
+
+// The parameters of each environment's shared sockets, as set by the subsessions that will use them:
+class SharedServerSocketsParams
+{
+public:
+    SharedServerSocketsParams(unsigned numSocketPairs, portNumBits initialPortNum)
+        : numSocketPairs(numSocketPairs), initialPortNum(initialPortNum), numSubsessions(0)
+    {
+    }
+
+    unsigned numSocketPairs;
+    portNumBits initialPortNum;
+    unsigned numSubsessions;
+};
+
+static HashTable* sharedServerSocketsParamsTable = NULL; // "UsageEnvironment" -> "SharedServerSocketsParams"
+
+SharedServerSockets* SharedServerSockets::lookup(UsageEnvironment& env,
+        unsigned numSocketPairs, portNumBits initialPortNum)
+{
+    if (sharedServerSocketsTable == NULL)
+        sharedServerSocketsTable = HashTable::create(ONE_WORD_HASH_KEYS);
+
+    SharedServerSockets* sockets =
+        (SharedServerSockets*) (sharedServerSocketsTable->Lookup((char const*) &env));
+    if (sockets == NULL)
+    {
+        sockets = new SharedServerSockets(env, numSocketPairs, initialPortNum);
+        sharedServerSocketsTable->Add((char const*) &env, sockets);
+    }
+
+    return sockets;
+}
+
+void SharedServerSockets::release(UsageEnvironment& env)
+{
+    if (sharedServerSocketsTable == NULL)
+        return;
+
+    SharedServerSockets* sockets =
+        (SharedServerSockets*) (sharedServerSocketsTable->Lookup((char const*) &env));
+    if (sockets == NULL || --sockets->fNumStreams > 0)
+        return;
+
+    // No more streams are using these sockets, so close them:
+    sharedServerSocketsTable->Remove((char const*) &env);
+    delete sockets;
+    if (sharedServerSocketsTable->IsEmpty())
+    {
+        delete sharedServerSocketsTable;
+        sharedServerSocketsTable = NULL;
+    }
+}
+
+Boolean SharedServerSockets::registerSubsession(UsageEnvironment& env,
+        unsigned numSocketPairs, portNumBits initialPortNum)
+{
+    if (sharedServerSocketsParamsTable == NULL)
+        sharedServerSocketsParamsTable = HashTable::create(ONE_WORD_HASH_KEYS);
+
+    SharedServerSocketsParams* params =
+        (SharedServerSocketsParams*) (sharedServerSocketsParamsTable->Lookup((char const*) &env));
+    if (params == NULL)
+    {
+        params = new SharedServerSocketsParams(numSocketPairs, initialPortNum);
+        sharedServerSocketsParamsTable->Add((char const*) &env, params);
+    }
+    else if (params->numSocketPairs != numSocketPairs || params->initialPortNum != initialPortNum)
+    {
+        char buf[200];
+        sprintf(buf, "The shared server sockets were already set up with %u socket pair(s), starting at port %u",
+                params->numSocketPairs, params->initialPortNum);
+        env.setResultMsg(buf);
+        return False;
+    }
+
+    ++params->numSubsessions;
+    return True;
+}
+
+void SharedServerSockets::deregisterSubsession(UsageEnvironment& env)
+{
+    if (sharedServerSocketsParamsTable == NULL)
+        return;
+
+    SharedServerSocketsParams* params =
+        (SharedServerSocketsParams*) (sharedServerSocketsParamsTable->Lookup((char const*) &env));
+    if (params == NULL || --params->numSubsessions > 0)
+        return;
+
+    // No more subsessions will use shared sockets, so a new one may choose different parameters:
+    sharedServerSocketsParamsTable->Remove((char const*) &env);
+    delete params;
+    if (sharedServerSocketsParamsTable->IsEmpty())
+    {
+        delete sharedServerSocketsParamsTable;
+        sharedServerSocketsParamsTable = NULL;
+    }
+}
+
+void SharedServerSockets::createGroupsocks(Groupsock*& rtpGroupsock,
+        Groupsock*& rtcpGroupsock, Port& serverRTPPort, Port& serverRTCPPort)
+{
+    unsigned i = fNextSocketPair;
+    fNextSocketPair = (fNextSocketPair + 1) % fNumSocketPairs;
+
+    rtpGroupsock = new Groupsock(fEnv, *fRTPGroupsocks[i]);
+    rtcpGroupsock = new Groupsock(fEnv, *fRTCPGroupsocks[i]);
+    serverRTPPort = fRTPPortNums[i];
+    serverRTCPPort = fRTCPPortNums[i];
+    ++fNumStreams;
+}
+
+void SharedServerSockets::createGroupsock(Groupsock*& rtpGroupsock, Port& serverRTPPort)
+{
+    unsigned i = fNextSocketPair;
+    fNextSocketPair = (fNextSocketPair + 1) % fNumSocketPairs;
+
+    rtpGroupsock = new Groupsock(fEnv, *fRTPGroupsocks[i]);
+    serverRTPPort = fRTPPortNums[i];
+    ++fNumStreams;
+}
+
+SharedServerSockets::SharedServerSockets(UsageEnvironment& env,
+        unsigned numSocketPairs, portNumBits initialPortNum) :
+    fEnv(env), fNumSocketPairs(numSocketPairs), fNextSocketPair(0), fNumStreams(0)
+{
+    fRTPGroupsocks = new Groupsock*[fNumSocketPairs];
+    fRTCPGroupsocks = new Groupsock*[fNumSocketPairs];
+    fRTPPortNums = new portNumBits[fNumSocketPairs];
+    fRTCPPortNums = new portNumBits[fNumSocketPairs];
+    fPortsAreFromAllocator = new Boolean[fNumSocketPairs];
+    for (unsigned i = 0; i < fNumSocketPairs; ++i)
+    {
+        Port serverRTPPort(0), serverRTCPPort(0);
+        fPortsAreFromAllocator[i]
+            = createServerGroupsockPair(env, initialPortNum, fRTPGroupsocks[i],
+                                        fRTCPGroupsocks[i], serverRTPPort, serverRTCPPort);
+        fRTPPortNums[i] = ntohs(serverRTPPort.num());
+        fRTCPPortNums[i] = ntohs(serverRTCPPort.num());
+
+        // Each RTP socket carries many streams, so give it a much bigger send buffer than usual:
+        increaseSendBufferTo(env, fRTPGroupsocks[i]->socketNum(), 1024 * 1024);
+    }
+}
+
+SharedServerSockets::~SharedServerSockets()
+{
+    for (unsigned i = 0; i < fNumSocketPairs; ++i)
+    {
+        if (fPortsAreFromAllocator[i])
+            ServerPortPairAllocator::release(fRTPPortNums[i]);
+        delete fRTPGroupsocks[i];
+        delete fRTCPGroupsocks[i];
+    }
+    delete[] fRTPGroupsocks;
+    delete[] fRTCPGroupsocks;
+    delete[] fRTPPortNums;
+    delete[] fRTCPPortNums;
+    delete[] fPortsAreFromAllocator;
+}
+
+////////// OnDemandServerMediaSubsession //////////
+
 OnDemandServerMediaSubsession::OnDemandServerMediaSubsession(
     UsageEnvironment& env, Boolean reuseFirstSource,
     portNumBits initialPortNum) :
     ServerMediaSubsession(env), fSDPLines(NULL), fReuseFirstSource(
         reuseFirstSource), fInitialPortNum(initialPortNum),
-    fLastStreamToken(NULL)
+    fNumSharedSocketPairs(0), fMultiplexRTCPWithRTP(False),
+    fRetransmissionHistorySize(0), fUseRTXStream(False), fLastStreamToken(NULL),
+    fLastMuxedStreamToken(NULL)
 {
     fDestinationsHashTable = HashTable::create(ONE_WORD_HASH_KEYS);
     gethostname(fCNAME, sizeof fCNAME);
@@ -48,6 +390,41 @@ OnDemandServerMediaSubsession::~OnDemandServerMediaSubsession()
         delete destinations;
     }
     delete fDestinationsHashTable;
+
+    if (fNumSharedSocketPairs > 0)
+        SharedServerSockets::deregisterSubsession(envir());
+}
+
+Boolean OnDemandServerMediaSubsession::useSharedServerSockets(unsigned numSocketPairs)
+{
+    if (fNumSharedSocketPairs > 0)
+        SharedServerSockets::deregisterSubsession(envir());
+    fNumSharedSocketPairs = 0;
+    if (numSocketPairs == 0)
+        return True;
+
+    if (!SharedServerSockets::registerSubsession(envir(), numSocketPairs, fInitialPortNum))
+        return False;
+    fNumSharedSocketPairs = numSocketPairs;
+    return True;
+}
+
+void OnDemandServerMediaSubsession::multiplexRTCPWithRTP()
+{
+    fMultiplexRTCPWithRTP = True;
+}
+
+void OnDemandServerMediaSubsession::enableRetransmissions(unsigned historySize, Boolean useRTXStream)
+{
+    fRetransmissionHistorySize = historySize;
+    fUseRTXStream = useRTXStream;
+}
+
+// The (dynamic) payload type that we use for a 'RTX' retransmission stream.  (These are allocated downwards from 127,
+// so that they don't clash with the dynamic payload types - allocated upwards from 96 - of our tracks.)
+static unsigned char rtxPayloadTypeForTrack(unsigned trackNumber)
+{
+    return (unsigned char)(127 - (trackNumber - 1)%32);
 }
 
 char const*
@@ -98,16 +475,25 @@ void OnDemandServerMediaSubsession::getStreamParameters(
     destinationAddr.s_addr = destinationAddress;
     isMulticast = False;
 
-    if (fLastStreamToken != NULL && fReuseFirstSource)
+    // A stream either multiplexes RTCP with RTP (RFC 5761) on a single server port, or it doesn't, so (if
+    // "fReuseFirstSource") we keep a separate stream for clients that asked for multiplexing.  (Otherwise, we'd
+    // tell a client to send its RTCP to the wrong server port.)  A client that uses TCP can share either stream:
+    Boolean rtcpMuxRequested = tcpSocketNum < 0 && clientRTCPPort.num() != 0
+                               && clientRTCPPort.num() == clientRTPPort.num();
+    void** lastStreamToken = rtcpMuxRequested ? &fLastMuxedStreamToken : &fLastStreamToken;
+    if (tcpSocketNum >= 0 && fLastStreamToken == NULL && fLastMuxedStreamToken != NULL)
+        lastStreamToken = &fLastMuxedStreamToken;
+
+    if (*lastStreamToken != NULL && fReuseFirstSource)
     {
         //fReuseFirstSourceΪTrueʱҪٴsource, sink, groupsockʵֻҪ¼ͻ˵ĵַ
 
         // Special case: Rather than creating a new 'StreamState',
         // we reuse the one that we've already created:
-        serverRTPPort = ((StreamState*) fLastStreamToken)->serverRTPPort();
-        serverRTCPPort = ((StreamState*) fLastStreamToken)->serverRTCPPort();
-        ++((StreamState*) fLastStreamToken)->referenceCount();	//ü
-        streamToken = fLastStreamToken;
+        serverRTPPort = ((StreamState*) *lastStreamToken)->serverRTPPort();
+        serverRTCPPort = ((StreamState*) *lastStreamToken)->serverRTCPPort();
+        ++((StreamState*) *lastStreamToken)->referenceCount();	//ü
+        streamToken = *lastStreamToken;
     }
     else
     {
@@ -127,23 +513,14 @@ void OnDemandServerMediaSubsession::getStreamParameters(
         BasicUDPSink* udpSink;
         Groupsock* rtpGroupsock;
         Groupsock* rtcpGroupsock;
-        portNumBits serverPortNum;
+        Boolean serverPortsAreFromAllocator = False;
         if (clientRTCPPort.num() == 0)
         {
             //ʹRAW UDP䣬ȻͲʹRTCP
             // We're streaming raw UDP (not RTP). Create a single groupsock:
-            NoReuse dummy(envir()); // ensures that we skip over ports that are already in use
-            for (serverPortNum = fInitialPortNum;; ++serverPortNum)
-            {
-                struct in_addr dummyAddr;
-                dummyAddr.s_addr = 0;
-
-                serverRTPPort = serverPortNum;
-                rtpGroupsock = new Groupsock(envir(), dummyAddr, serverRTPPort,
-                                             255);
-                if (rtpGroupsock->socketNum() >= 0)
-                    break; // success
-            }
+            // (We use the RTP port of a free port pair, so that the port gets released like any other.)
+            serverPortsAreFromAllocator
+                = createServerGroupsock(envir(), fInitialPortNum, rtpGroupsock, serverRTPPort);
 
             rtcpGroupsock = NULL;
             rtpSink = NULL;
@@ -159,38 +536,44 @@ void OnDemandServerMediaSubsession::getStreamParameters(
              */
             // Normal case: We're streaming RTP (over UDP or TCP).  Create a pair of
             // groupsocks (RTP and RTCP), with adjacent port numbers (RTP port number even):
-            NoReuse dummy(envir()); // ensures that we skip over ports that are already in use
-            for (portNumBits serverPortNum = fInitialPortNum;; serverPortNum
-                    += 2)
+            if (rtcpMuxRequested)
             {
-                struct in_addr dummyAddr;
-                dummyAddr.s_addr = 0;
-
-                serverRTPPort = serverPortNum;
-                rtpGroupsock = new Groupsock(envir(), dummyAddr, serverRTPPort,
-                                             255);
-                if (rtpGroupsock->socketNum() < 0)
+                // The client asked for RTCP to be multiplexed with RTP on the same port (RFC 5761), so
+                // we use a single groupsock for both:
+                if (fNumSharedSocketPairs > 0)
                 {
-                    delete rtpGroupsock;
-                    continue; // try again
+                    SharedServerSockets::lookup(envir(), fNumSharedSocketPairs, fInitialPortNum)
+                    ->createGroupsock(rtpGroupsock, serverRTPPort);
                 }
-
-                serverRTCPPort = serverPortNum + 1;	//RTP˿ںڵ
-                rtcpGroupsock = new Groupsock(envir(), dummyAddr,
-                                              serverRTCPPort, 255);
-                if (rtcpGroupsock->socketNum() < 0)
+                else
                 {
-                    delete rtpGroupsock;
-                    delete rtcpGroupsock;
-                    continue; // try again
+                    serverPortsAreFromAllocator
+                        = createServerGroupsock(envir(), fInitialPortNum, rtpGroupsock, serverRTPPort);
                 }
-
-                break; // success
+                rtcpGroupsock = rtpGroupsock;
+                serverRTCPPort = serverRTPPort;
+            }
+            else if (fNumSharedSocketPairs > 0)
+            {
+                // Send (and receive RTCP) through one of the server's shared socket pairs:
+                SharedServerSockets::lookup(envir(), fNumSharedSocketPairs, fInitialPortNum)
+                ->createGroupsocks(rtpGroupsock, rtcpGroupsock, serverRTPPort, serverRTCPPort);
+            }
+            else
+            {
+                serverPortsAreFromAllocator
+                    = createServerGroupsockPair(envir(), fInitialPortNum, rtpGroupsock,
+                                                rtcpGroupsock, serverRTPPort, serverRTCPPort);
             }
             //RTPSinksourceƣڴDESCRIBEй̲μDESCRIBEĴ
             unsigned char rtpPayloadType = 96 + trackNumber() - 1; // if dynamic
             rtpSink = createNewRTPSink(rtpGroupsock, rtpPayloadType,
                                        mediaSource);
+            if (rtpSink != NULL && fRetransmissionHistorySize > 0)
+            {
+                rtpSink->enableRetransmissions(fRetransmissionHistorySize,
+                                               fUseRTXStream ? rtxPayloadTypeForTrack(trackNumber()) : 0);
+            }
             udpSink = NULL;
         }
 
@@ -198,7 +581,7 @@ void OnDemandServerMediaSubsession::getStreamParameters(
         // (unless TCP is used instead):
         if (rtpGroupsock != NULL)
             rtpGroupsock->removeAllDestinations();
-        if (rtcpGroupsock != NULL)
+        if (rtcpGroupsock != NULL && rtcpGroupsock != rtpGroupsock)
             rtcpGroupsock->removeAllDestinations();
 
         //÷RTPsocketС
@@ -219,9 +602,9 @@ void OnDemandServerMediaSubsession::getStreamParameters(
          */
 
         // Set up the state of the stream.  The stream will get started later:
-        streamToken = fLastStreamToken = new StreamState(*this, serverRTPPort,
+        streamToken = *lastStreamToken = new StreamState(*this, serverRTPPort,
                 serverRTCPPort, rtpSink, udpSink, streamBitrate, mediaSource,
-                rtpGroupsock, rtcpGroupsock);
+                rtpGroupsock, rtcpGroupsock, serverPortsAreFromAllocator);
     }
 
     //ﶨDestinationsĿĵַRTP˿ڡRTCP˿ڣӦclientSessionId
@@ -464,28 +847,54 @@ void OnDemandServerMediaSubsession::setSDPLinesFromRTPSink(RTPSink* rtpSink,
     char const* auxSDPLine = getAuxSDPLine(rtpSink, inputSource);
     if (auxSDPLine == NULL)
         auxSDPLine = "";
+    char const* rtcpMuxLine = fMultiplexRTCPWithRTP ? "a=rtcp-mux\r\n" : "";
 
-    char const* const sdpFmt = "m=%s %u RTP/AVP %d\r\n"
+    // If we support retransmissions, describe this (and any 'RTX' stream that we use for them):
+    char fmtList[20] = "";
+    char retransmissionLines[200] = "";
+    if (fRetransmissionHistorySize > 0)
+    {
+        if (fUseRTXStream)
+        {
+            unsigned char rtxPayloadType = rtxPayloadTypeForTrack(trackNumber());
+            sprintf(fmtList, " %d", rtxPayloadType);
+            sprintf(retransmissionLines,
+                    "a=rtcp-fb:%d nack\r\n"
+                    "a=rtpmap:%d rtx/%u\r\n"
+                    "a=fmtp:%d apt=%d\r\n",
+                    rtpPayloadType, rtxPayloadType, rtpSink->rtpTimestampFrequency(), rtxPayloadType, rtpPayloadType);
+        }
+        else
+        {
+            sprintf(retransmissionLines, "a=rtcp-fb:%d nack\r\n", rtpPayloadType);
+        }
+    }
+
+    char const* const sdpFmt = "m=%s %u RTP/AVP %d%s\r\n"
                                "c=IN IP4 %s\r\n"
                                "b=AS:%u\r\n"
                                "%s"
                                "%s"
                                "%s"
+                               "%s"
+                               "%s"
                                "a=control:%s\r\n";
     unsigned sdpFmtSize = strlen(sdpFmt) + strlen(mediaType) + 5
                           /* max short len */+ 3 /* max char len */
                           + strlen(ipAddressStr.val()) + 20 /* max int len */
-                          + strlen(rtpmapLine) + strlen(rangeLine) + strlen(auxSDPLine) + strlen(
+                          + strlen(rtpmapLine) + strlen(rangeLine) + strlen(auxSDPLine) + strlen(rtcpMuxLine) + strlen(fmtList) + strlen(retransmissionLines) + strlen(
                               trackId());
     char* sdpLines = new char[sdpFmtSize];
     sprintf(sdpLines, sdpFmt, mediaType, // m= <media>
             fPortNumForSDP, // m= <port>
-            rtpPayloadType, // m= <fmt list>
+            rtpPayloadType, fmtList, // m= <fmt list>
             ipAddressStr.val(), // c= address
             estBitrate, // b=AS:<bandwidth>
             rtpmapLine, // a=rtpmap:... (if present)
             rangeLine, // a=range:... (if present)
             auxSDPLine, // optional extra SDP line
+            rtcpMuxLine, // a=rtcp-mux (if present)
+            retransmissionLines, // a=rtcp-fb:... etc. (if present)
             trackId()); // a=control:<track-id>
     delete[] (char*) rangeLine;
     delete[] rtpmapLine;
@@ -515,9 +924,11 @@ static void afterPlayingStreamState(void* clientData)
 StreamState::StreamState(OnDemandServerMediaSubsession& master,
                          Port const& serverRTPPort, Port const& serverRTCPPort,
                          RTPSink* rtpSink, BasicUDPSink* udpSink, unsigned totalBW,
-                         FramedSource* mediaSource, Groupsock* rtpGS, Groupsock* rtcpGS) :
+                         FramedSource* mediaSource, Groupsock* rtpGS, Groupsock* rtcpGS,
+                         Boolean serverPortsAreFromAllocator) :
     fMaster(master), fAreCurrentlyPlaying(False), fReferenceCount(1),
     fServerRTPPort(serverRTPPort), fServerRTCPPort(serverRTCPPort),
+    fServerPortsAreFromAllocator(serverPortsAreFromAllocator),
     fRTPSink(rtpSink), fUDPSink(udpSink), fStreamDuration(
         master.duration()), fTotalBW(totalBW),
     fRTCPInstance(NULL) /* created later */, fMediaSource(mediaSource),
@@ -677,9 +1088,25 @@ void StreamState::reclaim()
     fMediaSource = NULL;
     if (fMaster.fLastStreamToken == this)
         fMaster.fLastStreamToken = NULL;
+    if (fMaster.fLastMuxedStreamToken == this)
+        fMaster.fLastMuxedStreamToken = NULL;
 
+    Boolean socketsWereShared = fRTPgs != NULL && fRTPgs->socketIsShared();
+    Boolean hadOwnSockets = fRTPgs != NULL && !fRTPgs->socketIsShared();
+    if (fRTCPgs != fRTPgs)
+        delete fRTCPgs; // otherwise, RTCP was multiplexed with RTP on the same groupsock
+    fRTCPgs = NULL;
     delete fRTPgs;
     fRTPgs = NULL;
-    delete fRTCPgs;
-    fRTCPgs = NULL;
+
+    if (socketsWereShared)
+    {
+        SharedServerSockets::release(fMaster.envir());
+    }
+    else if (hadOwnSockets && fServerPortsAreFromAllocator)
+    {
+        // Return our port pair, so that a later stream can reuse it.  (If the OS chose our port numbers instead,
+        // there's nothing to return - and their bit in the allocator's bitmap may belong to some other stream.)
+        ServerPortPairAllocator::release(ntohs(fServerRTPPort.num()));
+    }
 }
@@ -24,92 +24,222 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 ////////// RTCPMemberDatabase //////////
 
+// The members are kept in an array of records.  These are looked up (by SSRC) using an open-addressing
+// (linear probing) hash table, whose slots hold the SSRC itself as well as the record number, so that a lookup
+// usually touches just one cache line.  Each record is also linked into one of a small ring of 'timeout buckets',
+// according to the 'time count' (i.e., outgoing report count) at which the member was last heard from.
+// This lets "reapOldMembers()" visit only those members that might be stale, rather than the whole table.
+
+#define NO_RECORD 0xFFFFFFFF
+#define NUM_TIMEOUT_BUCKETS 16 // a power of 2; more than the number of 'time counts' between successive reaps
+#define INITIAL_NUM_RECORDS 64
+
 class RTCPMemberDatabase {
 public:
-  RTCPMemberDatabase(RTCPInstance& ourRTCPInstance)
-    : fOurRTCPInstance(ourRTCPInstance), fNumMembers(1 /*ourself*/),
-      fTable(HashTable::create(ONE_WORD_HASH_KEYS)) {
+  RTCPMemberDatabase(RTCPInstance& ourRTCPInstance);
+  virtual ~RTCPMemberDatabase();
+
+  Boolean isMember(unsigned ssrc) const {
+    return fSlots[lookupSlot(ssrc)].recordNum != NO_RECORD;
   }
 
-  virtual ~RTCPMemberDatabase() {
-	delete fTable;
+  Boolean noteMembership(unsigned ssrc, unsigned curTimeCount);
+  Boolean remove(unsigned ssrc);
+
+  unsigned numMembers() const {
+    return fNumMembers;
   }
 
-  Boolean isMember(unsigned ssrc) const {
-    return fTable->Lookup((char*)(long)ssrc) != NULL;
+  void reapOldMembers(unsigned threshold);
+
+private:
+  unsigned homeSlot(u_int32_t ssrc) const {
+    // SSRCs are (supposed to be) random, but we mix the bits anyway, in case they're not:
+    return (u_int32_t)(ssrc*0x9E3779B1) >> fSlotShift;
   }
+  unsigned lookupSlot(u_int32_t ssrc) const; // the slot containing "ssrc", or else the empty slot where it would go
+  void growTables();
 
-  Boolean noteMembership(unsigned ssrc, unsigned curTimeCount) {
-    Boolean isNew = !isMember(ssrc);
+  void linkIntoBucket(unsigned recordNum);
+  void unlinkFromBucket(unsigned recordNum);
 
-    if (isNew) {
-      ++fNumMembers;
-    }
+private:
+  struct Slot {
+    u_int32_t ssrc;
+    unsigned recordNum; // NO_RECORD if the slot is empty
+  };
+  struct MemberRecord {
+    u_int32_t ssrc;
+    unsigned timeCount;
+    unsigned prev, next; // links within the record's 'timeout bucket' (for a free record, "next" links the free list)
+  };
 
-    // Record the current time, so we can age stale members
-    fTable->Add((char*)(long)ssrc, (void*)(long)curTimeCount);
+  RTCPInstance& fOurRTCPInstance;
+  unsigned fNumMembers; // includes ourself
+  Slot* fSlots;
+  unsigned fNumSlots; // a power of 2; always at least twice the number of records
+  unsigned fSlotShift; // 32 - log2(fNumSlots)
+  MemberRecord* fRecords;
+  unsigned fNumRecords; // the number allocated
+  unsigned fFreeRecords; // head of the free list
+  unsigned fBucketHeads[NUM_TIMEOUT_BUCKETS];
+  unsigned fLastReapThreshold;
+};
 
-    return isNew;
-  }
+RTCPMemberDatabase::RTCPMemberDatabase(RTCPInstance& ourRTCPInstance)
+  : fOurRTCPInstance(ourRTCPInstance), fNumMembers(1 /*ourself*/),
+    fSlots(NULL), fNumSlots(0), fSlotShift(32), fRecords(NULL), fNumRecords(0), fFreeRecords(NO_RECORD),
+    fLastReapThreshold(0) {
+  for (unsigned i = 0; i < NUM_TIMEOUT_BUCKETS; ++i) fBucketHeads[i] = NO_RECORD;
+  growTables();
+}
 
-  Boolean remove(unsigned ssrc) {
-    Boolean wasPresent = fTable->Remove((char*)(long)ssrc);
-    if (wasPresent) {
-      --fNumMembers;
-    }
-    return wasPresent;
+RTCPMemberDatabase::~RTCPMemberDatabase() {
+  delete[] fSlots;
+  delete[] fRecords;
+}
+
+unsigned RTCPMemberDatabase::lookupSlot(u_int32_t ssrc) const {
+  unsigned const slotMask = fNumSlots - 1;
+  unsigned i = homeSlot(ssrc);
+  while (fSlots[i].recordNum != NO_RECORD && fSlots[i].ssrc != ssrc) i = (i+1)&slotMask;
+
+  return i;
+}
+
+void RTCPMemberDatabase::growTables() {
+  // Double the number of records (adding the new ones to the free list), and the number of hash table slots:
+  unsigned newNumRecords = fNumRecords == 0 ? INITIAL_NUM_RECORDS : 2*fNumRecords;
+  MemberRecord* newRecords = new MemberRecord[newNumRecords];
+  if (fRecords != NULL) memmove(newRecords, fRecords, fNumRecords*sizeof (MemberRecord));
+  for (unsigned r = newNumRecords; r > fNumRecords; --r) {
+    newRecords[r-1].next = fFreeRecords;
+    fFreeRecords = r-1;
+  }
+  delete[] fRecords; fRecords = newRecords;
+  fNumRecords = newNumRecords;
+
+  Slot* oldSlots = fSlots;
+  unsigned oldNumSlots = fNumSlots;
+  fNumSlots = 2*newNumRecords;
+  for (fSlotShift = 32; (1u<<(32-fSlotShift)) < fNumSlots; --fSlotShift) {}
+  fSlots = new Slot[fNumSlots];
+  for (unsigned i = 0; i < fNumSlots; ++i) fSlots[i].recordNum = NO_RECORD;
+
+  // Re-insert the existing entries:
+  for (unsigned i = 0; i < oldNumSlots; ++i) {
+    if (oldSlots[i].recordNum != NO_RECORD) fSlots[lookupSlot(oldSlots[i].ssrc)] = oldSlots[i];
   }
+  delete[] oldSlots;
+}
 
-  unsigned numMembers() const {
-    return fNumMembers;
+void RTCPMemberDatabase::linkIntoBucket(unsigned recordNum) {
+  MemberRecord& record = fRecords[recordNum];
+  unsigned& head = fBucketHeads[record.timeCount&(NUM_TIMEOUT_BUCKETS-1)];
+
+  record.prev = NO_RECORD;
+  record.next = head;
+  if (head != NO_RECORD) fRecords[head].prev = recordNum;
+  head = recordNum;
+}
+
+void RTCPMemberDatabase::unlinkFromBucket(unsigned recordNum) {
+  MemberRecord& record = fRecords[recordNum];
+
+  if (record.prev != NO_RECORD) {
+    fRecords[record.prev].next = record.next;
+  } else {
+    fBucketHeads[record.timeCount&(NUM_TIMEOUT_BUCKETS-1)] = record.next;
   }
+  if (record.next != NO_RECORD) fRecords[record.next].prev = record.prev;
+}
 
-  void reapOldMembers(unsigned threshold);
+Boolean RTCPMemberDatabase::noteMembership(unsigned ssrc, unsigned curTimeCount) {
+  unsigned slot = lookupSlot(ssrc);
+  unsigned recordNum = fSlots[slot].recordNum;
+  Boolean isNew = recordNum == NO_RECORD;
 
-private:
-  RTCPInstance& fOurRTCPInstance;
-  unsigned fNumMembers;
-  HashTable* fTable;
-};
+  if (isNew) {
+    if (fFreeRecords == NO_RECORD) {
+      growTables();
+      slot = lookupSlot(ssrc);
+    }
+    recordNum = fFreeRecords;
+    fFreeRecords = fRecords[recordNum].next;
 
-void RTCPMemberDatabase::reapOldMembers(unsigned threshold) {
-  Boolean foundOldMember;
-  u_int32_t oldSSRC = 0;
+    fSlots[slot].ssrc = ssrc;
+    fSlots[slot].recordNum = recordNum;
+    fRecords[recordNum].ssrc = ssrc;
+    ++fNumMembers;
+  } else {
+    unlinkFromBucket(recordNum);
+  }
 
-  do {
-    foundOldMember = False;
+  // Record the current time, so we can age stale members
+  fRecords[recordNum].timeCount = curTimeCount;
+  linkIntoBucket(recordNum);
 
-    HashTable::Iterator* iter
-      = HashTable::Iterator::create(*fTable);
-    uintptr_t timeCount;
-    char const* key;
-    while ((timeCount = (uintptr_t)(iter->next(key))) != 0) {
-#ifdef DEBUG
-      fprintf(stderr, "reap: checking SSRC 0x%lx: %ld (threshold %d)\n", (unsigned long)key, timeCount, threshold);
-#endif
-      if (timeCount < (uintptr_t)threshold) { // this SSRC is old
-        uintptr_t ssrc = (uintptr_t)key;
-        oldSSRC = (u_int32_t)ssrc;
-        foundOldMember = True;
-      }
+  return isNew;
+}
+
+Boolean RTCPMemberDatabase::remove(unsigned ssrc) {
+  unsigned slot = lookupSlot(ssrc);
+  unsigned recordNum = fSlots[slot].recordNum;
+  if (recordNum == NO_RECORD) return False;
+
+  unlinkFromBucket(recordNum);
+  fRecords[recordNum].next = fFreeRecords;
+  fFreeRecords = recordNum;
+  --fNumMembers;
+
+  // Empty the slot, then move back any later entries (in the same 'probe run') that would no longer be found:
+  unsigned const slotMask = fNumSlots - 1;
+  unsigned i = slot, j = slot;
+  while (1) {
+    j = (j+1)&slotMask;
+    if (fSlots[j].recordNum == NO_RECORD) break;
+
+    unsigned home = homeSlot(fSlots[j].ssrc);
+    Boolean canStay = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+    if (!canStay) {
+      fSlots[i] = fSlots[j];
+      i = j;
     }
-    delete iter;
+  }
+  fSlots[i].recordNum = NO_RECORD;
 
-    if (foundOldMember) {
+  return True;
+}
+
+void RTCPMemberDatabase::reapOldMembers(unsigned threshold) {
+  // Visit the buckets for each 'time count' since the last reap, up to (but not including) "threshold".
+  // (Because a bucket may also contain members that have been heard from more recently, we check each one.)
+  if (threshold <= fLastReapThreshold) return;
+  unsigned numBucketsToVisit = threshold - fLastReapThreshold;
+  if (numBucketsToVisit > NUM_TIMEOUT_BUCKETS) numBucketsToVisit = NUM_TIMEOUT_BUCKETS;
+
+  for (unsigned k = 0; k < numBucketsToVisit; ++k) {
+    unsigned recordNum = fBucketHeads[(threshold-1-k)&(NUM_TIMEOUT_BUCKETS-1)];
+    while (recordNum != NO_RECORD) {
+      unsigned nextRecordNum = fRecords[recordNum].next;
+      if (fRecords[recordNum].timeCount < threshold) { // this SSRC is old
+	u_int32_t oldSSRC = fRecords[recordNum].ssrc;
 #ifdef DEBUG
-        fprintf(stderr, "reap: removing SSRC 0x%x\n", oldSSRC);
+	fprintf(stderr, "reap: removing SSRC 0x%x\n", oldSSRC);
 #endif
-      fOurRTCPInstance.removeSSRC(oldSSRC, True);
+	fOurRTCPInstance.removeSSRC(oldSSRC, True); // this also calls our "remove()"
+      }
+      recordNum = nextRecordNum;
     }
-  } while (foundOldMember);
+  }
+  fLastReapThreshold = threshold;
 }
 
 
 ////////// RTCPInstance //////////
 
-static double dTimeNow() {
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
+static double dTimeNow(UsageEnvironment& env) {
+    struct timeval const& timeNow = env.taskScheduler().timeNow();
     return (double) (timeNow.tv_sec + timeNow.tv_usec/1000000.0);
 }
 
@@ -123,7 +253,7 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
 			   RTPSink* sink, RTPSource const* source,
 			   Boolean isSSMSource)
   : Medium(env), fRTCPInterface(this, RTCPgs), fTotSessionBW(totSessionBW),
-    fSink(sink), fSource(source), fIsSSMSource(isSSMSource),
+    fSink(sink), fSource(source), fIsSSMSource(isSSMSource), fIsMultiplexedWithRTP(False),
     fCNAME(RTCP_SDES_CNAME, cname), fOutgoingReportCount(1),
     fAveRTCPSize(0), fIsInitial(1), fPrevNumMembers(0),
     fLastSentSize(0), fLastReceivedSize(0), fLastReceivedSSRC(0),
@@ -132,7 +262,9 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
     fByeHandlerTask(NULL), fByeHandlerClientData(NULL),
     fSRHandlerTask(NULL), fSRHandlerClientData(NULL),
     fRRHandlerTask(NULL), fRRHandlerClientData(NULL),
-    fSpecificRRHandlerTable(NULL) {
+    fSpecificRRHandlerTable(NULL),
+    fRRSamplingInterval(1), fMaxNumRRsPerReportInterval(0),
+    fNumRRsSinceLastProcessed(0), fNumRRsProcessedThisInterval(0) {
 #ifdef DEBUG
   fprintf(stderr, "RTCPInstance[%p]::RTCPInstance()\n", this);
 #endif
@@ -143,7 +275,7 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
 
   if (isSSMSource) RTCPgs->multicastSendOnly(); // don't receive multicast
 
-  double timeNow = dTimeNow();
+  double timeNow = dTimeNow(envir());
   fPrevReportTime = fNextReportTime = timeNow;
 
   fKnownMembers = new RTCPMemberDatabase(*this);
@@ -158,10 +290,17 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
   OutPacketBuffer::maxSize = savedMaxSize;
   if (fOutBuf == NULL) return;
 
-  // Arrange to handle incoming reports from others:
-  TaskScheduler::BackgroundHandlerProc* handler
-    = (TaskScheduler::BackgroundHandlerProc*)&incomingReportHandler;
-  fRTCPInterface.startNetworkReading(handler);
+  if (fSource != NULL && fSource->RTPgs() == RTCPgs) {
+    // RTCP is multiplexed with RTP on the same socket (RFC 5761).  Our "RTPSource" reads this socket,
+    // and hands each incoming RTCP packet to us (by calling "injectReport()"):
+    ((RTPSource*)fSource)->registerForMultiplexedRTCPPackets(this);
+    fIsMultiplexedWithRTP = True;
+  } else {
+    // Arrange to handle incoming reports from others:
+    TaskScheduler::BackgroundHandlerProc* handler
+      = (TaskScheduler::BackgroundHandlerProc*)&incomingReportHandler;
+    fRTCPInterface.startNetworkReading(handler);
+  }
 
   // Send our first report.
   fTypeOfEvent = EVENT_REPORT;
@@ -178,7 +317,11 @@ RTCPInstance::~RTCPInstance() {
   fprintf(stderr, "RTCPInstance[%p]::~RTCPInstance()\n", this);
 #endif
   // Turn off background read handling:
-  fRTCPInterface.stopNetworkReading();
+  if (fIsMultiplexedWithRTP) {
+    ((RTPSource*)fSource)->deregisterForMultiplexedRTCPPackets();
+  } else {
+    fRTCPInterface.stopNetworkReading();
+  }
 
   // Begin by sending a BYE.  We have to do this immediately, without
   // 'reconsideration', because "this" is going away.
@@ -281,10 +424,21 @@ void RTCPInstance
   }
 }
 
+void RTCPInstance::setRRProcessingLimits(unsigned rrSamplingInterval, unsigned maxNumRRsPerReportInterval) {
+  fRRSamplingInterval = rrSamplingInterval == 0 ? 1 : rrSamplingInterval;
+  fMaxNumRRsPerReportInterval = maxNumRRsPerReportInterval;
+  fNumRRsSinceLastProcessed = fNumRRsProcessedThisInterval = 0;
+}
+
 void RTCPInstance::setStreamSocket(int sockNum,
 				   unsigned char streamChannelId) {
   // Turn off background read handling:
-  fRTCPInterface.stopNetworkReading();
+  if (fIsMultiplexedWithRTP) {
+    ((RTPSource*)fSource)->deregisterForMultiplexedRTCPPackets();
+    fIsMultiplexedWithRTP = False;
+  } else {
+    fRTCPInterface.stopNetworkReading();
+  }
 
   // Switch to RTCP-over-TCP:
   fRTCPInterface.setStreamSocket(sockNum, streamChannelId);
@@ -298,7 +452,7 @@ void RTCPInstance::setStreamSocket(int sockNum,
 void RTCPInstance::addStreamSocket(int sockNum,
 				   unsigned char streamChannelId) {
   // First, turn off background read handling for the default (UDP) socket:
-  envir().taskScheduler().turnOffBackgroundReadHandling(fRTCPInterface.gs()->socketNum());
+  fRTCPInterface.stopDatagramReading();
 
   // Add the RTCP-over-TCP interface:
   fRTCPInterface.addStreamSocket(sockNum, streamChannelId);
@@ -320,29 +474,44 @@ void RTCPInstance::incomingReportHandler(RTCPInstance* instance,
 }
 
 void RTCPInstance::incomingReportHandler1() {
+  int tcpReadStreamSocketNum = fRTCPInterface.nextTCPReadStreamSocketNum();
+  unsigned char tcpReadStreamChannelId = fRTCPInterface.nextTCPReadStreamChannelId();
+  unsigned packetSize = 0;
+  unsigned numBytesRead;
+  struct sockaddr_in fromAddress;
+  Boolean packetReadWasIncomplete;
+  if (fNumBytesAlreadyRead >= maxRTCPPacketSize) {
+    envir() << "RTCPInstance error: Hit limit when reading incoming packet over TCP. Increase \"maxRTCPPacketSize\"\n";
+    return;
+  }
+  Boolean readResult
+    = fRTCPInterface.handleRead(&fInBuf[fNumBytesAlreadyRead], maxRTCPPacketSize - fNumBytesAlreadyRead,
+				numBytesRead, fromAddress, packetReadWasIncomplete);
+  if (packetReadWasIncomplete) {
+    fNumBytesAlreadyRead += numBytesRead;
+    return; // more reads are needed to get the entire packet
+  } else { // normal case: We've read the entire packet 
+    packetSize = fNumBytesAlreadyRead + numBytesRead;
+    fNumBytesAlreadyRead = 0; // for next time
+  }
+  if (!readResult) return;
+
+  processIncomingReport(packetSize, fromAddress, tcpReadStreamSocketNum, tcpReadStreamChannelId);
+}
+
+void RTCPInstance::injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_in const& fromAddress) {
+  if (packetSize > maxRTCPPacketSize) packetSize = maxRTCPPacketSize;
+  memmove(fInBuf, packet, packetSize);
+
+  struct sockaddr_in fromAddressCopy = fromAddress;
+  processIncomingReport(packetSize, fromAddressCopy, -1, 0xFF); // assume that the packet came over UDP
+}
+
+void RTCPInstance
+::processIncomingReport(unsigned packetSize, struct sockaddr_in& fromAddress,
+			int tcpReadStreamSocketNum, unsigned char tcpReadStreamChannelId) {
   do {
     Boolean callByeHandler = False;
-    int tcpReadStreamSocketNum = fRTCPInterface.nextTCPReadStreamSocketNum();
-    unsigned char tcpReadStreamChannelId = fRTCPInterface.nextTCPReadStreamChannelId();
-    unsigned packetSize = 0;
-    unsigned numBytesRead;
-    struct sockaddr_in fromAddress;
-    Boolean packetReadWasIncomplete;
-    if (fNumBytesAlreadyRead >= maxRTCPPacketSize) {
-      envir() << "RTCPInstance error: Hit limit when reading incoming packet over TCP. Increase \"maxRTCPPacketSize\"\n";
-      break;
-    }
-    Boolean readResult
-      = fRTCPInterface.handleRead(&fInBuf[fNumBytesAlreadyRead], maxRTCPPacketSize - fNumBytesAlreadyRead,
-				  numBytesRead, fromAddress, packetReadWasIncomplete);
-    if (packetReadWasIncomplete) {
-      fNumBytesAlreadyRead += numBytesRead;
-      return; // more reads are needed to get the entire packet
-    } else { // normal case: We've read the entire packet 
-      packetSize = fNumBytesAlreadyRead + numBytesRead;
-      fNumBytesAlreadyRead = 0; // for next time
-    }
-    if (!readResult) break;
 
     // Ignore the packet if it was looped-back from ourself:
     Boolean packetWasFromOurHost = False;
@@ -442,7 +611,8 @@ void RTCPInstance::incomingReportHandler1() {
 	    RTPReceptionStatsDB& receptionStats
 	      = fSource->receptionStatsDB();
 	    receptionStats.noteIncomingSR(reportSenderSSRC,
-					  NTPmsw, NTPlsw, rtpTimestamp);
+					  NTPmsw, NTPlsw, rtpTimestamp,
+					  &envir().taskScheduler().timeNow());
 	  }
 	  ADVANCE(8); // skip over packet count, octet count
 
@@ -459,7 +629,8 @@ void RTCPInstance::incomingReportHandler1() {
 	  if (length < reportBlocksSize) break;
 	  length -= reportBlocksSize;
 
-          if (fSink != NULL) {
+	  Boolean processThisRR = pt != RTCP_PT_RR || shouldProcessIncomingRR();
+          if (fSink != NULL && processThisRR) {
 	    // Use this information to update stats about our transmissions:
             RTPTransmissionStatsDB& transmissionStats = fSink->transmissionStatsDB();
             for (unsigned i = 0; i < rc; ++i) {
@@ -511,7 +682,7 @@ void RTCPInstance::incomingReportHandler1() {
 	    }
 
 	    // General RR handler:
-	    if (fRRHandlerTask != NULL) (*fRRHandlerTask)(fRRHandlerClientData);
+	    if (fRRHandlerTask != NULL && processThisRR) (*fRRHandlerTask)(fRRHandlerClientData);
 	  }
 
 	  subPacketOK = True;
@@ -539,6 +710,32 @@ void RTCPInstance::incomingReportHandler1() {
 	  typeOfPacket = PACKET_BYE;
 	  break;
 	}
+        case RTCP_PT_RTPFB: {
+#ifdef DEBUG
+	  fprintf(stderr, "RTPFB (FMT %d)\n", rc);
+#endif
+	  if (length < 4) break;
+	  length -= 4;
+	  u_int32_t mediaSSRC = ntohl(*(u_int32_t*)pkt); ADVANCE(4);
+
+	  if (rc == RTCP_FMT_GENERIC_NACK && fSink != NULL && mediaSSRC == fSink->SSRC()) {
+	    // A request to retransmit some of our packets.  Each 'FCI' entry is a packet id (a sequence number),
+	    // followed by a bitmask of the 16 sequence numbers that follow it:
+	    while (length >= 4) {
+	      unsigned fci = ntohl(*(u_int32_t*)pkt); ADVANCE(4); length -= 4;
+	      u_int16_t pid = (u_int16_t)(fci>>16);
+	      u_int16_t blp = (u_int16_t)fci;
+
+	      fSink->retransmitPacket(pid);
+	      for (unsigned i = 0; i < 16; ++i) {
+		if ((blp&(1<<i)) != 0) fSink->retransmitPacket((u_int16_t)(pid+1+i));
+	      }
+	    }
+	  }
+
+	  subPacketOK = True;
+	  break;
+	}
 	// Later handle SDES, APP, and compound RTCP packets #####
         default:
 #ifdef DEBUG
@@ -615,10 +812,19 @@ void RTCPInstance::onReceive(int typeOfPacket, int totPacketSize,
 	    &senders, // senders
 	    &fAveRTCPSize, // avg_rtcp_size
 	    &fPrevReportTime, // tp
-	    dTimeNow(), // tc
+	    dTimeNow(envir()), // tc
 	    fNextReportTime);
 }
 
+Boolean RTCPInstance::shouldProcessIncomingRR() {
+  if (++fNumRRsSinceLastProcessed < fRRSamplingInterval) return False;
+  if (fMaxNumRRsPerReportInterval > 0 && fNumRRsProcessedThisInterval >= fMaxNumRRsPerReportInterval) return False;
+
+  fNumRRsSinceLastProcessed = 0;
+  ++fNumRRsProcessedThisInterval;
+  return True;
+}
+
 void RTCPInstance::sendReport() {
 #ifdef DEBUG
   fprintf(stderr, "sending REPORT\n");
@@ -632,6 +838,8 @@ void RTCPInstance::sendReport() {
   // Send the report:
   sendBuiltPacket();
 
+  fNumRRsProcessedThisInterval = 0;
+
   // Periodically clean out old members from our SSRC membership database:
   const unsigned membershipReapPeriod = 5;
   if ((++fOutgoingReportCount) % membershipReapPeriod == 0) {
@@ -651,6 +859,22 @@ void RTCPInstance::sendBYE() {
   sendBuiltPacket();
 }
 
+void RTCPInstance::sendNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums) {
+  if (fSource == NULL || numSeqNums == 0) return;
+#ifdef DEBUG
+  fprintf(stderr, "sending NACK for %d packets\n", numSeqNums);
+#endif
+  // RFC 4585 requires that feedback be sent within a compound RTCP packet, beginning with a report.
+  // We use a "RR" with no report blocks, so that we don't disturb the reception statistics for our regular reports:
+  fOutBuf->enqueueWord(0x80000000 | (RTCP_PT_RR<<16) | 1); // version 2, no padding, no report blocks, 2 words long
+  fOutBuf->enqueueWord(fSource->SSRC());
+
+  addSDES();
+  addNACK(mediaSSRC, seqNums, numSeqNums);
+
+  sendBuiltPacket();
+}
+
 void RTCPInstance::sendBuiltPacket() {
 #ifdef DEBUG
   fprintf(stderr, "sending RTCP packet\n");
@@ -724,8 +948,7 @@ void RTCPInstance::addSR() {
   // Now, add the 'sender info' for our sink
 
   // Insert the NTP and RTP timestamps for the 'wallclock time':
-  struct timeval timeNow;
-  gettimeofday(&timeNow, NULL);
+  struct timeval timeNow = envir().taskScheduler().refreshTimeNow(); // we want a precise time here
   fOutBuf->enqueueWord(timeNow.tv_sec + 0x83AA7E80);
       // NTP timestamp most-significant word (1970 epoch -> 1900 epoch)
   double fractionalPart = (timeNow.tv_usec/15625.0)*0x04000000; // 2^32/10^6
@@ -831,8 +1054,8 @@ RTCPInstance::enqueueReportBlock(RTPReceptionStats* stats) {
 
   // Figure out how long has elapsed since the last SR rcvd from this src:
   struct timeval const& LSRtime = stats->lastReceivedSR_time(); // "last SR"
-  struct timeval timeNow, timeSinceLSR;
-  gettimeofday(&timeNow, NULL);
+  struct timeval timeNow = envir().taskScheduler().timeNow();
+  struct timeval timeSinceLSR;
   if (timeNow.tv_usec < LSRtime.tv_usec) {
     timeNow.tv_usec += 1000000;
     timeNow.tv_sec -= 1;
@@ -895,10 +1118,47 @@ void RTCPInstance::addBYE() {
   }
 }
 
+void RTCPInstance::addNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums) {
+  // ASSERT: fSource != NULL
+  // Figure out how many 'FCI' entries we have room for:
+  unsigned const headerSize = 12; // includes the sender and media source SSRCs
+  if (fOutBuf->curPacketSize() + headerSize + 4 > maxRTCPPacketSize) return;
+  unsigned const maxNumFCIs = (maxRTCPPacketSize - fOutBuf->curPacketSize() - headerSize)/4;
+
+  // Leave room for the header; we fill it in once we know how many 'FCI' entries there are:
+  unsigned headerPosition = fOutBuf->curPacketSize();
+  fOutBuf->skipBytes(headerSize);
+
+  unsigned numFCIs = 0;
+  unsigned i = 0;
+  while (i < numSeqNums && numFCIs < maxNumFCIs) {
+    // Each 'FCI' entry covers a sequence number (the 'PID'), plus a bitmask (the 'BLP') of the 16 sequence numbers after it:
+    u_int16_t pid = seqNums[i++];
+    u_int16_t blp = 0;
+    while (i < numSeqNums) {
+      u_int16_t diff = seqNums[i] - pid;
+      if (diff == 0) { ++i; continue; } // a duplicate
+      if (diff > 16) break;
+      blp |= 1<<(diff-1);
+      ++i;
+    }
+    fOutBuf->enqueueWord((pid<<16) | blp);
+    ++numFCIs;
+  }
+
+  unsigned rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= (RTCP_FMT_GENERIC_NACK<<24);
+  rtcpHdr |= (RTCP_PT_RTPFB<<16);
+  rtcpHdr |= (2 + numFCIs); // the length (in 32-bit words), not counting the first word
+  fOutBuf->insertWord(rtcpHdr, headerPosition);
+  fOutBuf->insertWord(fSource->SSRC(), headerPosition + 4);
+  fOutBuf->insertWord(mediaSSRC, headerPosition + 8);
+}
+
 void RTCPInstance::schedule(double nextTime) {
   fNextReportTime = nextTime;
 
-  double secondsToDelay = nextTime - dTimeNow();
+  double secondsToDelay = nextTime - dTimeNow(envir());
   if (secondsToDelay < 0) secondsToDelay = 0;
 #ifdef DEBUG
   fprintf(stderr, "schedule(%f->%f)\n", secondsToDelay, nextTime);
@@ -924,7 +1184,7 @@ void RTCPInstance::onExpire1() {
 	   (fSink != NULL) ? 1 : 0, // we_sent
 	   &fAveRTCPSize, // ave_rtcp_size
 	   &fIsInitial, // initial
-	   dTimeNow(), // tc
+	   dTimeNow(envir()), // tc
 	   &fPrevReportTime, // tp
 	   &fPrevNumMembers // pmembers
 	   );
@@ -0,0 +1,457 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A cache of pre-packetized RTP packets (payloads, plus timing) for a single media track.
+// (This is similar in idea to a QuickTime 'hint track'.)  The cache can be kept in memory, and also
+// written to (and later read from) a 'hint cache file'.  Also, a source and a "RTPSink" that stream from the cache.
+// Implementation
+
+#include "RTPHintCache.hh"
+#include "InputFile.hh"
+#include "OutputFile.hh"
+#include "GroupsockHelper.hh"
+
+// A 'hint cache file' consists of a header:
+//	"RTPH" (4 bytes); RTP timestamp frequency (4 bytes); number of channels (4 bytes); estimated bitrate, in kbps (4 bytes);
+//	duration, in microseconds (8 bytes); number of packets (4 bytes); size of the packet records (4 bytes);
+//	size of the source file (8 bytes); modification time of the source file (low 32 bits) (4 bytes),
+// followed by three strings - each a 2-byte length, then the string's bytes - for the SDP media type, the RTP payload
+// format name, and the 'aux SDP line' (length 0 if none), followed by the packet records.
+// Each packet record (the same format that we use in memory) is:
+//	send time, in microseconds (8 bytes); RTP timestamp offset (4 bytes); flags (1 byte; 0x80 means 'marker bit');
+//	reserved (1 byte); payload size (2 bytes); payload.
+// All numbers are big-endian.  (The source file's size and modification time are 0 if the cache was written without
+// a source file name.)
+
+#define HINT_CACHE_FILE_HEADER_SIZE 44
+#define HINT_RECORD_HEADER_SIZE 16
+
+static void putBigEndian(u_int8_t* to, u_int64_t value, unsigned numBytes) {
+  while (numBytes-- > 0) {
+    to[numBytes] = (u_int8_t)value;
+    value >>= 8;
+  }
+}
+
+static u_int64_t getBigEndian(u_int8_t const* from, unsigned numBytes) {
+  u_int64_t result = 0;
+  for (unsigned i = 0; i < numBytes; ++i) result = (result<<8)|from[i];
+  return result;
+}
+
+
+////////// RTPHintCache implementation //////////
+
+RTPHintCache* RTPHintCache
+::createNew(UsageEnvironment& env, FramedSource* inputSource, MultiFramedRTPSink* rtpSink) {
+  if (inputSource == NULL || rtpSink == NULL) return NULL;
+
+  RTPHintCache* hintCache = new RTPHintCache(env);
+
+  // Play "inputSource" through "rtpSink" - without pacing - recording each packet that gets sent:
+  hintCache->fPacketizingSink = rtpSink;
+  rtpSink->paceOutgoingPackets() = False;
+  rtpSink->addAfterSendingPacketHandler(afterSendingPacket, hintCache);
+  if (rtpSink->startPlaying(*inputSource, afterPacketizing, hintCache)) {
+    env.taskScheduler().doEventLoop(&hintCache->fDoneFlag);
+  }
+  rtpSink->removeAfterSendingPacketHandler(afterSendingPacket, hintCache);
+  rtpSink->paceOutgoingPackets() = True;
+  hintCache->fPacketizingSink = NULL;
+
+  if (!hintCache->indexPackets()) {
+    Medium::close(hintCache);
+    return NULL;
+  }
+
+  // Remember the sink's parameters.  (Note that we ask for the sink's 'aux SDP line' only now, because the sink - or its
+  // source - might not know it until it has seen some of the stream - e.g., the SPS and PPS NAL units of a H.264 stream.)
+  hintCache->fSDPMediaType = strDup(rtpSink->sdpMediaType());
+  hintCache->fRTPPayloadFormatName = strDup(rtpSink->rtpPayloadFormatName());
+  hintCache->fAuxSDPLine = strDup(rtpSink->auxSDPLine());
+  hintCache->fRTPTimestampFrequency = rtpSink->rtpTimestampFrequency();
+  hintCache->fNumChannels = rtpSink->numChannels();
+
+  struct timeval const& endTime = rtpSink->nextSendTime();
+  hintCache->fDuration = endTime.tv_sec*(u_int64_t)1000000 + endTime.tv_usec;
+  if (hintCache->fDuration > 0) {
+    u_int64_t numPayloadBytes = hintCache->fDataSize - hintCache->fNumPackets*HINT_RECORD_HEADER_SIZE;
+    hintCache->fEstBitrate = (unsigned)((numPayloadBytes*8*1000)/hintCache->fDuration);
+  }
+  if (hintCache->fEstBitrate == 0) hintCache->fEstBitrate = 500; // kbps, estimate
+
+  return hintCache;
+}
+
+RTPHintCache* RTPHintCache
+::createNew(UsageEnvironment& env, char const* hintCacheFileName, char const* sourceFileName) {
+  RTPHintCache* hintCache = new RTPHintCache(env);
+  if (!hintCache->readFromFile(hintCacheFileName, sourceFileName)) {
+    Medium::close(hintCache);
+    return NULL;
+  }
+
+  return hintCache;
+}
+
+RTPHintCache::RTPHintCache(UsageEnvironment& env)
+  : Medium(env),
+    fSDPMediaType(NULL), fRTPPayloadFormatName(NULL), fAuxSDPLine(NULL),
+    fRTPTimestampFrequency(0), fNumChannels(1), fEstBitrate(0), fDuration(0),
+    fData(NULL), fDataSize(0), fDataBufferSize(0), fPacketOffsets(NULL), fNumPackets(0), fMaxPayloadSize(0),
+    fPacketizingSink(NULL), fNextPacketSendTime(0), fFirstRTPTimestamp(0), fDoneFlag(0) {
+}
+
+RTPHintCache::~RTPHintCache() {
+  delete[] fSDPMediaType; delete[] fRTPPayloadFormatName; delete[] fAuxSDPLine;
+  delete[] fData; delete[] fPacketOffsets;
+}
+
+Boolean RTPHintCache::writeToFile(char const* hintCacheFileName, char const* sourceFileName) const {
+  FILE* fid = OpenOutputFile(envir(), hintCacheFileName);
+  if (fid == NULL) return False;
+
+  u_int8_t header[HINT_CACHE_FILE_HEADER_SIZE];
+  memcpy(header, "RTPH", 4);
+  putBigEndian(&header[4], fRTPTimestampFrequency, 4);
+  putBigEndian(&header[8], fNumChannels, 4);
+  putBigEndian(&header[12], fEstBitrate, 4);
+  putBigEndian(&header[16], fDuration, 8);
+  putBigEndian(&header[24], fNumPackets, 4);
+  putBigEndian(&header[28], fDataSize, 4);
+  putBigEndian(&header[32], sourceFileName == NULL ? 0 : GetFileSize(sourceFileName, NULL), 8);
+  putBigEndian(&header[40], (u_int32_t)GetFileModificationTime(sourceFileName), 4);
+  Boolean result = fwrite(header, HINT_CACHE_FILE_HEADER_SIZE, 1, fid) == 1;
+
+  char const* strings[3] = { fSDPMediaType, fRTPPayloadFormatName, fAuxSDPLine };
+  for (unsigned i = 0; i < 3 && result; ++i) {
+    unsigned length = strings[i] == NULL ? 0 : strlen(strings[i]);
+    if (length > 0xFFFF) length = 0xFFFF;
+    u_int8_t lengthBytes[2];
+    putBigEndian(lengthBytes, length, 2);
+    result = fwrite(lengthBytes, 2, 1, fid) == 1 && (length == 0 || fwrite(strings[i], length, 1, fid) == 1);
+  }
+
+  if (result) result = fwrite(fData, 1, fDataSize, fid) == fDataSize;
+  CloseOutputFile(fid);
+
+  if (!result) remove(hintCacheFileName); // don't leave a partially-written file behind
+  return result;
+}
+
+u_int8_t const* RTPHintCache::payload(unsigned packetNum, unsigned& payloadSize) const {
+  u_int8_t const* record = &fData[fPacketOffsets[packetNum]];
+  payloadSize = (unsigned)getBigEndian(&record[14], 2);
+  return &record[HINT_RECORD_HEADER_SIZE];
+}
+
+u_int64_t RTPHintCache::sendTime(unsigned packetNum) const {
+  return getBigEndian(&fData[fPacketOffsets[packetNum]], 8);
+}
+
+u_int32_t RTPHintCache::rtpTimestampOffset(unsigned packetNum) const {
+  return (u_int32_t)getBigEndian(&fData[fPacketOffsets[packetNum] + 8], 4);
+}
+
+Boolean RTPHintCache::markerBit(unsigned packetNum) const {
+  return (fData[fPacketOffsets[packetNum] + 12]&0x80) != 0;
+}
+
+unsigned RTPHintCache::lookupPacketNum(double npt) const {
+  if (npt <= 0.0) return 0;
+  u_int64_t targetTime = (u_int64_t)(npt*1000000.0);
+
+  // Do a binary search for the first packet whose send time is >= "targetTime":
+  unsigned lo = 0, hi = fNumPackets;
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo)/2;
+    if (sendTime(mid) < targetTime) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+void RTPHintCache::addPacket(unsigned char const* packet, unsigned packetSize) {
+  // Parse the RTP header, to find the packet's payload:
+  if (packetSize < 12) return;
+  u_int8_t const firstByte = packet[0];
+  unsigned headerSize = 12 + 4*(firstByte&0x0F); // allow for any CSRC identifiers
+  if ((firstByte&0x10) != 0 && packetSize >= headerSize + 4) { // there's a RTP header extension
+    headerSize += 4 + 4*(unsigned)getBigEndian(&packet[headerSize+2], 2);
+  }
+  unsigned payloadSize = packetSize;
+  if ((firstByte&0x20) != 0) payloadSize -= packet[packetSize-1]; // remove any padding
+  if (payloadSize < headerSize || payloadSize - headerSize > 0xFFFF) return; // sanity check
+  payloadSize -= headerSize;
+
+  u_int32_t rtpTimestamp = (u_int32_t)getBigEndian(&packet[4], 4);
+  if (fNumPackets == 0) fFirstRTPTimestamp = rtpTimestamp;
+
+  // Make sure that "fData" has room for the new record:
+  unsigned recordSize = HINT_RECORD_HEADER_SIZE + payloadSize;
+  if (fDataSize + recordSize > fDataBufferSize) {
+    unsigned newBufferSize = fDataBufferSize == 0 ? 100000 : 2*fDataBufferSize;
+    if (newBufferSize < fDataSize + recordSize) newBufferSize = fDataSize + recordSize;
+    u_int8_t* newData = new u_int8_t[newBufferSize];
+    if (fData != NULL) memmove(newData, fData, fDataSize);
+    delete[] fData; fData = newData;
+    fDataBufferSize = newBufferSize;
+  }
+
+  u_int8_t* record = &fData[fDataSize];
+  putBigEndian(&record[0], fNextPacketSendTime, 8);
+  putBigEndian(&record[8], rtpTimestamp - fFirstRTPTimestamp, 4);
+  record[12] = packet[1]&0x80; // the 'marker' bit
+  record[13] = 0; // reserved
+  putBigEndian(&record[14], payloadSize, 2);
+  memmove(&record[HINT_RECORD_HEADER_SIZE], &packet[headerSize], payloadSize);
+  fDataSize += recordSize;
+  ++fNumPackets;
+}
+
+Boolean RTPHintCache::indexPackets() {
+  delete[] fPacketOffsets; fPacketOffsets = NULL;
+  // Each packet has at least a record header, so (for a cache read from a file) reject any impossible packet count
+  // before allocating for it:
+  if (fNumPackets == 0 || fNumPackets > fDataSize/HINT_RECORD_HEADER_SIZE) return False;
+
+  fPacketOffsets = new unsigned[fNumPackets];
+  fMaxPayloadSize = 0;
+  unsigned offset = 0;
+  for (unsigned i = 0; i < fNumPackets; ++i) {
+    if (offset + HINT_RECORD_HEADER_SIZE > fDataSize) return False;
+    unsigned payloadSize = (unsigned)getBigEndian(&fData[offset+14], 2);
+    if (offset + HINT_RECORD_HEADER_SIZE + payloadSize > fDataSize) return False;
+
+    fPacketOffsets[i] = offset;
+    if (payloadSize > fMaxPayloadSize) fMaxPayloadSize = payloadSize;
+    offset += HINT_RECORD_HEADER_SIZE + payloadSize;
+  }
+
+  return offset == fDataSize;
+}
+
+Boolean RTPHintCache::readFromFile(char const* hintCacheFileName, char const* sourceFileName) {
+  FILE* fid = OpenInputFile(envir(), hintCacheFileName);
+  if (fid == NULL) return False;
+
+  Boolean result = False;
+  do {
+    u_int8_t header[HINT_CACHE_FILE_HEADER_SIZE];
+    if (fread(header, HINT_CACHE_FILE_HEADER_SIZE, 1, fid) != 1 || strncmp((char const*)header, "RTPH", 4) != 0) break;
+    fRTPTimestampFrequency = (unsigned)getBigEndian(&header[4], 4);
+    fNumChannels = (unsigned)getBigEndian(&header[8], 4);
+    fEstBitrate = (unsigned)getBigEndian(&header[12], 4);
+    fDuration = getBigEndian(&header[16], 8);
+    fNumPackets = (unsigned)getBigEndian(&header[24], 4);
+    fDataSize = (unsigned)getBigEndian(&header[28], 4);
+    if (fRTPTimestampFrequency == 0) break;
+
+    // If we were given a source file, then check that the cache was made from a file of the same size and modification
+    // time.  (If not, the caller rebuilds the cache.)
+    if (sourceFileName != NULL
+	&& (getBigEndian(&header[32], 8) != GetFileSize(sourceFileName, NULL)
+	    || getBigEndian(&header[40], 4) != (u_int32_t)GetFileModificationTime(sourceFileName))) break;
+
+    char* strings[3] = { NULL, NULL, NULL };
+    unsigned i;
+    for (i = 0; i < 3; ++i) {
+      u_int8_t lengthBytes[2];
+      if (fread(lengthBytes, 2, 1, fid) != 1) break;
+      unsigned length = (unsigned)getBigEndian(lengthBytes, 2);
+      if (length == 0) continue;
+
+      strings[i] = new char[length+1];
+      if (fread(strings[i], length, 1, fid) != 1) break;
+      strings[i][length] = '\0';
+    }
+    fSDPMediaType = strings[0]; fRTPPayloadFormatName = strings[1]; fAuxSDPLine = strings[2];
+    if (i < 3 || fSDPMediaType == NULL || fRTPPayloadFormatName == NULL) break;
+
+    // Read the packet records.  (Sanity check the record size against the file size first.)
+    if (fDataSize == 0 || fDataSize > GetFileSize(hintCacheFileName, fid)) break;
+    fData = new u_int8_t[fDataSize];
+    fDataBufferSize = fDataSize;
+    if (fread(fData, 1, fDataSize, fid) != fDataSize) break;
+
+    result = indexPackets();
+  } while (0);
+
+  CloseInputFile(fid);
+  return result;
+}
+
+void RTPHintCache::afterSendingPacket(void* clientData, unsigned char const* packet, unsigned packetSize) {
+  RTPHintCache* hintCache = (RTPHintCache*)clientData;
+  hintCache->addPacket(packet, packetSize);
+
+  // The sink has already accounted for the frame(s) in this packet, so its 'next send time' is the time at which the
+  // next packet is due:
+  struct timeval const& nextSendTime = hintCache->fPacketizingSink->nextSendTime();
+  hintCache->fNextPacketSendTime = nextSendTime.tv_sec*(u_int64_t)1000000 + nextSendTime.tv_usec;
+}
+
+void RTPHintCache::afterPacketizing(void* clientData) {
+  RTPHintCache* hintCache = (RTPHintCache*)clientData;
+  hintCache->fDoneFlag = ~0;
+}
+
+
+////////// RTPHintCacheSource implementation //////////
+
+RTPHintCacheSource* RTPHintCacheSource::createNew(UsageEnvironment& env, RTPHintCache& hintCache) {
+  return new RTPHintCacheSource(env, hintCache);
+}
+
+RTPHintCacheSource::RTPHintCacheSource(UsageEnvironment& env, RTPHintCache& hintCache)
+  : FramedSource(env), fHintCache(hintCache),
+    fNextPacketNum(0), fLimitPacketNum(hintCache.numPackets()), fHaveStartedDelivery(False),
+    fFirstRTPTimestampOffset(0), fCurPacketMarkerBit(False) {
+}
+
+RTPHintCacheSource::~RTPHintCacheSource() {
+}
+
+void RTPHintCacheSource::seekToTime(double& seekNPT, double streamDuration, u_int64_t& numBytes) {
+  fNextPacketNum = fHintCache.lookupPacketNum(seekNPT);
+  if (fNextPacketNum < fHintCache.numPackets()) seekNPT = fHintCache.sendTime(fNextPacketNum)/1000000.0;
+
+  fLimitPacketNum = streamDuration > 0.0 ? fHintCache.lookupPacketNum(seekNPT + streamDuration) : fHintCache.numPackets();
+
+  numBytes = 0;
+  for (unsigned i = fNextPacketNum; i < fLimitPacketNum; ++i) {
+    unsigned payloadSize;
+    (void)fHintCache.payload(i, payloadSize);
+    numBytes += payloadSize;
+  }
+
+  fHaveStartedDelivery = False;
+}
+
+void RTPHintCacheSource::doGetNextFrame() {
+  if (fNextPacketNum >= fLimitPacketNum) {
+    handleClosure(this);
+    return;
+  }
+
+  unsigned const packetNum = fNextPacketNum++;
+  unsigned payloadSize;
+  u_int8_t const* payload = fHintCache.payload(packetNum, payloadSize);
+  if (payloadSize > fMaxSize) {
+    fNumTruncatedBytes = payloadSize - fMaxSize;
+    fFrameSize = fMaxSize;
+  } else {
+    fNumTruncatedBytes = 0;
+    fFrameSize = payloadSize;
+  }
+  memmove(fTo, payload, fFrameSize);
+  fCurPacketMarkerBit = fHintCache.markerBit(packetNum);
+
+  // Compute a presentation time from the packet's RTP timestamp offset.  We measure this relative to the first packet
+  // that we deliver (after creation or a seek), from a base time that's a whole number of seconds, so that the
+  // "RTPSink"s conversion back to a RTP timestamp is exact:
+  u_int32_t rtpTimestampOffset = fHintCache.rtpTimestampOffset(packetNum);
+  if (!fHaveStartedDelivery) {
+    gettimeofday(&fPresentationTimeBase, NULL);
+    fPresentationTimeBase.tv_usec = 0;
+    fFirstRTPTimestampOffset = rtpTimestampOffset;
+    fHaveStartedDelivery = True;
+  }
+  int64_t uSecondsFromBase
+    = ((int64_t)(int32_t)(rtpTimestampOffset - fFirstRTPTimestampOffset)*1000000)/(int64_t)fHintCache.rtpTimestampFrequency();
+  int64_t presentationTimeUSeconds = fPresentationTimeBase.tv_sec*(int64_t)1000000 + uSecondsFromBase;
+  fPresentationTime.tv_sec = (long)(presentationTimeUSeconds/1000000);
+  fPresentationTime.tv_usec = (long)(presentationTimeUSeconds%1000000);
+
+  // Our duration is the time until the next packet is due:
+  u_int64_t thisSendTime = fHintCache.sendTime(packetNum);
+  u_int64_t nextSendTime = packetNum + 1 < fHintCache.numPackets()
+    ? fHintCache.sendTime(packetNum + 1) : (u_int64_t)(fHintCache.duration()*1000000.0);
+  fDurationInMicroseconds = nextSendTime > thisSendTime ? (unsigned)(nextSendTime - thisSendTime) : 0;
+
+  // Deliver the data immediately.  (Our "RTPSink" returns to the event loop after sending each packet.)
+  FramedSource::afterGetting(this);
+}
+
+
+////////// RTPHintCacheRTPSink implementation //////////
+
+RTPHintCacheRTPSink* RTPHintCacheRTPSink
+::createNew(UsageEnvironment& env, Groupsock* RTPgs,
+	    unsigned char rtpPayloadFormat, RTPHintCache& hintCache) {
+  return new RTPHintCacheRTPSink(env, RTPgs, rtpPayloadFormat, hintCache);
+}
+
+RTPHintCacheRTPSink
+::RTPHintCacheRTPSink(UsageEnvironment& env, Groupsock* RTPgs,
+		      unsigned char rtpPayloadFormat, RTPHintCache& hintCache)
+  : MultiFramedRTPSink(env, RTPgs, rtpPayloadFormat, hintCache.rtpTimestampFrequency(),
+		       hintCache.rtpPayloadFormatName(), hintCache.numChannels()),
+    fHintCache(hintCache), fAuxSDPLine(NULL) {
+  // Make sure that our packets are large enough for each cached payload:
+  unsigned const maxPacketSize = 12/*RTP header*/ + hintCache.maxPayloadSize();
+  if (maxPacketSize > ourMaxPacketSize()) setPacketSizes(maxPacketSize, maxPacketSize);
+}
+
+RTPHintCacheRTPSink::~RTPHintCacheRTPSink() {
+  delete[] fAuxSDPLine;
+}
+
+char const* RTPHintCacheRTPSink::sdpMediaType() const {
+  return fHintCache.sdpMediaType();
+}
+
+char const* RTPHintCacheRTPSink::auxSDPLine() {
+  if (fAuxSDPLine != NULL) return fAuxSDPLine;
+  char const* cachedLine = fHintCache.auxSDPLine();
+  if (cachedLine == NULL) return NULL;
+
+  // The cached line's "a=fmtp:" lines name the payload type that was used when the stream was packetized,
+  // so replace this with our own payload type:
+  fAuxSDPLine = new char[2*strlen(cachedLine) + 1]; // more than enough, because a payload type has at most 3 digits
+  char* to = fAuxSDPLine;
+  for (char const* from = cachedLine; *from != '\0'; ) {
+    if ((from == cachedLine || from[-1] == '\n') && strncmp(from, "a=fmtp:", 7) == 0) {
+      to += sprintf(to, "a=fmtp:%d", rtpPayloadType());
+      for (from += 7; *from >= '0' && *from <= '9'; ++from) {}
+    } else {
+      *to++ = *from++;
+    }
+  }
+  *to = '\0';
+
+  return fAuxSDPLine;
+}
+
+void RTPHintCacheRTPSink
+::doSpecialFrameHandling(unsigned fragmentationOffset,
+			 unsigned char* frameStart,
+			 unsigned numBytesInFrame,
+			 struct timeval framePresentationTime,
+			 unsigned numRemainingBytes) {
+  // Our source is a "RTPHintCacheSource"; use its packet's 'marker' bit:
+  if (((RTPHintCacheSource*)fSource)->curPacketMarkerBit()) setMarkerBit();
+
+  // Also set the RTP timestamp:
+  MultiFramedRTPSink::doSpecialFrameHandling(fragmentationOffset, frameStart, numBytesInFrame,
+					     framePresentationTime, numRemainingBytes);
+}
+
+Boolean RTPHintCacheRTPSink
+::frameCanAppearAfterPacketStart(unsigned char const* /*frameStart*/,
+				 unsigned /*numBytesInFrame*/) const {
+  return False; // each frame (a cached payload) gets a packet of its own
+}
@@ -0,0 +1,118 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that creates new, unicast, "RTPSink"s
+// on demand, that stream pre-packetized RTP packets from a "RTPHintCache".
+// Implementation
+
+#include "RTPHintCacheServerMediaSubsession.hh"
+#include "MultiFramedRTPSink.hh"
+
+RTPHintCacheServerMediaSubsession*
+RTPHintCacheServerMediaSubsession::createNew(UsageEnvironment& env, OnDemandServerMediaSubsession* packetizingSubsession,
+					     char const* hintCacheFileName, Boolean reuseFirstSource, char const* sourceFileName) {
+  RTPHintCacheServerMediaSubsession* subsession
+    = new RTPHintCacheServerMediaSubsession(env, packetizingSubsession, hintCacheFileName, reuseFirstSource,
+					    sourceFileName);
+
+  // Set up our cache now - rather than when our SDP description is first needed - because packetizing the stream runs
+  // the event loop until it's done, and (if we're called before the server starts) no client has to wait for this.
+  // (If this fails, we try again later, for each new stream.)
+  subsession->setUpHintCache();
+  return subsession;
+}
+
+RTPHintCacheServerMediaSubsession
+::RTPHintCacheServerMediaSubsession(UsageEnvironment& env, OnDemandServerMediaSubsession* packetizingSubsession,
+				    char const* hintCacheFileName, Boolean reuseFirstSource, char const* sourceFileName)
+  : OnDemandServerMediaSubsession(env, reuseFirstSource),
+    fPacketizingSubsession(packetizingSubsession),
+    fHintCacheFileName(strDup(hintCacheFileName)), fSourceFileName(strDup(sourceFileName)),
+    fHintCache(NULL), fIsSettingUpHintCache(False) {
+}
+
+RTPHintCacheServerMediaSubsession::~RTPHintCacheServerMediaSubsession() {
+  Medium::close(fHintCache);
+  Medium::close(fPacketizingSubsession);
+  delete[] fHintCacheFileName; delete[] fSourceFileName;
+}
+
+Boolean RTPHintCacheServerMediaSubsession::setUpHintCache() {
+  if (fHintCache != NULL) return True;
+  if (fIsSettingUpHintCache) return False; // we were called (e.g., for another client's "DESCRIBE") while packetizing
+
+  // First, try to read an existing (up-to-date) 'hint cache file':
+  if (fHintCacheFileName != NULL) {
+    fHintCache = RTPHintCache::createNew(envir(), fHintCacheFileName, fSourceFileName);
+    if (fHintCache != NULL) return True;
+  }
+
+  // Otherwise, packetize the stream, using a source and a "RTPSink" from our 'packetizing subsession'.
+  // (This is done in the same way as "OnDemandServerMediaSubsession::sdpLines()" creates its dummy objects.)
+  if (fPacketizingSubsession == NULL) return False;
+
+  unsigned estBitrate;
+  FramedSource* inputSource = fPacketizingSubsession->createNewStreamSource(0, estBitrate);
+  if (inputSource == NULL) return False; // file not found
+
+  struct in_addr dummyAddr;
+  dummyAddr.s_addr = 0;
+  Groupsock dummyGroupsock(envir(), dummyAddr, 0, 0);
+  dummyGroupsock.removeAllDestinations(); // we don't actually send any packets
+  unsigned char rtpPayloadType = 96; // (we don't yet have a track number, but the cache doesn't record the payload type)
+  RTPSink* rtpSink = fPacketizingSubsession->createNewRTPSink(&dummyGroupsock, rtpPayloadType, inputSource);
+
+  // Note: Every packetizing "RTPSink" is a "MultiFramedRTPSink":
+  fIsSettingUpHintCache = True;
+  fHintCache = RTPHintCache::createNew(envir(), inputSource, (MultiFramedRTPSink*)rtpSink);
+  fIsSettingUpHintCache = False;
+  Medium::close(rtpSink);
+  fPacketizingSubsession->closeStreamSource(inputSource);
+  if (fHintCache == NULL) return False;
+
+  if (fHintCacheFileName != NULL && !fHintCache->writeToFile(fHintCacheFileName, fSourceFileName)) {
+    envir() << "RTPHintCacheServerMediaSubsession: Failed to write the hint cache file \"" << fHintCacheFileName << "\"\n";
+  }
+
+  // We no longer need our 'packetizing subsession':
+  Medium::close(fPacketizingSubsession); fPacketizingSubsession = NULL;
+  return True;
+}
+
+float RTPHintCacheServerMediaSubsession::duration() const {
+  return fHintCache == NULL ? 0.0 : (float)fHintCache->duration();
+}
+
+void RTPHintCacheServerMediaSubsession
+::seekStreamSource(FramedSource* inputSource, double& seekNPT, double streamDuration, u_int64_t& numBytes) {
+  ((RTPHintCacheSource*)inputSource)->seekToTime(seekNPT, streamDuration, numBytes);
+}
+
+FramedSource* RTPHintCacheServerMediaSubsession
+::createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+  if (!setUpHintCache()) return NULL;
+
+  estBitrate = fHintCache->estBitrate();
+  return RTPHintCacheSource::createNew(envir(), *fHintCache);
+}
+
+RTPSink* RTPHintCacheServerMediaSubsession
+::createNewRTPSink(Groupsock* rtpGroupsock,
+		   unsigned char rtpPayloadTypeIfDynamic,
+		   FramedSource* /*inputSource*/) {
+  return RTPHintCacheRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic, *fHintCache);
+}
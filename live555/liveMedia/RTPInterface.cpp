@@ -111,6 +111,96 @@ static void removeSocketDescription(UsageEnvironment& env, int sockNum) {
   }
 }
 
+// Reading from a datagram socket that's shared by several "RTPInterface"s (because their 'groupsocks' were
+// created using the "Groupsock" constructor that takes a "socketToShare" parameter) is done by a
+// "SharedSocketDescriptor".  This reads each incoming packet itself, and then hands it to the "RTPInterface"
+// whose 'groupsock' has the packet's source as a destination - or, failing that, to the "RTPInterface" that
+// most recently received a packet with the same SSRC.
+
+static HashTable* sharedSocketHashTable(UsageEnvironment& env, Boolean createIfNotPresent = True) {
+  _Tables* ourTables = _Tables::getOurTables(env, createIfNotPresent);
+  if (ourTables == NULL) return NULL;
+
+  if (ourTables->sharedSocketTable == NULL) {
+    // Create a new socket number -> SharedSocketDescriptor mapping table:
+    ourTables->sharedSocketTable = HashTable::create(ONE_WORD_HASH_KEYS);
+  }
+  return (HashTable*)(ourTables->sharedSocketTable);
+}
+
+class SharedSocketDescriptor {
+public:
+  SharedSocketDescriptor(UsageEnvironment& env, int socketNum);
+  virtual ~SharedSocketDescriptor();
+
+  void registerRTPInterface(RTPInterface* rtpInterface);
+  void deregisterRTPInterface(RTPInterface* rtpInterface);
+  void noteSentPacket(RTPInterface* rtpInterface, unsigned char const* packet, unsigned packetSize);
+
+  // The most recently-read packet:
+  unsigned char const* packet() const { return fPacket; }
+  unsigned packetSize() const { return fPacketSize; }
+  struct sockaddr_in const& fromAddress() const { return fFromAddress; }
+
+private:
+  static void udpReadHandler(SharedSocketDescriptor*, int mask);
+  void udpReadHandler1(int mask);
+  RTPInterface* lookupRTPInterface();
+  RTPInterface* lookupRTPInterfaceFromRTCP(); // used if the packet's source (and sender SSRC) are unknown
+  Boolean sourceIsKnownToBeUnknown(unsigned const* sourceKey);
+  void noteUnknownSource(unsigned const* sourceKey);
+  static u_int32_t getSSRC(unsigned char const* packet, unsigned packetSize); // 0 if none
+  static void removeEntriesFor(HashTable* table, RTPInterface* rtpInterface);
+
+private:
+  UsageEnvironment& fEnv;
+  int fOurSocketNum;
+  HashTable* fRTPInterfaces; // the "RTPInterface"s that are reading from us
+  HashTable* fRTPInterfaceBySource; // (source address, port) -> "RTPInterface" (a cache of earlier lookups)
+  HashTable* fUnknownSources; // (source address, port) -> the time (in seconds) until which we don't look it up again
+  HashTable* fRTPInterfaceBySSRC;
+  unsigned char* fPacket;
+  unsigned fPacketSize;
+  struct sockaddr_in fFromAddress;
+  Boolean fDeleteMyselfNext, fAreInReadHandler;
+};
+
+static SharedSocketDescriptor* lookupSharedSocketDescriptor(UsageEnvironment& env, int sockNum, Boolean createIfNotFound = True) {
+  HashTable* table = sharedSocketHashTable(env, createIfNotFound);
+  if (table == NULL) return NULL;
+
+  char const* key = (char const*)(long)sockNum;
+  SharedSocketDescriptor* socketDescriptor = (SharedSocketDescriptor*)(table->Lookup(key));
+  if (socketDescriptor == NULL) {
+    if (createIfNotFound) {
+      socketDescriptor = new SharedSocketDescriptor(env, sockNum);
+      table->Add((char const*)(long)(sockNum), socketDescriptor);
+    } else if (table->IsEmpty()) {
+      // We can also delete the table (to reclaim space):
+      _Tables* ourTables = _Tables::getOurTables(env);
+      delete table;
+      ourTables->sharedSocketTable = NULL;
+      ourTables->reclaimIfPossible();
+    }
+  }
+
+  return socketDescriptor;
+}
+
+static void removeSharedSocketDescription(UsageEnvironment& env, int sockNum) {
+  char const* key = (char const*)(long)sockNum;
+  HashTable* table = sharedSocketHashTable(env);
+  table->Remove(key);
+
+  if (table->IsEmpty()) {
+    // We can also delete the table (to reclaim space):
+    _Tables* ourTables = _Tables::getOurTables(env);
+    delete table;
+    ourTables->sharedSocketTable = NULL;
+    ourTables->reclaimIfPossible();
+  }
+}
+
 
 ////////// RTPInterface - Implementation //////////
 
@@ -119,7 +209,8 @@ RTPInterface::RTPInterface(Medium* owner, Groupsock* gs)
     fTCPStreams(NULL),
     fNextTCPReadSize(0), fNextTCPReadStreamSocketNum(-1),
     fNextTCPReadStreamChannelId(0xFF), fReadHandlerProc(NULL),
-    fAuxReadHandlerFunc(NULL), fAuxReadHandlerClientData(NULL) {
+    fAuxReadHandlerFunc(NULL), fAuxReadHandlerClientData(NULL),
+    fSharedSocketNum(-1), fNextSharedReadDescriptor(NULL) {
   // Make the socket non-blocking, even though it will be read from only asynchronously, when packets arrive.
   // The reason for this is that, in some OSs, reads on a blocking socket can (allegedly) sometimes block,
   // even if the socket was previously reported (e.g., by "select()") as having data available.
@@ -129,6 +220,7 @@ RTPInterface::RTPInterface(Medium* owner, Groupsock* gs)
 }
 
 RTPInterface::~RTPInterface() {
+  stopSharedSocketReading();
   delete fTCPStreams;
 }
 
@@ -198,6 +290,11 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
   //һ£ʹUDP
   // Normal case: Send as a UDP packet:
   if (!fGS->output(envir(), fGS->ttl(), packet, packetSize)) success = False;
+  if (fSharedSocketNum >= 0) {
+    // Let the shared socket learn our SSRC, so that it can recognize packets that refer to it:
+    SharedSocketDescriptor* socketDescriptor = lookupSharedSocketDescriptor(envir(), fSharedSocketNum, False);
+    if (socketDescriptor != NULL) socketDescriptor->noteSentPacket(this, packet, packetSize);
+  }
 
   //ʹTCP
   // Also, send over each of our TCP sockets:
@@ -214,9 +311,17 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
 
 void RTPInterface
 ::startNetworkReading(TaskScheduler::BackgroundHandlerProc* handlerProc) {
-  // Normal case: Arrange to read UDP packets:
-  envir().taskScheduler().
-    turnOnBackgroundReadHandling(fGS->socketNum(), handlerProc, fOwner);
+  if (fGS->socketIsShared()) {
+    // Our UDP socket is also used by others, so have its "SharedSocketDescriptor" read packets for us:
+    if (fSharedSocketNum < 0) {
+      fSharedSocketNum = fGS->socketNum();
+      lookupSharedSocketDescriptor(envir(), fSharedSocketNum)->registerRTPInterface(this);
+    }
+  } else {
+    // Normal case: Arrange to read UDP packets:
+    envir().taskScheduler().
+      turnOnBackgroundReadHandling(fGS->socketNum(), handlerProc, fOwner);
+  }
 
   // Also, receive RTP over TCP, on each of our TCP connections:
   fReadHandlerProc = handlerProc;
@@ -234,7 +339,15 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 				 unsigned& bytesRead, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete) {
   packetReadWasIncomplete = False; // by default
   Boolean readSuccess;
-  if (fNextTCPReadStreamSocketNum < 0) {
+  if (fNextSharedReadDescriptor != NULL) {
+    // The packet has already been read from our shared UDP socket (by its "SharedSocketDescriptor"):
+    bytesRead = fNextSharedReadDescriptor->packetSize();
+    if (bytesRead > bufferMaxSize) bytesRead = bufferMaxSize;
+    memmove(buffer, fNextSharedReadDescriptor->packet(), bytesRead);
+    fromAddress = fNextSharedReadDescriptor->fromAddress();
+    fNextSharedReadDescriptor = NULL;
+    readSuccess = True;
+  } else if (fNextTCPReadStreamSocketNum < 0) {
     // Normal case: read from the (datagram) 'groupsock':
     readSuccess = fGS->handleRead(buffer, bufferMaxSize, bytesRead, fromAddress);
   } else {
@@ -276,7 +389,7 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 
 void RTPInterface::stopNetworkReading() {
   // Normal case
-  envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
+  stopDatagramReading();
 
   // Also turn off read handling on each of our TCP connections:
   for (tcpStreamRecord* streams = fTCPStreams; streams != NULL;
@@ -286,6 +399,28 @@ void RTPInterface::stopNetworkReading() {
 }
 
 
+void RTPInterface::stopDatagramReading() {
+  if (fGS->socketIsShared()) {
+    stopSharedSocketReading();
+  } else {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
+  }
+}
+
+void RTPInterface::stopSharedSocketReading() {
+  if (fSharedSocketNum < 0) return; // we weren't reading from a shared socket
+
+  SharedSocketDescriptor* socketDescriptor = lookupSharedSocketDescriptor(envir(), fSharedSocketNum, False);
+  if (socketDescriptor != NULL) {
+    socketDescriptor->deregisterRTPInterface(this);
+        // Note: This may delete "socketDescriptor",
+        // if no more interfaces are using this socket
+  }
+  fSharedSocketNum = -1;
+  fNextSharedReadDescriptor = NULL;
+}
+
+
 ////////// Helper Functions - Implementation /////////
 
 Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned packetSize,
@@ -552,6 +687,227 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
 }
 
 
+////////// SharedSocketDescriptor implementation //////////
+
+#define SHARED_SOCKET_MAX_PACKET_SIZE 65536
+#define SHARED_SOCKET_UNKNOWN_SOURCE_LIFETIME 2 /* seconds */
+#define SHARED_SOCKET_MAX_NUM_UNKNOWN_SOURCES 1000
+
+SharedSocketDescriptor::SharedSocketDescriptor(UsageEnvironment& env, int socketNum)
+  : fEnv(env), fOurSocketNum(socketNum),
+    fRTPInterfaces(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fRTPInterfaceBySource(HashTable::create(2)), fUnknownSources(HashTable::create(2)),
+    fRTPInterfaceBySSRC(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fPacket(new unsigned char[SHARED_SOCKET_MAX_PACKET_SIZE]), fPacketSize(0),
+    fDeleteMyselfNext(False), fAreInReadHandler(False) {
+}
+
+SharedSocketDescriptor::~SharedSocketDescriptor() {
+  fEnv.taskScheduler().turnOffBackgroundReadHandling(fOurSocketNum);
+  removeSharedSocketDescription(fEnv, fOurSocketNum);
+
+  // Remove knowledge of this socket from any "RTPInterface"s that are still using it:
+  RTPInterface* rtpInterface;
+  while ((rtpInterface = (RTPInterface*)(fRTPInterfaces->RemoveNext())) != NULL) {
+    rtpInterface->fSharedSocketNum = -1;
+    rtpInterface->fNextSharedReadDescriptor = NULL;
+  }
+  delete fRTPInterfaces;
+
+  while (fRTPInterfaceBySource->RemoveNext() != NULL) {}
+  delete fRTPInterfaceBySource;
+  while (fUnknownSources->RemoveNext() != NULL) {}
+  delete fUnknownSources;
+  while (fRTPInterfaceBySSRC->RemoveNext() != NULL) {}
+  delete fRTPInterfaceBySSRC;
+
+  delete[] fPacket;
+}
+
+void SharedSocketDescriptor::registerRTPInterface(RTPInterface* rtpInterface) {
+  Boolean isFirstRegistration = fRTPInterfaces->IsEmpty();
+  fRTPInterfaces->Add((char const*)rtpInterface, rtpInterface);
+
+  if (isFirstRegistration) {
+    // Arrange to handle reads on this UDP socket:
+    fEnv.taskScheduler().turnOnBackgroundReadHandling(fOurSocketNum,
+	      (TaskScheduler::BackgroundHandlerProc*)&udpReadHandler, this);
+  }
+}
+
+void SharedSocketDescriptor::deregisterRTPInterface(RTPInterface* rtpInterface) {
+  fRTPInterfaces->Remove((char const*)rtpInterface);
+  removeEntriesFor(fRTPInterfaceBySource, rtpInterface);
+  removeEntriesFor(fRTPInterfaceBySSRC, rtpInterface);
+
+  if (fRTPInterfaces->IsEmpty()) {
+    // No more interfaces are using us, so it's curtains for us now:
+    if (fAreInReadHandler) {
+      fDeleteMyselfNext = True; // we can't delete ourself yet, by we'll do so from "udpReadHandler()" below
+    } else {
+      delete this;
+    }
+  }
+}
+
+void SharedSocketDescriptor
+::noteSentPacket(RTPInterface* rtpInterface, unsigned char const* packet, unsigned packetSize) {
+  // Note: A server's "RTCPInstance" sends its RTCP reports - with its "RTPSink"'s SSRC - through the interface that reads
+  // from us, so this is how we learn the SSRC of each stream that we carry (even if its client never sends us any RTP):
+  u_int32_t ssrc = getSSRC(packet, packetSize);
+  if (ssrc != 0 && fRTPInterfaceBySSRC->Lookup((char const*)(long)ssrc) != rtpInterface) {
+    fRTPInterfaceBySSRC->Add((char const*)(long)ssrc, rtpInterface);
+  }
+}
+
+void SharedSocketDescriptor::udpReadHandler(SharedSocketDescriptor* socketDescriptor, int mask) {
+  socketDescriptor->fAreInReadHandler = True;
+  socketDescriptor->udpReadHandler1(mask);
+  socketDescriptor->fAreInReadHandler = False;
+  if (socketDescriptor->fDeleteMyselfNext) delete socketDescriptor;
+}
+
+void SharedSocketDescriptor::udpReadHandler1(int mask) {
+  int result = readSocket(fEnv, fOurSocketNum, fPacket, SHARED_SOCKET_MAX_PACKET_SIZE, fFromAddress);
+  if (result <= 0) return; // no packet (or an error)
+  fPacketSize = (unsigned)result;
+
+  RTPInterface* rtpInterface = lookupRTPInterface();
+  if (rtpInterface == NULL || rtpInterface->fReadHandlerProc == NULL) {
+#ifdef DEBUG_RECEIVE
+    fprintf(stderr, "SharedSocketDescriptor(socket %d)::udpReadHandler(): No \"rtpInterface\" for this %d-byte packet; ignoring it\n", fOurSocketNum, fPacketSize);
+#endif
+    return;
+  }
+
+  // Call the interface's read handler; it will get the packet data from us:
+  rtpInterface->fNextSharedReadDescriptor = this;
+  rtpInterface->fReadHandlerProc(rtpInterface->fOwner, mask);
+}
+
+u_int32_t SharedSocketDescriptor::getSSRC(unsigned char const* packet, unsigned packetSize) {
+  // The SSRC is at offset 4 in a RTCP packet (a RTCP "packet type" byte is in the range [192,223]), or offset 8 in a RTP packet:
+  unsigned ssrcOffset = (packetSize >= 2 && packet[1] >= 192 && packet[1] <= 223) ? 4 : 8;
+  if (packetSize < ssrcOffset + 4) return 0;
+
+  return (packet[ssrcOffset]<<24)|(packet[ssrcOffset+1]<<16)|(packet[ssrcOffset+2]<<8)|packet[ssrcOffset+3];
+}
+
+RTPInterface* SharedSocketDescriptor::lookupRTPInterface() {
+  u_int32_t ssrc = getSSRC(fPacket, fPacketSize);
+
+  // First, check whether we've already seen this source:
+  unsigned sourceKey[2];
+  sourceKey[0] = fFromAddress.sin_addr.s_addr;
+  sourceKey[1] = fFromAddress.sin_port;
+  RTPInterface* rtpInterface = (RTPInterface*)(fRTPInterfaceBySource->Lookup((char const*)sourceKey));
+
+  if (rtpInterface == NULL && !sourceIsKnownToBeUnknown(sourceKey)) {
+    // Look for the interface whose 'groupsock' sends to this source:
+    Port fromPort(ntohs(fFromAddress.sin_port));
+    HashTable::Iterator* iter = HashTable::Iterator::create(*fRTPInterfaces);
+    char const* key;
+    while ((rtpInterface = (RTPInterface*)(iter->next(key))) != NULL) {
+      if (rtpInterface->gs()->hasDestination(fFromAddress.sin_addr, fromPort)) break;
+    }
+    delete iter;
+
+    if (rtpInterface != NULL) {
+      fRTPInterfaceBySource->Add((char const*)sourceKey, rtpInterface);
+    } else {
+      // Don't search for this source again for a while (so that each packet from a source that we don't send to -
+      // or from a flood of them - doesn't cost us a search through all of our streams):
+      noteUnknownSource(sourceKey);
+    }
+  }
+
+  if (rtpInterface == NULL) {
+    // This source is unknown (e.g., because of a NAT - so that its packets come from a different address or port than
+    // the one that we send to), but its SSRC might not be:
+    if (ssrc == 0) return NULL;
+    rtpInterface = (RTPInterface*)(fRTPInterfaceBySSRC->Lookup((char const*)(long)ssrc));
+    if (rtpInterface == NULL) {
+      // If this is a RTCP packet, then look for one of our own streams' SSRCs (which we learned when we sent a RTCP
+      // report for it) in it - in a RR (or SR) 'report block', or as the 'media source' of a feedback message:
+      rtpInterface = lookupRTPInterfaceFromRTCP();
+      if (rtpInterface == NULL) return NULL;
+    }
+
+    // SSRCs are easily guessed (and our own streams' SSRCs are sent to every client), so we accept this only if the
+    // packet came from the address of a client that has been set up to receive this stream.  (A NAT changes the port,
+    // but not the address that the client's RTSP connection came from.)
+    if (!rtpInterface->gs()->hasDestinationAddress(fFromAddress.sin_addr)) return NULL;
+
+    // Remember this source (and its SSRC, below), for its later packets:
+    fUnknownSources->Remove((char const*)sourceKey);
+    fRTPInterfaceBySource->Add((char const*)sourceKey, rtpInterface);
+  }
+
+  if (ssrc != 0) fRTPInterfaceBySSRC->Add((char const*)(long)ssrc, rtpInterface);
+  return rtpInterface;
+}
+
+RTPInterface* SharedSocketDescriptor::lookupRTPInterfaceFromRTCP() {
+  // Walk through each packet in the (compound) RTCP packet:
+  unsigned offset = 0;
+  while (offset + 4 <= fPacketSize) {
+    unsigned char const* packet = &fPacket[offset];
+    unsigned const packetType = packet[1];
+    if ((packet[0]&0xC0) != 0x80 || packetType < 192 || packetType > 223) break; // not RTCP
+    unsigned const packetSize = 4*(((packet[2]<<8)|packet[3]) + 1);
+    if (offset + packetSize > fPacketSize) break;
+
+    unsigned ssrcOffset = 0; // the offset (within "packet") of a SSRC that might be ours; 0 if none
+    if ((packet[0]&0x1F) > 0 && (packetType == 200/*SR*/ || packetType == 201/*RR*/)) {
+      ssrcOffset = packetType == 200 ? 28 : 8; // the first report block
+    } else if (packetType == 205/*RTPFB*/ || packetType == 206/*PSFB*/) {
+      ssrcOffset = 8; // the 'SSRC of media source'
+    }
+    if (ssrcOffset > 0 && ssrcOffset + 4 <= packetSize) {
+      u_int32_t ssrc = (packet[ssrcOffset]<<24)|(packet[ssrcOffset+1]<<16)|(packet[ssrcOffset+2]<<8)|packet[ssrcOffset+3];
+      RTPInterface* rtpInterface = (RTPInterface*)(fRTPInterfaceBySSRC->Lookup((char const*)(long)ssrc));
+      if (rtpInterface != NULL) return rtpInterface;
+    }
+
+    offset += packetSize;
+  }
+
+  return NULL;
+}
+
+Boolean SharedSocketDescriptor::sourceIsKnownToBeUnknown(unsigned const* sourceKey) {
+  long lookAgainTime = (long)(fUnknownSources->Lookup((char const*)sourceKey));
+  if (lookAgainTime == 0) return False; // we haven't noted this source
+
+  if (fEnv.taskScheduler().timeNow().tv_sec < lookAgainTime) return True;
+
+  // Our note about this source has expired.  (A stream might have been set up for it since.)
+  fUnknownSources->Remove((char const*)sourceKey);
+  return False;
+}
+
+void SharedSocketDescriptor::noteUnknownSource(unsigned const* sourceKey) {
+  if (fUnknownSources->numEntries() >= SHARED_SOCKET_MAX_NUM_UNKNOWN_SOURCES) {
+    // Too many sources; start again:
+    while (fUnknownSources->RemoveNext() != NULL) {}
+  }
+
+  long lookAgainTime = fEnv.taskScheduler().timeNow().tv_sec + SHARED_SOCKET_UNKNOWN_SOURCE_LIFETIME;
+  fUnknownSources->Add((char const*)sourceKey, (void*)lookAgainTime);
+}
+
+void SharedSocketDescriptor::removeEntriesFor(HashTable* table, RTPInterface* rtpInterface) {
+  // Note: It's OK to remove the entry that "next()" has just returned
+  HashTable::Iterator* iter = HashTable::Iterator::create(*table);
+  RTPInterface* entry;
+  char const* key;
+  while ((entry = (RTPInterface*)(iter->next(key))) != NULL) {
+    if (entry == rtpInterface) table->Remove(key);
+  }
+  delete iter;
+}
+
+
 ////////// tcpStreamRecord implementation //////////
 
 tcpStreamRecord
@@ -21,6 +21,97 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTPSink.hh"
 #include "GroupsockHelper.hh"
 
+////////// RTPRetransmissionHistory //////////
+
+// A record of the packets that we've sent most recently (for possible retransmission).
+// Each packet is stored in the slot given by its sequence number (modulo the number of slots):
+
+class RTPRetransmissionHistory {
+public:
+  RTPRetransmissionHistory(unsigned numSlots);
+  virtual ~RTPRetransmissionHistory();
+
+  void storePacket(unsigned char const* packet, unsigned packetSize);
+  unsigned char const* lookupPacket(u_int16_t seqNum, unsigned& packetSize) const;
+
+  unsigned char* scratchBuffer(unsigned size); // used to build a retransmitted ('RTX') packet
+
+private:
+  struct Slot {
+    unsigned char* packet;
+    unsigned packetSize, bufferSize;
+  };
+  Slot* fSlots;
+  unsigned fNumSlots; // a power of 2
+  unsigned char* fScratchBuffer;
+  unsigned fScratchBufferSize;
+};
+
+RTPRetransmissionHistory::RTPRetransmissionHistory(unsigned numSlots)
+  : fScratchBuffer(NULL), fScratchBufferSize(0) {
+  // Round "numSlots" up to a power of 2:
+  for (fNumSlots = 1; fNumSlots < numSlots; fNumSlots <<= 1) {}
+
+  fSlots = new Slot[fNumSlots];
+  for (unsigned i = 0; i < fNumSlots; ++i) {
+    fSlots[i].packet = NULL;
+    fSlots[i].packetSize = fSlots[i].bufferSize = 0;
+  }
+}
+
+RTPRetransmissionHistory::~RTPRetransmissionHistory() {
+  for (unsigned i = 0; i < fNumSlots; ++i) delete[] fSlots[i].packet;
+  delete[] fSlots;
+  delete[] fScratchBuffer;
+}
+
+void RTPRetransmissionHistory::storePacket(unsigned char const* packet, unsigned packetSize) {
+  if (packetSize < 12) return; // not a RTP packet
+  u_int16_t seqNum = (packet[2]<<8)|packet[3];
+
+  Slot& slot = fSlots[seqNum&(fNumSlots-1)];
+  if (packetSize > slot.bufferSize) {
+    // (Buffers are reused, so this happens only until each slot's buffer reaches the maximum packet size.)
+    delete[] slot.packet;
+    slot.packet = new unsigned char[packetSize];
+    slot.bufferSize = packetSize;
+  }
+  memmove(slot.packet, packet, packetSize);
+  slot.packetSize = packetSize;
+}
+
+unsigned char const* RTPRetransmissionHistory::lookupPacket(u_int16_t seqNum, unsigned& packetSize) const {
+  Slot const& slot = fSlots[seqNum&(fNumSlots-1)];
+  if (slot.packetSize == 0 || ((slot.packet[2]<<8)|slot.packet[3]) != seqNum) {
+    return NULL; // we never sent this packet, or it has since been overwritten
+  }
+
+  packetSize = slot.packetSize;
+  return slot.packet;
+}
+
+unsigned char* RTPRetransmissionHistory::scratchBuffer(unsigned size) {
+  if (size > fScratchBufferSize) {
+    delete[] fScratchBuffer;
+    fScratchBuffer = new unsigned char[size];
+    fScratchBufferSize = size;
+  }
+  return fScratchBuffer;
+}
+
+////////// AfterSendingPacketHandlerRecord //////////
+
+class AfterSendingPacketHandlerRecord {
+public:
+  AfterSendingPacketHandlerRecord(RTPSink::afterSendingPacketFunc* handler, void* clientData)
+    : fNext(NULL), fHandler(handler), fClientData(clientData) {
+  }
+
+  AfterSendingPacketHandlerRecord* fNext;
+  RTPSink::afterSendingPacketFunc* fHandler;
+  void* fClientData;
+};
+
 ////////// RTPSink //////////
 
 Boolean RTPSink::lookupByName(UsageEnvironment& env, char const* sinkName,
@@ -52,7 +143,9 @@ RTPSink::RTPSink(UsageEnvironment& env,
     fRTPPayloadType(rtpPayloadType),
     fPacketCount(0), fOctetCount(0), fTotalOctetCount(0),
     fTimestampFrequency(rtpTimestampFrequency), fNextTimestampHasBeenPreset(False), fEnableRTCPReports(True),
-    fNumChannels(numChannels) {
+    fNumChannels(numChannels), fRetransmissionHistory(NULL), fRTXPayloadType(0),
+    fNumPacketsRetransmitted(0), fNumUnavailableRetransmissions(0),
+    fAfterSendingPacketHandlers(NULL) {
   fRTPPayloadFormatName
     = strDup(rtpPayloadFormatName == NULL ? "???" : rtpPayloadFormatName);
   gettimeofday(&fCreationTime, NULL);
@@ -67,6 +160,12 @@ RTPSink::RTPSink(UsageEnvironment& env,
 }
 
 RTPSink::~RTPSink() {
+  while (fAfterSendingPacketHandlers != NULL) {
+    AfterSendingPacketHandlerRecord* record = fAfterSendingPacketHandlers;
+    fAfterSendingPacketHandlers = record->fNext;
+    delete record;
+  }
+  delete fRetransmissionHistory;
   delete fTransmissionStatsDB;
   delete[] (char*)fRTPPayloadFormatName;
 }
@@ -95,8 +194,7 @@ u_int32_t RTPSink::convertToRTPTimestamp(struct timeval tv) {
 }
 
 u_int32_t RTPSink::presetNextTimestamp() {
-  struct timeval timeNow;
-  gettimeofday(&timeNow, NULL);
+  struct timeval timeNow = envir().taskScheduler().refreshTimeNow();
 
   u_int32_t tsNow = convertToRTPTimestamp(timeNow);
   fTimestampBase = tsNow;
@@ -122,6 +220,82 @@ void RTPSink::resetPresentationTimes() {
   fInitialPresentationTime.tv_usec = fMostRecentPresentationTime.tv_usec = 0;
 }
 
+void RTPSink::enableRetransmissions(unsigned historySize, unsigned char rtxPayloadType) {
+  delete fRetransmissionHistory;
+  fRetransmissionHistory = historySize == 0 ? NULL : new RTPRetransmissionHistory(historySize);
+
+  fRTXPayloadType = rtxPayloadType;
+  fRTXSSRC = our_random32();
+  fRTXSeqNo = (u_int16_t)our_random();
+}
+
+void RTPSink::addAfterSendingPacketHandler(afterSendingPacketFunc* handler, void* clientData) {
+  if (handler == NULL) return;
+
+  AfterSendingPacketHandlerRecord** recordPtr = &fAfterSendingPacketHandlers;
+  while (*recordPtr != NULL) recordPtr = &(*recordPtr)->fNext;
+  *recordPtr = new AfterSendingPacketHandlerRecord(handler, clientData);
+}
+
+void RTPSink::removeAfterSendingPacketHandler(afterSendingPacketFunc* handler, void* clientData) {
+  for (AfterSendingPacketHandlerRecord** recordPtr = &fAfterSendingPacketHandlers; *recordPtr != NULL;
+       recordPtr = &(*recordPtr)->fNext) {
+    AfterSendingPacketHandlerRecord* record = *recordPtr;
+    if (record->fHandler == handler && record->fClientData == clientData) {
+      *recordPtr = record->fNext;
+      delete record;
+      return;
+    }
+  }
+}
+
+void RTPSink::noteSentPacket(unsigned char const* packet, unsigned packetSize) {
+  if (fRetransmissionHistory != NULL) fRetransmissionHistory->storePacket(packet, packetSize);
+
+  AfterSendingPacketHandlerRecord* record = fAfterSendingPacketHandlers;
+  while (record != NULL) {
+    AfterSendingPacketHandlerRecord* nextRecord = record->fNext; // in case the handler removes itself
+    (*record->fHandler)(record->fClientData, packet, packetSize);
+    record = nextRecord;
+  }
+}
+
+void RTPSink::retransmitPacket(u_int16_t seqNum) {
+  if (fRetransmissionHistory == NULL) return;
+
+  unsigned packetSize;
+  unsigned char const* packet = fRetransmissionHistory->lookupPacket(seqNum, packetSize);
+  if (packet == NULL) {
+    ++fNumUnavailableRetransmissions;
+    return;
+  }
+
+  if (fRTXPayloadType == 0) {
+    // Resend the packet unchanged, as part of our original stream:
+    fRTPInterface.sendPacket((unsigned char*)packet, packetSize);
+  } else {
+    // Send the packet in our 'RTX' stream (RFC 4588): It has the same RTP header as the original packet, but with our
+    // RTX payload type, sequence number and SSRC, and the original sequence number at the start of the payload:
+    unsigned headerSize = 12 + 4*(packet[0]&0x0F); // includes any CSRCs
+    if ((packet[0]&0x10) != 0 && headerSize + 4 <= packetSize) { // there's also a header extension
+      headerSize += 4 + 4*((packet[headerSize+2]<<8)|packet[headerSize+3]);
+    }
+    if (headerSize > packetSize) return; // sanity check
+
+    unsigned char* rtxPacket = fRetransmissionHistory->scratchBuffer(packetSize + 2);
+    memmove(rtxPacket, packet, headerSize);
+    rtxPacket[1] = (packet[1]&0x80) | fRTXPayloadType; // keep the marker bit
+    rtxPacket[2] = fRTXSeqNo>>8; rtxPacket[3] = (unsigned char)fRTXSeqNo;
+    ++fRTXSeqNo;
+    rtxPacket[8] = fRTXSSRC>>24; rtxPacket[9] = fRTXSSRC>>16; rtxPacket[10] = fRTXSSRC>>8; rtxPacket[11] = fRTXSSRC;
+    rtxPacket[headerSize] = packet[2]; rtxPacket[headerSize+1] = packet[3]; // the 'original sequence number'
+    memmove(&rtxPacket[headerSize+2], &packet[headerSize], packetSize - headerSize);
+
+    fRTPInterface.sendPacket(rtxPacket, packetSize + 2);
+  }
+  ++fNumPacketsRetransmitted;
+}
+
 char const* RTPSink::sdpMediaType() const {
   return "data";
   // default SDP media (m=) type, unless redefined by subclasses
@@ -167,11 +341,15 @@ RTPTransmissionStatsDB::RTPTransmissionStatsDB(RTPSink& rtpSink)
 }
 
 RTPTransmissionStatsDB::~RTPTransmissionStatsDB() {
-  // First, remove and delete all stats records from the table:
+  // First, delete all stats records from the table.  (We do this in a single pass, rather than by calling
+  // "RemoveNext()" repeatedly, because - with many receivers - that would take quadratic time.)
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fTable);
   RTPTransmissionStats* stats;
-  while ((stats = (RTPTransmissionStats*)fTable->RemoveNext()) != NULL) {
+  char const* key;
+  while ((stats = (RTPTransmissionStats*)iter->next(key)) != NULL) {
     delete stats;
   }
+  delete iter;
 
   // Then, delete the table itself:
   delete fTable;
@@ -265,7 +443,7 @@ void RTPTransmissionStats
     fOldLastPacketNumReceived = fLastPacketNumReceived;
     fOldTotNumPacketsLost = fTotNumPacketsLost;
   }
-  gettimeofday(&fTimeReceived, NULL);
+  fTimeReceived = fOurRTPSink.envir().taskScheduler().timeNow();
 
   fLastFromAddress = lastFromAddress;
   fPacketLossRatio = lossStats>>24;
@@ -54,6 +54,7 @@ RTPSource::RTPSource(UsageEnvironment& env, Groupsock* RTPgs,
   : FramedSource(env),
     fRTPInterface(this, RTPgs),
     fCurPacketHasBeenSynchronizedUsingRTCP(False), fLastReceivedSSRC(0),
+    fRTCPInstanceForMultiplexedRTCPPackets(NULL),
     fRTPPayloadFormat(rtpPayloadFormat), fTimestampFrequency(rtpTimestampFrequency),
     fSSRC(our_random32()), fEnableRTCPReports(True) {
   fReceptionStatsDB = new RTPReceptionStatsDB();
@@ -102,7 +103,7 @@ void RTPReceptionStatsDB
 		     Boolean useForJitterCalculation,
 		     struct timeval& resultPresentationTime,
 		     Boolean& resultHasBeenSyncedUsingRTCP,
-		     unsigned packetSize) {
+		     unsigned packetSize, struct timeval const* timeReceived) {
   ++fTotNumPacketsReceived;
   RTPReceptionStats* stats = lookup(SSRC);
   if (stats == NULL) {
@@ -120,13 +121,39 @@ void RTPReceptionStatsDB
   stats->noteIncomingPacket(seqNum, rtpTimestamp, timestampFrequency,
 			    useForJitterCalculation,
 			    resultPresentationTime,
-			    resultHasBeenSyncedUsingRTCP, packetSize);
+			    resultHasBeenSyncedUsingRTCP, packetSize, timeReceived);
+}
+
+void RTPReceptionStatsDB
+::computePresentationTime(u_int32_t SSRC, u_int32_t rtpTimestamp,
+			  unsigned timestampFrequency,
+			  struct timeval& resultPresentationTime,
+			  Boolean& resultHasBeenSyncedUsingRTCP,
+			  struct timeval const* timeReceived) {
+  struct timeval timeNow;
+  if (timeReceived != NULL) {
+    timeNow = *timeReceived;
+  } else {
+    gettimeofday(&timeNow, NULL);
+  }
+
+  RTPReceptionStats* stats = lookup(SSRC);
+  if (stats == NULL) {
+    // We haven't yet heard from this SSRC, so there's no timestamp mapping to use:
+    resultPresentationTime = timeNow;
+    resultHasBeenSyncedUsingRTCP = False;
+    return;
+  }
+
+  stats->computePresentationTime(rtpTimestamp, timestampFrequency, timeNow,
+				 resultPresentationTime, resultHasBeenSyncedUsingRTCP);
 }
 
 void RTPReceptionStatsDB
 ::noteIncomingSR(u_int32_t SSRC,
 		 u_int32_t ntpTimestampMSW, u_int32_t ntpTimestampLSW,
-		 u_int32_t rtpTimestamp) {
+		 u_int32_t rtpTimestamp,
+		 struct timeval const* timeReceived) {
   RTPReceptionStats* stats = lookup(SSRC);
   if (stats == NULL) {
     // This is the first time we've heard of this SSRC.
@@ -136,7 +163,7 @@ void RTPReceptionStatsDB
     add(SSRC, stats);
   }
 
-  stats->noteIncomingSR(ntpTimestampMSW, ntpTimestampLSW, rtpTimestamp);
+  stats->noteIncomingSR(ntpTimestampMSW, ntpTimestampLSW, rtpTimestamp, timeReceived);
 }
 
 void RTPReceptionStatsDB::removeRecord(u_int32_t SSRC) {
@@ -233,7 +260,7 @@ void RTPReceptionStats
 		     Boolean useForJitterCalculation,
 		     struct timeval& resultPresentationTime,
 		     Boolean& resultHasBeenSyncedUsingRTCP,
-		     unsigned packetSize) {
+		     unsigned packetSize, struct timeval const* timeReceived) {
   if (!fHaveSeenInitialSequenceNumber) initSeqNum(seqNum);
 
   ++fNumPacketsReceivedSinceLastReset;
@@ -277,7 +304,11 @@ void RTPReceptionStats
 
   // Record the inter-packet delay
   struct timeval timeNow;
-  gettimeofday(&timeNow, NULL);
+  if (timeReceived != NULL) {
+    timeNow = *timeReceived;
+  } else {
+    gettimeofday(&timeNow, NULL);
+  }
   if (fLastPacketReceptionTime.tv_sec != 0
       || fLastPacketReceptionTime.tv_usec != 0) {
     unsigned gap
@@ -317,6 +348,17 @@ void RTPReceptionStats
     fJitter += (1.0/16.0) * ((double)d - fJitter);
   }
 
+  computePresentationTime(rtpTimestamp, timestampFrequency, timeNow,
+			  resultPresentationTime, resultHasBeenSyncedUsingRTCP);
+
+  fPreviousPacketRTPTimestamp = rtpTimestamp;
+}
+
+void RTPReceptionStats
+::computePresentationTime(u_int32_t rtpTimestamp, unsigned timestampFrequency,
+			  struct timeval const& timeNow,
+			  struct timeval& resultPresentationTime,
+			  Boolean& resultHasBeenSyncedUsingRTCP) {
   // Return the 'presentation time' that corresponds to "rtpTimestamp":
   if (fSyncTime.tv_sec == 0 && fSyncTime.tv_usec == 0) {
     // This is the first timestamp that we've seen, so use the current
@@ -361,17 +403,20 @@ void RTPReceptionStats
   // Save these as the new synchronization timestamp & time:
   fSyncTimestamp = rtpTimestamp;
   fSyncTime = resultPresentationTime;
-
-  fPreviousPacketRTPTimestamp = rtpTimestamp;
 }
 
 void RTPReceptionStats::noteIncomingSR(u_int32_t ntpTimestampMSW,
 				       u_int32_t ntpTimestampLSW,
-				       u_int32_t rtpTimestamp) {
+				       u_int32_t rtpTimestamp,
+				       struct timeval const* timeReceived) {
   fLastReceivedSR_NTPmsw = ntpTimestampMSW;
   fLastReceivedSR_NTPlsw = ntpTimestampLSW;
 
-  gettimeofday(&fLastReceivedSR_time, NULL);
+  if (timeReceived != NULL) {
+    fLastReceivedSR_time = *timeReceived;
+  } else {
+    gettimeofday(&fLastReceivedSR_time, NULL);
+  }
 
   // Use this SR to update time synchronization information:
   fSyncTimestamp = rtpTimestamp;
@@ -606,9 +606,9 @@ unsigned RTSPClient::sendRequest(RequestRecord* request) {
       char const* transportFmt;
       if (strcmp(subsession.protocolName(), "UDP") == 0) {
 	suffix = "";
-	transportFmt = "Transport: RAW/RAW/UDP%s%s%s=%d-%d\r\n";
+	transportFmt = "Transport: RAW/RAW/UDP%s%s%s=%d-%d%s\r\n";
       } else {
-	transportFmt = "Transport: RTP/AVP%s%s%s=%d-%d\r\n";
+	transportFmt = "Transport: RTP/AVP%s%s%s=%d-%d%s\r\n";
       }
 
       cmdURL = new char[strlen(prefix) + strlen(separator) + strlen(suffix) + 1];
@@ -620,6 +620,7 @@ unsigned RTSPClient::sendRequest(RequestRecord* request) {
       char const* modeStr = streamOutgoing ? ";mode=receive" : "";
           // Note: I think the above is nonstandard, but DSS wants it this way
       char const* portTypeStr;
+      char const* rtcpMuxStr = "";
       portNumBits rtpNumber, rtcpNumber;
       if (streamUsingTCP) { // streaming over the RTSP connection
 	transportTypeStr = "/TCP;unicast";
@@ -638,13 +639,19 @@ unsigned RTSPClient::sendRequest(RequestRecord* request) {
 	  delete[] cmdURL;
 	  break;
 	}
-	rtcpNumber = rtpNumber + 1;
+	if (subsession.multiplexRTCPWithRTP()) {
+	  // RTCP is multiplexed with RTP on the same port (RFC 5761):
+	  rtcpNumber = rtpNumber;
+	  rtcpMuxStr = ";RTCP-mux";
+	} else {
+	  rtcpNumber = rtpNumber + 1;
+	}
       }
       unsigned transportSize = strlen(transportFmt)
-	+ strlen(transportTypeStr) + strlen(modeStr) + strlen(portTypeStr) + 2*5 /* max port len */;
+	+ strlen(transportTypeStr) + strlen(modeStr) + strlen(portTypeStr) + 2*5 /* max port len */ + strlen(rtcpMuxStr);
       char* transportStr = new char[transportSize];
       sprintf(transportStr, transportFmt,
-	      transportTypeStr, modeStr, portTypeStr, rtpNumber, rtcpNumber);
+	      transportTypeStr, modeStr, portTypeStr, rtpNumber, rtcpNumber, rtcpMuxStr);
 
       // When sending more than one "SETUP" request, include a "Session:" header in the 2nd and later commands:
       char* sessionStr = createSessionString(fLastSessionId);
@@ -892,12 +899,13 @@ Boolean RTSPClient::checkForHeader(char const* line, char const* headerName, uns
 }
 
 Boolean RTSPClient::parseTransportParams(char const* paramsStr,
-					 char*& serverAddressStr, portNumBits& serverPortNum,
-					 unsigned char& rtpChannelId, unsigned char& rtcpChannelId) {
+					 char*& serverAddressStr, portNumBits& serverPortNum, portNumBits& serverRTCPPortNum,
+					 unsigned char& rtpChannelId, unsigned char& rtcpChannelId, Boolean& rtcpIsMuxed) {
   // Initialize the return parameters to 'not found' values:
   serverAddressStr = NULL;
-  serverPortNum = 0;
+  serverPortNum = serverRTCPPortNum = 0;
   rtpChannelId = rtcpChannelId = 0xFF;
+  rtcpIsMuxed = False;
   if (paramsStr == NULL) return False;  
 
   char* foundServerAddressStr = NULL;
@@ -915,7 +923,10 @@ Boolean RTSPClient::parseTransportParams(char const* paramsStr,
   char const* fields = paramsStr;
   char* field = strDupSize(fields);
   while (sscanf(fields, "%[^;]", field) == 1) {
-    if (sscanf(field, "server_port=%hu", &serverPortNum) == 1) {
+    if (sscanf(field, "server_port=%hu-%hu", &serverPortNum, &serverRTCPPortNum) == 2) {
+      foundServerPortNum = True;
+    } else if (sscanf(field, "server_port=%hu", &serverPortNum) == 1) {
+      serverRTCPPortNum = serverPortNum + 1;
       foundServerPortNum = True;
     } else if (sscanf(field, "client_port=%hu", &clientPortNum) == 1) {
       foundClientPortNum = True;
@@ -934,6 +945,8 @@ Boolean RTSPClient::parseTransportParams(char const* paramsStr,
     } else if (sscanf(field, "port=%hu-%hu", &multicastPortNumRTP, &multicastPortNumRTCP) == 2 ||
 	       sscanf(field, "port=%hu", &multicastPortNumRTP) == 1) {
       foundMulticastPortNum = True;
+    } else if (_strncasecmp(field, "RTCP-mux", 8) == 0 && field[8] == '\0') {
+      rtcpIsMuxed = True;
     }
 
     fields += strlen(field);
@@ -961,6 +974,7 @@ Boolean RTSPClient::parseTransportParams(char const* paramsStr,
   if (foundChannelIds || foundServerPortNum || foundClientPortNum) {
     if (foundClientPortNum && !foundServerPortNum) {
       serverPortNum = clientPortNum;
+      serverRTCPPortNum = clientPortNum + 1;
     }
     serverAddressStr = foundServerAddressStr;
     return True;
@@ -1023,9 +1037,11 @@ Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const*
 
     // Parse the "Transport:" header parameters:
     char* serverAddressStr;
-    portNumBits serverPortNum;
+    portNumBits serverPortNum, serverRTCPPortNum;
     unsigned char rtpChannelId, rtcpChannelId;
-    if (!parseTransportParams(transportParamsStr, serverAddressStr, serverPortNum, rtpChannelId, rtcpChannelId)) {
+    Boolean rtcpIsMuxed;
+    if (!parseTransportParams(transportParamsStr, serverAddressStr, serverPortNum, serverRTCPPortNum,
+			      rtpChannelId, rtcpChannelId, rtcpIsMuxed)) {
       envir().setResultMsg("Missing or bad \"Transport:\" header");
       break;
     }
@@ -1057,12 +1073,24 @@ Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const*
       Groupsock* gs1 = NULL; Groupsock* gs2 = NULL;
       if (subsession.rtpSource() != NULL) gs1 = subsession.rtpSource()->RTPgs();
       if (subsession.rtcpInstance() != NULL) gs2 = subsession.rtcpInstance()->RTCPgs();
+      if (gs2 == gs1) gs2 = NULL; // RTCP is multiplexed with RTP
       u_int32_t const dummy = 0xFEEDFACE;
       unsigned const numDummyPackets = 2;
       for (unsigned i = 0; i < numDummyPackets; ++i) {
 	if (gs1 != NULL) gs1->output(envir(), 255, (unsigned char*)&dummy, sizeof dummy);
 	if (gs2 != NULL) gs2->output(envir(), 255, (unsigned char*)&dummy, sizeof dummy);
       }
+
+      if (gs1 != NULL && gs2 == NULL && subsession.rtcpInstance() != NULL && !rtcpIsMuxed && serverRTCPPortNum != 0) {
+	// We asked for RTCP to be multiplexed with RTP (RFC 5761), but the server didn't agree, so it expects our
+	// RTCP on its separate RTCP port.  (Its own RTCP still reaches our single port, where we demultiplex it from
+	// RTP.)  Because we send only RTCP (and the 'dummy' packets above) through our socket, we redirect it there:
+	struct in_addr destAddr; destAddr.s_addr = destAddress;
+	gs1->changeDestinationParameters(destAddr, Port(serverRTCPPortNum), ~0);
+	for (unsigned i = 0; i < numDummyPackets; ++i) {
+	  gs1->output(envir(), 255, (unsigned char*)&dummy, sizeof dummy);
+	}
+      }
     }
 
     success = True;
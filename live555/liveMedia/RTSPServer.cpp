@@ -382,10 +382,22 @@ RTSPServer::RTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort,
     fClientSessions(HashTable::create(STRING_HASH_KEYS)),
     fPendingRegisterRequests(HashTable::create(ONE_WORD_HASH_KEYS)),
     fAuthDB(authDatabase), fReclamationTestSeconds(
-        reclamationTestSeconds)
+        reclamationTestSeconds),
+    fLivenessBuckets(NULL), fNumLivenessBuckets(0),
+    fNumClientSessionsInLivenessBuckets(0), fLastLivenessSweepTime(0),
+    fLivenessSweepTask(NULL), fNumClientSessionsReclaimed(0)
 {
     ignoreSigPipeOnSocket(ourSocket); // so that clients on the same host that are killed don't also kill us
 
+    if (fReclamationTestSeconds > 0)
+    {
+        // Use one 'liveness bucket' for each second within a reclamation period (plus one for the current second):
+        fNumLivenessBuckets = fReclamationTestSeconds + 1;
+        fLivenessBuckets = new RTSPClientSession*[fNumLivenessBuckets];
+        for (unsigned i = 0; i < fNumLivenessBuckets; ++i)
+            fLivenessBuckets[i] = NULL;
+    }
+
     // Arrange to handle connections from others:
     env.taskScheduler().turnOnBackgroundReadHandling(
         fRTSPServerSocket,
@@ -441,6 +453,10 @@ RTSPServer::~RTSPServer()
         delete registerRequest;
     }
     delete fPendingRegisterRequests;
+
+    // All client sessions have now been deleted (and so removed from our 'liveness buckets'):
+    envir().taskScheduler().unscheduleDelayedTask(fLivenessSweepTask);
+    delete[] fLivenessBuckets;
 }
 
 Boolean RTSPServer::isRTSPServer() const
@@ -1643,7 +1659,8 @@ RTSPServer::RTSPClientSession::RTSPClientSession(RTSPServer& ourServer,
         u_int32_t sessionId) :
     fOurServer(ourServer), fOurSessionId(sessionId), fOurServerMediaSession(
         NULL), fIsMulticast(False), fStreamAfterSETUP(False),
-    fTCPStreamIdCount(0), fLivenessCheckTask(NULL),
+    fTCPStreamIdCount(0), fLastLivenessTime(0), fLivenessBucketIndex(-1),
+    fNextInLivenessBucket(NULL), fPrevInLivenessBucket(NULL),
     fNumStreamStates(0), fStreamStates(NULL)
 {
     noteLiveness();
@@ -1652,7 +1669,7 @@ RTSPServer::RTSPClientSession::RTSPClientSession(RTSPServer& ourServer,
 RTSPServer::RTSPClientSession::~RTSPClientSession()
 {
     // Turn off any liveness checking:
-    envir().taskScheduler().unscheduleDelayedTask(fLivenessCheckTask);
+    fOurServer.removeFromLivenessBucket(this);
 
     // Remove ourself from the server's 'client sessions' hash table before we go:
     char sessionIdStr[9];
@@ -1712,6 +1729,7 @@ static void parseTransportHeader(char const* buf, StreamingMode& streamingMode,
 
     portNumBits p1, p2;
     unsigned ttl, rtpCid, rtcpCid;
+    Boolean rtcpMuxRequested = False;
 
     // First, find "Transport:"
     while (1)
@@ -1768,6 +1786,11 @@ static void parseTransportHeader(char const* buf, StreamingMode& streamingMode,
             rtpChannelId = (unsigned char) rtpCid;	//RTPʶ
             rtcpChannelId = (unsigned char) rtcpCid;//RTCPʶ
         }
+        else if (_strncasecmp(field, "RTCP-mux", 8) == 0 && field[8] == '\0')
+        {
+            // The client wants RTCP multiplexed with RTP on the same port (RFC 5761):
+            rtcpMuxRequested = True;
+        }
 
         fields += strlen(field);
         while (*fields == ';')
@@ -1776,6 +1799,12 @@ static void parseTransportHeader(char const* buf, StreamingMode& streamingMode,
             break;
     }
     delete[] field;
+
+    if (rtcpMuxRequested && streamingMode == RTP_UDP)
+    {
+        // RTCP uses the client's RTP port:
+        clientRTCPPortNum = clientRTPPortNum;
+    }
 }
 
 static Boolean parsePlayNowHeader(char const* buf)
@@ -2089,20 +2118,28 @@ void RTSPServer::RTSPClientSession::handleCmd_SETUP(
             {
             case RTP_UDP:
             {
+                // We multiplex RTCP with RTP (RFC 5761) only if this client asked for it (in which case
+                // "parseTransportHeader()" set its RTCP port to its RTP port), and if the stream that it got
+                // (which, if "reuseFirstSource" was set, might have been set up for some other client) has a
+                // single server port:
+                Boolean rtcpIsMuxed = clientRTCPPort.num() == clientRTPPort.num()
+                                      && serverRTCPPort.num() == serverRTPPort.num();
                 snprintf(
                     (char*) ourClientConnection->fResponseBuffer,
                     sizeof ourClientConnection->fResponseBuffer,
                     "RTSP/1.0 200 OK\r\n"
                     "CSeq: %s\r\n"
                     "%s"
-                    "Transport: RTP/AVP;unicast;destination=%s;source=%s;client_port=%d-%d;server_port=%d-%d\r\n"
+                    "Transport: RTP/AVP;unicast;destination=%s;source=%s;client_port=%d-%d;server_port=%d-%d%s\r\n"
                     "Session: %08X\r\n\r\n",
                     ourClientConnection->fCurrentCSeq, dateHeader(),
                     destAddrStr.val(), sourceAddrStr.val(), ntohs(
                         clientRTPPort.num()), ntohs(
                         clientRTCPPort.num()), ntohs(
                         serverRTPPort.num()), ntohs(
-                        serverRTCPPort.num()), fOurSessionId);
+                        serverRTCPPort.num()),
+                    rtcpIsMuxed ? ";RTCP-mux" : "",
+                    fOurSessionId);
                 break;
             }
             case RTP_TCP:
@@ -2605,13 +2642,23 @@ RTSPServer::createNewClientSession(u_int32_t sessionId)
     return new RTSPClientSession(*this, sessionId);
 }
 
+static long livenessTimeNow(UsageEnvironment& env)
+{
+    // (Liveness is noted for each incoming RTCP packet, so we use the scheduler's cached time.)
+    return env.taskScheduler().timeNow().tv_sec;
+}
+
 void RTSPServer::RTSPClientSession::noteLiveness()
 {
     if (fOurServer.fReclamationTestSeconds > 0)
     {
-        envir().taskScheduler() .rescheduleDelayedTask(fLivenessCheckTask,
-                fOurServer.fReclamationTestSeconds * 1000000,
-                (TaskFunc*) livenessTimeoutTask, this);
+        // Just record the time.  (Our server's 'liveness sweep' will reclaim us if this gets too old.):
+        fLastLivenessTime = livenessTimeNow(envir());
+        if (fLivenessBucketIndex < 0)
+        {
+            fOurServer.addToLivenessBucket(this,
+                                           fLastLivenessTime + fOurServer.fReclamationTestSeconds);
+        }
     }
 }
 
@@ -2641,6 +2688,110 @@ void RTSPServer::RTSPClientSession::livenessTimeoutTask(
     delete clientSession;
 }
 
+void RTSPServer::addToLivenessBucket(RTSPClientSession* clientSession,
+                                     long deadline)
+{
+    if (fLivenessSweepTask == NULL)
+    {
+        // Start our periodic 'liveness sweep':
+        fLastLivenessSweepTime = livenessTimeNow(envir());
+        fLivenessSweepTask = envir().taskScheduler().scheduleDelayedTask(1000000,
+                             (TaskFunc*) livenessSweepTask, this);
+    }
+
+    // Make sure that the deadline falls within the range of buckets that have not yet been swept.
+    // (If the deadline is later than this, then the session will get checked - and moved - early; that's OK.)
+    if (deadline <= fLastLivenessSweepTime)
+        deadline = fLastLivenessSweepTime + 1;
+    else if (deadline > fLastLivenessSweepTime + (long) fReclamationTestSeconds)
+        deadline = fLastLivenessSweepTime + fReclamationTestSeconds;
+
+    unsigned index = (unsigned) (deadline % fNumLivenessBuckets);
+    clientSession->fLivenessBucketIndex = (int) index;
+    clientSession->fPrevInLivenessBucket = NULL;
+    clientSession->fNextInLivenessBucket = fLivenessBuckets[index];
+    if (fLivenessBuckets[index] != NULL)
+        fLivenessBuckets[index]->fPrevInLivenessBucket = clientSession;
+    fLivenessBuckets[index] = clientSession;
+    ++fNumClientSessionsInLivenessBuckets;
+}
+
+void RTSPServer::removeFromLivenessBucket(RTSPClientSession* clientSession)
+{
+    if (clientSession->fLivenessBucketIndex < 0)
+        return; // we're not in a bucket
+
+    if (clientSession->fPrevInLivenessBucket != NULL)
+    {
+        clientSession->fPrevInLivenessBucket->fNextInLivenessBucket
+            = clientSession->fNextInLivenessBucket;
+    }
+    else
+    {
+        fLivenessBuckets[clientSession->fLivenessBucketIndex]
+            = clientSession->fNextInLivenessBucket;
+    }
+    if (clientSession->fNextInLivenessBucket != NULL)
+    {
+        clientSession->fNextInLivenessBucket->fPrevInLivenessBucket
+            = clientSession->fPrevInLivenessBucket;
+    }
+    clientSession->fLivenessBucketIndex = -1;
+    clientSession->fNextInLivenessBucket = clientSession->fPrevInLivenessBucket = NULL;
+    --fNumClientSessionsInLivenessBuckets;
+}
+
+void RTSPServer::livenessSweepTask(void* clientData)
+{
+    RTSPServer* server = (RTSPServer*) clientData;
+    server->livenessSweep();
+}
+
+void RTSPServer::livenessSweep()
+{
+    // Note: "fLivenessSweepTask" remains non-NULL until we're done, so that sessions that we move to
+    // another bucket don't cause another sweep to get scheduled.
+    long timeNow = livenessTimeNow(envir());
+    if (timeNow < fLastLivenessSweepTime)
+        fLastLivenessSweepTime = timeNow; // the clock went backwards
+
+    // Check each bucket that has become due since our last sweep (but no more than one full turn of buckets):
+    long numBucketsToCheck = timeNow - fLastLivenessSweepTime;
+    if (numBucketsToCheck > (long) fNumLivenessBuckets)
+        numBucketsToCheck = fNumLivenessBuckets;
+    while (numBucketsToCheck-- > 0)
+    {
+        ++fLastLivenessSweepTime;
+        unsigned index = (unsigned) (fLastLivenessSweepTime % fNumLivenessBuckets);
+
+        RTSPClientSession* clientSession;
+        while ((clientSession = fLivenessBuckets[index]) != NULL)
+        {
+            removeFromLivenessBucket(clientSession);
+
+            long deadline = clientSession->fLastLivenessTime + fReclamationTestSeconds;
+            if (deadline <= timeNow)
+            {
+                ++fNumClientSessionsReclaimed;
+                RTSPClientSession::livenessTimeoutTask(clientSession);
+            }
+            else
+            {
+                // The client has shown signs of life since this session was put in this bucket:
+                addToLivenessBucket(clientSession, deadline);
+            }
+        }
+    }
+    fLastLivenessSweepTime = timeNow;
+
+    fLivenessSweepTask = NULL;
+    if (fNumClientSessionsInLivenessBuckets > 0)
+    {
+        fLivenessSweepTask = envir().taskScheduler().scheduleDelayedTask(1000000,
+                             (TaskFunc*) livenessSweepTask, this);
+    }
+}
+
 ////////// ServerMediaSessionIterator implementation //////////
 
 RTSPServer::ServerMediaSessionIterator::ServerMediaSessionIterator(
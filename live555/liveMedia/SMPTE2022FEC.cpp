@@ -0,0 +1,524 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// Row/column XOR Forward Error Correction (FEC) for RTP streams - e.g., MPEG Transport Streams - as specified
+// by SMPTE 2022-1 (a.k.a. the "Pro-MPEG Code of Practice #3").
+// Implementation
+
+#include "SMPTE2022FEC.hh"
+#include "GroupsockHelper.hh"
+
+#define MAX_FEC_PAYLOAD_SIZE 1500
+#define FEC_HEADER_SIZE 16 // follows the (12-byte) RTP header in each FEC packet
+
+// Returns the size of a RTP packet's header (including any CSRCs and header extension), or 0 if the packet is bad:
+static unsigned rtpHeaderSize(unsigned char const* packet, unsigned packetSize) {
+  if (packetSize < 12 || (packet[0]&0xC0) != 0x80) return 0;
+
+  unsigned headerSize = 12 + 4*(packet[0]&0x0F);
+  if ((packet[0]&0x10) != 0) { // there's a header extension
+    if (headerSize + 4 > packetSize) return 0;
+    headerSize += 4 + 4*((packet[headerSize+2]<<8)|packet[headerSize+3]);
+  }
+  return headerSize > packetSize ? 0 : headerSize;
+}
+
+static void xorBytes(unsigned char* to, unsigned char const* from, unsigned numBytes) {
+  for (unsigned i = 0; i < numBytes; ++i) to[i] ^= from[i];
+}
+
+
+////////// SMPTE2022FECAccumulator //////////
+
+// The (running) XOR of the media packets in a row or column:
+
+class SMPTE2022FECAccumulator {
+public:
+  SMPTE2022FECAccumulator() : fPayload(new unsigned char[MAX_FEC_PAYLOAD_SIZE]) { reset(); }
+  virtual ~SMPTE2022FECAccumulator() { delete[] fPayload; }
+
+  void reset() {
+    fNumPackets = 0;
+    fLengthRecovery = 0; fPTRecovery = 0; fTSRecovery = 0;
+    fPayloadSize = 0;
+  }
+  void addPacket(u_int16_t seqNum, u_int8_t payloadType, u_int32_t timestamp,
+		 unsigned char const* payload, unsigned payloadSize) {
+    if (fNumPackets++ == 0) fSNBase = seqNum;
+    fLastTimestamp = timestamp;
+
+    fLengthRecovery ^= (u_int16_t)payloadSize;
+    fPTRecovery ^= payloadType;
+    fTSRecovery ^= timestamp;
+
+    if (payloadSize > MAX_FEC_PAYLOAD_SIZE) payloadSize = MAX_FEC_PAYLOAD_SIZE;
+    if (payloadSize > fPayloadSize) {
+      // Shorter packets are treated as if they were padded with zeros:
+      memset(&fPayload[fPayloadSize], 0, payloadSize - fPayloadSize);
+      fPayloadSize = payloadSize;
+    }
+    xorBytes(fPayload, payload, payloadSize);
+  }
+
+public:
+  unsigned fNumPackets;
+  u_int16_t fSNBase;
+  u_int32_t fLastTimestamp;
+  u_int16_t fLengthRecovery;
+  u_int8_t fPTRecovery;
+  u_int32_t fTSRecovery;
+  unsigned char* fPayload;
+  unsigned fPayloadSize;
+};
+
+
+////////// SMPTE2022FECSender //////////
+
+SMPTE2022FECSender*
+SMPTE2022FECSender::createNew(UsageEnvironment& env, RTPSink* mediaSink,
+			      Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock,
+			      unsigned numColumns, unsigned numRows,
+			      unsigned char fecPayloadType) {
+  if (mediaSink == NULL || columnFECGroupsock == NULL) return NULL;
+  if (numColumns == 0 || numRows == 0 || numColumns > 20 || numRows > 20 || numColumns*numRows > 100) {
+    env.setResultMsg("SMPTE2022FECSender: Bad FEC matrix size (it must have 1-20 columns, 1-20 rows, and at most 100 packets)");
+    return NULL;
+  }
+
+  return new SMPTE2022FECSender(env, mediaSink, columnFECGroupsock, rowFECGroupsock,
+				numColumns, numRows, fecPayloadType);
+}
+
+SMPTE2022FECSender
+::SMPTE2022FECSender(UsageEnvironment& env, RTPSink* mediaSink,
+		     Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock,
+		     unsigned numColumns, unsigned numRows, unsigned char fecPayloadType)
+  : Medium(env), fMediaSink(mediaSink),
+    fColumnFECGroupsock(columnFECGroupsock), fRowFECGroupsock(rowFECGroupsock),
+    fNumColumns(numColumns), fNumRows(numRows), fFECPayloadType(fecPayloadType),
+    fHaveStartedMatrix(False), fMatrixBaseSeqNum(0),
+    fColumnFECSeqNum((u_int16_t)our_random()), fRowFECSeqNum((u_int16_t)our_random()),
+    fNumFECPacketsSent(0) {
+  fColumnAccumulators = new SMPTE2022FECAccumulator[fNumColumns];
+  fRowAccumulator = new SMPTE2022FECAccumulator;
+  fOutBuf = new unsigned char[12 + FEC_HEADER_SIZE + MAX_FEC_PAYLOAD_SIZE];
+
+  fMediaSink->addAfterSendingPacketHandler(afterSendingMediaPacket, this);
+}
+
+SMPTE2022FECSender::~SMPTE2022FECSender() {
+  fMediaSink->removeAfterSendingPacketHandler(afterSendingMediaPacket, this);
+
+  delete[] fOutBuf;
+  delete fRowAccumulator;
+  delete[] fColumnAccumulators;
+}
+
+void SMPTE2022FECSender
+::afterSendingMediaPacket(void* clientData, unsigned char const* packet, unsigned packetSize) {
+  ((SMPTE2022FECSender*)clientData)->afterSendingMediaPacket1(packet, packetSize);
+}
+
+void SMPTE2022FECSender::afterSendingMediaPacket1(unsigned char const* packet, unsigned packetSize) {
+  unsigned headerSize = rtpHeaderSize(packet, packetSize);
+  if (headerSize == 0) return;
+
+  u_int8_t payloadType = packet[1]&0x7F;
+  u_int16_t seqNum = (packet[2]<<8)|packet[3];
+  u_int32_t timestamp = (packet[4]<<24)|(packet[5]<<16)|(packet[6]<<8)|packet[7];
+  unsigned char const* payload = &packet[headerSize];
+  unsigned payloadSize = packetSize - headerSize;
+
+  // Figure out where this packet lies within the current matrix (starting a new matrix if necessary):
+  unsigned const matrixSize = fNumColumns*fNumRows;
+  u_int16_t index = seqNum - fMatrixBaseSeqNum;
+  if (!fHaveStartedMatrix || index >= matrixSize) {
+    if (fHaveStartedMatrix && index == matrixSize) {
+      fMatrixBaseSeqNum += matrixSize; // the normal case: the next matrix follows on from the previous one
+    } else {
+      // This is the first packet, or there's been a jump in sequence numbers.  Forget any partial rows and columns:
+      fMatrixBaseSeqNum = seqNum;
+      for (unsigned i = 0; i < fNumColumns; ++i) fColumnAccumulators[i].reset();
+      fRowAccumulator->reset();
+      fHaveStartedMatrix = True;
+    }
+    index = seqNum - fMatrixBaseSeqNum;
+  }
+  unsigned row = index/fNumColumns;
+  unsigned column = index%fNumColumns;
+
+  // Add the packet to its column (and row), and send the column's (or row's) FEC packet, if it's now complete:
+  SMPTE2022FECAccumulator& columnAccumulator = fColumnAccumulators[column];
+  columnAccumulator.addPacket(seqNum, payloadType, timestamp, payload, payloadSize);
+  if (row == fNumRows-1) sendFECPacket(columnAccumulator, fColumnFECGroupsock, False);
+
+  if (fRowFECGroupsock != NULL) {
+    fRowAccumulator->addPacket(seqNum, payloadType, timestamp, payload, payloadSize);
+    if (column == fNumColumns-1) sendFECPacket(*fRowAccumulator, fRowFECGroupsock, True);
+  }
+}
+
+void SMPTE2022FECSender::sendFECPacket(SMPTE2022FECAccumulator& accumulator, Groupsock* gs, Boolean isRowFEC) {
+  if (accumulator.fNumPackets == (isRowFEC ? fNumColumns : fNumRows)) { // sanity check
+    unsigned char* p = fOutBuf;
+
+    // The RTP header:
+    u_int16_t& seqNum = isRowFEC ? fRowFECSeqNum : fColumnFECSeqNum;
+    *p++ = 0x80; // version 2; no padding, extension or CSRCs
+    *p++ = fFECPayloadType;
+    *p++ = seqNum>>8; *p++ = (u_int8_t)seqNum;
+    ++seqNum;
+    u_int32_t timestamp = accumulator.fLastTimestamp;
+    *p++ = timestamp>>24; *p++ = timestamp>>16; *p++ = timestamp>>8; *p++ = timestamp;
+    *p++ = 0; *p++ = 0; *p++ = 0; *p++ = 0; // SSRC (unused)
+
+    // The FEC header:
+    *p++ = accumulator.fSNBase>>8; *p++ = (u_int8_t)accumulator.fSNBase; // SNBase low bits
+    *p++ = accumulator.fLengthRecovery>>8; *p++ = (u_int8_t)accumulator.fLengthRecovery; // Length recovery
+    *p++ = 0x80|accumulator.fPTRecovery; // E=1; PT recovery
+    *p++ = 0; *p++ = 0; *p++ = 0; // Mask (unused)
+    u_int32_t tsRecovery = accumulator.fTSRecovery;
+    *p++ = tsRecovery>>24; *p++ = tsRecovery>>16; *p++ = tsRecovery>>8; *p++ = tsRecovery; // TS recovery
+    *p++ = isRowFEC ? 0x40 : 0x00; // N=0; D (0 for a column, 1 for a row); type=0 (XOR); index=0
+    *p++ = isRowFEC ? 1 : fNumColumns; // Offset
+    *p++ = isRowFEC ? fNumColumns : fNumRows; // NA
+    *p++ = 0; // SNBase ext bits
+
+    // The FEC payload:
+    memmove(p, accumulator.fPayload, accumulator.fPayloadSize);
+    p += accumulator.fPayloadSize;
+
+    if (gs->output(envir(), gs->ttl(), fOutBuf, p - fOutBuf)) ++fNumFECPacketsSent;
+  }
+
+  accumulator.reset();
+}
+
+
+////////// SMPTE2022MediaPacketHistory //////////
+
+// A record of the media packets that we've received (or recovered) recently, indexed by sequence number:
+
+#define MEDIA_PACKET_HISTORY_SIZE 256 // must be a power of 2, and comfortably larger than the largest FEC matrix (100)
+
+class SMPTE2022MediaPacketHistory {
+public:
+  SMPTE2022MediaPacketHistory();
+  virtual ~SMPTE2022MediaPacketHistory();
+
+  void storePacket(u_int16_t seqNum, u_int8_t payloadType, u_int32_t timestamp,
+		   unsigned char const* payload, unsigned payloadSize);
+  Boolean havePacket(u_int16_t seqNum) const {
+    Slot const& slot = fSlots[seqNum&(MEDIA_PACKET_HISTORY_SIZE-1)];
+    return slot.isValid && slot.seqNum == seqNum;
+  }
+  Boolean haveSeenAnyPackets() const { return fHaveSeenAnyPackets; }
+  u_int16_t highestSeqNum() const { return fHighestSeqNum; }
+
+public:
+  struct Slot {
+    Boolean isValid;
+    u_int16_t seqNum;
+    u_int8_t payloadType;
+    u_int32_t timestamp;
+    unsigned char* payload;
+    unsigned payloadSize, bufferSize;
+  };
+  Slot const& slotFor(u_int16_t seqNum) const { return fSlots[seqNum&(MEDIA_PACKET_HISTORY_SIZE-1)]; }
+
+private:
+  Slot fSlots[MEDIA_PACKET_HISTORY_SIZE];
+  Boolean fHaveSeenAnyPackets;
+  u_int16_t fHighestSeqNum;
+};
+
+SMPTE2022MediaPacketHistory::SMPTE2022MediaPacketHistory()
+  : fHaveSeenAnyPackets(False), fHighestSeqNum(0) {
+  for (unsigned i = 0; i < MEDIA_PACKET_HISTORY_SIZE; ++i) {
+    fSlots[i].isValid = False;
+    fSlots[i].payload = NULL;
+    fSlots[i].payloadSize = fSlots[i].bufferSize = 0;
+  }
+}
+
+SMPTE2022MediaPacketHistory::~SMPTE2022MediaPacketHistory() {
+  for (unsigned i = 0; i < MEDIA_PACKET_HISTORY_SIZE; ++i) delete[] fSlots[i].payload;
+}
+
+void SMPTE2022MediaPacketHistory
+::storePacket(u_int16_t seqNum, u_int8_t payloadType, u_int32_t timestamp,
+	      unsigned char const* payload, unsigned payloadSize) {
+  if (payloadSize > MAX_FEC_PAYLOAD_SIZE) return; // too big to be protected by FEC
+
+  Slot& slot = fSlots[seqNum&(MEDIA_PACKET_HISTORY_SIZE-1)];
+  if (payloadSize > slot.bufferSize) {
+    delete[] slot.payload;
+    slot.payload = new unsigned char[payloadSize];
+    slot.bufferSize = payloadSize;
+  }
+  memmove(slot.payload, payload, payloadSize);
+  slot.payloadSize = payloadSize;
+  slot.seqNum = seqNum;
+  slot.payloadType = payloadType;
+  slot.timestamp = timestamp;
+  slot.isValid = True;
+
+  if (!fHaveSeenAnyPackets || seqNumLT(fHighestSeqNum, seqNum)) fHighestSeqNum = seqNum;
+  fHaveSeenAnyPackets = True;
+}
+
+
+////////// SMPTE2022PendingFECPacket //////////
+
+// A FEC packet that we've received, but haven't yet been able to use (because more than one of the packets
+// that it protects is missing):
+
+#define MAX_NUM_PENDING_FEC_PACKETS 64
+
+class SMPTE2022PendingFECPacket {
+public:
+  SMPTE2022PendingFECPacket() : fPayload(new unsigned char[MAX_FEC_PAYLOAD_SIZE]), fPayloadSize(0) {}
+  virtual ~SMPTE2022PendingFECPacket() { delete[] fPayload; }
+
+  Boolean parse(unsigned char const* packet, unsigned packetSize); // returns False if the packet is bad
+
+  u_int16_t protectedSeqNum(unsigned i) const { return fSNBase + i*fOffset; }
+  void copyFrom(SMPTE2022PendingFECPacket const& from) {
+    fSNBase = from.fSNBase; fOffset = from.fOffset; fNA = from.fNA;
+    fLengthRecovery = from.fLengthRecovery; fPTRecovery = from.fPTRecovery; fTSRecovery = from.fTSRecovery;
+    memmove(fPayload, from.fPayload, from.fPayloadSize); fPayloadSize = from.fPayloadSize;
+  }
+
+public:
+  u_int16_t fSNBase;
+  unsigned fOffset, fNA;
+  u_int16_t fLengthRecovery;
+  u_int8_t fPTRecovery;
+  u_int32_t fTSRecovery;
+  unsigned char* fPayload;
+  unsigned fPayloadSize;
+};
+
+Boolean SMPTE2022PendingFECPacket::parse(unsigned char const* packet, unsigned packetSize) {
+  unsigned headerSize = rtpHeaderSize(packet, packetSize);
+  if (headerSize == 0 || headerSize + FEC_HEADER_SIZE > packetSize) return False;
+  unsigned char const* fecHeader = &packet[headerSize];
+
+  if ((fecHeader[12]&0x38) != 0) return False; // we handle only the XOR type of FEC
+  fSNBase = (fecHeader[0]<<8)|fecHeader[1];
+  fLengthRecovery = (fecHeader[2]<<8)|fecHeader[3];
+  fPTRecovery = fecHeader[4]&0x7F;
+  fTSRecovery = (fecHeader[8]<<24)|(fecHeader[9]<<16)|(fecHeader[10]<<8)|fecHeader[11];
+  fOffset = fecHeader[13];
+  fNA = fecHeader[14];
+  if (fOffset == 0 || fNA == 0 || (fNA-1)*fOffset >= MEDIA_PACKET_HISTORY_SIZE/2) return False;
+
+  fPayloadSize = packetSize - headerSize - FEC_HEADER_SIZE;
+  if (fPayloadSize > MAX_FEC_PAYLOAD_SIZE) return False;
+  memmove(fPayload, &fecHeader[FEC_HEADER_SIZE], fPayloadSize);
+
+  return True;
+}
+
+
+////////// SMPTE2022FECReceiver //////////
+
+SMPTE2022FECReceiver*
+SMPTE2022FECReceiver::createNew(UsageEnvironment& env, MultiFramedRTPSource* mediaSource,
+				Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock) {
+  if (mediaSource == NULL || columnFECGroupsock == NULL) return NULL;
+
+  return new SMPTE2022FECReceiver(env, mediaSource, columnFECGroupsock, rowFECGroupsock);
+}
+
+SMPTE2022FECReceiver
+::SMPTE2022FECReceiver(UsageEnvironment& env, MultiFramedRTPSource* mediaSource,
+		       Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock)
+  : Medium(env), fMediaSource(mediaSource),
+    fColumnFECGroupsock(columnFECGroupsock), fRowFECGroupsock(rowFECGroupsock),
+    fNumPendingFECPackets(0), fRecoveryTask(NULL),
+    fNumRecoveredPackets(0), fNumLateRecoveredPackets(0), fNumFECPacketsReceived(0) {
+  fMediaPackets = new SMPTE2022MediaPacketHistory;
+  fPendingFECPackets = new SMPTE2022PendingFECPacket[MAX_NUM_PENDING_FEC_PACKETS];
+  fInBuf = new unsigned char[12 + FEC_HEADER_SIZE + MAX_FEC_PAYLOAD_SIZE + 100/*for any CSRCs or header extension*/];
+
+  fMediaSource->setIncomingPacketHandler(incomingMediaPacketHandler, this);
+
+  // Await incoming FEC packets:
+  increaseReceiveBufferTo(env, fColumnFECGroupsock->socketNum(), 50*1024);
+  makeSocketNonBlocking(fColumnFECGroupsock->socketNum());
+  envir().taskScheduler().turnOnBackgroundReadHandling(fColumnFECGroupsock->socketNum(),
+	(TaskScheduler::BackgroundHandlerProc*)&incomingColumnFECPacketHandler, this);
+  if (fRowFECGroupsock != NULL) {
+    increaseReceiveBufferTo(env, fRowFECGroupsock->socketNum(), 50*1024);
+    makeSocketNonBlocking(fRowFECGroupsock->socketNum());
+    envir().taskScheduler().turnOnBackgroundReadHandling(fRowFECGroupsock->socketNum(),
+	(TaskScheduler::BackgroundHandlerProc*)&incomingRowFECPacketHandler, this);
+  }
+}
+
+SMPTE2022FECReceiver::~SMPTE2022FECReceiver() {
+  envir().taskScheduler().turnOffBackgroundReadHandling(fColumnFECGroupsock->socketNum());
+  if (fRowFECGroupsock != NULL) envir().taskScheduler().turnOffBackgroundReadHandling(fRowFECGroupsock->socketNum());
+  envir().taskScheduler().unscheduleDelayedTask(fRecoveryTask);
+  fMediaSource->setIncomingPacketHandler(NULL, NULL);
+
+  delete[] fInBuf;
+  delete[] fPendingFECPackets;
+  delete fMediaPackets;
+}
+
+void SMPTE2022FECReceiver
+::incomingMediaPacketHandler(void* clientData, unsigned char const* packet, unsigned packetSize) {
+  ((SMPTE2022FECReceiver*)clientData)->incomingMediaPacketHandler1(packet, packetSize);
+}
+
+void SMPTE2022FECReceiver::incomingMediaPacketHandler1(unsigned char const* packet, unsigned packetSize) {
+  unsigned headerSize = rtpHeaderSize(packet, packetSize);
+  if (headerSize == 0) return;
+
+  fMediaPackets->storePacket((packet[2]<<8)|packet[3], packet[1]&0x7F,
+			     (packet[4]<<24)|(packet[5]<<16)|(packet[6]<<8)|packet[7],
+			     &packet[headerSize], packetSize - headerSize);
+
+  if (fNumPendingFECPackets > 0 && fRecoveryTask == NULL) {
+    // This packet might let us use a FEC packet that we're holding.  We can't give any recovered packets to our
+    // media source while it's handling this packet, so try again once we've returned to the event loop:
+    fRecoveryTask = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)recoveryHandler, this);
+  }
+}
+
+void SMPTE2022FECReceiver::incomingColumnFECPacketHandler(SMPTE2022FECReceiver* receiver, int /*mask*/) {
+  receiver->incomingFECPacketHandler1(receiver->fColumnFECGroupsock);
+}
+
+void SMPTE2022FECReceiver::incomingRowFECPacketHandler(SMPTE2022FECReceiver* receiver, int /*mask*/) {
+  receiver->incomingFECPacketHandler1(receiver->fRowFECGroupsock);
+}
+
+void SMPTE2022FECReceiver::incomingFECPacketHandler1(Groupsock* gs) {
+  unsigned packetSize;
+  struct sockaddr_in fromAddress;
+  if (!gs->handleRead(fInBuf, 12 + FEC_HEADER_SIZE + MAX_FEC_PAYLOAD_SIZE + 100, packetSize, fromAddress)) return;
+
+  if (fNumPendingFECPackets == MAX_NUM_PENDING_FEC_PACKETS) {
+    // We're full (this should be rare).  Drop our oldest FEC packet, to make room:
+    SMPTE2022PendingFECPacket* oldest = &fPendingFECPackets[0];
+    for (unsigned i = 1; i < fNumPendingFECPackets; ++i) {
+      if (seqNumLT(fPendingFECPackets[i].fSNBase, oldest->fSNBase)) oldest = &fPendingFECPackets[i];
+    }
+    --fNumPendingFECPackets;
+    if (oldest != &fPendingFECPackets[fNumPendingFECPackets]) oldest->copyFrom(fPendingFECPackets[fNumPendingFECPackets]);
+  }
+
+  if (!fPendingFECPackets[fNumPendingFECPackets].parse(fInBuf, packetSize)) return;
+  ++fNumPendingFECPackets;
+  ++fNumFECPacketsReceived;
+
+  tryToRecoverPackets();
+}
+
+void SMPTE2022FECReceiver::recoveryHandler(SMPTE2022FECReceiver* receiver) {
+  receiver->fRecoveryTask = NULL;
+  receiver->tryToRecoverPackets();
+}
+
+void SMPTE2022FECReceiver::tryToRecoverPackets() {
+  // Recovering a packet can let us use another FEC packet (e.g., a column's, after a row's FEC packet has recovered a
+  // packet in that column), so keep going until we make no more progress:
+  Boolean madeProgress;
+  do {
+    madeProgress = False;
+    for (unsigned i = 0; i < fNumPendingFECPackets; ) {
+      Boolean fecPacketIsNoLongerNeeded = False;
+      if (tryToRecoverPacket(fPendingFECPackets[i], fecPacketIsNoLongerNeeded)) madeProgress = True;
+
+      if (fecPacketIsNoLongerNeeded) {
+	// Remove this FEC packet (by replacing it with the last one):
+	--fNumPendingFECPackets;
+	if (i != fNumPendingFECPackets) fPendingFECPackets[i].copyFrom(fPendingFECPackets[fNumPendingFECPackets]);
+      } else {
+	++i;
+      }
+    }
+  } while (madeProgress);
+}
+
+Boolean SMPTE2022FECReceiver
+::tryToRecoverPacket(SMPTE2022PendingFECPacket& fecPacket, Boolean& fecPacketIsNoLongerNeeded) {
+  // Check how many of the packets that this FEC packet protects are missing:
+  unsigned numMissing = 0;
+  u_int16_t missingSeqNum = 0;
+  for (unsigned i = 0; i < fecPacket.fNA; ++i) {
+    u_int16_t seqNum = fecPacket.protectedSeqNum(i);
+    if (!fMediaPackets->havePacket(seqNum)) {
+      ++numMissing;
+      missingSeqNum = seqNum;
+    }
+  }
+
+  if (numMissing == 0) {
+    fecPacketIsNoLongerNeeded = True;
+    return False;
+  }
+  if (numMissing > 1) {
+    // We can't use this FEC packet yet.  Hold on to it, unless it's now too old to be useful:
+    u_int16_t lastSeqNum = fecPacket.protectedSeqNum(fecPacket.fNA-1);
+    fecPacketIsNoLongerNeeded = !fMediaPackets->haveSeenAnyPackets()
+      || (u_int16_t)(fMediaPackets->highestSeqNum() - lastSeqNum) >= MEDIA_PACKET_HISTORY_SIZE/2;
+    return False;
+  }
+
+  // Exactly one packet is missing, so recover it, by XORing the FEC packet with all of the other packets:
+  fecPacketIsNoLongerNeeded = True;
+  u_int16_t lengthRecovery = fecPacket.fLengthRecovery;
+  u_int8_t ptRecovery = fecPacket.fPTRecovery;
+  u_int32_t tsRecovery = fecPacket.fTSRecovery;
+  unsigned char* recoveredPayload = &fInBuf[12];
+  memmove(recoveredPayload, fecPacket.fPayload, fecPacket.fPayloadSize);
+  for (unsigned i = 0; i < fecPacket.fNA; ++i) {
+    u_int16_t seqNum = fecPacket.protectedSeqNum(i);
+    if (seqNum == missingSeqNum) continue;
+
+    SMPTE2022MediaPacketHistory::Slot const& slot = fMediaPackets->slotFor(seqNum);
+    lengthRecovery ^= (u_int16_t)slot.payloadSize;
+    ptRecovery ^= slot.payloadType;
+    tsRecovery ^= slot.timestamp;
+    xorBytes(recoveredPayload, slot.payload, slot.payloadSize < fecPacket.fPayloadSize ? slot.payloadSize : fecPacket.fPayloadSize);
+  }
+  unsigned recoveredPayloadSize = lengthRecovery;
+  if (recoveredPayloadSize > fecPacket.fPayloadSize) return False; // the FEC packet must have been bad
+
+  // Reconstruct the packet's RTP header:
+  u_int32_t ssrc = fMediaSource->lastReceivedSSRC();
+  unsigned char* p = fInBuf;
+  *p++ = 0x80; // version 2; no padding, extension or CSRCs
+  *p++ = ptRecovery&0x7F; // Note: We can't recover the 'M' bit (but MPEG Transport Streams don't use it)
+  *p++ = missingSeqNum>>8; *p++ = (u_int8_t)missingSeqNum;
+  *p++ = tsRecovery>>24; *p++ = tsRecovery>>16; *p++ = tsRecovery>>8; *p++ = tsRecovery;
+  *p++ = ssrc>>24; *p++ = ssrc>>16; *p++ = ssrc>>8; *p++ = ssrc;
+
+  // Remember the recovered packet (because it might help us recover others), and hand it to our media source:
+  fMediaPackets->storePacket(missingSeqNum, ptRecovery&0x7F, tsRecovery, recoveredPayload, recoveredPayloadSize);
+  if (fMediaSource->injectPacket(fInBuf, 12 + recoveredPayloadSize)) {
+    ++fNumRecoveredPackets;
+  } else {
+    ++fNumLateRecoveredPackets;
+  }
+
+  return True;
+}
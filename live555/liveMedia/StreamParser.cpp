@@ -22,13 +22,20 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include <string.h>
 #include <stdlib.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define BANK_SIZE 150000
+#define MAX_BANK_SIZE (64*BANK_SIZE)
 
 void StreamParser::flushInput() {
   fCurParserIndex = fSavedParserIndex = 0;
   fSavedRemainingUnparsedBits = fRemainingUnparsedBits = 0;
   fTotNumValidBytes = 0;
+  fScanTag = NULL;
 }
 
 StreamParser::StreamParser(FramedSource* inputSource,
@@ -42,9 +49,10 @@ StreamParser::StreamParser(FramedSource* inputSource,
     fClientContinueClientData(clientContinueClientData),
     fSavedParserIndex(0), fSavedRemainingUnparsedBits(0),
     fCurParserIndex(0), fRemainingUnparsedBits(0),
-    fTotNumValidBytes(0), fHaveSeenEOF(False) {
-  fBank[0] = new unsigned char[BANK_SIZE];
-  fBank[1] = new unsigned char[BANK_SIZE];
+    fTotNumValidBytes(0), fBankSize(BANK_SIZE),
+    fScanStartIndex(0), fScanEndIndex(0), fScanTag(NULL), fHaveSeenEOF(False) {
+  fBank[0] = new unsigned char[fBankSize];
+  fBank[1] = new unsigned char[fBankSize];
   fCurBankNum = 0;
   fCurBank = fBank[fCurBankNum];
 
@@ -58,6 +66,7 @@ StreamParser::~StreamParser() {
 void StreamParser::saveParserState() {
   fSavedParserIndex = fCurParserIndex;
   fSavedRemainingUnparsedBits = fRemainingUnparsedBits;
+  fScanTag = NULL; // any scan progress that we noted is no longer useful
 }
 
 void StreamParser::restoreSavedParserState() {
@@ -112,8 +121,105 @@ unsigned StreamParser::getBits(unsigned numBits) {
   }
 }
 
+#if defined(__AVX2__) || defined(__SSE2__)
+static inline unsigned countTrailingZeros(unsigned x) { // "x" != 0
+#ifdef __GNUC__
+  return __builtin_ctz(x);
+#else
+  unsigned result = 0;
+  while ((x&1) == 0) { x >>= 1; ++result; }
+  return result;
+#endif
+}
+#endif
+
+unsigned StreamParser::findStartCode(unsigned char const* ptr, unsigned size) {
+  unsigned i = 0;
+
+  // Compare many candidate positions at once: Position "j" begins a start code iff
+  // ptr[j] == 0 && ptr[j+1] == 0 && ptr[j+2] == 1
+#if defined(__AVX2__)
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const one = _mm256_set1_epi8(1);
+  for (; i + 32 + 2 <= size; i += 32) {
+    __m256i b0 = _mm256_loadu_si256((__m256i const*)&ptr[i]);
+    __m256i b1 = _mm256_loadu_si256((__m256i const*)&ptr[i+1]);
+    __m256i b2 = _mm256_loadu_si256((__m256i const*)&ptr[i+2]);
+    __m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+				     _mm256_cmpeq_epi8(b2, one));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(match);
+    if (mask != 0) return i + countTrailingZeros(mask);
+  }
+#elif defined(__SSE2__)
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const one = _mm_set1_epi8(1);
+  for (; i + 16 + 2 <= size; i += 16) {
+    __m128i b0 = _mm_loadu_si128((__m128i const*)&ptr[i]);
+    __m128i b1 = _mm_loadu_si128((__m128i const*)&ptr[i+1]);
+    __m128i b2 = _mm_loadu_si128((__m128i const*)&ptr[i+2]);
+    __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+				  _mm_cmpeq_epi8(b2, one));
+    unsigned mask = (unsigned)_mm_movemask_epi8(match);
+    if (mask != 0) return i + countTrailingZeros(mask);
+  }
+#endif
+
+  // Check any remaining positions (or all positions, if we don't have SIMD instructions).
+  // We look at every third byte: If it's > 1, then no start code can begin at it, or at either of the two previous bytes:
+  while (i + 3 <= size) {
+    unsigned char c = ptr[i+2];
+    if (c > 1) {
+      i += 3;
+    } else if (c == 1) {
+      if (ptr[i] == 0 && ptr[i+1] == 0) return i;
+      i += 3;
+    } else { // c == 0
+      ++i;
+    }
+  }
+
+  return size;
+}
+
+unsigned StreamParser::scanForStartCode(Boolean& foundStartCode) {
+  unsigned numBufferedBytes = fTotNumValidBytes - fCurParserIndex;
+  unsigned offset = findStartCode(nextToParse(), numBufferedBytes);
+  if (offset < numBufferedBytes) {
+    foundStartCode = True;
+    return offset;
+  }
+
+  foundStartCode = False;
+  // The last 3 buffered bytes might be part of a start code that ends in data that we haven't read yet
+  // (or - for H.264 - a 0x00000001 start code), so don't include them:
+  if (numBufferedBytes > 3) return numBufferedBytes - 3;
+
+  ensureValidBytes(numBufferedBytes + 1); // reads more input data, and doesn't return
+  return 0; // to prevent compiler warning
+}
+
+unsigned StreamParser::numAvailableBytes(unsigned maxNumBytes) {
+  if (maxNumBytes == 0) return 0;
+
+  ensureValidBytes(1); // reads more input data (and doesn't return) if we have none
+  unsigned numBytes = fTotNumValidBytes - fCurParserIndex;
+  return numBytes < maxNumBytes ? numBytes : maxNumBytes;
+}
+
+void StreamParser::noteScanProgress(unsigned scanStartOffset, void const* scanTag) {
+  fScanStartIndex = scanStartOffset;
+  fScanEndIndex = fCurParserIndex;
+  fScanTag = scanTag;
+}
+
+unsigned StreamParser::previousScanProgress(void const* scanTag) const {
+  if (fScanTag == NULL || scanTag != fScanTag || fScanStartIndex != fCurParserIndex) return 0;
+
+  return fScanEndIndex - fScanStartIndex;
+}
+
 unsigned StreamParser::bankSize() const {
-  return BANK_SIZE;
+  return fBankSize;
 }
 
 #define NO_MORE_BUFFERED_INPUT 1
@@ -126,7 +232,7 @@ void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
 
   // First, check whether these new bytes would overflow the current
   // bank.  If so, start using a new bank now.
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
+  if (fCurParserIndex + numBytesNeeded > fBankSize) {
     // Swap banks, but save any still-needed bytes from the old bank:
     unsigned numBytesToSave = fTotNumValidBytes - fSavedParserIndex;
     unsigned char const* from = &curBank()[fSavedParserIndex];
@@ -135,24 +241,40 @@ void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
     fCurBank = fBank[fCurBankNum];
     memmove(curBank(), from, numBytesToSave);
     fCurParserIndex = fCurParserIndex - fSavedParserIndex;
+    fScanStartIndex -= fSavedParserIndex; fScanEndIndex -= fSavedParserIndex; // (meaningful only if "fScanTag" != NULL)
     fSavedParserIndex = 0;
     fTotNumValidBytes = numBytesToSave;
   }
 
+  if (fCurParserIndex + numBytesNeeded > fBankSize && fCurParserIndex + numBytesNeeded <= MAX_BANK_SIZE) {
+    // The saved parser state (e.g., a single, large frame) doesn't fit in a bank.  Use larger banks:
+    unsigned newBankSize = 2*fBankSize;
+    if (newBankSize < fCurParserIndex + numBytesNeeded) newBankSize = fCurParserIndex + numBytesNeeded;
+    if (newBankSize > MAX_BANK_SIZE) newBankSize = MAX_BANK_SIZE;
+
+    unsigned char* newBank = new unsigned char[newBankSize];
+    memmove(newBank, curBank(), fTotNumValidBytes);
+    delete[] fBank[0]; delete[] fBank[1];
+    fBank[fCurBankNum] = newBank;
+    fBank[(fCurBankNum + 1)%2] = new unsigned char[newBankSize];
+    fCurBank = newBank;
+    fBankSize = newBankSize;
+  }
+
   // ASSERT: fCurParserIndex + numBytesNeeded > fTotNumValidBytes
-  //      && fCurParserIndex + numBytesNeeded <= BANK_SIZE
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
+  //      && fCurParserIndex + numBytesNeeded <= fBankSize
+  if (fCurParserIndex + numBytesNeeded > fBankSize) {
     // If this happens, it means that we have too much saved parser state.
-    // To fix this, increase BANK_SIZE as appropriate.
+    // To fix this, increase MAX_BANK_SIZE as appropriate.
     fInputSource->envir() << "StreamParser internal error ("
 			  << fCurParserIndex << " + "
 			  << numBytesNeeded << " > "
-			  << BANK_SIZE << ")\n";
+			  << fBankSize << ")\n";
     fInputSource->envir().internalError();
   }
 
   // Try to read as many new bytes as will fit in the current bank:
-  unsigned maxNumBytesToRead = BANK_SIZE - fTotNumValidBytes;
+  unsigned maxNumBytesToRead = fBankSize - fTotNumValidBytes;
   fInputSource->getNextFrame(&curBank()[fTotNumValidBytes],
 			     maxNumBytesToRead,
 			     afterGettingBytes, this,
@@ -172,11 +294,11 @@ void StreamParser::afterGettingBytes(void* clientData,
 
 void StreamParser::afterGettingBytes1(unsigned numBytesRead, struct timeval presentationTime) {
   // Sanity check: Make sure we didn't get too many bytes for our bank:
-  if (fTotNumValidBytes + numBytesRead > BANK_SIZE) {
+  if (fTotNumValidBytes + numBytesRead > fBankSize) {
     fInputSource->envir()
       << "StreamParser::afterGettingBytes() warning: read "
       << numBytesRead << " bytes; expected no more than "
-      << BANK_SIZE - fTotNumValidBytes << "\n";
+      << fBankSize - fTotNumValidBytes << "\n";
   }
 
   fLastSeenPresentationTime = presentationTime;
@@ -30,6 +30,10 @@ class StreamParser
 public:
     virtual void flushInput();
 
+    static unsigned findStartCode(unsigned char const* ptr, unsigned size);
+    // Returns the offset of the first 0x000001 'start code' in "ptr[0..size-1]", or "size" if there is none.
+    // (This uses SSE2 or AVX2 instructions, if they are available at compile time.)
+
 protected: // we're a virtual base class
     typedef void (clientContinueFunc)(void* clientData,
                                       unsigned char* ptr, unsigned size,
@@ -102,6 +106,25 @@ protected: // we're a virtual base class
         fCurParserIndex += numBytes;
     }
 
+    unsigned scanForStartCode(Boolean& foundStartCode);
+    // Looks - in the input data that's already been read, beginning at the current position - for a 0x000001 'start code'.
+    // If one is found, sets "foundStartCode" to True, and returns its offset from the current position.  Otherwise,
+    // sets "foundStartCode" to False, and returns the (non-zero) number of bytes that definitely precede any start code,
+    // (reading more input data first, if necessary).  In either case, the current position is not changed.
+
+    unsigned numAvailableBytes(unsigned maxNumBytes);
+    // Returns the number of input bytes - up to "maxNumBytes" - that have already been read, but not yet parsed (reading more
+    // input data first, if there are none).  This lets a parser consume a large object (e.g., a frame) piece by piece, as the
+    // input data arrives, rather than waiting until all of it is present in the buffer.
+
+    // Support for 'resumable' scans: When a parser runs out of input data, it gets restarted (once more data has arrived) from
+    // its saved state.  To avoid re-scanning the same data each time that this happens, a long scan (e.g., for the next start code)
+    // can call "noteScanProgress()" - with the offset at which the scan began, and a 'tag' that identifies it - as it goes.
+    // When the scan is repeated (from the same offset, with the same tag), "previousScanProgress()" then returns the number of
+    // bytes that were already scanned (and consumed) - otherwise 0.  (Noted progress is forgotten when the parser state is saved.)
+    void noteScanProgress(unsigned scanStartOffset, void const* scanTag);
+    unsigned previousScanProgress(void const* scanTag) const;
+
     void skipBits(unsigned numBits);
     unsigned getBits(unsigned numBits);
     // numBits <= 32; returns data into low-order bits of result
@@ -177,7 +200,14 @@ private:
     unsigned char fRemainingUnparsedBits; // in previous byte: [0,7]
 
     // The total number of valid bytes stored in the current bank:
-    unsigned fTotNumValidBytes; // <= BANK_SIZE
+    unsigned fTotNumValidBytes; // <= fBankSize
+
+    // The current size of each bank.  (This grows if a saved parser state - e.g., a very large frame - doesn't fit.)
+    unsigned fBankSize;
+
+    // The progress of the most recent 'resumable' scan (if "fScanTag" != NULL):
+    unsigned fScanStartIndex, fScanEndIndex;
+    void const* fScanTag;
 
     // Whether we have seen EOF on the input source:
     Boolean fHaveSeenEOF;
@@ -0,0 +1,200 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A fast, read-only alternative to "BitVector", for parsing codec headers
+// C++ header
+
+#ifndef _BIT_READER_HH
+#define _BIT_READER_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#include "NetCommon.h"
+
+// "BitReader" has the same 'get' interface - and the same results - as "BitVector": Reading past the end of the data
+// returns 0 bits.  However, instead of copying each field a bit at a time, it keeps up to 63 upcoming bits in a 64-bit
+// 'cache' word, from which each field is extracted with a single shift, and it decodes Exp-Golomb codes by counting
+// the cache's leading zero bits.  (All member functions are inline, because they are called once per header field.)
+
+class BitReader {
+public:
+  BitReader(u_int8_t const* baseBytePtr,
+	    unsigned baseBitOffset,
+	    unsigned totNumBits) {
+    setup(baseBytePtr, baseBitOffset, totNumBits);
+  }
+
+  void setup(u_int8_t const* baseBytePtr,
+	     unsigned baseBitOffset,
+	     unsigned totNumBits) {
+    fBaseBytePtr = baseBytePtr;
+    fBaseBitOffset = baseBitOffset;
+    fTotNumBits = totNumBits;
+    fEndBytePtr = baseBytePtr + (baseBitOffset + totNumBits + 7)/8;
+    seekToBit(0);
+  }
+
+  unsigned getBits(unsigned numBits); // "numBits" <= 32
+  unsigned get1Bit();
+  Boolean get1BitBoolean() { return get1Bit() != 0; }
+
+  void skipBits(unsigned numBits);
+
+  unsigned curBitIndex() const { return fCurBitIndex; }
+  unsigned totNumBits() const { return fTotNumBits; }
+  unsigned numBitsRemaining() const { return fTotNumBits - fCurBitIndex; }
+
+  unsigned get_expGolomb();
+      // Returns the value of the next bits, assuming that they were encoded using an exponential-Golomb code of order 0
+
+private:
+  void refill();
+  void consume(unsigned numBits) { // "numBits" <= "fNumCachedBits"
+    fCache <<= numBits;
+    fNumCachedBits -= numBits;
+    fCurBitIndex += numBits;
+  }
+  void seekToBit(unsigned bitIndex);
+
+private:
+  u_int8_t const* fBaseBytePtr;
+  unsigned fBaseBitOffset;
+  unsigned fTotNumBits;
+  unsigned fCurBitIndex;
+
+  u_int8_t const* fNextBytePtr; // the next byte to be loaded into "fCache"
+  u_int8_t const* fEndBytePtr;
+  u_int64_t fCache; // the next bit to be read is the high-order bit
+  unsigned fNumCachedBits; // <= 63
+      // Note: Any bits of "fCache" after the first "fNumCachedBits" are either 0, or (after a word-sized load) are
+      // copies of the data that follows; either way, ORing the following bytes into "fCache" leaves it correct.
+};
+
+static inline unsigned countLeadingZeros32(u_int32_t x) { // "x" != 0
+#ifdef __GNUC__
+  return __builtin_clz(x);
+#else
+  unsigned result = 0;
+  while ((x&0x80000000) == 0) { x <<= 1; ++result; }
+  return result;
+#endif
+}
+
+inline void BitReader::refill() {
+  // Load data into "fCache", until it contains at least 56 bits (or until we run out of data):
+  if (fEndBytePtr - fNextBytePtr >= 8) {
+    // Common case: Load 8 bytes (big-endian) at once.  Only the whole bytes that fit are counted as having been loaded:
+    u_int8_t const* p = fNextBytePtr;
+    u_int64_t word
+      = ((u_int64_t)p[0]<<56) | ((u_int64_t)p[1]<<48) | ((u_int64_t)p[2]<<40) | ((u_int64_t)p[3]<<32)
+      | ((u_int64_t)p[4]<<24) | ((u_int64_t)p[5]<<16) | ((u_int64_t)p[6]<<8) | (u_int64_t)p[7];
+    fCache |= word>>fNumCachedBits;
+    fNextBytePtr += (63 - fNumCachedBits)>>3;
+    fNumCachedBits |= 56;
+  } else {
+    while (fNumCachedBits < 56 && fNextBytePtr < fEndBytePtr) {
+      fCache |= ((u_int64_t)(*fNextBytePtr++))<<(56 - fNumCachedBits);
+      fNumCachedBits += 8;
+    }
+  }
+}
+
+inline void BitReader::seekToBit(unsigned bitIndex) {
+  fCurBitIndex = bitIndex;
+  unsigned const totBitOffset = fBaseBitOffset + bitIndex;
+  fNextBytePtr = fBaseBytePtr + totBitOffset/8;
+  fCache = 0;
+  fNumCachedBits = 0;
+
+  unsigned const bitRem = totBitOffset%8;
+  if (bitRem > 0) {
+    // Discard the bits of the first byte that precede our position:
+    refill();
+    fCache <<= bitRem;
+    fNumCachedBits -= bitRem;
+  }
+}
+
+inline unsigned BitReader::getBits(unsigned numBits) {
+  if (numBits > 32) numBits = 32;
+
+  unsigned numBitsToRead = numBits;
+  if (numBitsToRead > fTotNumBits - fCurBitIndex) numBitsToRead = fTotNumBits - fCurBitIndex;
+  if (numBitsToRead == 0) return 0;
+
+  if (fNumCachedBits < numBitsToRead) refill();
+  unsigned result = (unsigned)(fCache>>(64 - numBitsToRead));
+  consume(numBitsToRead);
+
+  return result<<(numBits - numBitsToRead); // so any overflow bits are 0
+}
+
+inline unsigned BitReader::get1Bit() {
+  if (fCurBitIndex >= fTotNumBits) return 0; // overflow
+
+  if (fNumCachedBits == 0) refill();
+  unsigned result = (unsigned)(fCache>>63);
+  consume(1);
+
+  return result;
+}
+
+inline void BitReader::skipBits(unsigned numBits) {
+  if (numBits > fTotNumBits - fCurBitIndex) numBits = fTotNumBits - fCurBitIndex; // overflow
+
+  if (numBits <= fNumCachedBits) {
+    consume(numBits);
+  } else {
+    seekToBit(fCurBitIndex + numBits);
+  }
+}
+
+inline unsigned BitReader::get_expGolomb() {
+  unsigned const numBitsRemaining = fTotNumBits - fCurBitIndex;
+  if (fNumCachedBits < 32) refill();
+
+  // Look for the code's first 1 bit within the next 32 bits (or whatever fewer bits remain):
+  unsigned numBitsToTest = numBitsRemaining < 32 ? numBitsRemaining : 32;
+  u_int32_t nextBits = numBitsToTest == 0 ? 0 : (u_int32_t)(fCache>>32) & (0xFFFFFFFF<<(32 - numBitsToTest));
+
+  if (nextBits != 0) {
+    unsigned numLeadingZeroBits = countLeadingZeros32(nextBits);
+    consume(numLeadingZeroBits + 1);
+    return (1u<<numLeadingZeroBits) - 1 + getBits(numLeadingZeroBits);
+  }
+
+  if (numBitsToTest == numBitsRemaining) {
+    // The remaining bits are all 0.  (As in "BitVector", the final 0 bit is treated as the code's '1' bit.)
+    consume(numBitsRemaining);
+    return numBitsRemaining == 0 ? 0 : (1u<<(numBitsRemaining-1)) - 1;
+  }
+
+  // There are at least 32 leading 0 bits (so this isn't a value that any header field would have).
+  // Handle this (rare) case the same way that "BitVector" does:
+  unsigned numLeadingZeroBits = 0;
+  unsigned codeStart = 1;
+
+  while (get1Bit() == 0 && fCurBitIndex < fTotNumBits) {
+    ++numLeadingZeroBits;
+    codeStart *= 2;
+  }
+
+  return codeStart - 1 + getBits(numLeadingZeroBits);
+}
+
+#endif
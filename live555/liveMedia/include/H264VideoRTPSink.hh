@@ -53,6 +53,7 @@ protected: // redefined virtual functions:
 private: // redefined virtual functions:
   virtual Boolean sourceIsCompatibleWithUs(MediaSource& source);
   virtual Boolean continuePlaying();
+  virtual unsigned specialHeaderSize() const;
   virtual void doSpecialFrameHandling(unsigned fragmentationOffset,
                                       unsigned char* frameStart,
                                       unsigned numBytesInFrame,
@@ -72,20 +73,22 @@ private:
 
 ////////// H264FUAFragmenter definition //////////
 
-// Because of the ideosyncracies of the H.264 RTP payload format, we implement
-// "H264VideoRTPSink" using a separate "H264FUAFragmenter" class that delivers,
-// to the "H264VideoRTPSink", only fragments that will fit within an outgoing
-// RTP packet.  I.e., we implement fragmentation in this separate "H264FUAFragmenter"
-// class, rather than in "H264VideoRTPSink".
+// Because of the ideosyncracies of the H.264 RTP payload format, "H264VideoRTPSink" reads each NAL unit
+// through a separate "H264FUAFragmenter" class.  This reads each NAL unit directly into the sink's
+// output buffer.  If the NAL unit is too large for a single RTP packet, it converts it (in place) into
+// the start of a FU-A packet, and our sink then fragments it (again, in place), adding the FU indicator
+// and FU header bytes (from "fuIndicator()" and "fuHeader()") in front of each subsequent fragment.
 // (Note: This class should be used only by "H264VideoRTPSink", or a subclass.)
 
 class H264FUAFragmenter: public FramedFilter {
 public:
   H264FUAFragmenter(UsageEnvironment& env, FramedSource* inputSource,
-		    unsigned inputBufferMax, unsigned maxOutputPacketSize);
+		    unsigned maxOutputPacketSize);
   virtual ~H264FUAFragmenter();
 
-  Boolean lastFragmentCompletedNALUnit() const { return fLastFragmentCompletedNALUnit; }
+  u_int8_t fuIndicator() const { return fFUIndicator; }
+  u_int8_t fuHeader() const { return fFUHeader; } // without the S or E bits
+      // for the most recent NAL unit that we delivered (if it had to be sent as FU-A packets)
 
 private: // redefined virtual functions:
   virtual void doGetNextFrame();
@@ -101,13 +104,8 @@ private:
                           unsigned durationInMicroseconds);
 
 private:
-  unsigned fInputBufferSize;
   unsigned fMaxOutputPacketSize;
-  unsigned char* fInputBuffer;
-  unsigned fNumValidDataBytes;
-  unsigned fCurDataOffset;
-  unsigned fSaveNumTruncatedBytes;
-  Boolean fLastFragmentCompletedNALUnit;
+  u_int8_t fFUIndicator, fFUHeader;
 };
 
 
@@ -32,6 +32,15 @@ public:
 	    unsigned char rtpPayloadFormat,
 	    unsigned rtpTimestampFrequency = 90000);
 
+  Boolean& deliverAccessUnits() { return fDeliverAccessUnits; }
+      // If set (before we start being read), each delivered frame is a complete 'access unit' - i.e., all of the NAL units
+      // that have the same RTP timestamp - with each NAL unit preceded by a 4-byte start code (0x00000001).
+      // (By default, each delivered frame is a single NAL unit, with no start code.)
+      // An access unit ends with a packet that has the RTP 'M' bit set (or, if the sender failed to set it, when a
+      // packet with a new timestamp arrives).  An access unit from which any packet was lost is not delivered at all.
+      // Note that because the resulting data already contains start codes, it should be written using a "FileSink",
+      // not a "H264VideoFileSink" (and should not be fed to a "H264VideoStreamDiscreteFramer").
+
 protected:
   H264VideoRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 			 unsigned char rtpPayloadFormat,
@@ -49,6 +58,10 @@ protected:
 private:
   friend class H264BufferedPacket;
   unsigned char fCurPacketNALUnitType;
+  Boolean fCurPacketBeginsNALUnit; // False iff the packet is the continuation of a fragmented NAL unit
+  Boolean fDeliverAccessUnits;
+  Boolean fAccessUnitIsInProgress;
+  unsigned fCurAccessUnitRTPTimestamp;
 };
 
 class SPropRecord {
@@ -0,0 +1,144 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// RTP sink for H.265 video (RFC 7798)
+// C++ header
+
+#ifndef _H265_VIDEO_RTP_SINK_HH
+#define _H265_VIDEO_RTP_SINK_HH
+
+#ifndef _VIDEO_RTP_SINK_HH
+#include "VideoRTPSink.hh"
+#endif
+#ifndef _FRAMED_FILTER_HH
+#include "FramedFilter.hh"
+#endif
+
+class H265FUFragmenter;
+
+class H265VideoRTPSink: public VideoRTPSink {
+public:
+  static H265VideoRTPSink* createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat);
+  static H265VideoRTPSink* createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
+				     u_int8_t const* vps, unsigned vpsSize,
+				     u_int8_t const* sps, unsigned spsSize,
+				     u_int8_t const* pps, unsigned ppsSize);
+    // an optional variant of "createNew()", useful if we know, in advance, the stream's VPS, SPS and PPS NAL units.
+  static H265VideoRTPSink* createNew(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
+				     char const* sPropVPSStr, char const* sPropSPSStr, char const* sPropPPSStr);
+    // an optional variant of "createNew()", useful if we know, in advance, the stream's VPS, SPS and PPS NAL units
+    // (as Base-64 encoded strings, e.g. from a SDP description).
+
+protected:
+  H265VideoRTPSink(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
+		   u_int8_t const* vps = NULL, unsigned vpsSize = 0,
+		   u_int8_t const* sps = NULL, unsigned spsSize = 0,
+		   u_int8_t const* pps = NULL, unsigned ppsSize = 0);
+	// called only by createNew()
+
+  virtual ~H265VideoRTPSink();
+
+protected: // redefined virtual functions:
+  virtual char const* auxSDPLine();
+
+private: // redefined virtual functions:
+  virtual Boolean sourceIsCompatibleWithUs(MediaSource& source);
+  virtual Boolean continuePlaying();
+  virtual unsigned specialHeaderSize() const;
+  virtual void doSpecialFrameHandling(unsigned fragmentationOffset,
+                                      unsigned char* frameStart,
+                                      unsigned numBytesInFrame,
+                                      struct timeval framePresentationTime,
+                                      unsigned numRemainingBytes);
+  virtual Boolean frameCanAppearAfterPacketStart(unsigned char const* frameStart,
+						 unsigned numBytesInFrame) const;
+
+protected:
+  H265FUFragmenter* fOurFragmenter;
+
+private:
+  char* fFmtpSDPLine;
+  u_int8_t* fVPS; unsigned fVPSSize; u_int8_t* fSPS; unsigned fSPSSize; u_int8_t* fPPS; unsigned fPPSSize;
+};
+
+
+////////// H265FUFragmenter definition //////////
+
+// As with "H264VideoRTPSink", "H265VideoRTPSink" reads each NAL unit through a separate "H265FUFragmenter" class,
+// which reads it directly into the sink's output buffer.  If the NAL unit is too large for a single RTP packet, it
+// converts it (in place) into the start of a FU (Fragmentation Unit) packet, and our sink then fragments it, adding the
+// 2-byte payload header and 1-byte FU header (from "payloadHeader()" and "fuHeader()") in front of each subsequent fragment.
+// In addition, small parameter set, access unit delimiter, and (prefix) SEI NAL units that share a presentation time
+// are combined into a single AP (Aggregation Packet).  (To do this, we read the following NAL unit in advance; if it
+// can't also be aggregated, we hold on to a copy of it, and deliver it next.)
+// (Note: This class should be used only by "H265VideoRTPSink", or a subclass.)
+
+class H265FUFragmenter: public FramedFilter {
+public:
+  H265FUFragmenter(UsageEnvironment& env, FramedSource* inputSource,
+		   unsigned maxOutputPacketSize);
+  virtual ~H265FUFragmenter();
+
+  u_int8_t const* payloadHeader() const { return fPayloadHeader; }
+  u_int8_t fuHeader() const { return fFUHeader; } // without the S or E bits
+      // for the most recent NAL unit that we delivered (if it had to be sent as FU packets)
+  Boolean lastDeliveryEndedAccessUnit() const { return fLastDeliveryEndedAccessUnit; }
+      // whether the most recent NAL unit (or AP) that we delivered ended an 'access unit' (i.e., video frame)
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+  virtual void doStopGettingFrames();
+
+private:
+  void readNextNALUnit(unsigned char* to, unsigned maxSize);
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+                                struct timeval presentationTime,
+                                unsigned durationInMicroseconds);
+  void afterGettingFrame1(unsigned frameSize,
+                          unsigned numTruncatedBytes,
+                          struct timeval presentationTime,
+                          unsigned durationInMicroseconds);
+  static void onSourceClosure(void* clientData);
+  void onSourceClosure1();
+
+  Boolean inputEndedAccessUnit(); // also resets our input source's flag
+  void deliverNALUnit(unsigned frameSize); // a NAL unit that's been read at "fTo + 1"
+  void deliverAggregationPacket();
+
+private:
+  unsigned fMaxOutputPacketSize;
+  u_int8_t fPayloadHeader[2], fFUHeader;
+  Boolean fLastDeliveryEndedAccessUnit;
+
+  // State used while building an AP:
+  unsigned fAPSize; // the number of bytes (at "fTo") of the AP that we're building (or 0, if none)
+  unsigned fNumNALUnitsInAP;
+  Boolean fAPEndsAccessUnit;
+
+  // A NAL unit (read after an AP) that we're holding on to, for our next delivery:
+  u_int8_t* fHeldNALUnit;
+  unsigned fHeldNALUnitBufferSize;
+  unsigned fHeldNALUnitSize;
+  unsigned fHeldNumTruncatedBytes;
+  struct timeval fHeldPresentationTime;
+  unsigned fHeldDurationInMicroseconds;
+  Boolean fHeldNALUnitEndsAccessUnit;
+  Boolean fHaveHeldNALUnit, fInputSourceHasClosed;
+};
+
+#endif
@@ -40,6 +40,43 @@ public:
   static MPEG2IFrameIndexFromTransportStream*
   createNew(UsageEnvironment& env, FramedSource* inputSource);
 
+public:
+  // The following lets a Transport Stream file be indexed in separate pieces, by feeding packets to us directly, rather
+  // than from an input source.  (This is used by "MPEG2TransportStreamParallelIndexer", which indexes the pieces
+  // concurrently - each in its own thread - and then concatenates the results, and by
+  // "MPEG2TransportStreamIncrementalIndexer", which indexes a Transport Stream while it's being recorded.)
+
+  // The state that we carry over from one Transport Stream packet to the next (apart from unparsed data):
+  class ParseState {
+  public:
+    ParseState(); // the state at the start of a file
+
+    Boolean parsesLike(ParseState const& other) const;
+        // True iff the subsequent Video Elementary Stream data - and thus its parsing - would be the same
+    Boolean operator==(ParseState const& other) const; // also compares the PCR state
+
+  public:
+    Boolean isH264, isH265;
+    u_int16_t PMT_PID, video_PID;
+    u_int8_t lastContinuityCounter;
+    Boolean haveSeenFirstPCR;
+    float firstPCR, lastPCR;
+  };
+
+  void getParseState(ParseState& state) const;
+  void setParseState(ParseState const& state, unsigned long nextTransportPacketNumber);
+      // Call this (if at all) before adding the first packet
+
+  Boolean addTransportPacket(unsigned char const* pkt);
+      // Adds the next (TRANSPORT_PACKET_SIZE-byte) Transport Stream packet.  Returns False iff the packet could not
+      // be added (because it was bad, or because our parse buffer is full); this should be treated as the end of input.
+  Boolean getNextIndexRecord(u_int8_t* to);
+      // Parses the data that has been added so far, and - if possible - writes the next (11-byte) index record to "to".
+      // Call this repeatedly, until it returns False, after each call to "addTransportPacket()".
+  void noteEndOfInput();
+      // Call this after the last packet has been added, then call "getNextIndexRecord()" until it returns False,
+      // to get the index records for the remaining data.
+
 protected:
   MPEG2IFrameIndexFromTransportStream(UsageEnvironment& env,
 				      FramedSource* inputSource);
@@ -63,17 +100,22 @@ private:
   static void handleInputClosure(void* clientData);
   void handleInputClosure1();
 
-  void analyzePAT(unsigned char* pkt, unsigned size);
-  void analyzePMT(unsigned char* pkt, unsigned size);
+  void analyzePAT(unsigned char const* pkt, unsigned size);
+  void analyzePMT(unsigned char const* pkt, unsigned size);
 
   Boolean deliverIndexRecord();
   Boolean parseFrame();
   Boolean parseToNextCode(unsigned char& nextCode);
+  Boolean haveRoomForPacket(); // compacting our parse buffer, if necessary
   void compactParseBuffer();
   void addToTail(IndexRecord* newIndexRecord);
+  Boolean addEndOfInputCode();
+  IndexRecord* dequeueIndexRecord();
+  static void packIndexRecord(IndexRecord& record, u_int8_t* to);
 
 private:
   Boolean fIsH264; // True iff the video is H.264 (encapsulated in a Transport Stream)
+  Boolean fIsH265; // True iff the video is H.265 (encapsulated in a Transport Stream)
   unsigned long fInputTransportPacketCounter;
   unsigned fClosureNumber;
   u_int8_t fLastContinuityCounter;
@@ -87,6 +129,7 @@ private:
   unsigned fParseBufferFrameStart;
   unsigned fParseBufferParseEnd;
   unsigned fParseBufferDataEnd;
+  unsigned fNumInitialBadBytes; // before the first frame's initial code
   IndexRecord* fHeadIndexRecord;
   IndexRecord* fTailIndexRecord;
 };
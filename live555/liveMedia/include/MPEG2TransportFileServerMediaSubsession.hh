@@ -40,6 +40,13 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class ClientTrickPlayState; // forward
 
+// 'Trick play' (fast forward or reverse play) is normally done by extracting I-frames from the Transport Stream file
+// - separately for each client - as they're streamed.  Alternatively, files that contain just these I-frames can be
+// precomputed (e.g., by "MPEG2TransportStreamTrickPlayFileGenerator") for some scales, and are then streamed directly.
+// Each such scale serves as a 'band': Any requested scale (with the same sign) gets changed to the nearest scale
+// for which there's a precomputed 'trick play' file.
+#define MAX_PRECOMPUTED_TRICK_PLAY_SCALE 64
+
 class MPEG2TransportFileServerMediaSubsession: public FileServerMediaSubsession{
 public:
   static MPEG2TransportFileServerMediaSubsession*
@@ -47,6 +54,15 @@ public:
 	    char const* dataFileName, char const* indexFileName,
 	    Boolean reuseFirstSource);
 
+  static char* trickPlayFileName(char const* dataFileName, int scale);
+      // Returns (as a new string) the name of the precomputed 'trick play' file for "scale" (with absolute value in
+      // [2,MAX_PRECOMPUTED_TRICK_PLAY_SCALE]).  For a data file "<name>.ts", this is "<name>.ff<scale>.ts" for fast
+      // forward, or "<name>.rw<-scale>.ts" for reverse play.  (Its index file has the same name, plus "x".)
+      // A fast forward file starts at the start of the data file; a reverse play file starts at its end.
+
+  Boolean lookupTrickPlayFile(int scale, char const*& fileName, MPEG2TransportStreamIndexFile*& indexFile) const;
+      // Returns True iff there's a precomputed 'trick play' file (with an index file) for "scale"
+
 protected:
   MPEG2TransportFileServerMediaSubsession(UsageEnvironment& env,
 					  char const* fileName,
@@ -87,10 +103,18 @@ private: // redefined virtual functions
 private:
   ClientTrickPlayState* lookupClient(unsigned clientSessionId);
 
+private:
+  void findTrickPlayFiles();
+  int nearestTrickPlayFileScale(int scale) const; // returns 0 if there's no 'trick play' file in that direction
+
 private:
   MPEG2TransportStreamIndexFile* fIndexFile;
   float fDuration;
   HashTable* fClientSessionHashTable; // indexed by client session id
+  unsigned fNumTrickPlayFiles;
+  int* fTrickPlayFileScales;
+  char** fTrickPlayFileNames;
+  MPEG2TransportStreamIndexFile** fTrickPlayIndexFiles;
 };
 
 
@@ -101,7 +125,9 @@ private:
 
 class ClientTrickPlayState {
 public:
-  ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile);
+  ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile,
+		       MPEG2TransportFileServerMediaSubsession* subsession = NULL);
+      // "subsession" (if not NULL) is used to find any precomputed 'trick play' files
 
   // Functions to bring "fNPT", "fTSRecordNum" and "fIxRecordNum" in sync:
   unsigned long updateStateFromNPT(double npt, double seekDuration);
@@ -117,15 +143,31 @@ public:
 protected:
   void updateTSRecordNum();
   void reseekOriginalTransportStreamSource();
+  void closeTrickPlaySource();
+  Boolean openTrickPlayFile(int scale); // returns False if there's no precomputed 'trick play' file for "scale"
+  void reseekTrickPlayFile();
+
+  // Functions that map between NPTs in the original file and in a (precomputed) 'trick play' file:
+  float trickPlayFileNPT(float npt, int scale) const { return (npt - trickPlayFileOriginNPT(scale))/scale; }
+  float originalNPT(float trickPlayFileNPT) const { return fTrickPlayFileOriginNPT + fTrickPlayFileScale*trickPlayFileNPT; }
+  float trickPlayFileOriginNPT(int scale) const; // the NPT (in the original file) at which the 'trick play' file starts
 
 protected:
   MPEG2TransportStreamIndexFile* fIndexFile;
+  MPEG2TransportFileServerMediaSubsession* fSubsession;
   ByteStreamFileSource* fOriginalTransportStreamSource;
   MPEG2TransportStreamTrickModeFilter* fTrickModeFilter;
   MPEG2TransportStreamFromESSource* fTrickPlaySource;
   MPEG2TransportStreamFramer* fFramer;
   float fScale, fNextScale, fNPT;
   unsigned long fTSRecordNum, fIxRecordNum;
+
+  // Used only when we're streaming from a precomputed 'trick play' file:
+  ByteStreamFileSource* fTrickPlayFileSource;
+  MPEG2TransportStreamIndexFile* fTrickPlayIndexFile;
+  int fTrickPlayFileScale;
+  float fTrickPlayFileOriginNPT;
+  unsigned long fTrickPlayFileTSRecordNum; // where we are in the 'trick play' file
 };
 
 #endif
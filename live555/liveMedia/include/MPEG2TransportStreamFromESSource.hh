@@ -31,7 +31,8 @@ public:
   static MPEG2TransportStreamFromESSource* createNew(UsageEnvironment& env);
 
   void addNewVideoSource(FramedSource* inputSource, int mpegVersion);
-      // Note: For MPEG-4 video, set "mpegVersion" to 4; for H.264 video, set "mpegVersion" to 5.
+      // Note: For MPEG-4 video, set "mpegVersion" to 4; for H.264 video, set "mpegVersion" to 5;
+      // for H.265 video, set "mpegVersion" to 6.
   void addNewAudioSource(FramedSource* inputSource, int mpegVersion);
 
 protected:
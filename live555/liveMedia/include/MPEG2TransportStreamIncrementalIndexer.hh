@@ -0,0 +1,77 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A filter that passes through (unchanged) a MPEG-2 Transport Stream that's being recorded, while also writing -
+// incrementally - the corresponding index file.  This lets the recording be served (with 'trick play' operations)
+// while it's still in progress.
+// C++ header
+
+#ifndef _MPEG2_TRANSPORT_STREAM_INCREMENTAL_INDEXER_HH
+#define _MPEG2_TRANSPORT_STREAM_INCREMENTAL_INDEXER_HH
+
+#ifndef _MPEG2_IFRAME_INDEX_FROM_TRANSPORT_STREAM_HH
+#include "MPEG2IndexFromTransportStream.hh"
+#endif
+
+class MPEG2TransportStreamIncrementalIndexer: public FramedFilter {
+public:
+  static MPEG2TransportStreamIncrementalIndexer*
+  createNew(UsageEnvironment& env, FramedSource* inputSource, char const* indexFileName);
+      // "inputSource" must deliver the Transport Stream from its start (i.e., from its first packet), because that's
+      // where the Transport Stream file - written by our downstream object (e.g., a "FileSink") - starts.
+      // Returns NULL if the index file could not be opened.
+
+  unsigned long numIndexRecordsWritten() const { return fNumIndexRecordsWritten; }
+
+protected:
+  MPEG2TransportStreamIncrementalIndexer(UsageEnvironment& env, FramedSource* inputSource, FILE* indexFid);
+      // called only by createNew()
+  virtual ~MPEG2TransportStreamIncrementalIndexer();
+
+private:
+  // Redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+  void afterGettingFrame1(unsigned frameSize,
+			  unsigned numTruncatedBytes,
+			  struct timeval presentationTime,
+			  unsigned durationInMicroseconds);
+
+  static void handleInputClosure(void* clientData);
+  void handleInputClosure1();
+
+  void indexData(unsigned char const* data, unsigned dataSize);
+  void getIndexRecords(); // from "fIndexer", into "fPendingIndexRecords"
+  void stopIndexing();
+  void writePendingIndexRecords();
+
+private:
+  FILE* fIndexFid;
+  MPEG2IFrameIndexFromTransportStream* fIndexer; // NULL after we've stopped indexing
+  unsigned char fPartialPacket[TRANSPORT_PACKET_SIZE]; // holds the start of a packet that was split between frames
+  unsigned fPartialPacketSize;
+  u_int8_t* fPendingIndexRecords; // records for data that we've delivered, but (perhaps) not yet written to the file
+  unsigned fNumPendingIndexRecords, fMaxNumPendingIndexRecords;
+  unsigned long fNumIndexRecordsWritten;
+};
+
+#endif
@@ -33,7 +33,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 class MPEG2TransportStreamIndexFile: public Medium {
 public:
   static MPEG2TransportStreamIndexFile* createNew(UsageEnvironment& env,
-						  char const* indexFileName);
+						  char const* indexFileName,
+						  Boolean holdInMemory = True);
+      // If "holdInMemory" is True, then the index file is read into memory here, and
+      // the 'lookup' functions below use a binary search over in-memory arrays, rather than reading individual records
+      // from the file.  (If the file can't be loaded, we fall back to reading it record by record.)
+      // The index file may still be growing (e.g., if it's being written by a "MPEG2TransportStreamIncrementalIndexer",
+      // for a recording that's in progress).  Each lookup - and each attempt to read past the last known record -
+      // first checks the file's size, and takes in any records that have been added since.
 
   virtual ~MPEG2TransportStreamIndexFile();
 
@@ -61,10 +68,10 @@ public:
 
   int mpegVersion();
       // returns the best guess for the version of MPEG being used for data within the underlying Transport Stream file.
-      // (1,2,4, or 5 (representing H.264).  0 means 'don't know' (usually because the index file is empty))
+      // (1,2,4, 5 (representing H.264), or 6 (representing H.265).  0 means 'don't know' (usually because the index file is empty))
 
 private:
-  MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName);
+  MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName, Boolean holdInMemory);
 
   Boolean openFid();
   Boolean seekToIndexRecord(unsigned long indexRecordNumber);
@@ -72,11 +79,20 @@ private:
   Boolean readOneIndexRecord(unsigned long indexRecordNum); // closes "fFid" at end
   void closeFid();
 
+  void updateNumIndexRecords(); // in case the index file has grown (checked at most once per second)
+  void loadIndexData(); // sets "fIndexData", if possible
+  Boolean extendIndexData(unsigned long newNumIndexRecords);
+  void freeIndexData();
+  void buildSearchArrays(unsigned long numExistingRecords = 0); // from "fIndexData"
+      // (If the arrays already exist, then only the records from "numExistingRecords" onwards are added.)
+
   u_int8_t recordTypeFromBuf() { return fBuf[0]; }
   u_int8_t offsetFromBuf() { return fBuf[1]; }
   u_int8_t sizeFromBuf() { return fBuf[2]; }
-  float pcrFromBuf(); // after "fBuf" has been read
-  unsigned long tsPacketNumFromBuf();
+  float pcrFromBuf() { return pcrFromRecord(fBuf); } // after "fBuf" has been read
+  unsigned long tsPacketNumFromBuf() { return tsPacketNumFromRecord(fBuf); }
+  static float pcrFromRecord(u_int8_t const* record);
+  static unsigned long tsPacketNumFromRecord(u_int8_t const* record);
   void setMPEGVersionFromRecordType(u_int8_t recordType);
 
   Boolean rewindToCleanPoint(unsigned long&ixFound);
@@ -90,7 +106,14 @@ private:
   float fCachedPCR;
   unsigned long fCachedTSPacketNumber, fCachedIndexRecordNumber;
   unsigned long fNumIndexRecords;
+  long fLastIndexFileSizeCheckTime; // in seconds, by our scheduler's clock
   unsigned char fBuf[INDEX_RECORD_SIZE]; // used for reading index records from file
+
+  // Used only if we hold the index file in memory:
+  u_int8_t* fIndexData; // the contents of the index file
+  float* fRecordPCRs; // the PCR of each index record, and...
+  u_int32_t* fRecordTSPacketNums; // ...its Transport Stream packet number (both built on the first lookup)
+  unsigned long fIndexDataCapacity; // the number of records that each of these arrays has room for
 };
 
 #endif
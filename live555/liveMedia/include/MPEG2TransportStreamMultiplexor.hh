@@ -30,8 +30,18 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 #define PID_TABLE_SIZE 256
+#define PSI_TABLE_PAYLOAD_SIZE (188-4) // a PAT or PMT occupies a whole Transport Stream packet (after its 4-byte header)
+#define DEFAULT_MAX_NUM_TS_PACKETS_PER_DELIVERY 7 // as many as fit in a RTP packet
 
 class MPEG2TransportStreamMultiplexor: public FramedSource {
+public:
+  void setMaxNumTSPacketsPerDelivery(unsigned maxNumTSPacketsPerDelivery) {
+    fMaxNumTSPacketsPerDelivery = maxNumTSPacketsPerDelivery;
+  }
+      // Each delivery to our client contains as many Transport Stream packets as will fit in its buffer, but (by
+      // default) no more than DEFAULT_MAX_NUM_TS_PACKETS_PER_DELIVERY, because a RTP sink sends each delivery
+      // (unfragmented) in one RTP packet.  0 means 'no limit'; use this when writing to a file (e.g., with a "FileSink").
+
 protected:
   MPEG2TransportStreamMultiplexor(UsageEnvironment& env);
   virtual ~MPEG2TransportStreamMultiplexor();
@@ -42,13 +52,16 @@ protected:
   void handleNewBuffer(unsigned char* buffer, unsigned bufferSize,
 		       int mpegVersion, MPEG1or2Demux::SCR scr);
   // called by "awaitNewBuffer()"
-  // Note: For MPEG-4 video, set "mpegVersion" to 4; for H.264 video, set "mpegVersion" to 5. 
+  // Note: For MPEG-4 video, set "mpegVersion" to 4; for H.264 video, set "mpegVersion" to 5;
+  // for H.265 video, set "mpegVersion" to 6.
 
 private:
   // Redefined virtual functions:
   virtual void doGetNextFrame();
 
 private:
+  void deliverPackets(); // fills the client's buffer with as many Transport Stream packets as we can
+  void deliverPacket();
   void deliverDataToClient(u_int8_t pid, unsigned char* buffer, unsigned bufferSize,
 			   unsigned& startPositionInBuffer);
 
@@ -75,6 +88,9 @@ private:
   unsigned char* fInputBuffer;
   unsigned fInputBufferSize, fInputBufferBytesUsed;
   Boolean fIsFirstAdaptationField;
+  unsigned char fPATBuffer[PSI_TABLE_PAYLOAD_SIZE], fPMTBuffer[PSI_TABLE_PAYLOAD_SIZE];
+  Boolean fPATIsSet, fPMTIsCurrent; // "fPMTIsCurrent" iff "fPMTBuffer" reflects our current streams (and version)
+  unsigned fMaxNumTSPacketsPerDelivery, fNumDeliveries;
 };
 
 #endif
@@ -35,10 +35,22 @@ class MatroskaFile: public Medium {
 public:
   typedef void (onCreationFunc)(MatroskaFile* newFile, void* clientData);
   static void createNew(UsageEnvironment& env, char const* fileName, onCreationFunc* onCreation, void* onCreationClientData,
-			char const* preferredLanguage = "eng");
+			char const* preferredLanguage = "eng", Boolean createIndexFileIfAbsent = False);
     // Note: Unlike most "createNew()" functions, this one doesn't return a new object immediately.  Instead, because this class
     // requires file reading (to parse the Matroska 'Track' headers) before a new object can be initialized, the creation of a new
     // object is signalled by calling - from the event loop - an 'onCreationFunc' that is passed as a parameter to "createNew()".
+    // If an up-to-date index file (see below) exists, its cue points are used instead of parsing the file's 'Cues'.
+    // If "createIndexFileIfAbsent" is True, and no such index file exists, then one is written before "onCreation" is called.
+    // (For a file that has no 'Cues', this requires scanning the whole file.)
+
+  // Index files: An index file has the same name as the Matroska file, but with an extra 'x' appended (e.g., "foo.mkvx").
+  // It records the file position and start time of each 'Cluster' that begins with a key frame, allowing fast seeking
+  // (including within files that have no 'Cues' element) without having to reparse the file each time it's opened.
+  typedef void (afterIndexingFunc)(MatroskaFile* file, Boolean success, void* clientData);
+  void createIndexFile(afterIndexingFunc* afterIndexing, void* afterIndexingClientData);
+    // Scans the whole file, and writes a new index file.  (The resulting cue points also replace any that we already have.)
+    // "afterIndexing" is called - from the event loop - when done.
+  char const* indexFileName() const { return fIndexFileName; }
 
   // For looking up and iterating over the file's tracks:
   class TrackTable {
@@ -84,16 +96,24 @@ public:
 
 private:
   MatroskaFile(UsageEnvironment& env, char const* fileName, onCreationFunc* onCreation, void* onCreationClientData,
-	       char const* preferredLanguage);
+	       char const* preferredLanguage, Boolean createIndexFileIfAbsent);
       // called only by createNew()
   virtual ~MatroskaFile();
 
   static void handleEndOfTrackHeaderParsing(void* clientData);
   void handleEndOfTrackHeaderParsing();
+  static void handleEndOfIndexing(void* clientData);
+  void handleEndOfIndexing();
+  static void afterCreatingIndexFile(MatroskaFile* file, Boolean success, void* clientData);
 
   void addCuePoint(double cueTime, u_int64_t clusterOffsetInFile, unsigned blockNumWithinCluster);
   Boolean lookupCuePoint(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster);
   void printCuePoints(FILE* fid);
+  Boolean haveCuePoints();
+
+  Boolean indexFileIsUpToDate();
+  Boolean readIndexFile();
+  Boolean writeIndexFile();
 
   void removeDemux(MatroskaDemux* demux);
 
@@ -114,6 +134,13 @@ private:
   class CuePoint* fCuePoints;
   unsigned fChosenVideoTrackNumber, fChosenAudioTrackNumber, fChosenSubtitleTrackNumber;
   class MatroskaFileParser* fParserForInitialization;
+
+  // Used to implement index files:
+  char* fIndexFileName;
+  Boolean fCreateIndexFileIfAbsent, fHaveIndexFile, fHaveReadIndexFile;
+  class MatroskaFileParser* fParserForIndexing;
+  afterIndexingFunc* fAfterIndexing;
+  void* fAfterIndexingClientData;
 };
 
 // We define our own track type codes as bits (powers of 2), so we can use the set of track types as a bitmap, representing a set:
@@ -73,6 +73,15 @@ public:
 	virtual Boolean isServerMediaSession() const;
 	virtual Boolean isDarwinInjector() const;
 
+	static char const* eventHandlerLabel(void* env, void* handlerClientData,
+					     struct timeval const& lastExecutionTime);
+	// "env" is a "UsageEnvironment*".  If "handlerClientData" is a "Medium" (in this environment) that was created
+	// before "lastExecutionTime", returns a label - e.g., "liveMedia3 (RTCPInstance)" - that describes it; otherwise
+	// returns NULL.  (A "Medium" created later can't be the one that the handler last ran for; it must have reused
+	// the address of a deleted object.)
+	// (This can be used (as an "EventHandlerLabelFunc") to label the handlers in a "BasicTaskScheduler"'s
+	//  "EventLoopStats".  The returned string is overwritten by the next call.)
+
 protected:
 	friend class MediaLookupTable;
 	Medium(UsageEnvironment& env); // abstract base class
@@ -86,6 +95,7 @@ private:
 	UsageEnvironment& fEnviron;
 	char fMediumName[mediumNameMaxLen];
 	TaskToken fNextTask;
+	struct timeval fCreationTime; // used only by "eventHandlerLabel()"
 };
 
 // A data structure for looking up a Medium by its string name.
@@ -107,6 +117,8 @@ private:
 
 	Medium* lookup(char const* name) const;
 	// Returns NULL if none already exists
+	Medium* lookupByAddress(void* address) const;
+	// Returns NULL if "address" is not that of one of our "Medium"s
 
 	void addNew(Medium* medium, char* mediumName);
 	void remove(char const* name);
@@ -116,6 +128,7 @@ private:
 private:
 	UsageEnvironment& fEnv;
 	HashTable* fTable;
+	HashTable* fTableByAddress; // maps each "Medium*" to itself
 	unsigned fNameGenerator;
 };
 
@@ -130,6 +143,7 @@ public:
 
 	MediaLookupTable* mediaTable;
 	void* socketTable;
+	void* sharedSocketTable;
 
 protected:
 	_Tables(UsageEnvironment& env);
@@ -170,6 +170,14 @@ public:
   unsigned videoFPS() const { return fVideoFPS; }
   unsigned numChannels() const { return fNumChannels; }
   float& scale() { return fScale; }
+  Boolean& multiplexRTCPWithRTP() { return fMultiplexRTCPWithRTP; }
+      // If True (set by an "a=rtcp-mux" SDP line, or by the caller), RTCP is multiplexed with RTP
+      // on the same port (RFC 5761).  This must not be changed after initiate().
+  Boolean& useNACKs() { return fUseNACKs; }
+      // If True (set by an "a=rtcp-fb:<fmt> nack" SDP line, or by the caller), we use RTCP feedback to ask the
+      // sender to retransmit lost packets (RFC 4585).  This must be set before initiate().
+  unsigned char rtxPayloadFormat() const { return fRTXPayloadFormat; }
+      // the payload format of a 'RTX' retransmission stream (RFC 4588), if set by an "a=rtpmap:<fmt> rtx/..." SDP line
 
   RTPSource* rtpSource() { return fRTPSource; }
   RTCPInstance* rtcpInstance() { return fRTCPInstance; }
@@ -230,12 +238,16 @@ public:
   unsigned fmtp_sizelength() const { return fSizelength; }
   unsigned fmtp_streamstateindication() const { return fStreamstateindication; }
   unsigned fmtp_streamtype() const { return fStreamtype; }
+  unsigned fmtp_spropmaxdondiff() const { return fSpropMaxDonDiff; }
   Boolean fmtp_cpresent() const { return fCpresent; }
   Boolean fmtp_randomaccessindication() const { return fRandomaccessindication; }
   char const* fmtp_config() const { return fConfig; }
   char const* fmtp_configuration() const { return fmtp_config(); }
   char const* fmtp_mode() const { return fMode; }
   char const* fmtp_spropparametersets() const { return fSpropParameterSets; }
+  char const* fmtp_spropvps() const { return fSpropVPS; }
+  char const* fmtp_spropsps() const { return fSpropSPS; }
+  char const* fmtp_sproppps() const { return fSpropPPS; }
   char const* fmtp_emphasis() const { return fEmphasis; }
   char const* fmtp_channelorder() const { return fChannelOrder; }
 
@@ -290,6 +302,8 @@ protected:
   Boolean parseSDPAttribute_source_filter(char const* sdpLine);
   Boolean parseSDPAttribute_x_dimensions(char const* sdpLine);
   Boolean parseSDPAttribute_framerate(char const* sdpLine);
+  Boolean parseSDPAttribute_rtcpmux(char const* sdpLine);
+  Boolean parseSDPAttribute_rtcpfb(char const* sdpLine);
 
   virtual Boolean createSourceObjects(int useSpecialRTPoffset);
     // create "fRTPSource" and "fReadSource" member objects, after we've been initialized via SDP
@@ -319,9 +333,9 @@ protected:
   unsigned fIndexdeltalength, fIndexlength, fInterleaving;
   unsigned fMaxdisplacement, fObjecttype;
   unsigned fOctetalign, fProfile_level_id, fRobustsorting;
-  unsigned fSizelength, fStreamstateindication, fStreamtype;
+  unsigned fSizelength, fStreamstateindication, fStreamtype, fSpropMaxDonDiff;
   Boolean fCpresent, fRandomaccessindication;
-  char *fConfig, *fMode, *fSpropParameterSets, *fEmphasis, *fChannelOrder;
+  char *fConfig, *fMode, *fSpropParameterSets, *fSpropVPS, *fSpropSPS, *fSpropPPS, *fEmphasis, *fChannelOrder;
 
   double fPlayStartTime;
   double fPlayEndTime;
@@ -334,6 +348,9 @@ protected:
   unsigned fNumChannels;
      // optionally set by "a=rtpmap:" lines for audio sessions.  Default: 1
   float fScale; // set from a RTSP "Scale:" header
+  Boolean fMultiplexRTCPWithRTP; // set by an optional "a=rtcp-mux" line
+  Boolean fUseNACKs; // set by an optional "a=rtcp-fb:<fmt> nack" line
+  unsigned char fRTXPayloadFormat; // set by an optional "a=rtpmap:<fmt> rtx/<freq>" line; 0 if none
   double fNPT_PTS_Offset; // set by "getNormalPlayTime()"; add this to a PTS to get NPT
 
   // Fields set or used by initiate():
@@ -37,6 +37,14 @@ public:
     fOnSendErrorData = onSendErrorFuncData;
   }
 
+  Boolean& paceOutgoingPackets() { return fPaceOutgoingPackets; }
+      // By default (True), each outgoing packet is sent at the time that it's due (based on the durations of the frames
+      // that were packed into earlier packets).  If this is set to False (before "startPlaying()"), then packets are sent
+      // as fast as possible, and "nextSendTime()" is instead measured from the start of the stream (time 0).
+      // (This is used to pre-packetize a stream; see "RTPHintCache".)
+  struct timeval const& nextSendTime() const { return fNextSendTime; }
+      // the time at which the next packet is due to be sent
+
 protected:
   MultiFramedRTPSink(UsageEnvironment& env,
 		     Groupsock* rtpgs, unsigned char rtpPayloadType,
@@ -132,6 +140,7 @@ private:
   unsigned fCurFrameSpecificHeaderSize; // size in bytes of cur frame-specific header
   unsigned fTotalFrameSpecificHeaderSizes; // size of all frame-specific hdrs in pkt
   unsigned fOurMaxPacketSize;
+  Boolean fPaceOutgoingPackets;
 
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
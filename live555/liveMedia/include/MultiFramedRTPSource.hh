@@ -28,8 +28,59 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class BufferedPacket; // forward
 class BufferedPacketFactory; // forward
+class RTCPInstance; // forward
 
 class MultiFramedRTPSource: public RTPSource {
+public:
+  // Statistics about the out-of-order arrival of incoming packets:
+  unsigned numReorderedPackets() const;
+      // the number of packets that arrived after a packet with a higher sequence number
+  unsigned maxReorderingDepth() const;
+  double aveReorderingDepth() const;
+      // the 'reordering depth' of a packet is the number of sequence numbers by which it arrived late
+  unsigned numDuplicatePackets() const;
+  unsigned numLatePackets() const;
+      // packets that arrived too late to be used (because we'd already delivered - or given up on - their sequence number)
+
+  void enableAdaptiveJitterBuffer(unsigned minPlayoutDelayUS = 20000, unsigned maxPlayoutDelayUS = 500000);
+      // If called, then rather than delivering each packet's data as soon as it's available, we hold it until its
+      // 'playout time': its presentation time, plus the (smallest seen) network transit time, plus a 'playout delay'.
+      // The playout delay adapts - between the given limits - to the network jitter (as estimated by our
+      // "RTPReceptionStats"), growing quickly when packets arrive late, and shrinking slowly otherwise.  The playout
+      // delay is also used as the packet reordering threshold (replacing any "setPacketReorderingThresholdTime()").
+  // Metrics for the adaptive jitter buffer:
+  unsigned playoutDelayUS() const { return (unsigned)fPlayoutDelay; }
+  double aveBufferingTimeUS() const {
+    return fNumPacketsPlayedOut == 0 ? 0.0 : fTotBufferingTime/fNumPacketsPlayedOut;
+  }
+      // the average time for which packets were held (after arriving) before their data was delivered
+  unsigned numPacketsPastPlayoutTime() const { return fNumPacketsPastPlayoutTime; }
+      // packets that arrived after their playout time (and so would have been lost to a real-time player)
+
+  void enableNACKs(RTCPInstance* rtcpInstance, unsigned char rtxPayloadFormat = 0,
+		   unsigned maxNumRequestsPerPacket = 3, unsigned requestIntervalUS = 50000);
+      // If called, then whenever we see a gap in the sequence numbers of incoming packets, we use "rtcpInstance" to
+      // send RTCP 'Generic NACK' feedback (RFC 4585), asking the sender to retransmit the missing packets.  Requests
+      // are repeated (every "requestIntervalUS" uSeconds, up to "maxNumRequestsPerPacket" times) until the packet
+      // arrives, or until we stop waiting for it.  (So, for retransmitted packets to be useful, the packet reordering
+      // threshold - or the adaptive jitter buffer's playout delay - must allow time for them to arrive.)
+      // If "rtxPayloadFormat" is non-zero, we also accept retransmitted packets from a 'RTX' stream (RFC 4588) that's
+      // multiplexed - with this payload format - with our original stream.
+      // Note: "rtcpInstance" must not be deleted before us, unless "enableNACKs(NULL)" is called first.
+  unsigned numPacketsNACKed() const { return fNumPacketsNACKed; }
+      // missing packets that we asked to be retransmitted
+  unsigned numRetransmittedPacketsReceived() const { return fNumRetransmittedPacketsReceived; }
+
+  typedef void (incomingPacketHandlerFunc)(void* clientData, unsigned char const* packet, unsigned packetSize);
+  void setIncomingPacketHandler(incomingPacketHandlerFunc* handler, void* clientData);
+      // If set, "handler" is called for each incoming RTP packet (with our payload format), with the complete packet
+      // (including its RTP header).  The packet data is valid only for the duration of the call.
+      // (This is used - e.g., by "SMPTE2022FECReceiver" - to keep copies of incoming packets.)
+  Boolean injectPacket(unsigned char const* packet, unsigned packetSize);
+      // Hands us a complete RTP packet - e.g., one that was recovered using FEC - to be handled as if it had just
+      // arrived.  Returns True iff we were still waiting for a packet with this sequence number (and so used it).
+      // Note: This must not be called from within an "incomingPacketHandler".
+
 protected:
   MultiFramedRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 		       unsigned char rtpPayloadFormat,
@@ -66,6 +117,17 @@ private:
 
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  Boolean processIncomingPacket(BufferedPacket* bPacket, Boolean wasInjected);
+      // parses and stores a packet that we've just read (or that was injected); returns False if it's unusable
+
+  void updatePlayoutDelay(BufferedPacket* packet);
+  Boolean packetIsDueForPlayout(BufferedPacket* packet);
+  static void playoutTimerHandler(MultiFramedRTPSource* source);
+
+  void requestRetransmissions(unsigned short firstSeqNo, unsigned numPackets);
+  void noteReceivedPendingNACK(unsigned short rtpSeqNo);
+  void resendNACKs();
+  static void nackTimerHandler(MultiFramedRTPSource* source);
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
@@ -76,6 +138,30 @@ private:
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
+
+  // State used by the (optional) adaptive jitter buffer:
+  Boolean fUseJitterBuffer;
+  double fMinPlayoutDelay, fMaxPlayoutDelay, fPlayoutDelay; // uSeconds
+  Boolean fHaveTransitTime, fTransitTimeIsSyncedUsingRTCP;
+  double fMinTransitTime; // uSeconds (arrival time minus presentation time)
+  TaskToken fPlayoutTask;
+  unsigned fNumPacketsPlayedOut, fNumPacketsPastPlayoutTime;
+  double fTotBufferingTime; // uSeconds
+
+  // State used for retransmission requests (NACKs):
+  RTCPInstance* fNACKRTCPInstance;
+  unsigned char fRTXPayloadFormat;
+  unsigned fMaxNumNACKsPerPacket, fNACKIntervalUS;
+  struct PendingNACK {
+    unsigned short seqNo;
+    unsigned short numRequests;
+  }* fPendingNACKs; // in increasing order of sequence number
+  unsigned fNumPendingNACKs;
+  TaskToken fNACKTask;
+  unsigned fNumPacketsNACKed, fNumRetransmittedPacketsReceived;
+
+  incomingPacketHandlerFunc* fIncomingPacketHandler;
+  void* fIncomingPacketHandlerClientData;
 };
 
 
@@ -91,7 +177,9 @@ public:
   Boolean hasUsableData() const { return fTail > fHead; }
   unsigned useCount() const { return fUseCount; }
 
-  Boolean fillInData(RTPInterface& rtpInterface, Boolean& packetReadWasIncomplete);
+  Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete);
+      // Note: Our buffer is allocated (with the maximum packet size) on the first call to this function
+  Boolean fillInData(unsigned char const* data, unsigned dataSize); // copies a complete packet that's already in memory
   void assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 			struct timeval presentationTime,
 			Boolean hasBeenSyncedUsingRTCP,
@@ -108,7 +196,10 @@ public:
   BufferedPacket*& nextPacket() { return fNextPacket; }
 
   unsigned short rtpSeqNo() const { return fRTPSeqNo; }
+  unsigned rtpTimestamp() const { return fRTPTimestamp; }
   struct timeval const& timeReceived() const { return fTimeReceived; }
+  struct timeval const& presentationTime() const { return fPresentationTime; }
+  Boolean hasBeenSyncedUsingRTCP() const { return fHasBeenSyncedUsingRTCP; }
 
   unsigned char* data() const { return &fBuf[fHead]; }
   unsigned dataSize() const { return fTail-fHead; }
@@ -132,7 +223,9 @@ protected:
   unsigned fTail;
 
 private:
+  friend class ReorderingPacketBuffer;
   BufferedPacket* fNextPacket; // used to link together packets
+  Boolean fBufIsFromSlab; // if True, "fBuf" belongs to our "ReorderingPacketBuffer", rather than to us
 
   unsigned fUseCount;
   unsigned short fRTPSeqNo;
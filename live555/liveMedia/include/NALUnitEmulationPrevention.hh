@@ -0,0 +1,54 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// Removing and adding the 'emulation prevention' bytes of H.264 (or H.265) NAL units
+// C++ header
+
+#ifndef _NAL_UNIT_EMULATION_PREVENTION_HH
+#define _NAL_UNIT_EMULATION_PREVENTION_HH
+
+#include "NetCommon.h"
+
+// Within a NAL unit, the byte 0x03 is inserted after any pair of 0x00 bytes that would otherwise be followed by a byte
+// <= 0x03 (or would end the NAL unit), so that a start code cannot appear inside it.  The NAL unit's payload without these
+// 'emulation prevention' bytes is its "RBSP" (Raw Byte Sequence Payload) - which is what must be parsed to get header fields.
+
+unsigned removeEmulationPreventionBytes(u_int8_t* to, unsigned toMaxSize,
+					u_int8_t const* from, unsigned fromSize);
+    // Copies the NAL unit data "from" (of size "fromSize") to "to", removing any 'emulation prevention' bytes,
+    // and returns the number of bytes that were written to "to".  At most "toMaxSize" bytes are written; any remaining data
+    // is ignored (so a small "to" buffer can be used if only the start of a NAL unit - e.g., a slice header - is needed).
+    // "to" may be the same as "from" (in which case the data is converted in place).
+
+unsigned addEmulationPreventionBytes(u_int8_t* to, unsigned toMaxSize,
+				     u_int8_t const* from, unsigned fromSize);
+    // The reverse operation: Copies "RBSP" data "from" (of size "fromSize") to "to", adding any 'emulation prevention' bytes
+    // that are needed, and returns the number of bytes that were written to "to".  At most "toMaxSize" bytes are written;
+    // to be sure that there's enough space, make "toMaxSize" at least "maxSizeWithEmulationPreventionBytes(fromSize)".
+    // "to" must not overlap "from".
+
+inline unsigned maxSizeWithEmulationPreventionBytes(unsigned rbspSize) {
+  // (At most one 'emulation prevention' byte is added for every two bytes of data, plus one at the end.)
+  return rbspSize + rbspSize/2 + 1;
+}
+
+unsigned findEmulationPreventionCandidate(u_int8_t const* ptr, unsigned size);
+    // Returns the offset of the first position in "ptr" (of size "size") that begins a three-byte sequence
+    // 0x00 0x00 0xNN, with 0xNN <= 0x03 (or "size", if there is none).  In a NAL unit, this finds the next
+    // 'emulation prevention' byte (at the returned offset + 2); in RBSP data, it finds where the next one must be added.
+
+#endif
@@ -36,6 +36,26 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class OnDemandServerMediaSubsession: public ServerMediaSubsession {
+public:
+  Boolean useSharedServerSockets(unsigned numSocketPairs = 1);
+      // If called (before any "SETUP"), then our RTP (and RTCP) streams are sent - and their incoming RTCP packets
+      // received - through a pool of "numSocketPairs" server socket pairs that are shared with every other stream
+      // (from any subsession) that also uses this option, rather than through a new socket pair for each stream.
+      // (This does not apply to raw-UDP streams.)
+      // There's one such pool (per environment), so every subsession that uses it must ask for the same
+      // "numSocketPairs", and have the same "initialPortNum".  If not, we return False (and set the result message),
+      // and don't use shared sockets.
+  void multiplexRTCPWithRTP();
+      // If called (before "DESCRIBE"), then our SDP description includes "a=rtcp-mux", inviting clients to multiplex
+      // RTCP with RTP on the same port (RFC 5761).  (We accept a "RTCP-mux" request in "SETUP" regardless.)
+      // (If "reuseFirstSource" is True, then clients that multiplex RTCP with RTP share one stream, and clients that
+      //  don't share another.)
+  void enableRetransmissions(unsigned historySize = 512, Boolean useRTXStream = True);
+      // If called (before "DESCRIBE"), then each of our (unicast) streams remembers its most recent "historySize"
+      // RTP packets, and retransmits them when asked by a client's RTCP 'Generic NACK' feedback (RFC 4585).  Our SDP
+      // description includes "a=rtcp-fb:<fmt> nack" to advertise this.  If "useRTXStream" is True, retransmitted
+      // packets are sent in a separate 'RTX' stream (RFC 4588), which is also described in the SDP description.
+
 protected: // we're a virtual base class
   OnDemandServerMediaSubsession(UsageEnvironment& env, Boolean reuseFirstSource,
 				portNumBits initialPortNum = 6970);
@@ -107,9 +127,15 @@ protected:
 private:
   Boolean fReuseFirstSource;
   portNumBits fInitialPortNum;
+  unsigned fNumSharedSocketPairs; // 0 means: don't use shared sockets
+  Boolean fMultiplexRTCPWithRTP;
+  unsigned fRetransmissionHistorySize; // 0 means: don't support retransmissions
+  Boolean fUseRTXStream;
   void* fLastStreamToken;
+  void* fLastMuxedStreamToken; // if "fReuseFirstSource", the stream reused by clients that multiplex RTCP with RTP
   char fCNAME[100]; // for RTCP
   friend class StreamState;
+  friend class RTPHintCacheServerMediaSubsession; // uses our "createNewStreamSource()" and "createNewRTPSink()" to fill its cache
 };
 
 
@@ -144,7 +170,8 @@ public:
               Port const& serverRTPPort, Port const& serverRTCPPort,
 	      RTPSink* rtpSink, BasicUDPSink* udpSink,
 	      unsigned totalBW, FramedSource* mediaSource,
-	      Groupsock* rtpGS, Groupsock* rtcpGS);
+	      Groupsock* rtpGS, Groupsock* rtcpGS,
+	      Boolean serverPortsAreFromAllocator = False);
   virtual ~StreamState();
 
   void startPlaying(Destinations* destinations,
@@ -173,6 +200,7 @@ private:
   unsigned fReferenceCount;
 
   Port fServerRTPPort, fServerRTCPPort;
+  Boolean fServerPortsAreFromAllocator; // if False, the ports were chosen by the OS
 
   RTPSink* fRTPSink;
   BasicUDPSink* fUDPSink;
@@ -82,6 +82,14 @@ public:
       // and a general "RR" handler function is set, then both will be called.)
   void unsetSpecificRRHandler(netAddressBits fromAddress, Port fromPort); // equivalent to setSpecificRRHandler(..., NULL, NULL);
 
+  void setRRProcessingLimits(unsigned rrSamplingInterval, unsigned maxNumRRsPerReportInterval = 0);
+      // For a session with a very large number of (e.g., multicast) receivers: Process the report blocks of
+      // only one in every "rrSamplingInterval" incoming "RR"s, and of at most "maxNumRRsPerReportInterval"
+      // "RR"s (if non-zero) between each of our own reports.  ('Processing' means updating our "RTPSink"'s
+      // "RTPTransmissionStatsDB", and calling the general "RR" handler.)  Every incoming "RR" is still used to
+      // note the sender's membership (and so to compute our report interval), and still causes any 'specific'
+      // "RR" handler (see above) to be called.  By default, every "RR" is processed.
+
   Groupsock* RTCPgs() const { return fRTCPInterface.gs(); }
 
   void setStreamSocket(int sockNum, unsigned char streamChannelId);
@@ -97,6 +105,16 @@ public:
 					    handlerClientData);
   }
 
+  void injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_in const& fromAddress);
+      // Allows an outside party to hand us a RTCP packet that it has read - e.g., our "RTPSource",
+      // if RTCP is multiplexed with RTP on the same socket (RFC 5761)
+
+  void sendNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums);
+      // Sends a RTCP 'Generic NACK' feedback message (RFC 4585, section 6.2.1), asking the sender of the RTP
+      // stream "mediaSSRC" to retransmit the packets with the given sequence numbers (which should be in
+      // increasing order).  The message is sent immediately, within a compound RTCP packet that begins with
+      // a (report-less) "RR".  (This is used by "MultiFramedRTPSource"; see "MultiFramedRTPSource::enableNACKs()".)
+
 protected:
   RTCPInstance(UsageEnvironment& env, Groupsock* RTPgs, unsigned totSessionBW,
 	       unsigned char const* cname,
@@ -119,6 +137,7 @@ private:
         void enqueueReportBlock(RTPReceptionStats* receptionStats);
   void addSDES();
   void addBYE();
+  void addNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums);
 
   void sendBuiltPacket();
 
@@ -127,7 +146,10 @@ private:
 
   static void incomingReportHandler(RTCPInstance* instance, int /*mask*/);
   void incomingReportHandler1();
+  void processIncomingReport(unsigned packetSize, struct sockaddr_in& fromAddress,
+			     int tcpReadStreamSocketNum, unsigned char tcpReadStreamChannelId);
   void onReceive(int typeOfPacket, int totPacketSize, u_int32_t ssrc);
+  Boolean shouldProcessIncomingRR(); // see "setRRProcessingLimits()"
 
 private:
   unsigned char* fInBuf;
@@ -138,6 +160,7 @@ private:
   RTPSink* fSink;
   RTPSource const* fSource;
   Boolean fIsSSMSource;
+  Boolean fIsMultiplexedWithRTP; // (RFC 5761)
 
   SDESItem fCNAME;
   RTCPMemberDatabase* fKnownMembers;
@@ -165,6 +188,8 @@ private:
   TaskFunc* fRRHandlerTask;
   void* fRRHandlerClientData;
   AddressPortLookupTable* fSpecificRRHandlerTable;
+  unsigned fRRSamplingInterval, fMaxNumRRsPerReportInterval;
+  unsigned fNumRRsSinceLastProcessed, fNumRRsProcessedThisInterval;
 
 public: // because this stuff is used by an external "C" function
   void schedule(double nextTime);
@@ -186,6 +211,11 @@ const unsigned char RTCP_PT_RR = 201;
 const unsigned char RTCP_PT_SDES = 202;
 const unsigned char RTCP_PT_BYE = 203;
 const unsigned char RTCP_PT_APP = 204;
+const unsigned char RTCP_PT_RTPFB = 205; // Generic RTP Feedback (RFC 4585)
+const unsigned char RTCP_PT_PSFB = 206; // Payload-specific Feedback (RFC 4585)
+
+// RTPFB feedback message types ("FMT"):
+const unsigned char RTCP_FMT_GENERIC_NACK = 1;
 
 // SDES tags:
 const unsigned char RTCP_SDES_END = 0;
@@ -0,0 +1,168 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A cache of pre-packetized RTP packets (payloads, plus timing) for a single media track.
+// (This is similar in idea to a QuickTime 'hint track'.)  The cache can be kept in memory, and also
+// written to (and later read from) a 'hint cache file'.  Also, a source and a "RTPSink" that stream from the cache.
+// C++ header
+
+#ifndef _RTP_HINT_CACHE_HH
+#define _RTP_HINT_CACHE_HH
+
+#ifndef _MULTI_FRAMED_RTP_SINK_HH
+#include "MultiFramedRTPSink.hh"
+#endif
+#ifndef _FRAMED_SOURCE_HH
+#include "FramedSource.hh"
+#endif
+
+class RTPHintCache: public Medium {
+public:
+  static RTPHintCache* createNew(UsageEnvironment& env, FramedSource* inputSource, MultiFramedRTPSink* rtpSink);
+      // Creates a cache by packetizing - as fast as possible - all of "inputSource" through "rtpSink", and remembering
+      // each resulting RTP packet.  (This runs the event loop until the input source closes.)  "rtpSink" should use a
+      // 'groupsock' that has no destinations (or whose packets are otherwise unneeded).  The caller closes
+      // "inputSource" and "rtpSink" afterwards.  Returns NULL if no packets were produced.
+  static RTPHintCache* createNew(UsageEnvironment& env, char const* hintCacheFileName,
+				 char const* sourceFileName = NULL);
+      // Creates a cache by reading a 'hint cache file' that was previously written by "writeToFile()".
+      // Returns NULL if the file doesn't exist, or isn't a valid 'hint cache file', or - if "sourceFileName" is non-NULL -
+      // if the cache was made from a source file of a different size or modification time (i.e., is out of date).
+
+  Boolean writeToFile(char const* hintCacheFileName, char const* sourceFileName = NULL) const;
+      // If "sourceFileName" is non-NULL, the file also records that (source) file's size and modification time.
+
+  // Parameters of the original "RTPSink", for use in SDP descriptions:
+  char const* sdpMediaType() const { return fSDPMediaType; }
+  char const* rtpPayloadFormatName() const { return fRTPPayloadFormatName; }
+  char const* auxSDPLine() const { return fAuxSDPLine; } // NULL if none
+  unsigned rtpTimestampFrequency() const { return fRTPTimestampFrequency; }
+  unsigned numChannels() const { return fNumChannels; }
+  unsigned estBitrate() const { return fEstBitrate; } // kbps
+
+  unsigned numPackets() const { return fNumPackets; }
+  unsigned maxPayloadSize() const { return fMaxPayloadSize; }
+  double duration() const { return fDuration/1000000.0; } // seconds
+
+  // Access to each cached packet:
+  u_int8_t const* payload(unsigned packetNum, unsigned& payloadSize) const;
+  u_int64_t sendTime(unsigned packetNum) const;
+      // the time (in microseconds, from the start of the stream) at which the packet is due to be sent
+  u_int32_t rtpTimestampOffset(unsigned packetNum) const;
+      // the packet's RTP timestamp, minus that of the first packet
+  Boolean markerBit(unsigned packetNum) const;
+
+  unsigned lookupPacketNum(double npt) const;
+      // returns the first packet whose send time is >= "npt" (seconds); or "numPackets()" if none
+
+protected:
+  RTPHintCache(UsageEnvironment& env);
+      // called only by createNew()
+  virtual ~RTPHintCache();
+
+private:
+  void addPacket(unsigned char const* packet, unsigned packetSize);
+  Boolean indexPackets(); // sets "fPacketOffsets[]" from "fData"
+  Boolean readFromFile(char const* hintCacheFileName, char const* sourceFileName);
+
+  static void afterSendingPacket(void* clientData, unsigned char const* packet, unsigned packetSize);
+  static void afterPacketizing(void* clientData);
+
+private:
+  char* fSDPMediaType;
+  char* fRTPPayloadFormatName;
+  char* fAuxSDPLine;
+  unsigned fRTPTimestampFrequency;
+  unsigned fNumChannels;
+  unsigned fEstBitrate;
+  u_int64_t fDuration; // in microseconds
+
+  // The cached packets are kept, as consecutive records, in "fData":
+  u_int8_t* fData;
+  unsigned fDataSize, fDataBufferSize;
+  unsigned* fPacketOffsets; // the offset (in "fData") of each packet's record
+  unsigned fNumPackets;
+  unsigned fMaxPayloadSize;
+
+  // State used only while packetizing (by the first "createNew()"):
+  MultiFramedRTPSink* fPacketizingSink;
+  u_int64_t fNextPacketSendTime;
+  u_int32_t fFirstRTPTimestamp;
+  char fDoneFlag;
+};
+
+
+// A source that delivers - as frames - the payloads of the packets in a "RTPHintCache", at the times at which they're due:
+
+class RTPHintCacheSource: public FramedSource {
+public:
+  static RTPHintCacheSource* createNew(UsageEnvironment& env, RTPHintCache& hintCache);
+
+  Boolean curPacketMarkerBit() const { return fCurPacketMarkerBit; }
+  void seekToTime(double& seekNPT, double streamDuration, u_int64_t& numBytes);
+      // (See "OnDemandServerMediaSubsession::seekStreamSource()".)
+
+protected:
+  RTPHintCacheSource(UsageEnvironment& env, RTPHintCache& hintCache);
+      // called only by createNew()
+  virtual ~RTPHintCacheSource();
+
+private:
+  // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  RTPHintCache& fHintCache;
+  unsigned fNextPacketNum, fLimitPacketNum;
+  Boolean fHaveStartedDelivery; // since our creation, or our last seek
+  struct timeval fPresentationTimeBase; // the presentation time of the first packet that we deliver
+  u_int32_t fFirstRTPTimestampOffset; // the RTP timestamp offset of the first packet that we deliver
+  Boolean fCurPacketMarkerBit;
+};
+
+
+// A "RTPSink" that sends - one per RTP packet - the payloads delivered by a "RTPHintCacheSource".
+// (Only the RTP header - SSRC, sequence number, and timestamp - is generated anew.)
+
+class RTPHintCacheRTPSink: public MultiFramedRTPSink {
+public:
+  static RTPHintCacheRTPSink* createNew(UsageEnvironment& env, Groupsock* RTPgs,
+					unsigned char rtpPayloadFormat, RTPHintCache& hintCache);
+
+protected:
+  RTPHintCacheRTPSink(UsageEnvironment& env, Groupsock* RTPgs,
+		      unsigned char rtpPayloadFormat, RTPHintCache& hintCache);
+      // called only by createNew()
+  virtual ~RTPHintCacheRTPSink();
+
+private: // redefined virtual functions:
+  virtual char const* sdpMediaType() const;
+  virtual char const* auxSDPLine();
+  virtual void doSpecialFrameHandling(unsigned fragmentationOffset,
+                                      unsigned char* frameStart,
+                                      unsigned numBytesInFrame,
+                                      struct timeval framePresentationTime,
+                                      unsigned numRemainingBytes);
+  virtual Boolean frameCanAppearAfterPacketStart(unsigned char const* frameStart,
+						 unsigned numBytesInFrame) const;
+
+private:
+  RTPHintCache& fHintCache;
+  char* fAuxSDPLine; // the cache's 'aux SDP line', but with our own payload type
+};
+
+#endif
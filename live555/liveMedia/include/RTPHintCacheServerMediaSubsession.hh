@@ -0,0 +1,76 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that creates new, unicast, "RTPSink"s
+// on demand, that stream pre-packetized RTP packets from a "RTPHintCache".
+// C++ header
+
+#ifndef _RTP_HINT_CACHE_SERVER_MEDIA_SUBSESSION_HH
+#define _RTP_HINT_CACHE_SERVER_MEDIA_SUBSESSION_HH
+
+#ifndef _ON_DEMAND_SERVER_MEDIA_SUBSESSION_HH
+#include "OnDemandServerMediaSubsession.hh"
+#endif
+#ifndef _RTP_HINT_CACHE_HH
+#include "RTPHintCache.hh"
+#endif
+
+class RTPHintCacheServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  static RTPHintCacheServerMediaSubsession*
+  createNew(UsageEnvironment& env, OnDemandServerMediaSubsession* packetizingSubsession,
+	    char const* hintCacheFileName, Boolean reuseFirstSource, char const* sourceFileName = NULL);
+      // "packetizingSubsession" is an ordinary subsession for the media - e.g., a "H264VideoFileServerMediaSubsession".
+      // It is used - once only, by "createNew()" - to packetize the whole stream into our cache, unless
+      // "hintCacheFileName" (which may be NULL) names an existing 'hint cache file', in which case we use that
+      // instead.  If we packetize the stream, and "hintCacheFileName" is non-NULL, then we also write the cache to
+      // that file, for next time.  If "sourceFileName" (the media file that "packetizingSubsession" reads) is non-NULL,
+      // then the 'hint cache file' also records that file's size and modification time, and is rebuilt if either
+      // changes.  (Otherwise, delete the 'hint cache file' if the media changes.)
+      // Note that packetizing runs the event loop - without handling any client requests - until the whole stream has
+      // been packetized, so create this subsession before starting the server (or provide a 'hint cache file').
+      // Each client is then streamed directly from the (in-memory) cache.
+      // We take ownership of "packetizingSubsession" (i.e., we close it when we're closed).
+
+  RTPHintCache* hintCache() const { return fHintCache; } // NULL if the cache couldn't be set up (yet)
+
+protected:
+  RTPHintCacheServerMediaSubsession(UsageEnvironment& env, OnDemandServerMediaSubsession* packetizingSubsession,
+				    char const* hintCacheFileName, Boolean reuseFirstSource, char const* sourceFileName);
+      // called only by createNew();
+  virtual ~RTPHintCacheServerMediaSubsession();
+
+  Boolean setUpHintCache(); // reads or creates "fHintCache", if we don't already have it
+
+protected: // redefined virtual functions
+  virtual float duration() const;
+  virtual void seekStreamSource(FramedSource* inputSource, double& seekNPT, double streamDuration, u_int64_t& numBytes);
+  virtual FramedSource* createNewStreamSource(unsigned clientSessionId,
+					      unsigned& estBitrate);
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
+                                    unsigned char rtpPayloadTypeIfDynamic,
+				    FramedSource* inputSource);
+
+private:
+  OnDemandServerMediaSubsession* fPacketizingSubsession;
+  char* fHintCacheFileName;
+  char* fSourceFileName;
+  RTPHintCache* fHintCache;
+  Boolean fIsSettingUpHintCache; // prevents a re-entrant call (during the event loop) from packetizing the stream again
+};
+
+#endif
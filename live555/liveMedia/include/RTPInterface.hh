@@ -52,6 +52,8 @@ public:
   unsigned char fStreamChannelId;
 };
 
+class SharedSocketDescriptor; // forward
+
 class RTPInterface {
 public:
   RTPInterface(Medium* owner, Groupsock* gs);
@@ -70,6 +72,7 @@ public:
   Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 		     unsigned& bytesRead, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete);
   void stopNetworkReading();
+  void stopDatagramReading(); // like "stopNetworkReading()", but leaves any TCP connections alone
 
   UsageEnvironment& envir() const { return fOwner->envir(); }
 
@@ -89,8 +92,11 @@ private:
 				     int socketNum, unsigned char streamChannelId);
   Boolean sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed);
 
+  void stopSharedSocketReading();
+
 private:
   friend class SocketDescriptor;
+  friend class SharedSocketDescriptor;
   Medium* fOwner;
   Groupsock* fGS;
   tcpStreamRecord* fTCPStreams; // optional, for RTP-over-TCP streaming/receiving
@@ -103,6 +109,10 @@ private:
 
   AuxHandlerFunc* fAuxReadHandlerFunc;
   void* fAuxReadHandlerClientData;
+
+  // Used if our 'groupsock' shares its socket with other "RTPInterface"s:
+  int fSharedSocketNum; // the socket, if we've registered to read from it; -1 otherwise
+  SharedSocketDescriptor* fNextSharedReadDescriptor; // non-NULL iff it holds a packet for us to read
 };
 
 #endif
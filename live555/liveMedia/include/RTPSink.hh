@@ -29,6 +29,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class RTPTransmissionStatsDB; // forward
+class RTPRetransmissionHistory; // forward
+class AfterSendingPacketHandlerRecord; // forward
 
 class RTPSink: public MediaSink {
 public:
@@ -69,6 +71,25 @@ public:
       // returns the number of bytes sent since the last time that we
       // were called, and resets the counter.
 
+  void enableRetransmissions(unsigned historySize = 512, unsigned char rtxPayloadType = 0);
+      // If called, we remember (in a fixed-size buffer) the most recent "historySize" packets that we've sent, so that
+      // we can retransmit them if a receiver asks for them using RTCP 'Generic NACK' feedback (RFC 4585).
+      // If "rtxPayloadType" is non-zero, then retransmitted packets are sent as a separate 'RTX' stream (RFC 4588),
+      // multiplexed - using a different SSRC, and this payload type - with our original stream.  Otherwise,
+      // retransmitted packets are resent unchanged, as part of our original stream.
+  Boolean retransmissionsAreEnabled() const { return fRetransmissionHistory != NULL; }
+  unsigned char rtxPayloadType() const { return fRTXPayloadType; }
+  unsigned numPacketsRetransmitted() const { return fNumPacketsRetransmitted; }
+  unsigned numUnavailableRetransmissions() const { return fNumUnavailableRetransmissions; }
+      // requested packets that we couldn't retransmit, because they were no longer in our history
+
+  typedef void (afterSendingPacketFunc)(void* clientData, unsigned char const* packet, unsigned packetSize);
+  void addAfterSendingPacketHandler(afterSendingPacketFunc* handler, void* clientData);
+  void removeAfterSendingPacketHandler(afterSendingPacketFunc* handler, void* clientData);
+      // Each added "handler" is called after we send each RTP packet, with the complete packet (including its RTP header).
+      // (This is used - e.g., by "SMPTE2022FECSender" to compute FEC packets, and by "RTPHintCache" to record packets.
+      // Because several of these may use the same sink, each removes only its own "handler"/"clientData" pair.)
+
   struct timeval const& creationTime() const { return fCreationTime; }
   struct timeval const& initialPresentationTime() const { return fInitialPresentationTime; }
   struct timeval const& mostRecentPresentationTime() const { return fMostRecentPresentationTime; }
@@ -106,6 +127,11 @@ protected:
   u_int32_t convertToRTPTimestamp(struct timeval tv);
   unsigned packetCount() const {return fPacketCount;}
   unsigned octetCount() const {return fOctetCount;}
+  void retransmitPacket(u_int16_t seqNum);
+
+protected:
+  void noteSentPacket(unsigned char const* packet, unsigned packetSize);
+      // called by subclasses, after sending each RTP packet, so that we can retransmit it later if asked
 
 protected:
   RTPInterface fRTPInterface;
@@ -129,6 +155,15 @@ private:
   struct timeval fCreationTime;
 
   RTPTransmissionStatsDB* fTransmissionStatsDB;
+
+  // State used for retransmissions:
+  RTPRetransmissionHistory* fRetransmissionHistory;
+  unsigned char fRTXPayloadType;
+  u_int32_t fRTXSSRC;
+  u_int16_t fRTXSeqNo;
+  unsigned fNumPacketsRetransmitted, fNumUnavailableRetransmissions;
+
+  AfterSendingPacketHandlerRecord* fAfterSendingPacketHandlers; // a list, in the order in which they were added
 };
 
 
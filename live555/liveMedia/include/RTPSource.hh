@@ -29,6 +29,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class RTPReceptionStatsDB; // forward
+class RTCPInstance; // forward
 
 class RTPSource: public FramedSource {
 public:
@@ -61,6 +62,13 @@ public:
 
   Boolean& enableRTCPReports() { return fEnableRTCPReports; }
 
+  void registerForMultiplexedRTCPPackets(RTCPInstance* rtcpInstance) {
+    fRTCPInstanceForMultiplexedRTCPPackets = rtcpInstance;
+  }
+  void deregisterForMultiplexedRTCPPackets() { registerForMultiplexedRTCPPackets(NULL); }
+      // Used if RTCP is multiplexed with RTP on our socket (RFC 5761): We then hand each incoming RTCP packet
+      // to this "RTCPInstance", rather than treating it as a RTP packet.
+
   void setStreamSocket(int sockNum, unsigned char streamChannelId) {
     // hack to allow sending RTP over TCP (RFC 2236, section 10.12)
     fRTPInterface.setStreamSocket(sockNum, streamChannelId);
@@ -95,6 +103,7 @@ protected:
   Boolean fCurPacketMarkerBit;
   Boolean fCurPacketHasBeenSynchronizedUsingRTCP;
   u_int32_t fLastReceivedSSRC;
+  RTCPInstance* fRTCPInstanceForMultiplexedRTCPPackets;
 
 private:
   // redefined virtual functions:
@@ -143,12 +152,24 @@ public:
 			  Boolean useForJitterCalculation,
 			  struct timeval& resultPresentationTime,
 			  Boolean& resultHasBeenSyncedUsingRTCP,
-			  unsigned packetSize /* payload only */);
+			  unsigned packetSize /* payload only */,
+			  struct timeval const* timeReceived = NULL);
+      // If "timeReceived" is NULL, then the current time is used.
+
+  // The following is called instead, for a retransmitted packet (which is not counted in the reception stats),
+  // to get the 'presentation time' of "rtpTimestamp" in the stream "SSRC":
+  void computePresentationTime(u_int32_t SSRC, u_int32_t rtpTimestamp,
+			       unsigned timestampFrequency,
+			       struct timeval& resultPresentationTime,
+			       Boolean& resultHasBeenSyncedUsingRTCP,
+			       struct timeval const* timeReceived = NULL);
 
   // The following is called whenever a RTCP SR packet is received:
   void noteIncomingSR(u_int32_t SSRC,
 		      u_int32_t ntpTimestampMSW, u_int32_t ntpTimestampLSW,
-		      u_int32_t rtpTimestamp);
+		      u_int32_t rtpTimestamp,
+		      struct timeval const* timeReceived = NULL);
+      // If "timeReceived" is NULL, then the current time is used.
 
   // The following is called when a RTCP BYE packet is received:
   void removeRecord(u_int32_t SSRC);
@@ -220,9 +241,14 @@ private:
 			  Boolean useForJitterCalculation,
 			  struct timeval& resultPresentationTime,
 			  Boolean& resultHasBeenSyncedUsingRTCP,
-			  unsigned packetSize /* payload only */);
+			  unsigned packetSize /* payload only */,
+			  struct timeval const* timeReceived);
+  void computePresentationTime(u_int32_t rtpTimestamp, unsigned timestampFrequency,
+			       struct timeval const& timeNow,
+			       struct timeval& resultPresentationTime,
+			       Boolean& resultHasBeenSyncedUsingRTCP);
   void noteIncomingSR(u_int32_t ntpTimestampMSW, u_int32_t ntpTimestampLSW,
-		      u_int32_t rtpTimestamp);
+		      u_int32_t rtpTimestamp, struct timeval const* timeReceived);
   void init(u_int32_t SSRC);
   void initSeqNum(u_int16_t initialSeqNum);
   void reset();
@@ -253,8 +253,8 @@ private:
   void handleIncomingRequest();
   static Boolean checkForHeader(char const* line, char const* headerName, unsigned headerNameLength, char const*& headerParams);
   Boolean parseTransportParams(char const* paramsStr,
-			       char*& serverAddressStr, portNumBits& serverPortNum,
-			       unsigned char& rtpChannelId, unsigned char& rtcpChannelId);
+			       char*& serverAddressStr, portNumBits& serverPortNum, portNumBits& serverRTCPPortNum,
+			       unsigned char& rtpChannelId, unsigned char& rtcpChannelId, Boolean& rtcpIsMuxed);
   Boolean parseScaleParam(char const* paramStr, float& scale);
   Boolean parseRTPInfoParams(char const*& paramStr, u_int16_t& seqNum, u_int32_t& timestamp);
   Boolean handleSETUPResponse(MediaSubsession& subsession, char const* sessionParamsStr, char const* transportParamsStr,
@@ -144,6 +144,12 @@ public:
 	// Note: RTSP-over-HTTP tunneling is described in http://developer.apple.com/quicktime/icefloe/dispatch028.html
 	portNumBits httpServerPortNum() const; // in host byte order.  (Returns 0 if not present.)
 
+	unsigned numClientSessionsReclaimed() const {
+		return fNumClientSessionsReclaimed;
+	}
+	// The number of client sessions that we have reclaimed (so far) because no RTSP commands - or RTCP "RR" packets -
+	// were received from the client in at least "reclamationTestSeconds" seconds.
+
 protected:
 	RTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort,
 			UserAuthenticationDatabase* authDatabase,
@@ -338,7 +344,11 @@ public:
 		Boolean usesTCPTransport() const {
 			return fTCPStreamIdCount > 0;
 		}
-		TaskToken fLivenessCheckTask;
+		// 'Liveness' state, used by our server's periodic 'liveness sweep':
+		long fLastLivenessTime; // in seconds
+		int fLivenessBucketIndex; // -1 if we're not in a bucket
+		RTSPClientSession* fNextInLivenessBucket;
+		RTSPClientSession* fPrevInLivenessBucket;
 		unsigned fNumStreamStates;
 		struct streamState {
 			ServerMediaSubsession* subsession;
@@ -376,6 +386,15 @@ private:
 
 	void incomingConnectionHandler(int serverSocket);
 
+	// 'Liveness' checking of client sessions.  Rather than each session having its own delayed task (rescheduled each time that
+	// the client shows signs of life), each session just records the time of its latest 'liveness' indication, and sits in one
+	// of a ring of 'buckets', indexed by its reclamation deadline (in seconds).  Once each second, a single task checks the
+	// sessions in the bucket that has just become due - reclaiming those that have timed out, and moving the rest to later buckets:
+	void addToLivenessBucket(RTSPClientSession* clientSession, long deadline);
+	void removeFromLivenessBucket(RTSPClientSession* clientSession);
+	static void livenessSweepTask(void* clientData);
+	void livenessSweep();
+
 public:
 	// Some compilers complain if this is "private:"
 	// A class that represents the state of a "REGISTER" request in progress:
@@ -437,6 +456,11 @@ private:
 	HashTable* fPendingRegisterRequests;
 	UserAuthenticationDatabase* fAuthDB;
 	unsigned fReclamationTestSeconds;
+	RTSPClientSession** fLivenessBuckets;
+	unsigned fNumLivenessBuckets, fNumClientSessionsInLivenessBuckets;
+	long fLastLivenessSweepTime; // in seconds
+	TaskToken fLivenessSweepTask;
+	unsigned fNumClientSessionsReclaimed;
 };
 
 ////////// A subclass of "RTSPServer" that implements the "REGISTER" command to set up proxying on the specified URL //////////
@@ -0,0 +1,126 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2013 Live Networks, Inc.  All rights reserved.
+// Row/column XOR Forward Error Correction (FEC) for RTP streams - e.g., MPEG Transport Streams - as specified
+// by SMPTE 2022-1 (a.k.a. the "Pro-MPEG Code of Practice #3").
+// C++ header
+
+#ifndef _SMPTE2022_FEC_HH
+#define _SMPTE2022_FEC_HH
+
+#ifndef _MULTI_FRAMED_RTP_SOURCE_HH
+#include "MultiFramedRTPSource.hh"
+#endif
+#ifndef _RTP_SINK_HH
+#include "RTPSink.hh"
+#endif
+#ifndef _GROUPSOCK_HH
+#include <Groupsock.hh>
+#endif
+
+// The media packets are arranged - in sequence number order - into a 'matrix' of "numRows" rows of "numColumns"
+// packets each.  One FEC packet is generated for each column (and, optionally, one for each row); each is the XOR
+// of the packets in its column (or row), and can be used to recover any one of these packets, if it is lost.
+// Column FEC packets are conventionally sent to the media stream's port number + 2; row FEC packets to
+// the media stream's port number + 4.
+// (SMPTE 2022-1 limits the matrix to at most 20 columns, at most 20 rows, and at most 100 packets in all.)
+
+class SMPTE2022FECSender: public Medium {
+public:
+  static SMPTE2022FECSender* createNew(UsageEnvironment& env, RTPSink* mediaSink,
+				       Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock,
+				       unsigned numColumns, unsigned numRows,
+				       unsigned char fecPayloadType = 96);
+      // Generates FEC packets from the RTP packets that "mediaSink" sends.  "rowFECGroupsock" may be NULL,
+      // in which case only column FEC packets are sent.
+
+  unsigned numColumns() const { return fNumColumns; }
+  unsigned numRows() const { return fNumRows; }
+  unsigned numFECPacketsSent() const { return fNumFECPacketsSent; }
+
+protected:
+  SMPTE2022FECSender(UsageEnvironment& env, RTPSink* mediaSink,
+		     Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock,
+		     unsigned numColumns, unsigned numRows, unsigned char fecPayloadType);
+      // called only by createNew()
+  virtual ~SMPTE2022FECSender();
+
+private:
+  static void afterSendingMediaPacket(void* clientData, unsigned char const* packet, unsigned packetSize);
+  void afterSendingMediaPacket1(unsigned char const* packet, unsigned packetSize);
+  void sendFECPacket(class SMPTE2022FECAccumulator& accumulator, Groupsock* gs, Boolean isRowFEC);
+
+private:
+  RTPSink* fMediaSink;
+  Groupsock* fColumnFECGroupsock;
+  Groupsock* fRowFECGroupsock;
+  unsigned fNumColumns, fNumRows;
+  unsigned char fFECPayloadType;
+  Boolean fHaveStartedMatrix;
+  u_int16_t fMatrixBaseSeqNum;
+  class SMPTE2022FECAccumulator* fColumnAccumulators; // one for each column
+  class SMPTE2022FECAccumulator* fRowAccumulator;
+  u_int16_t fColumnFECSeqNum, fRowFECSeqNum;
+  unsigned char* fOutBuf;
+  unsigned fNumFECPacketsSent;
+};
+
+class SMPTE2022FECReceiver: public Medium {
+public:
+  static SMPTE2022FECReceiver* createNew(UsageEnvironment& env, MultiFramedRTPSource* mediaSource,
+					 Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock);
+      // Reads FEC packets from "columnFECGroupsock" and (if not NULL) "rowFECGroupsock", and uses them to recover
+      // packets that "mediaSource" failed to receive.  (The matrix size is taken from the incoming FEC packets.)
+      // Note that recovered packets can be used only if "mediaSource" is still waiting for them - i.e., its packet
+      // reordering threshold must allow time for the FEC packets (which follow their rows or columns) to arrive.
+      // We must be closed before "mediaSource" is.
+
+  unsigned numRecoveredPackets() const { return fNumRecoveredPackets; }
+      // lost packets that we recovered (in time for "mediaSource" to use them)
+  unsigned numLateRecoveredPackets() const { return fNumLateRecoveredPackets; }
+      // lost packets that we recovered, but too late for "mediaSource" to use them
+  unsigned numFECPacketsReceived() const { return fNumFECPacketsReceived; }
+
+protected:
+  SMPTE2022FECReceiver(UsageEnvironment& env, MultiFramedRTPSource* mediaSource,
+		       Groupsock* columnFECGroupsock, Groupsock* rowFECGroupsock);
+      // called only by createNew()
+  virtual ~SMPTE2022FECReceiver();
+
+private:
+  static void incomingMediaPacketHandler(void* clientData, unsigned char const* packet, unsigned packetSize);
+  void incomingMediaPacketHandler1(unsigned char const* packet, unsigned packetSize);
+  static void incomingColumnFECPacketHandler(SMPTE2022FECReceiver* receiver, int mask);
+  static void incomingRowFECPacketHandler(SMPTE2022FECReceiver* receiver, int mask);
+  void incomingFECPacketHandler1(Groupsock* gs);
+  static void recoveryHandler(SMPTE2022FECReceiver* receiver);
+  void tryToRecoverPackets();
+  Boolean tryToRecoverPacket(class SMPTE2022PendingFECPacket& fecPacket, Boolean& fecPacketIsNoLongerNeeded);
+
+private:
+  MultiFramedRTPSource* fMediaSource;
+  Groupsock* fColumnFECGroupsock;
+  Groupsock* fRowFECGroupsock;
+  class SMPTE2022MediaPacketHistory* fMediaPackets;
+  class SMPTE2022PendingFECPacket* fPendingFECPackets;
+  unsigned fNumPendingFECPackets;
+  TaskToken fRecoveryTask;
+  unsigned char* fInBuf;
+  unsigned fNumRecoveredPackets, fNumLateRecoveredPackets, fNumFECPacketsReceived;
+};
+
+#endif
@@ -34,14 +34,17 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "GSMAudioRTPSink.hh"
 #include "H263plusVideoRTPSink.hh"
 #include "H264VideoRTPSink.hh"
+#include "H265VideoRTPSink.hh"
 #include "DVVideoRTPSource.hh"
 #include "DVVideoRTPSink.hh"
 #include "DVVideoStreamFramer.hh"
 #include "H264VideoStreamDiscreteFramer.hh"
+#include "H265VideoStreamDiscreteFramer.hh"
 #include "JPEGVideoRTPSink.hh"
 #include "SimpleRTPSink.hh"
 #include "uLawAudioFilter.hh"
 #include "MPEG2IndexFromTransportStream.hh"
+#include "MPEG2TransportStreamIncrementalIndexer.hh"
 #include "MPEG2TransportStreamTrickModeFilter.hh"
 #include "ByteStreamMultiFileSource.hh"
 #include "ByteStreamMemoryBufferSource.hh"
@@ -67,6 +70,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "H261VideoRTPSource.hh"
 #include "H263plusVideoRTPSource.hh"
 #include "H264VideoRTPSource.hh"
+#include "H265VideoRTPSource.hh"
+#include "NALUnitEmulationPrevention.hh"
 #include "MP3FileSource.hh"
 #include "MP3ADU.hh"
 #include "MP3ADUinterleaving.hh"
@@ -95,6 +100,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "PassiveServerMediaSubsession.hh"
 #include "MPEG4VideoFileServerMediaSubsession.hh"
 #include "H264VideoFileServerMediaSubsession.hh"
+#include "H265VideoFileServerMediaSubsession.hh"
 #include "WAVAudioFileServerMediaSubsession.hh"
 #include "AMRAudioFileServerMediaSubsession.hh"
 #include "AMRAudioFileSource.hh"
@@ -112,6 +118,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MPEG2TransportUDPServerMediaSubsession.hh"
 #include "MatroskaFileServerDemux.hh"
 #include "ProxyServerMediaSession.hh"
+#include "RTPHintCacheServerMediaSubsession.hh"
 #include "DarwinInjector.hh"
+#include "SMPTE2022FEC.hh"
 
 #endif
@@ -163,6 +163,14 @@ static ServerMediaSession* createNewSMS(UsageEnvironment& env,
         sms->addSubsession(H264VideoFileServerMediaSubsession::createNew(env,
                            fileName, reuseSource));
     }
+    else if (strcmp(extension, ".265") == 0)
+    {
+        // Assumed to be a H.265 Video Elementary Stream file:
+        NEW_SMS("H.265 Video");
+        OutPacketBuffer::maxSize = 100000; // allow for some possibly large H.265 frames
+        sms->addSubsession(H265VideoFileServerMediaSubsession::createNew(env,
+                           fileName, reuseSource));
+    }
     else if (strcmp(extension, ".mp3") == 0)
     {
         // Assumed to be a MPEG-1 or 2 Audio file:
@@ -0,0 +1,763 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that reads an existing MPEG-2 Transport Stream file (usually having suffix ".ts"),
+// and generates the same index file (with suffix ".tsx") as "MPEG2TransportStreamIndexer" - but faster,
+// for large files: The file is split (at Transport Stream packet boundaries) into chunks that are indexed
+// concurrently, each in its own thread, and the resulting index records are then concatenated.
+// (Optionally, the program also runs the existing, sequential indexing code on the same file, and compares
+// its speed and its output with ours.)
+// main program
+
+#include <liveMedia.hh>
+#include <BasicUsageEnvironment.hh>
+#include "GroupsockHelper.hh"
+#include "InputFile.hh"
+#include "OutputFile.hh"
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(_WIN32_WCE) && !defined(_QNX4)
+// (Without POSIX threads - e.g., on Windows or QNX 4 - the chunks are indexed one at a time, in this thread.)
+#include <pthread.h>
+#include <unistd.h>
+#define USE_THREADS 1
+#endif
+
+// How it works:
+// A chunk's index records depend upon the state that the indexer carried into the chunk (the stream's PIDs, the last
+// PCR, etc.), and upon where the frame (or NAL unit) that straddles the chunk's start began.  So:
+// 1/ For each chunk (after the first), we first estimate the starting state, by indexing the packets just before the
+//    chunk, and we find the chunk's 'sync point': the start of the second frame that can be parsed from the chunk's
+//    own data.  (Frames after this point are parsed the same way, regardless of where parsing began.)
+// 2/ Each chunk is then indexed (starting from its estimated state), keeping only the records from its own sync point
+//    up to (but not including) the next chunk's sync point - reading past the end of the chunk, if necessary.
+// 3/ As each chunk is completed, in order, we check that its starting state was the state that the previous chunk ended
+//    with.  If only the PCR state differed (e.g., because the PCR went backwards in an earlier chunk), the chunk (and any
+//    later chunk that made the same assumption) is indexed again.  In the (unlikely) event that any other state
+//    differed, we index the whole file sequentially instead.
+
+typedef MPEG2IFrameIndexFromTransportStream::ParseState ParseState;
+
+#define INDEX_RECORD_SIZE 11
+#define STATE_WINDOW_NUM_PACKETS 4096 // the number of packets before each chunk used to estimate its starting state
+
+UsageEnvironment* env;
+char const* programName;
+char const* inputFileName;
+u_int64_t numPackets;
+unsigned numThreads;
+Boolean doBenchmark = False;
+
+void usage() {
+  *env << "usage: " << programName << " [-j <num-threads>] [-c <chunk-size-in-kbytes>] [-b] <transport-stream-file-name>\n";
+  *env << "\twhere <transport-stream-file-name> ends with \".ts\"\n";
+  *env << "\t(\"-b\" also runs the sequential indexer, to compare its speed and its output with ours)\n";
+  exit(1);
+}
+
+// A "UsageEnvironment" that saves its (error and warning) messages, rather than printing them immediately, so that
+// each chunk's messages can be printed in order, and only once:
+class ChunkUsageEnvironment: public BasicUsageEnvironment {
+public:
+  static ChunkUsageEnvironment* createNew(TaskScheduler& taskScheduler) {
+    return new ChunkUsageEnvironment(taskScheduler);
+  }
+
+  void setSaveMessages(Boolean saveMessages) { fSaveMessages = saveMessages; }
+  char* takeMessages() { // returns the saved messages (or NULL), which the caller must delete[]
+    char* result = fMessages;
+    fMessages = NULL; fMessagesSize = 0;
+    return result;
+  }
+
+  virtual UsageEnvironment& operator<<(char const* str) {
+    if (str == NULL) str = "(NULL)"; // sanity check
+    if (fSaveMessages) {
+      unsigned len = strlen(str);
+      char* newMessages = new char[fMessagesSize + len + 1];
+      if (fMessages != NULL) memmove(newMessages, fMessages, fMessagesSize);
+      memmove(&newMessages[fMessagesSize], str, len + 1);
+      delete[] fMessages;
+      fMessages = newMessages; fMessagesSize += len;
+    }
+    return *this;
+  }
+  virtual UsageEnvironment& operator<<(int i) {
+    char buf[30]; sprintf(buf, "%d", i);
+    return *this << buf;
+  }
+  virtual UsageEnvironment& operator<<(unsigned u) {
+    char buf[30]; sprintf(buf, "%u", u);
+    return *this << buf;
+  }
+  virtual UsageEnvironment& operator<<(double d) {
+    char buf[100]; sprintf(buf, "%f", d);
+    return *this << buf;
+  }
+  virtual UsageEnvironment& operator<<(void* p) {
+    char buf[30]; sprintf(buf, "%p", p);
+    return *this << buf;
+  }
+
+protected:
+  ChunkUsageEnvironment(TaskScheduler& taskScheduler)
+    : BasicUsageEnvironment(taskScheduler), fSaveMessages(False), fMessages(NULL), fMessagesSize(0) {
+  }
+  virtual ~ChunkUsageEnvironment() {
+    delete[] fMessages;
+  }
+
+private:
+  Boolean fSaveMessages;
+  char* fMessages;
+  unsigned fMessagesSize;
+};
+
+// Reads consecutive Transport Stream packets from the input file, a block at a time:
+#define PACKET_READER_BLOCK_NUM_PACKETS 1024
+
+class PacketReader {
+public:
+  PacketReader(u_int64_t firstPacketNum)
+    : fNumPacketsInBlock(0), fNextPacketIndex(0), fHadError(False) {
+    fFid = OpenInputFile(*env, inputFileName);
+    if (fFid == NULL || SeekFile64(fFid, (int64_t)(firstPacketNum*TRANSPORT_PACKET_SIZE), SEEK_SET) < 0) {
+      fHadError = True;
+    }
+  }
+  ~PacketReader() {
+    if (fFid != NULL) CloseInputFile(fFid);
+  }
+
+  u_int8_t const* nextPacket() { // returns NULL at the end of the file
+    if (fNextPacketIndex == fNumPacketsInBlock) {
+      if (fHadError) return NULL;
+      fNumPacketsInBlock = fread(fBlock, TRANSPORT_PACKET_SIZE, PACKET_READER_BLOCK_NUM_PACKETS, fFid);
+      fNextPacketIndex = 0;
+      if (fNumPacketsInBlock == 0) return NULL;
+    }
+    return &fBlock[TRANSPORT_PACKET_SIZE*(fNextPacketIndex++)];
+  }
+
+private:
+  FILE* fFid;
+  u_int8_t fBlock[TRANSPORT_PACKET_SIZE*PACKET_READER_BLOCK_NUM_PACKETS];
+  unsigned fNumPacketsInBlock, fNextPacketIndex;
+  Boolean fHadError;
+};
+
+static u_int64_t recordPosition(u_int8_t const* record) {
+  // The position (Transport Stream packet number, and offset within the packet) of the data that a record describes:
+  u_int32_t tpn = record[7]|(record[8]<<8)|(record[9]<<16)|(record[10]<<24);
+  return ((u_int64_t)tpn<<8)|record[1];
+}
+
+static Boolean recordStartsFrame(u_int8_t const* record) {
+  return (record[0]&0x80) != 0;
+}
+
+enum ChunkStatus { CHUNK_PENDING, CHUNK_RUNNING, CHUNK_DONE };
+
+class Chunk {
+public:
+  Chunk()
+    : haveSyncPoint(False), syncPosition(0),
+      status(CHUNK_PENDING), version(0),
+      records(NULL), recordsSize(0), recordsMaxSize(0), messages(NULL),
+      endedEarly(False), wasInconsistent(False) {
+  }
+  ~Chunk() { freeResult(); }
+
+  void freeResult() {
+    delete[] records; records = NULL; recordsSize = recordsMaxSize = 0;
+    delete[] messages; messages = NULL;
+    endedEarly = wasInconsistent = False;
+  }
+  void addRecord(u_int8_t const* record) {
+    if (recordsSize + INDEX_RECORD_SIZE > recordsMaxSize) {
+      unsigned newMaxSize = recordsMaxSize == 0 ? 1000*INDEX_RECORD_SIZE : 2*recordsMaxSize;
+      u_int8_t* newRecords = new u_int8_t[newMaxSize];
+      if (records != NULL) memmove(newRecords, records, recordsSize);
+      delete[] records;
+      records = newRecords; recordsMaxSize = newMaxSize;
+    }
+    memmove(&records[recordsSize], record, INDEX_RECORD_SIZE);
+    recordsSize += INDEX_RECORD_SIZE;
+  }
+
+public:
+  u_int64_t firstPacketNum, endPacketNum;
+
+  // Set by "prepareChunk()" (for each chunk after the first):
+  Boolean haveSyncPoint;
+  u_int64_t syncPosition; // of the first record that we keep (see "recordPosition()")
+
+  // The (estimated) state at the start of the chunk; "version" is incremented each time it changes:
+  ParseState startState;
+  ChunkStatus status;
+  unsigned version;
+
+  // Set by "indexChunk()":
+  u_int8_t* records;
+  unsigned recordsSize, recordsMaxSize;
+  char* messages;
+  ParseState endState; // the state at "endPacketNum"
+  Boolean endedEarly; // the input ended (or had an error) before "endPacketNum"
+  Boolean wasInconsistent; // we did not find the expected sync points (this shouldn't happen)
+};
+
+Chunk* chunks;
+unsigned numChunks;
+ParseState headState; // the state after indexing the start of the file
+u_int64_t firstPCRPacketNum; // the packet in which the first PCR was seen (or ~0, if none was seen)
+
+void indexFileStart(ChunkUsageEnvironment& ourEnv) {
+  // Index the first few packets of the file, to find its PIDs, and its first PCR:
+  MPEG2IFrameIndexFromTransportStream* indexer = MPEG2IFrameIndexFromTransportStream::createNew(ourEnv, NULL);
+  PacketReader reader(0);
+  firstPCRPacketNum = ~0;
+  u_int8_t const* pkt;
+  u_int8_t record[INDEX_RECORD_SIZE];
+  for (u_int64_t pktNum = 0; pktNum < STATE_WINDOW_NUM_PACKETS && (pkt = reader.nextPacket()) != NULL; ++pktNum) {
+    if (!indexer->addTransportPacket(pkt)) break;
+    while (indexer->getNextIndexRecord(record)) {}
+
+    if (firstPCRPacketNum == (u_int64_t)(~0)) {
+      indexer->getParseState(headState);
+      if (headState.haveSeenFirstPCR) firstPCRPacketNum = pktNum;
+    }
+  }
+  indexer->getParseState(headState);
+  Medium::close(indexer);
+}
+
+void prepareChunk(ChunkUsageEnvironment& ourEnv, Chunk& chunk) {
+  u_int8_t const* pkt;
+  u_int8_t record[INDEX_RECORD_SIZE];
+
+  // Estimate the state at the start of the chunk, by indexing the packets that precede it:
+  u_int64_t windowStart
+    = chunk.firstPacketNum > STATE_WINDOW_NUM_PACKETS ? chunk.firstPacketNum - STATE_WINDOW_NUM_PACKETS : 0;
+  MPEG2IFrameIndexFromTransportStream* indexer = MPEG2IFrameIndexFromTransportStream::createNew(ourEnv, NULL);
+  if (windowStart > 0) {
+    // Assume that the stream's PIDs have not changed since the start of the file, and that the PCR has not gone backwards:
+    ParseState windowState = headState;
+    windowState.lastContinuityCounter = ParseState().lastContinuityCounter;
+    windowState.haveSeenFirstPCR = firstPCRPacketNum < windowStart;
+    if (!windowState.haveSeenFirstPCR) windowState.firstPCR = 0.0;
+    windowState.lastPCR = 0.0;
+    indexer->setParseState(windowState, windowStart);
+  }
+  {
+    PacketReader reader(windowStart);
+    for (u_int64_t pktNum = windowStart; pktNum < chunk.firstPacketNum && (pkt = reader.nextPacket()) != NULL; ++pktNum) {
+      if (!indexer->addTransportPacket(pkt)) break;
+      while (indexer->getNextIndexRecord(record)) {}
+    }
+  }
+  indexer->getParseState(chunk.startState);
+  Medium::close(indexer);
+
+  // Then find the chunk's sync point - the start of the second frame that gets parsed from the chunk's own data:
+  indexer = MPEG2IFrameIndexFromTransportStream::createNew(ourEnv, NULL);
+  indexer->setParseState(chunk.startState, chunk.firstPacketNum);
+  PacketReader reader(chunk.firstPacketNum);
+  unsigned numFrameStarts = 0;
+  Boolean haveReachedEnd = False;
+  while (1) {
+    if (!haveReachedEnd && ((pkt = reader.nextPacket()) == NULL || !indexer->addTransportPacket(pkt))) {
+      indexer->noteEndOfInput();
+      haveReachedEnd = True;
+    }
+
+    while (indexer->getNextIndexRecord(record)) {
+      if (recordStartsFrame(record) && ++numFrameStarts == 2) {
+	chunk.haveSyncPoint = True;
+	chunk.syncPosition = recordPosition(record);
+	Medium::close(indexer);
+	return;
+      }
+    }
+    if (haveReachedEnd) break;
+  }
+  Medium::close(indexer);
+}
+
+void indexChunk(ChunkUsageEnvironment& ourEnv, unsigned chunkIndex, ParseState const& startState) {
+  Chunk& chunk = chunks[chunkIndex];
+  Boolean haveStopPoint = chunkIndex + 1 < numChunks;
+  u_int64_t stopPosition = haveStopPoint ? chunks[chunkIndex+1].syncPosition : 0;
+
+  MPEG2IFrameIndexFromTransportStream* indexer = MPEG2IFrameIndexFromTransportStream::createNew(ourEnv, NULL);
+  if (chunkIndex > 0) indexer->setParseState(startState, chunk.firstPacketNum);
+  ourEnv.setSaveMessages(True);
+
+  PacketReader reader(chunk.firstPacketNum);
+  u_int64_t pktNum = chunk.firstPacketNum;
+  Boolean isKeeping = chunkIndex == 0;
+  Boolean haveReachedEnd = False, haveReachedStopPoint = False;
+  u_int8_t const* pkt;
+  u_int8_t record[INDEX_RECORD_SIZE];
+  while (!haveReachedStopPoint) {
+    if ((pkt = reader.nextPacket()) == NULL || !indexer->addTransportPacket(pkt)) {
+      // The input has ended (or had an error).  Handle this the same way that the sequential indexer does:
+      if (pktNum < chunk.endPacketNum) chunk.endedEarly = True;
+      indexer->noteEndOfInput();
+      haveReachedEnd = True;
+    } else if (++pktNum == chunk.endPacketNum) {
+      // This is the last packet of our chunk.  Note our state (for the next chunk to be checked against):
+      indexer->getParseState(chunk.endState);
+      ourEnv.setSaveMessages(False); // because any further messages will also be generated by the next chunk
+    }
+
+    while (indexer->getNextIndexRecord(record)) {
+      if (recordStartsFrame(record)) {
+	u_int64_t position = recordPosition(record);
+	if (!isKeeping) {
+	  if (position == chunk.syncPosition) {
+	    isKeeping = True;
+	  } else if (position > chunk.syncPosition) {
+	    chunk.wasInconsistent = True;
+	    haveReachedStopPoint = True;
+	    break;
+	  }
+	}
+	if (haveStopPoint && position >= stopPosition) {
+	  if (position > stopPosition) chunk.wasInconsistent = True;
+	  haveReachedStopPoint = True;
+	  break;
+	}
+      }
+      if (isKeeping) chunk.addRecord(record);
+    }
+    if (haveReachedEnd) break;
+  }
+  if (haveStopPoint && !haveReachedStopPoint && !chunk.endedEarly) chunk.wasInconsistent = True;
+
+  ourEnv.setSaveMessages(False);
+  chunk.messages = ourEnv.takeMessages();
+  Medium::close(indexer);
+}
+
+// Thread management.  Worker threads first prepare all chunks (after the first); then they index chunks, each time
+// taking the lowest-numbered chunk that's pending (which may be a chunk that needs to be indexed again):
+#ifdef USE_THREADS
+pthread_mutex_t chunksMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t chunksChanged = PTHREAD_COND_INITIALIZER;
+#define LOCK_CHUNKS pthread_mutex_lock(&chunksMutex)
+#define UNLOCK_CHUNKS pthread_mutex_unlock(&chunksMutex)
+#define NOTE_CHUNKS_CHANGED pthread_cond_broadcast(&chunksChanged)
+#define WAIT_FOR_CHUNKS_CHANGE pthread_cond_wait(&chunksChanged, &chunksMutex)
+#else
+#define LOCK_CHUNKS
+#define UNLOCK_CHUNKS
+#define NOTE_CHUNKS_CHANGED
+#define WAIT_FOR_CHUNKS_CHANGE
+#endif
+unsigned nextChunkToPrepare;
+Boolean workIsDone = False;
+unsigned numChunksReindexed = 0;
+
+Boolean prepareNextChunk(ChunkUsageEnvironment& ourEnv) {
+  LOCK_CHUNKS;
+  unsigned chunkIndex = nextChunkToPrepare < numChunks ? nextChunkToPrepare++ : 0;
+  UNLOCK_CHUNKS;
+  if (chunkIndex == 0) return False;
+
+  prepareChunk(ourEnv, chunks[chunkIndex]);
+  return True;
+}
+
+Boolean indexNextChunk(ChunkUsageEnvironment& ourEnv, Boolean waitForWork) {
+  LOCK_CHUNKS;
+  unsigned chunkIndex;
+  while (1) {
+    chunkIndex = numChunks;
+    if (workIsDone) break;
+    for (chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex) {
+      if (chunks[chunkIndex].status == CHUNK_PENDING) break;
+    }
+    if (chunkIndex < numChunks || !waitForWork) break;
+    WAIT_FOR_CHUNKS_CHANGE;
+  }
+  if (chunkIndex == numChunks) {
+    UNLOCK_CHUNKS;
+    return False;
+  }
+  Chunk& chunk = chunks[chunkIndex];
+  chunk.status = CHUNK_RUNNING;
+  unsigned version = chunk.version;
+  ParseState startState = chunk.startState;
+  UNLOCK_CHUNKS;
+
+  indexChunk(ourEnv, chunkIndex, startState);
+
+  LOCK_CHUNKS;
+  if (chunk.version == version) {
+    chunk.status = CHUNK_DONE;
+  } else {
+    // The chunk's starting state was changed while we were indexing it.  It needs to be indexed again:
+    chunk.freeResult();
+    chunk.status = CHUNK_PENDING;
+    ++numChunksReindexed;
+  }
+  NOTE_CHUNKS_CHANGED;
+  UNLOCK_CHUNKS;
+  return True;
+}
+
+void setChunkStartState(unsigned chunkIndex, ParseState const& startState) {
+  // Note: Called with the chunks locked
+  Chunk& chunk = chunks[chunkIndex];
+  chunk.startState = startState;
+  ++chunk.version;
+  if (chunk.status == CHUNK_DONE) {
+    chunk.freeResult();
+    chunk.status = CHUNK_PENDING;
+    ++numChunksReindexed;
+  }
+}
+
+#ifdef USE_THREADS
+void* prepareChunksThread(void* /*arg*/) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  ChunkUsageEnvironment* ourEnv = ChunkUsageEnvironment::createNew(*scheduler);
+  while (prepareNextChunk(*ourEnv)) {}
+  ourEnv->reclaim(); delete scheduler;
+  return NULL;
+}
+
+void* indexChunksThread(void* /*arg*/) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  ChunkUsageEnvironment* ourEnv = ChunkUsageEnvironment::createNew(*scheduler);
+  while (indexNextChunk(*ourEnv, True)) {}
+  ourEnv->reclaim(); delete scheduler;
+  return NULL;
+}
+#endif
+
+Boolean indexFileSequentially(FILE* outFid) {
+  // Index the whole file (in this thread), without splitting it into chunks:
+  MPEG2IFrameIndexFromTransportStream* indexer = MPEG2IFrameIndexFromTransportStream::createNew(*env, NULL);
+  PacketReader reader(0);
+  u_int8_t const* pkt;
+  u_int8_t record[INDEX_RECORD_SIZE];
+  Boolean haveReachedEnd = False;
+  while (!haveReachedEnd) {
+    if ((pkt = reader.nextPacket()) == NULL || !indexer->addTransportPacket(pkt)) {
+      indexer->noteEndOfInput();
+      haveReachedEnd = True;
+    }
+    while (indexer->getNextIndexRecord(record)) {
+      if (fwrite(record, 1, INDEX_RECORD_SIZE, outFid) != INDEX_RECORD_SIZE) return False;
+    }
+  }
+  Medium::close(indexer);
+  return True;
+}
+
+Boolean indexFileInParallel(char const* outputFileName, u_int64_t chunkNumPackets) {
+  FILE* outFid = OpenOutputFile(*env, outputFileName);
+  if (outFid == NULL) return False;
+
+  // Divide the file into chunks:
+  numChunks = (unsigned)((numPackets + chunkNumPackets - 1)/chunkNumPackets);
+  if (numChunks == 0) numChunks = 1;
+  chunks = new Chunk[numChunks];
+  for (unsigned i = 0; i < numChunks; ++i) {
+    chunks[i].firstPacketNum = i*chunkNumPackets;
+    chunks[i].endPacketNum = i+1 < numChunks ? (i+1)*chunkNumPackets : numPackets;
+  }
+
+  // Prepare the chunks.  (Any messages generated by this are not printed.):
+  ChunkUsageEnvironment* ourEnv = ChunkUsageEnvironment::createNew(env->taskScheduler());
+  indexFileStart(*ourEnv);
+  nextChunkToPrepare = 1;
+#ifdef USE_THREADS
+  pthread_t* threads = new pthread_t[numThreads];
+  unsigned i;
+  for (i = 0; i < numThreads; ++i) pthread_create(&threads[i], NULL, prepareChunksThread, NULL);
+  for (i = 0; i < numThreads; ++i) pthread_join(threads[i], NULL);
+#else
+  while (prepareNextChunk(*ourEnv)) {}
+#endif
+
+  // If a chunk has no sync point (because there's no frame after the chunk's start), then it (and any later chunk)
+  // is empty; the previous chunk continues to the end of the file instead:
+  for (unsigned k = 1; k < numChunks; ++k) {
+    if (!chunks[k].haveSyncPoint) { numChunks = k; break; }
+  }
+  chunks[numChunks-1].endPacketNum = numPackets;
+
+  // Index the chunks, and write out their records, in order:
+#ifdef USE_THREADS
+  for (i = 0; i < numThreads; ++i) pthread_create(&threads[i], NULL, indexChunksThread, NULL);
+#endif
+  Boolean mustIndexSequentially = False;
+  ParseState prevEndState;
+  for (unsigned k = 0; k < numChunks; ++k) {
+    Chunk& chunk = chunks[k];
+    LOCK_CHUNKS;
+    while (chunk.status != CHUNK_DONE) {
+#ifdef USE_THREADS
+      WAIT_FOR_CHUNKS_CHANGE;
+#else
+      indexNextChunk(*ourEnv, False);
+#endif
+    }
+    if (k > 0 && !(chunk.startState == prevEndState)) {
+      if (!chunk.startState.parsesLike(prevEndState)) {
+	// The chunk's data would have been parsed differently (which should be rare), so give up:
+	UNLOCK_CHUNKS;
+	mustIndexSequentially = True;
+	break;
+      }
+
+      // Only the PCR state was different.  Index the chunk again, starting with the correct state:
+      setChunkStartState(k, prevEndState);
+      NOTE_CHUNKS_CHANGED;
+      UNLOCK_CHUNKS;
+      --k; continue;
+    }
+    if (chunk.wasInconsistent) {
+      UNLOCK_CHUNKS;
+      mustIndexSequentially = True;
+      break;
+    }
+
+    // This chunk's index records are correct.  If the PCR state changed during the chunk (i.e., because the PCR went
+    // backwards), then later chunks are likely to have assumed the wrong starting state, so correct this now:
+    if (!chunk.endedEarly && k+1 < numChunks
+	&& (chunk.endState.firstPCR != chunks[k+1].startState.firstPCR
+	    || chunk.endState.haveSeenFirstPCR != chunks[k+1].startState.haveSeenFirstPCR)) {
+      for (unsigned j = k+1; j < numChunks; ++j) {
+	ParseState newStartState = chunks[j].startState;
+	newStartState.haveSeenFirstPCR = chunk.endState.haveSeenFirstPCR;
+	newStartState.firstPCR = chunk.endState.firstPCR;
+	if (!(newStartState == chunks[j].startState)) setChunkStartState(j, newStartState);
+      }
+      NOTE_CHUNKS_CHANGED;
+    }
+    UNLOCK_CHUNKS;
+
+    if (chunk.messages != NULL) *env << chunk.messages;
+    if (chunk.recordsSize > 0 && fwrite(chunk.records, 1, chunk.recordsSize, outFid) != chunk.recordsSize) {
+      *env << "Failed to write to output file \"" << outputFileName << "\"\n";
+      exit(1);
+    }
+    prevEndState = chunk.endState;
+    LOCK_CHUNKS;
+    chunk.freeResult();
+    UNLOCK_CHUNKS;
+
+    if (chunk.endedEarly) break; // the sequential indexer would have stopped here also
+  }
+
+  LOCK_CHUNKS;
+  workIsDone = True;
+  NOTE_CHUNKS_CHANGED;
+  UNLOCK_CHUNKS;
+#ifdef USE_THREADS
+  for (i = 0; i < numThreads; ++i) pthread_join(threads[i], NULL);
+  delete[] threads;
+#endif
+
+  if (mustIndexSequentially) {
+    *env << "\n(The file's chunks could not be indexed consistently; indexing it sequentially instead)\n";
+    CloseOutputFile(outFid);
+    outFid = OpenOutputFile(*env, outputFileName);
+    if (outFid == NULL || !indexFileSequentially(outFid)) return False;
+  } else if (numChunksReindexed > 0) {
+    *env << "\n(" << numChunksReindexed << " chunk(s) were indexed again, because of a PCR discontinuity)\n";
+  }
+
+  CloseOutputFile(outFid);
+  delete[] chunks;
+  ourEnv->reclaim();
+  return True;
+}
+
+// For benchmarking: A sink that compares the index records delivered by the sequential indexer with those in our file:
+class IndexComparisonSink: public MediaSink {
+public:
+  IndexComparisonSink(UsageEnvironment& env, FILE* fid)
+    : MediaSink(env), fFid(fid), fNumBytesCompared(0), fHaveMismatch(False) {
+  }
+
+  Boolean outputsMatch() {
+    // Also checks that our file has no more data:
+    return !fHaveMismatch && fgetc(fFid) == EOF;
+  }
+  u_int64_t numBytesCompared() const { return fNumBytesCompared; }
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    IndexComparisonSink* sink = (IndexComparisonSink*)clientData;
+    u_int8_t ourRecord[INDEX_RECORD_SIZE];
+    if (!sink->fHaveMismatch) {
+      if (frameSize > INDEX_RECORD_SIZE || fread(ourRecord, 1, frameSize, sink->fFid) != frameSize
+	  || memcmp(ourRecord, sink->fBuffer, frameSize) != 0) {
+	sink->fHaveMismatch = True;
+      } else {
+	sink->fNumBytesCompared += frameSize;
+      }
+    }
+
+    sink->continuePlaying();
+  }
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+private:
+  FILE* fFid;
+  u_int8_t fBuffer[INDEX_RECORD_SIZE];
+  u_int64_t fNumBytesCompared;
+  Boolean fHaveMismatch;
+};
+
+char benchmarkIsDone;
+
+void afterSequentialIndexing(void* /*clientData*/) {
+  benchmarkIsDone = ~0;
+}
+
+static double secondsSince(struct timeval const& startTime) {
+  struct timeval endTime;
+  gettimeofday(&endTime, NULL);
+  double result = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+  return result > 0.0 ? result : 0.000001;
+}
+
+void runSequentialIndexer(char const* outputFileName, double parallelSeconds) {
+  // Run the indexing code used by "MPEG2TransportStreamIndexer", comparing its output with the file that we wrote:
+  FILE* ourFid = OpenInputFile(*env, outputFileName);
+  FramedSource* input = ByteStreamFileSource::createNew(*env, inputFileName, TRANSPORT_PACKET_SIZE);
+  if (ourFid == NULL || input == NULL) {
+    *env << "Failed to open \"" << outputFileName << "\" or \"" << inputFileName << "\"\n";
+    exit(1);
+  }
+  FramedSource* indexer = MPEG2IFrameIndexFromTransportStream::createNew(*env, input);
+  IndexComparisonSink* sink = new IndexComparisonSink(*env, ourFid);
+
+  *env << "Running the sequential indexer...";
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  sink->startPlaying(*indexer, afterSequentialIndexing, NULL);
+  env->taskScheduler().doEventLoop(&benchmarkIsDone);
+  double sequentialSeconds = secondsSince(startTime);
+
+  char buf[300];
+  double numMBytes = numPackets*TRANSPORT_PACKET_SIZE/1000000.0;
+  sprintf(buf, "done (%.3f seconds; %.1f MBytes/second)\n", sequentialSeconds, numMBytes/sequentialSeconds);
+  *env << buf;
+  sprintf(buf, "Speedup: %.2fx\n", sequentialSeconds/parallelSeconds);
+  *env << buf;
+  if (sink->outputsMatch()) {
+    *env << "The two index files are identical (" << (unsigned)(sink->numBytesCompared()/INDEX_RECORD_SIZE)
+	 << " index records)\n";
+  } else {
+    *env << "ERROR: The two index files differ, starting at byte offset " << (unsigned)sink->numBytesCompared()
+	 << " (index record #" << (unsigned)(sink->numBytesCompared()/INDEX_RECORD_SIZE) << ")\n";
+  }
+
+  Medium::close(sink);
+  Medium::close(indexer);
+  CloseInputFile(ourFid);
+}
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  programName = argv[0];
+#ifdef USE_THREADS
+  long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+  numThreads = numCPUs > 0 ? (unsigned)numCPUs : 1;
+#else
+  numThreads = 1;
+#endif
+  unsigned chunkSizeInKBytes = 32*1024;
+  while (argc > 1 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-b") == 0) doBenchmark = True;
+    else if (strcmp(argv[1], "-j") == 0) {
+      if (argc < 3 || sscanf(argv[2], "%u", &numThreads) != 1 || numThreads == 0) usage();
+      ++argv; --argc;
+    } else if (strcmp(argv[1], "-c") == 0) {
+      if (argc < 3 || sscanf(argv[2], "%u", &chunkSizeInKBytes) != 1 || chunkSizeInKBytes == 0) usage();
+      ++argv; --argc;
+    }
+    else usage();
+    ++argv; --argc;
+  }
+  if (argc != 2) usage();
+
+  inputFileName = argv[1];
+  // Check whether the input file name ends with ".ts":
+  int len = strlen(inputFileName);
+  if (len < 4 || strcmp(&inputFileName[len-3], ".ts") != 0) {
+    *env << "ERROR: input file name \"" << inputFileName
+	 << "\" does not end with \".ts\"\n";
+    usage();
+  }
+
+  FILE* fid = OpenInputFile(*env, inputFileName);
+  if (fid == NULL) {
+    *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
+    exit(1);
+  }
+  numPackets = GetFileSize(inputFileName, fid)/TRANSPORT_PACKET_SIZE;
+  if (doBenchmark) {
+    // Read the whole file once, so that both indexers read it from the file system cache:
+    u_int8_t buf[65536];
+    while (fread(buf, 1, sizeof buf, fid) > 0) {}
+  }
+  CloseInputFile(fid);
+
+  u_int64_t chunkNumPackets = ((u_int64_t)chunkSizeInKBytes*1024)/TRANSPORT_PACKET_SIZE;
+  if (chunkNumPackets == 0) chunkNumPackets = 1;
+
+  // The output file name is the same as the input file name, except with suffix ".tsx":
+  char* outputFileName = new char[len+2]; // allow for trailing x\0
+  sprintf(outputFileName, "%sx", inputFileName);
+
+  *env << "Writing index file \"" << outputFileName << "\" (using " << numThreads << " thread(s))...";
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  if (!indexFileInParallel(outputFileName, chunkNumPackets)) {
+    *env << "Failed to write output file \"" << outputFileName << "\"\n";
+    exit(1);
+  }
+  double parallelSeconds = secondsSince(startTime);
+  *env << "...done\n";
+
+  if (doBenchmark) {
+    char buf[300];
+    sprintf(buf, "Indexed %.0f bytes (in %u chunk(s)) in %.3f seconds (%.1f MBytes/second)\n",
+	    (double)numPackets*TRANSPORT_PACKET_SIZE, numChunks, parallelSeconds,
+	    numPackets*TRANSPORT_PACKET_SIZE/1000000.0/parallelSeconds);
+    *env << buf;
+    runSequentialIndexer(outputFileName, parallelSeconds);
+  }
+
+  delete[] outputFileName;
+  return 0;
+}
@@ -0,0 +1,146 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that generates - from a MPEG-2 Transport Stream file (and its index file) - precomputed 'trick play'
+// files (each containing only the I-frames for a particular fast-forward or reverse play speed), along with their
+// own index files.  "MPEG2TransportFileServerMediaSubsession" uses these files (if present) to serve 'trick play'
+// requests by reading a single, compact file sequentially, rather than by seeking around the original file.
+// Note: If the original Transport Stream file is ever changed, these files must be regenerated.
+// main program
+
+#include <liveMedia.hh>
+#include <BasicUsageEnvironment.hh>
+
+void afterPlaying(void* clientData); // forward
+
+UsageEnvironment* env;
+char const* programName;
+char doneFlag;
+
+void usage() {
+  *env << "usage: " << programName << " <transport-stream-file-name> <scale> [<scale> ...]\n";
+  *env << "\twhere\t<transport-stream-file-name> ends with \".ts\" (and has a corresponding \".tsx\" index file)\n";
+  *env << "\t\teach <scale> is an integer - other than -1, 0 or 1 - no larger (in magnitude) than "
+       << MAX_PRECOMPUTED_TRICK_PLAY_SCALE << " (use a negative number for reverse play)\n";
+  exit(1);
+}
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  programName = argv[0];
+  if (argc < 3) usage();
+
+  char const* inputFileName = argv[1];
+  // Check whether the input file name ends with ".ts":
+  int len = strlen(inputFileName);
+  if (len < 4 || strcmp(&inputFileName[len-3], ".ts") != 0) {
+    *env << "ERROR: input file name \"" << inputFileName
+	 << "\" does not end with \".ts\"\n";
+    usage();
+  }
+
+  // Open the corresponding index file.
+  // The index file name is the same as the input file name, except with suffix ".tsx":
+  char* indexFileName = new char[len+2]; // allow for trailing x\0
+  sprintf(indexFileName, "%sx", inputFileName);
+  MPEG2TransportStreamIndexFile* indexFile
+    = MPEG2TransportStreamIndexFile::createNew(*env, indexFileName);
+  if (indexFile == NULL) {
+    *env << "Failed to open index file \"" << indexFileName << "\" (does it exist?)\n";
+    exit(1);
+  }
+
+  for (int i = 2; i < argc; ++i) {
+    int scale;
+    if (sscanf(argv[i], "%d", &scale) != 1 || (scale >= -1 && scale <= 1)
+	|| scale > MAX_PRECOMPUTED_TRICK_PLAY_SCALE || scale < -MAX_PRECOMPUTED_TRICK_PLAY_SCALE) usage();
+
+    // Open the input file (as a 'byte stream file source'):
+    FramedSource* input
+      = ByteStreamFileSource::createNew(*env, inputFileName, TRANSPORT_PACKET_SIZE);
+    if (input == NULL) {
+      *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
+      exit(1);
+    }
+
+    // Create a filter that generates trick mode data from the input and index files:
+    MPEG2TransportStreamTrickModeFilter* trickModeFilter
+      = MPEG2TransportStreamTrickModeFilter::createNew(*env, input, indexFile, scale);
+
+    if (scale < 0) {
+      // Reverse play starts from the end of the file, so seek there.  (Looking up a TS packet number that's
+      // past the end of the file gives us the last indexed frame.)
+      unsigned long tsRecordNumber = ~0UL, indexRecordNumber;
+      float pcr;
+      indexFile->lookupPCRFromTSPacketNum(tsRecordNumber, False, pcr, indexRecordNumber);
+      if (!trickModeFilter->seekTo(tsRecordNumber, indexRecordNumber)) { // TARFU!
+	*env << "Failed to seek trick mode filter to the end of \"" << inputFileName << "\"\n";
+	exit(1);
+      }
+    }
+
+    // Generate a new Transport Stream from the Trick Mode filter:
+    MPEG2TransportStreamFromESSource* newTransportStream
+      = MPEG2TransportStreamFromESSource::createNew(*env);
+    newTransportStream->addNewVideoSource(trickModeFilter, indexFile->mpegVersion());
+    newTransportStream->setMaxNumTSPacketsPerDelivery(0); // because we're writing to a file (not to a RTP sink)
+
+    // Index the new Transport Stream as we write it:
+    char* outputFileName = MPEG2TransportFileServerMediaSubsession::trickPlayFileName(inputFileName, scale);
+    char* outputIndexFileName = new char[strlen(outputFileName)+2]; // allow for trailing x\0
+    sprintf(outputIndexFileName, "%sx", outputFileName);
+    MPEG2TransportStreamIncrementalIndexer* indexer
+      = MPEG2TransportStreamIncrementalIndexer::createNew(*env, newTransportStream, outputIndexFileName);
+    if (indexer == NULL) {
+      *env << "Failed to open output index file \"" << outputIndexFileName << "\"\n";
+      exit(1);
+    }
+
+    // Open the output file (for writing), as a 'file sink':
+    MediaSink* output = FileSink::createNew(*env, outputFileName);
+    if (output == NULL) {
+      *env << "Failed to open output file \"" << outputFileName << "\"\n";
+      exit(1);
+    }
+
+    // Start playing, to generate the output file (and its index file):
+    *env << "Writing \"" << outputFileName << "\" and \"" << outputIndexFileName
+	 << "\" (scale " << scale << ")...";
+    doneFlag = 0;
+    output->startPlaying(*indexer, afterPlaying, NULL);
+    env->taskScheduler().doEventLoop(&doneFlag);
+
+    // Closing the sink's source closes the whole chain of filters, down to (and including) "input".
+    // ("indexFile" is not closed, because we still use it.)
+    Medium::close(output);
+    Medium::close(indexer);
+    delete[] outputIndexFileName; delete[] outputFileName;
+  }
+
+  Medium::close(indexFile);
+  delete[] indexFileName;
+
+  return 0;
+}
+
+void afterPlaying(void* /*clientData*/) {
+  *env << "done\n";
+  doneFlag = 1;
+}
@@ -0,0 +1,77 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that reads an existing Matroska file, and generates a separate
+// index file (with the same name, but with an extra 'x' at the end) that
+// records the position and time of each 'Cluster' that begins with a key frame.
+// "MatroskaFile" uses this index file - if present - to open and seek within
+// the Matroska file without having to parse its 'Cues' (and to seek within
+// files that have no 'Cues' at all).
+// main program
+
+#include <liveMedia.hh>
+#include <BasicUsageEnvironment.hh>
+
+void onMatroskaFileCreation(MatroskaFile* newFile, void* clientData); // forward
+void afterIndexing(MatroskaFile* file, Boolean success, void* clientData); // forward
+
+UsageEnvironment* env;
+char const* programName;
+
+void usage() {
+  *env << "usage: " << programName << " <matroska-file-name>\n";
+  exit(1);
+}
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  programName = argv[0];
+  if (argc != 2) usage();
+
+  char const* inputFileName = argv[1];
+
+  // Open the input file (this parses its 'Track' headers):
+  MatroskaFile::createNew(*env, inputFileName, onMatroskaFileCreation, NULL);
+
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+}
+
+void onMatroskaFileCreation(MatroskaFile* newFile, void* /*clientData*/) {
+  if (newFile->tracks().numTracks() == 0) {
+    *env << "Failed to read a Matroska file from \"" << newFile->fileName() << "\" (does it exist?)\n";
+    exit(1);
+  }
+
+  // Scan the file, to generate the output index file:
+  *env << "Writing index file \"" << newFile->indexFileName() << "\"...";
+  newFile->createIndexFile(afterIndexing, NULL);
+}
+
+void afterIndexing(MatroskaFile* /*file*/, Boolean success, void* /*clientData*/) {
+  if (!success) {
+    *env << "failed to write the index file (the file might not contain any key frames): "
+	 << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  *env << "...done\n";
+  exit(0);
+}
@@ -1190,6 +1190,19 @@ void printQOSData(int exitCode) {
 	       << (totNumPacketsReceived == 0 ? 0.0 : totalGapsMS/totNumPacketsReceived) << "\n";
 	  *env << "inter_packet_gap_ms_max\t" << stats->maxInterPacketGapUS()/1000.0 << "\n";
 	}
+
+	// (Each "RTPSource" that "MediaSubsession" creates is a "MultiFramedRTPSource".)
+	MultiFramedRTPSource* mfSrc = (MultiFramedRTPSource*)src;
+	*env << "num_packets_reordered\t" << mfSrc->numReorderedPackets() << "\n";
+	*env << "reordering_depth_ave\t" << mfSrc->aveReorderingDepth() << "\n";
+	*env << "reordering_depth_max\t" << mfSrc->maxReorderingDepth() << "\n";
+	*env << "num_packets_duplicated\t" << mfSrc->numDuplicatePackets() << "\n";
+	*env << "num_packets_too_late\t" << mfSrc->numLatePackets() << "\n";
+	*env << "playout_delay_ms\t" << mfSrc->playoutDelayUS()/1000.0 << "\n";
+	*env << "buffering_time_ms_ave\t" << mfSrc->aveBufferingTimeUS()/1000.0 << "\n";
+	*env << "num_packets_past_playout_time\t" << mfSrc->numPacketsPastPlayoutTime() << "\n";
+	*env << "num_packets_nacked\t" << mfSrc->numPacketsNACKed() << "\n";
+	*env << "num_packets_retransmitted\t" << mfSrc->numRetransmittedPacketsReceived() << "\n";
 	
 	curQOSRecord = curQOSRecord->fNext;
       }
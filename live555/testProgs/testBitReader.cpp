@@ -0,0 +1,140 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that checks that "BitReader" gives the same results as "BitVector", using random data that's read (from
+// a random bit offset) as a random sequence of fields - including past the end of the data.  (Some of the data is
+// mostly 0 bits, so that long Exp-Golomb codes - including those with 32 or more leading 0 bits - are also checked.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "BitVector.hh"
+#include "BitReader.hh"
+#include <string.h>
+
+UsageEnvironment* env;
+char const* progName;
+unsigned numTests = 100000;
+unsigned numFailures = 0;
+
+#define MAX_DATA_SIZE 64
+
+void usage() {
+  *env << "usage: " << progName << " [-n <num-tests>] [-s <random-seed>]\n";
+  exit(1);
+}
+
+// Our own random number generator, so that the data is the same (for a given seed) on every platform:
+static u_int32_t randomState = 1;
+static u_int32_t ourRandom() {
+  randomState = randomState*1103515245 + 12345;
+  return randomState>>8;
+}
+
+static void makeRandomData(u_int8_t* data, unsigned size) {
+  // Each bit is 1 with probability 1/2, 1/8, 1/64 or 0:
+  static unsigned const oneBitDenominators[4] = { 2, 8, 64, 0 };
+  unsigned const denominator = oneBitDenominators[ourRandom()%4];
+
+  for (unsigned i = 0; i < size; ++i) {
+    data[i] = 0;
+    if (denominator == 0) continue;
+    for (unsigned j = 0; j < 8; ++j) {
+      if (ourRandom()%denominator == 0) data[i] |= 0x80>>j;
+    }
+  }
+}
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  progName = argv[0];
+  while (argc > 1) {
+    char const* const opt = argv[1];
+    if (argc < 3) usage();
+    if (strcmp(opt, "-n") == 0) {
+      if (sscanf(argv[2], "%u", &numTests) != 1) usage();
+    } else if (strcmp(opt, "-s") == 0) {
+      if (sscanf(argv[2], "%u", &randomState) != 1) usage();
+    } else {
+      usage();
+    }
+    argc -= 2; argv += 2;
+  }
+
+  for (unsigned testNum = 0; testNum < numTests; ++testNum) {
+    unsigned const baseBitOffset = ourRandom()%16;
+    unsigned const totNumBits = ourRandom()%(MAX_DATA_SIZE*8 + 1);
+
+    // Allocate exactly as many bytes as the bits occupy, so that any read past the end can be detected by a memory checker:
+    unsigned const dataSize = (baseBitOffset + totNumBits + 7)/8;
+    u_int8_t* data = new u_int8_t[dataSize];
+    makeRandomData(data, dataSize);
+
+    BitVector bv(data, baseBitOffset, totNumBits);
+    BitReader br(data, baseBitOffset, totNumBits);
+
+    // Read fields until we're past the end of the data (and then read a few more):
+    for (unsigned numFieldsPastEnd = 0; numFieldsPastEnd < 4; ) {
+      if (bv.numBitsRemaining() == 0) ++numFieldsPastEnd;
+
+      unsigned op = ourRandom()%4, result = 0, refResult = 0;
+      char const* opName = "";
+      switch (op) {
+	case 0: {
+	  unsigned numBits = ourRandom()%33;
+	  result = br.getBits(numBits); refResult = bv.getBits(numBits);
+	  opName = "getBits()";
+	  break;
+	}
+	case 1: {
+	  result = br.get1Bit(); refResult = bv.get1Bit();
+	  opName = "get1Bit()";
+	  break;
+	}
+	case 2: {
+	  // Usually a short skip (as in a header), but sometimes a long one (which needs a reload):
+	  unsigned numBits = ourRandom()%4 == 0 ? ourRandom()%200 : ourRandom()%12;
+	  br.skipBits(numBits); bv.skipBits(numBits);
+	  opName = "skipBits()";
+	  break;
+	}
+	case 3: {
+	  result = br.get_expGolomb(); refResult = bv.get_expGolomb();
+	  opName = "get_expGolomb()";
+	  break;
+	}
+      }
+
+      if (result != refResult || br.curBitIndex() != bv.curBitIndex()) {
+	if (numFailures < 10) {
+	  *env << "Test " << testNum << ": " << opName << " gave " << result << " (at bit " << br.curBitIndex()
+	       << "), but \"BitVector\" gave " << refResult << " (at bit " << bv.curBitIndex() << ")\n";
+	}
+	++numFailures;
+	break;
+      }
+    }
+
+    delete[] data;
+  }
+
+  *env << "Ran " << numTests << " tests: " << numFailures << " failure(s)\n";
+  return numFailures == 0 ? 0 : 1;
+}
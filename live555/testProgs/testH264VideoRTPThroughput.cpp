@@ -0,0 +1,205 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that measures how fast a H.264 Video Elementary Stream file (e.g., a 4K stream)
+// can be packetized into RTP by "H264VideoRTPSink".
+// The file is first read into memory, and split into NAL units.  These NAL units are then
+// fed - without pacing - to a "H264VideoRTPSink" (one or more times), which sends the
+// resulting RTP packets to an (unused) UDP port on the local host.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include "InputFile.hh"
+#include <time.h>
+
+UsageEnvironment* env;
+char const* progName;
+unsigned numPasses = 10;
+struct timeval startTime;
+clock_t startClock;
+RTPSink* videoSink;
+unsigned numPacketsSent = 0;
+double numPacketBytesSent = 0;
+
+// A source that delivers NAL units (without 'start codes') from an in-memory copy of the file:
+class InMemoryNALUnitSource: public FramedSource {
+public:
+  InMemoryNALUnitSource(UsageEnvironment& env, u_int8_t const* data,
+			unsigned const* nalUnitOffsets, unsigned numNALUnits, unsigned numPasses)
+    : FramedSource(env), fData(data), fNALUnitOffsets(nalUnitOffsets), fNumNALUnits(numNALUnits),
+      fNumPassesRemaining(numPasses), fNextNALUnit(0), fNumBytesDelivered(0) {
+  }
+
+  double numBytesDelivered() const { return fNumBytesDelivered; }
+
+private:
+  virtual void doGetNextFrame() {
+    if (fNextNALUnit == fNumNALUnits) {
+      fNextNALUnit = 0;
+      if (--fNumPassesRemaining == 0) {
+	handleClosure(this);
+	return;
+      }
+    }
+
+    // NAL unit i occupies the bytes from "fNALUnitOffsets[2*i]" up to (but not including) "fNALUnitOffsets[2*i+1]":
+    unsigned start = fNALUnitOffsets[2*fNextNALUnit];
+    unsigned end = fNALUnitOffsets[2*fNextNALUnit+1];
+    ++fNextNALUnit;
+
+    fFrameSize = end - start;
+    if (fFrameSize > fMaxSize) {
+      fNumTruncatedBytes = fFrameSize - fMaxSize;
+      fFrameSize = fMaxSize;
+    } else {
+      fNumTruncatedBytes = 0;
+    }
+    memmove(fTo, &fData[start], fFrameSize);
+    fNumBytesDelivered += fFrameSize;
+
+    gettimeofday(&fPresentationTime, NULL);
+    fDurationInMicroseconds = 0; // don't pace the sink
+
+    // Deliver the data immediately.  (The sink returns to the event loop after sending each packet.)
+    FramedSource::afterGetting(this);
+  }
+
+private:
+  u_int8_t const* fData;
+  unsigned const* fNALUnitOffsets;
+  unsigned fNumNALUnits;
+  unsigned fNumPassesRemaining;
+  unsigned fNextNALUnit;
+  double fNumBytesDelivered;
+};
+
+InMemoryNALUnitSource* nalUnitSource;
+
+void usage() {
+  *env << "usage: " << progName << " <input-H.264-file> [<num-passes>]\n";
+  exit(1);
+}
+
+void afterPlaying(void* clientData); // forward
+
+void afterSendingPacket(void* /*clientData*/, unsigned char const* /*packet*/, unsigned packetSize) {
+  ++numPacketsSent;
+  numPacketBytesSent += packetSize;
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  if (argc != 2 && argc != 3) usage();
+  char const* inputFileName = argv[1];
+  if (argc == 3 && (sscanf(argv[2], "%u", &numPasses) != 1 || numPasses == 0)) usage();
+
+  // Read the whole input file into memory:
+  FILE* fid = OpenInputFile(*env, inputFileName);
+  if (fid == NULL) {
+    *env << "Unable to open file \"" << inputFileName << "\"\n";
+    exit(1);
+  }
+  u_int64_t fileSize = GetFileSize(inputFileName, fid);
+  if (fileSize == 0 || fileSize > 0x7FFFFFFF) {
+    *env << "Input file \"" << inputFileName << "\" is empty, or too large\n";
+    exit(1);
+  }
+  u_int8_t* data = new u_int8_t[(unsigned)fileSize];
+  if (fread(data, 1, (size_t)fileSize, fid) != (size_t)fileSize) {
+    *env << "Failed to read input file \"" << inputFileName << "\"\n";
+    exit(1);
+  }
+  CloseInputFile(fid);
+  unsigned const dataSize = (unsigned)fileSize;
+
+  // Split the data into NAL units, by scanning for 0x000001 'start codes'.
+  // (A 0x00 byte that precedes a start code - i.e., a 4-byte 0x00000001 start code - is ignored.)
+  unsigned maxNumNALUnits = dataSize/3 + 1;
+  unsigned* nalUnitOffsets = new unsigned[2*maxNumNALUnits];
+  unsigned numNALUnits = 0;
+  unsigned maxNALUnitSize = 0;
+  for (unsigned i = 0; i + 3 <= dataSize; ++i) {
+    if (data[i] == 0 && data[i+1] == 0 && data[i+2] == 1) {
+      if (numNALUnits > 0) {
+	unsigned end = (i > 0 && data[i-1] == 0) ? i-1 : i;
+	nalUnitOffsets[2*numNALUnits-1] = end;
+      }
+      nalUnitOffsets[2*numNALUnits] = i+3;
+      ++numNALUnits;
+      i += 2;
+    }
+  }
+  if (numNALUnits == 0) {
+    *env << "No NAL units were found in \"" << inputFileName << "\".  (It needs to be a H.264 Video Elementary Stream file.)\n";
+    exit(1);
+  }
+  nalUnitOffsets[2*numNALUnits-1] = dataSize;
+  for (unsigned n = 0; n < numNALUnits; ++n) {
+    unsigned nalUnitSize = nalUnitOffsets[2*n+1] - nalUnitOffsets[2*n];
+    if (nalUnitSize > maxNALUnitSize) maxNALUnitSize = nalUnitSize;
+  }
+  *env << "Read " << numNALUnits << " NAL units (" << dataSize << " bytes; largest NAL unit: "
+       << maxNALUnitSize << " bytes) from \"" << inputFileName << "\"\n";
+
+  // Create a 'groupsock' that sends to an unused UDP port on the local host:
+  struct in_addr destinationAddress;
+  destinationAddress.s_addr = our_inet_addr("127.0.0.1");
+  const Port rtpPort(0);
+  Groupsock rtpGroupsock(*env, destinationAddress, rtpPort, 255);
+  rtpGroupsock.changeDestinationParameters(destinationAddress, Port(18888), 255);
+
+  // Create a 'H264 Video RTP' sink from the RTP 'groupsock', with a buffer large enough for our largest NAL unit:
+  OutPacketBuffer::maxSize = maxNALUnitSize + 1000;
+  videoSink = H264VideoRTPSink::createNew(*env, &rtpGroupsock, 96);
+  videoSink->addAfterSendingPacketHandler(afterSendingPacket, NULL);
+
+  // Feed the in-memory NAL units to the sink (via a 'discrete framer'):
+  nalUnitSource = new InMemoryNALUnitSource(*env, data, nalUnitOffsets, numNALUnits, numPasses);
+  H264VideoStreamDiscreteFramer* framer = H264VideoStreamDiscreteFramer::createNew(*env, nalUnitSource);
+
+  *env << "Packetizing (" << numPasses << " passes)...\n";
+  gettimeofday(&startTime, NULL);
+  startClock = clock();
+  videoSink->startPlaying(*framer, afterPlaying, NULL);
+
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+}
+
+void afterPlaying(void* /*clientData*/) {
+  struct timeval endTime;
+  gettimeofday(&endTime, NULL);
+  double elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+  double cpuTime = (clock() - startClock)/(double)CLOCKS_PER_SEC;
+  if (elapsed <= 0.0) elapsed = 0.000001;
+
+  double numBytes = nalUnitSource->numBytesDelivered();
+  char buf[200];
+  sprintf(buf, "%.0f NAL unit bytes => %u RTP packets (%.0f bytes) in %.3f seconds (%.3f CPU seconds)\n",
+	  numBytes, numPacketsSent, numPacketBytesSent, elapsed, cpuTime);
+  *env << buf;
+  sprintf(buf, "\t%.1f Mbytes/second; %.0f packets/second\n",
+	  numBytes/elapsed/1000000.0, numPacketsSent/elapsed);
+  *env << buf;
+  exit(0);
+}
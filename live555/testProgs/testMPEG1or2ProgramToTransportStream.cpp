@@ -48,8 +48,9 @@ int main(int argc, char** argv) {
   MPEG1or2DemuxedElementaryStream* pesSource = baseDemultiplexor->newRawPESStream();
 
   // And, from this, a filter that converts to MPEG-2 Transport Stream frames:
-  FramedSource* tsFrames
+  MPEG2TransportStreamFromPESSource* tsFrames
     = MPEG2TransportStreamFromPESSource::createNew(*env, pesSource);
+  tsFrames->setMaxNumTSPacketsPerDelivery(0); // because we're writing to a file (not to a RTP sink)
 
   // Open the output file as a 'file sink':
   MediaSink* outputSink = FileSink::createNew(*env, outputFileName);
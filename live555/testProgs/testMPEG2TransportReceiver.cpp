@@ -26,6 +26,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // To receive a "source-specific multicast" (SSM) stream, uncomment this:
 //#define USE_SSM 1
 
+// To use SMPTE 2022-1 FEC packets (if the sender sends them) to recover lost packets, uncomment the following:
+//#define USE_FEC 1
+
+// To write the received Transport Stream to a file - along with an index file, so that the recording can be served
+// (with 'trick play' operations, by "testOnDemandRTSPServer" or "live555MediaServer") while it's still in progress -
+// uncomment this:
+//#define RECORD_WITH_INDEX 1
+#define RECORDING_FILE_NAME "recording.ts"
+#define RECORDING_INDEX_FILE_NAME "recording.tsx"
+
 void afterPlaying(void* clientData); // forward
 
 // A structure to hold the state of the current session.
@@ -34,6 +44,12 @@ struct sessionState_t {
   RTPSource* source;
   MediaSink* sink;
   RTCPInstance* rtcpInstance;
+#ifdef RECORD_WITH_INDEX
+  MPEG2TransportStreamIncrementalIndexer* indexer;
+#endif
+#ifdef USE_FEC
+  SMPTE2022FECReceiver* fecReceiver;
+#endif
 } sessionState;
 
 UsageEnvironment* env;
@@ -43,10 +59,15 @@ int main(int argc, char** argv) {
   TaskScheduler* scheduler = BasicTaskScheduler::createNew();
   env = BasicUsageEnvironment::createNew(*scheduler);
 
+#ifdef RECORD_WITH_INDEX
+  // Create the data sink for the recording file:
+  sessionState.sink = FileSink::createNew(*env, RECORDING_FILE_NAME);
+#else
   // Create the data sink for 'stdout':
   sessionState.sink = FileSink::createNew(*env, "stdout");
   // Note: The string "stdout" is handled as a special case.
   // A real file name could have been used instead.
+#endif
 
   // Create 'groupsocks' for RTP and RTCP:
   char const* sessionAddressStr
@@ -78,9 +99,17 @@ int main(int argc, char** argv) {
   Groupsock rtcpGroupsock(*env, sessionAddress, sourceFilterAddress, rtcpPort);
   rtcpGroupsock.changeDestinationParameters(sourceFilterAddress,0,~0);
       // our RTCP "RR"s are sent back using unicast
+#ifdef USE_FEC
+  Groupsock columnFECGroupsock(*env, sessionAddress, sourceFilterAddress, Port(rtpPortNum+2));
+  Groupsock rowFECGroupsock(*env, sessionAddress, sourceFilterAddress, Port(rtpPortNum+4));
+#endif
 #else
   Groupsock rtpGroupsock(*env, sessionAddress, rtpPort, ttl);
   Groupsock rtcpGroupsock(*env, sessionAddress, rtcpPort, ttl);
+#ifdef USE_FEC
+  Groupsock columnFECGroupsock(*env, sessionAddress, Port(rtpPortNum+2), ttl);
+  Groupsock rowFECGroupsock(*env, sessionAddress, Port(rtpPortNum+4), ttl);
+#endif
 #endif
 
   // Create the data source: a "MPEG-2 TransportStream RTP source" (which uses a 'simple' RTP payload format):
@@ -98,9 +127,28 @@ int main(int argc, char** argv) {
 			      NULL /* we're a client */, sessionState.source);
   // Note: This starts RTCP running automatically
 
+#ifdef USE_FEC
+  // Give lost packets a chance to be recovered (from FEC packets) before we give up on them:
+  sessionState.source->setPacketReorderingThresholdTime(300000); // 300 ms
+  sessionState.fecReceiver
+    = SMPTE2022FECReceiver::createNew(*env, (MultiFramedRTPSource*)sessionState.source,
+				      &columnFECGroupsock, &rowFECGroupsock);
+#endif
+
+#ifdef RECORD_WITH_INDEX
+  // Index the stream as it gets recorded:
+  sessionState.indexer
+    = MPEG2TransportStreamIncrementalIndexer::createNew(*env, sessionState.source, RECORDING_INDEX_FILE_NAME);
+  if (sessionState.indexer == NULL) exit(1);
+#endif
+
   // Finally, start receiving the multicast stream:
   *env << "Beginning receiving multicast stream...\n";
+#ifdef RECORD_WITH_INDEX
+  sessionState.sink->startPlaying(*sessionState.indexer, afterPlaying, NULL);
+#else
   sessionState.sink->startPlaying(*sessionState.source, afterPlaying, NULL);
+#endif
 
   env->taskScheduler().doEventLoop(); // does not return
 
@@ -110,9 +158,19 @@ int main(int argc, char** argv) {
 
 void afterPlaying(void* /*clientData*/) {
   *env << "...done receiving\n";
+#ifdef USE_FEC
+  *env << "Recovered " << sessionState.fecReceiver->numRecoveredPackets() << " lost packets (and "
+       << sessionState.fecReceiver->numLateRecoveredPackets() << " too late to be used) from "
+       << sessionState.fecReceiver->numFECPacketsReceived() << " FEC packets\n";
+  Medium::close(sessionState.fecReceiver);
+#endif
 
   // End by closing the media:
   Medium::close(sessionState.rtcpInstance); // Note: Sends a RTCP BYE
   Medium::close(sessionState.sink);
+#ifdef RECORD_WITH_INDEX
+  Medium::close(sessionState.indexer); // this also closes "sessionState.source"
+#else
   Medium::close(sessionState.source);
+#endif
 }
@@ -0,0 +1,302 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that measures how fast Video Elementary Stream data (H.264, or MPEG-1 or 2) can be packed into a
+// MPEG-2 Transport Stream (by "MPEG2TransportStreamFromESSource"), as in "testH264VideoToTransportStream".
+// The file is first parsed into frames (or NAL units), which are held in memory.  These frames are then fed - one or
+// more times, without pacing - to the Transport Stream multiplexor, so that only the multiplexing is timed.
+// The Transport Stream data is read into a buffer of a given size (by default, 7 Transport Stream packets - as for a
+// RTP packet; use a large size - e.g., 65536 - to measure writing to a file), and is discarded.  (Optionally, a
+// checksum of it is computed, so that the output of different versions of the multiplexor can be compared.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <time.h>
+
+UsageEnvironment* env;
+char const* progName;
+unsigned numPasses = 10;
+unsigned outputBufferSize = 7*TRANSPORT_PACKET_SIZE;
+Boolean computeChecksum = False;
+char doneFlag;
+
+// We give the frames presentation times of our own - at this rate, from 1 second - rather than using the framer's
+// (which are based on the current time), so that the Transport Stream (and its checksum) is the same each time we're run:
+#define FRAME_RATE 25
+
+// The frames (or NAL units) that were parsed from the input file:
+struct ParsedFrame {
+  u_int8_t* data;
+  unsigned size;
+  u_int64_t presentationTimeUS; // in microseconds
+};
+ParsedFrame* frames = NULL;
+unsigned numFrames = 0, maxNumFrames = 0;
+double numFrameBytes = 0;
+
+// A sink that receives each frame from a framer, and adds a copy of it to "frames":
+class FrameCollectingSink: public MediaSink {
+public:
+  FrameCollectingSink(UsageEnvironment& env)
+    : MediaSink(env), fNumPictures(0) {
+    fPrevPresentationTime.tv_sec = fPrevPresentationTime.tv_usec = 0;
+  }
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval presentationTime, unsigned /*durationInMicroseconds*/) {
+    FrameCollectingSink* sink = (FrameCollectingSink*)clientData;
+    if (numFrames == maxNumFrames) {
+      // Enlarge our array of frames:
+      maxNumFrames = maxNumFrames == 0 ? 1000 : 2*maxNumFrames;
+      ParsedFrame* newFrames = new ParsedFrame[maxNumFrames];
+      for (unsigned i = 0; i < numFrames; ++i) newFrames[i] = frames[i];
+      delete[] frames;
+      frames = newFrames;
+    }
+    ParsedFrame& frame = frames[numFrames++];
+    frame.data = new u_int8_t[frameSize];
+    memmove(frame.data, sink->fBuffer, frameSize);
+    frame.size = frameSize;
+    // The framer gives each picture (but not each NAL unit of a H.264 picture) a new presentation time, so we use this
+    // only to count pictures:
+    if (numFrames == 1 || presentationTime.tv_sec != sink->fPrevPresentationTime.tv_sec
+	|| presentationTime.tv_usec != sink->fPrevPresentationTime.tv_usec) {
+      ++sink->fNumPictures;
+      sink->fPrevPresentationTime = presentationTime;
+    }
+    frame.presentationTimeUS = 1000000 + (sink->fNumPictures - 1)*(u_int64_t)(1000000/FRAME_RATE);
+    numFrameBytes += frameSize;
+
+    sink->continuePlaying();
+  }
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+private:
+  u_int8_t fBuffer[1000000];
+  struct timeval fPrevPresentationTime;
+  unsigned fNumPictures;
+};
+
+// A source that delivers the frames in "frames", "numPasses" times:
+class InMemoryFrameSource: public FramedSource {
+public:
+  InMemoryFrameSource(UsageEnvironment& env, unsigned numPasses)
+    : FramedSource(env), fNumPassesRemaining(numPasses), fNextFrameNum(0), fPassDurationUS(0), fTimeOffsetUS(0) {
+    if (numFrames > 0) {
+      // Each pass follows the previous one in time (by one picture), so that presentation times keep increasing:
+      fPassDurationUS = frames[numFrames-1].presentationTimeUS - frames[0].presentationTimeUS + 1000000/FRAME_RATE;
+    }
+  }
+
+private:
+  virtual void doGetNextFrame() {
+    if (fNextFrameNum == numFrames && fNumPassesRemaining > 0) {
+      fNextFrameNum = 0;
+      --fNumPassesRemaining;
+      fTimeOffsetUS += fPassDurationUS;
+    }
+    if (fNumPassesRemaining == 0 || numFrames == 0) {
+      handleClosure(this);
+      return;
+    }
+
+    ParsedFrame& frame = frames[fNextFrameNum++];
+    if (frame.size > fMaxSize) {
+      fFrameSize = fMaxSize;
+      fNumTruncatedBytes = frame.size - fMaxSize;
+    } else {
+      fFrameSize = frame.size;
+      fNumTruncatedBytes = 0;
+    }
+    memmove(fTo, frame.data, fFrameSize);
+
+    u_int64_t presentationTimeUS = frame.presentationTimeUS + fTimeOffsetUS;
+    fPresentationTime.tv_sec = (long)(presentationTimeUS/1000000);
+    fPresentationTime.tv_usec = (long)(presentationTimeUS%1000000);
+    fDurationInMicroseconds = 0;
+
+    // Deliver the data via the event loop (as a file source would), to avoid unbounded recursion:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  unsigned fNumPassesRemaining;
+  unsigned fNextFrameNum;
+  u_int64_t fPassDurationUS, fTimeOffsetUS;
+};
+
+// A sink that reads Transport Stream data into a buffer of size "outputBufferSize", and computes a checksum of it:
+class ChecksummingSink: public MediaSink {
+public:
+  ChecksummingSink(UsageEnvironment& env)
+    : MediaSink(env), fNumDeliveries(0), fNumBytes(0), fNumTruncatedBytes(0), fChecksum(0) {
+    fBuffer = new u_int8_t[outputBufferSize];
+  }
+  virtual ~ChecksummingSink() {
+    delete[] fBuffer;
+  }
+
+  unsigned numDeliveries() const { return fNumDeliveries; }
+  double numBytes() const { return fNumBytes; }
+  double numTruncatedBytes() const { return fNumTruncatedBytes; }
+  u_int32_t checksum() const { return fChecksum; }
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    ChecksummingSink* sink = (ChecksummingSink*)clientData;
+    ++sink->fNumDeliveries;
+    sink->fNumBytes += frameSize;
+    sink->fNumTruncatedBytes += numTruncatedBytes;
+    if (computeChecksum) {
+      // Note: The checksum covers just the data - not how it was divided into deliveries - so that it doesn't
+      // depend on the buffer size:
+      u_int32_t checksum = sink->fChecksum;
+      for (unsigned i = 0; i < frameSize; ++i) checksum = checksum*31 + sink->fBuffer[i];
+      sink->fChecksum = checksum;
+    }
+
+    sink->continuePlaying();
+  }
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+
+    fSource->getNextFrame(fBuffer, outputBufferSize, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+private:
+  u_int8_t* fBuffer;
+  unsigned fNumDeliveries;
+  double fNumBytes, fNumTruncatedBytes;
+  u_int32_t fChecksum;
+};
+
+void usage() {
+  *env << "usage: " << progName << " [-h264|-mpeg2] [-b <output-buffer-size>] [-c] <input-file> [<num-passes>]\n";
+  *env << "\t(If no stream type is given, it is guessed from the file name suffix.  \"-b\" sets the size of the buffer\n";
+  *env << "\tinto which Transport Stream data is read (at least " << TRANSPORT_PACKET_SIZE << "; default: " << 7*TRANSPORT_PACKET_SIZE
+       << ").  \"-c\" computes a checksum of the Transport Stream data.)\n";
+  exit(1);
+}
+
+void afterPlaying(void* clientData); // forward
+
+static Boolean hasSuffix(char const* fileName, char const* suffix) {
+  size_t len = strlen(fileName), suffixLen = strlen(suffix);
+  return len >= suffixLen && strcmp(&fileName[len - suffixLen], suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  enum { H264, MPEG1or2, UNKNOWN } streamType = UNKNOWN;
+  while (argc > 1 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-h264") == 0) streamType = H264;
+    else if (strcmp(argv[1], "-mpeg2") == 0) streamType = MPEG1or2;
+    else if (strcmp(argv[1], "-c") == 0) computeChecksum = True;
+    else if (strcmp(argv[1], "-b") == 0) {
+      if (argc < 3 || sscanf(argv[2], "%u", &outputBufferSize) != 1
+	  || outputBufferSize < TRANSPORT_PACKET_SIZE) usage();
+      ++argv; --argc;
+    }
+    else usage();
+    ++argv; --argc;
+  }
+  if (argc != 2 && argc != 3) usage();
+  char const* inputFileName = argv[1];
+  if (argc == 3 && (sscanf(argv[2], "%u", &numPasses) != 1 || numPasses == 0)) usage();
+  if (streamType == UNKNOWN) {
+    if (hasSuffix(inputFileName, ".264") || hasSuffix(inputFileName, ".h264")) streamType = H264;
+    else if (hasSuffix(inputFileName, ".mpg") || hasSuffix(inputFileName, ".m1v") || hasSuffix(inputFileName, ".m2v")) streamType = MPEG1or2;
+    else usage();
+  }
+
+  // First, parse the input file into frames (or NAL units), held in memory:
+  FramedSource* inputSource = ByteStreamFileSource::createNew(*env, inputFileName);
+  if (inputSource == NULL) {
+    *env << "Unable to open file \"" << inputFileName << "\" as a byte-stream file source\n";
+    exit(1);
+  }
+  FramedSource* framer;
+  if (streamType == H264) {
+    framer = H264VideoStreamFramer::createNew(*env, inputSource, True/*includeStartCodeInOutput*/);
+  } else {
+    framer = MPEG1or2VideoStreamFramer::createNew(*env, inputSource);
+  }
+  MediaSink* collectingSink = new FrameCollectingSink(*env);
+  doneFlag = 0;
+  collectingSink->startPlaying(*framer, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+  Medium::close(collectingSink);
+  Medium::close(framer);
+
+  // Then, pack these frames into a Transport Stream (as "testH264VideoToTransportStream" does), and read it:
+  FramedSource* frameSource = new InMemoryFrameSource(*env, numPasses);
+  MPEG2TransportStreamFromESSource* tsFrames = MPEG2TransportStreamFromESSource::createNew(*env);
+  tsFrames->addNewVideoSource(frameSource, streamType == H264 ? 5 : 2);
+  tsFrames->setMaxNumTSPacketsPerDelivery(0); // so that our buffer size is the only limit
+  ChecksummingSink* sink = new ChecksummingSink(*env);
+
+  *env << "Multiplexing " << numFrames << " frames (" << (unsigned)numFrameBytes << " bytes; " << numPasses
+       << " passes) from \"" << inputFileName << "\", with a " << outputBufferSize << "-byte output buffer...\n";
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  clock_t startClock = clock();
+  doneFlag = 0;
+  sink->startPlaying(*tsFrames, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  struct timeval endTime;
+  gettimeofday(&endTime, NULL);
+  double elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+  double cpuTime = (clock() - startClock)/(double)CLOCKS_PER_SEC;
+  if (elapsed <= 0.0) elapsed = 0.000001;
+
+  double numInputBytes = numFrameBytes*numPasses;
+  double numTSPackets = sink->numBytes()/TRANSPORT_PACKET_SIZE;
+  if (numTSPackets <= 0.0) numTSPackets = 1;
+  char buf[300];
+  sprintf(buf, "%.0f input bytes => %.0f Transport Stream packets (%.0f bytes; %.0f truncated), in %u deliveries, in %.3f seconds (%.3f CPU seconds)\n",
+	  numInputBytes, numTSPackets, sink->numBytes(), sink->numTruncatedBytes(), sink->numDeliveries(), elapsed, cpuTime);
+  *env << buf;
+  sprintf(buf, "Throughput: %.1f MBytes/second of Transport Stream (%.0f packets/second); %.1f CPU nanoseconds per packet\n",
+	  sink->numBytes()/elapsed/1000000.0, numTSPackets/elapsed, cpuTime*1000000000.0/numTSPackets);
+  *env << buf;
+  if (computeChecksum) {
+    sprintf(buf, "Transport Stream checksum: 0x%08x\n", sink->checksum());
+    *env << buf;
+  }
+
+  return 0;
+}
+
+void afterPlaying(void* /*clientData*/) {
+  doneFlag = 1;
+}
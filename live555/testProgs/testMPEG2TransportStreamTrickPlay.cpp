@@ -102,6 +102,7 @@ int main(int argc, char const** argv) {
   MPEG2TransportStreamFromESSource* newTransportStream
     = MPEG2TransportStreamFromESSource::createNew(*env);
   newTransportStream->addNewVideoSource(trickModeFilter, indexFile->mpegVersion());
+  newTransportStream->setMaxNumTSPacketsPerDelivery(0); // because we're writing to a file (not to a RTP sink)
 
   // Open the output file (for writing), as a 'file sink':
   char const* outputFileName = argv[4];
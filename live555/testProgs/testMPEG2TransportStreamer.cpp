@@ -34,6 +34,12 @@ Boolean const isSSM = False;
 //#define IMPLEMENT_RTSP_SERVER 1
 // (Note that this RTSP server works for multicast only)
 
+// To also send SMPTE 2022-1 FEC packets (a 'column' FEC stream on port rtpPortNum+2, and a 'row' FEC stream on
+// port rtpPortNum+4), uncomment the following:
+//#define USE_FEC 1
+#define FEC_NUM_COLUMNS 10
+#define FEC_NUM_ROWS 5
+
 #define TRANSPORT_PACKET_SIZE 188
 #define TRANSPORT_PACKETS_PER_NETWORK_PACKET 7
 // The product of these two numbers must be enough to fit within a network packet
@@ -82,6 +88,20 @@ int main(int argc, char** argv) {
     SimpleRTPSink::createNew(*env, &rtpGroupsock, 33, 90000, "video", "MP2T",
 			     1, True, False /*no 'M' bit*/);
 
+#ifdef USE_FEC
+  Groupsock columnFECGroupsock(*env, destinationAddress, Port(rtpPortNum+2), ttl);
+  Groupsock rowFECGroupsock(*env, destinationAddress, Port(rtpPortNum+4), ttl);
+#ifdef USE_SSM
+  columnFECGroupsock.multicastSendOnly();
+  rowFECGroupsock.multicastSendOnly();
+#endif
+  if (SMPTE2022FECSender::createNew(*env, videoSink, &columnFECGroupsock, &rowFECGroupsock,
+				    FEC_NUM_COLUMNS, FEC_NUM_ROWS) == NULL) {
+    *env << "Failed to create FEC sender: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+#endif
+
   // Create (and start) a 'RTCP instance' for this RTP sink:
   const unsigned estimatedSessionBandwidth = 5000; // in kbps; for RTCP b/w share
   const unsigned maxCNAMElen = 100;
@@ -0,0 +1,181 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that checks the (word-at-a-time, or SIMD) functions in "NALUnitEmulationPrevention" against simple
+// byte-at-a-time versions, using random data.  (The data is mostly 0x00-0x03 bytes, so that it contains many
+// 'emulation prevention' candidates.)  Removal is checked both with a separate output buffer and in place, and both
+// removal and addition are checked with output buffers that are too small.  Also, removing the 'emulation prevention'
+// bytes that were added to data must give back the original data.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include <string.h>
+
+UsageEnvironment* env;
+char const* progName;
+unsigned numTests = 100000;
+unsigned numFailures = 0;
+
+#define MAX_DATA_SIZE 300
+
+void usage() {
+  *env << "usage: " << progName << " [-n <num-tests>] [-s <random-seed>]\n";
+  exit(1);
+}
+
+// Our own random number generator, so that the data is the same (for a given seed) on every platform:
+static u_int32_t randomState = 1;
+static u_int32_t ourRandom() {
+  randomState = randomState*1103515245 + 12345;
+  return randomState>>8;
+}
+
+static void makeRandomData(u_int8_t* data, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    unsigned r = ourRandom()%8;
+    data[i] = r < 4 ? r : r == 4 ? 0 : (u_int8_t)ourRandom();
+  }
+}
+
+// The byte-at-a-time versions:
+
+static unsigned refFindEmulationPreventionCandidate(u_int8_t const* ptr, unsigned size) {
+  for (unsigned i = 0; i + 2 < size; ++i) {
+    if (ptr[i] == 0 && ptr[i+1] == 0 && ptr[i+2] <= 3) return i;
+  }
+  return size;
+}
+
+static unsigned refRemoveEmulationPreventionBytes(u_int8_t* to, unsigned toMaxSize,
+						  u_int8_t const* from, unsigned fromSize) {
+  unsigned toSize = 0, i = 0;
+
+  while (i < fromSize && toSize < toMaxSize) {
+    if (i+2 < fromSize && from[i] == 0 && from[i+1] == 0 && from[i+2] == 3) {
+      to[toSize++] = 0;
+      if (toSize < toMaxSize) to[toSize++] = 0;
+      i += 3;
+    } else {
+      to[toSize++] = from[i++];
+    }
+  }
+
+  return toSize;
+}
+
+static unsigned refAddEmulationPreventionBytes(u_int8_t* to, unsigned toMaxSize,
+					       u_int8_t const* from, unsigned fromSize) {
+  unsigned toSize = 0, numZeros = 0;
+
+  for (unsigned i = 0; i < fromSize; ++i) {
+    if (numZeros >= 2 && from[i] <= 3) {
+      if (toSize == toMaxSize) return toSize;
+      to[toSize++] = 3;
+      numZeros = 0;
+    }
+    if (toSize == toMaxSize) return toSize;
+    to[toSize++] = from[i];
+    numZeros = from[i] == 0 ? numZeros+1 : 0;
+  }
+
+  if (numZeros >= 2 && toSize < toMaxSize) to[toSize++] = 3;
+
+  return toSize;
+}
+
+static void check(Boolean ok, char const* what, unsigned testNum) {
+  if (ok) return;
+
+  if (numFailures < 10) *env << "Test " << testNum << ": " << what << "\n";
+  ++numFailures;
+}
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  progName = argv[0];
+  while (argc > 1) {
+    char const* const opt = argv[1];
+    if (argc < 3) usage();
+    if (strcmp(opt, "-n") == 0) {
+      if (sscanf(argv[2], "%u", &numTests) != 1) usage();
+    } else if (strcmp(opt, "-s") == 0) {
+      if (sscanf(argv[2], "%u", &randomState) != 1) usage();
+    } else {
+      usage();
+    }
+    argc -= 2; argv += 2;
+  }
+
+  u_int8_t data[MAX_DATA_SIZE];
+  u_int8_t result[MAX_DATA_SIZE + MAX_DATA_SIZE/2 + 1], refResult[sizeof result]; // see "maxSizeWithEmulationPreventionBytes()"
+  u_int8_t roundTrip[sizeof result];
+
+  for (unsigned testNum = 0; testNum < numTests; ++testNum) {
+    // Mostly short data (like most NAL unit headers), but sometimes long enough for the SIMD loops to be used:
+    unsigned const dataSize = ourRandom()%4 == 0 ? ourRandom()%(MAX_DATA_SIZE+1) : ourRandom()%40;
+    makeRandomData(data, dataSize);
+
+    check(findEmulationPreventionCandidate(data, dataSize) == refFindEmulationPreventionCandidate(data, dataSize),
+	  "findEmulationPreventionCandidate() differs from the byte-at-a-time version", testNum);
+
+    // Removal, first with a large enough output buffer, and then with one that might be too small:
+    unsigned toMaxSize = dataSize;
+    for (unsigned j = 0; j < 2; ++j) {
+      unsigned size = removeEmulationPreventionBytes(result, toMaxSize, data, dataSize);
+      unsigned refSize = refRemoveEmulationPreventionBytes(refResult, toMaxSize, data, dataSize);
+      check(size == refSize && memcmp(result, refResult, size) == 0,
+	    "removeEmulationPreventionBytes() differs from the byte-at-a-time version", testNum);
+
+      // Also in place:
+      memmove(result, data, dataSize);
+      size = removeEmulationPreventionBytes(result, toMaxSize, result, dataSize);
+      check(size == refSize && memcmp(result, refResult, size) == 0,
+	    "removeEmulationPreventionBytes() (in place) differs from the byte-at-a-time version", testNum);
+
+      toMaxSize = ourRandom()%(dataSize+1);
+    }
+
+    // Addition, in the same way:
+    toMaxSize = maxSizeWithEmulationPreventionBytes(dataSize);
+    for (unsigned j = 0; j < 2; ++j) {
+      unsigned size = addEmulationPreventionBytes(result, toMaxSize, data, dataSize);
+      unsigned refSize = refAddEmulationPreventionBytes(refResult, toMaxSize, data, dataSize);
+      check(size == refSize && memcmp(result, refResult, size) == 0,
+	    "addEmulationPreventionBytes() differs from the byte-at-a-time version", testNum);
+
+      if (j == 0) {
+	// The result must contain no start code (or other candidate) - except for its 'emulation prevention' bytes -
+	// and removing these must give back the original data:
+	for (unsigned k = 0; (k += findEmulationPreventionCandidate(&result[k], size - k)) < size; k += 3) {
+	  check(result[k+2] == 3, "addEmulationPreventionBytes() left a candidate without an 'emulation prevention' byte", testNum);
+	}
+	unsigned roundTripSize = removeEmulationPreventionBytes(roundTrip, sizeof roundTrip, result, size);
+	check(roundTripSize == dataSize && memcmp(roundTrip, data, dataSize) == 0,
+	      "removeEmulationPreventionBytes() did not undo addEmulationPreventionBytes()", testNum);
+      }
+
+      toMaxSize = ourRandom()%(toMaxSize+1);
+    }
+  }
+
+  *env << "Ran " << numTests << " tests: " << numFailures << " failure(s)\n";
+  return numFailures == 0 ? 0 : 1;
+}
@@ -100,6 +100,39 @@ int main(int argc, char** argv) {
     announceStream(rtspServer, sms, streamName, inputFileName);
   }
 
+  // A H.265 video elementary stream:
+  {
+    char const* streamName = "h265ESVideoTest";
+    char const* inputFileName = "test.265";
+    ServerMediaSession* sms
+      = ServerMediaSession::createNew(*env, streamName, streamName,
+				      descriptionString);
+    sms->addSubsession(H265VideoFileServerMediaSubsession
+		       ::createNew(*env, inputFileName, reuseFirstSource));
+    rtspServer->addServerMediaSession(sms);
+
+    announceStream(rtspServer, sms, streamName, inputFileName);
+  }
+
+  // A H.264 video elementary stream, streamed from a cache of pre-packetized RTP packets:
+  // (The cache is created - and written to the 'hint cache file' "test.264.hints" - when the stream is
+  //  first described.  It's rebuilt if "test.264" changes.)
+  {
+    char const* streamName = "h264ESVideoHintCacheTest";
+    char const* inputFileName = "test.264";
+    char const* hintCacheFileName = "test.264.hints";
+    ServerMediaSession* sms
+      = ServerMediaSession::createNew(*env, streamName, streamName,
+				      descriptionString);
+    sms->addSubsession(RTPHintCacheServerMediaSubsession
+		       ::createNew(*env,
+				   H264VideoFileServerMediaSubsession::createNew(*env, inputFileName, False),
+				   hintCacheFileName, reuseFirstSource, inputFileName));
+    rtspServer->addServerMediaSession(sms);
+
+    announceStream(rtspServer, sms, streamName, inputFileName);
+  }
+
   // A MPEG-1 or 2 audio+video program stream:
   {
     char const* streamName = "mpeg1or2AudioVideoTest";
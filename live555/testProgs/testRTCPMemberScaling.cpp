@@ -0,0 +1,124 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that measures how well "RTCPInstance" copes with a (simulated) multicast session that has a very
+// large number of receivers (by default, 50000).  In each 'round', every current receiver sends us a RTCP "RR",
+// and we then send our own report.  Between rounds, some receivers leave the session (so must eventually be
+// 'reaped' from our membership database), and are replaced by new receivers.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+UsageEnvironment* env;
+char const* progName;
+
+// A "SimpleRTPSink" that lets us find its SSRC (so that our simulated receivers can report about its stream):
+class ReportedRTPSink: public SimpleRTPSink {
+public:
+  ReportedRTPSink(UsageEnvironment& env, Groupsock* RTPgs)
+    : SimpleRTPSink(env, RTPgs, 96, 90000, "video", "X-TEST", 1, True, True) {
+  }
+
+  u_int32_t ourSSRC() const { return SSRC(); }
+};
+
+void usage() {
+  *env << "usage: " << progName
+       << " [<num-receivers> [<num-rounds> [<rr-sampling-interval> [<max-rrs-per-report-interval>]]]]\n";
+  exit(1);
+}
+
+static double timeNow() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  unsigned numReceivers = 50000, numRounds = 20, rrSamplingInterval = 1, maxNumRRsPerReportInterval = 0;
+  if (argc > 5) usage();
+  if (argc > 1 && (sscanf(argv[1], "%u", &numReceivers) != 1 || numReceivers == 0)) usage();
+  if (argc > 2 && (sscanf(argv[2], "%u", &numRounds) != 1 || numRounds == 0)) usage();
+  if (argc > 3 && (sscanf(argv[3], "%u", &rrSamplingInterval) != 1 || rrSamplingInterval == 0)) usage();
+  if (argc > 4 && sscanf(argv[4], "%u", &maxNumRRsPerReportInterval) != 1) usage();
+  unsigned const numLeavingPerRound = numReceivers/10;
+
+  // Create 'groupsocks' for RTP and RTCP.  We don't actually send any packets:
+  struct in_addr destinationAddress;
+  destinationAddress.s_addr = our_inet_addr("127.0.0.1");
+  Groupsock rtpGroupsock(*env, destinationAddress, Port(0), 255);
+  rtpGroupsock.removeAllDestinations();
+  Groupsock rtcpGroupsock(*env, destinationAddress, Port(0), 255);
+  rtcpGroupsock.removeAllDestinations();
+
+  // Create a RTP sink, and a RTCP instance for it:
+  ReportedRTPSink* sink = new ReportedRTPSink(*env, &rtpGroupsock);
+  RTCPInstance* rtcp = RTCPInstance::createNew(*env, &rtcpGroupsock, 5000, (unsigned char const*)"sender", sink, NULL);
+  rtcp->setRRProcessingLimits(rrSamplingInterval, maxNumRRsPerReportInterval);
+
+  // Each receiver sends a "RR" containing one report block (about our stream):
+  u_int8_t rr[32];
+  u_int32_t const words[8] = { 0x81C90007, 0, sink->ourSSRC(), 0, 1000, 10, 0, 0 };
+  for (unsigned i = 0; i < 8; ++i) {
+    rr[4*i] = words[i]>>24; rr[4*i+1] = words[i]>>16; rr[4*i+2] = words[i]>>8; rr[4*i+3] = words[i];
+  }
+  struct sockaddr_in fromAddress;
+  memset(&fromAddress, 0, sizeof fromAddress);
+  fromAddress.sin_family = AF_INET;
+
+  *env << "Simulating " << numReceivers << " receivers, for " << numRounds << " rounds ("
+       << numLeavingPerRound << " receivers leave, and are replaced, after each round)\n";
+  double rrTime = 0.0, reportTime = 0.0, maxReportTime = 0.0;
+  unsigned firstReceiver = 0;
+  for (unsigned round = 0; round < numRounds; ++round) {
+    double start = timeNow();
+    for (unsigned r = firstReceiver; r < firstReceiver + numReceivers; ++r) {
+      u_int32_t ssrc = 0x10000000 + r*2654435761u;
+      rr[4] = ssrc>>24; rr[5] = ssrc>>16; rr[6] = ssrc>>8; rr[7] = ssrc;
+      fromAddress.sin_addr.s_addr = htonl(0x0A000000 | (r&0xFFFFFF));
+      fromAddress.sin_port = htons(5001);
+      rtcp->injectReport(rr, sizeof rr, fromAddress);
+    }
+    double afterRRs = timeNow();
+    rtcp->sendReport(); // this also (periodically) reaps old members
+    double afterReport = timeNow();
+
+    rrTime += afterRRs - start;
+    reportTime += afterReport - afterRRs;
+    if (afterReport - afterRRs > maxReportTime) maxReportTime = afterReport - afterRRs;
+    firstReceiver += numLeavingPerRound;
+  }
+
+  char buf[300];
+  sprintf(buf, "Processed %u incoming \"RR\"s in %.3f seconds (%.0f \"RR\"s/second)\n",
+	  numReceivers*numRounds, rrTime, numReceivers*numRounds/rrTime);
+  *env << buf;
+  sprintf(buf, "Sent %u reports (including member reaping) in %.3f seconds (average %.3f ms; maximum %.3f ms)\n",
+	  numRounds, reportTime, 1000.0*reportTime/numRounds, 1000.0*maxReportTime);
+  *env << buf;
+  *env << "Final number of members: " << rtcp->numMembers() << "\n";
+
+  Medium::close(rtcp);
+  Medium::close(sink);
+  return 0;
+}
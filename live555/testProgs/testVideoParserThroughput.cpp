@@ -0,0 +1,281 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2013, Live Networks, Inc.  All rights reserved
+// A program that measures how fast a Video Elementary Stream file (H.264, MPEG-1 or 2, or MPEG-4) can be parsed
+// into frames (or NAL units) by the corresponding "StreamParser"-based framer.
+// The file is first read into memory, and is then fed - one or more times, without pacing - to the framer.
+// (Optionally, the data is fed in small pieces, as it would be if it were read from a network or a pipe.)
+// Alternatively, the program measures how fast a Matroska file's video track can be demultiplexed (from the file).
+// The resulting frames are discarded.  (Optionally, a checksum of them is computed, so that the output of different
+// versions of the parser can be compared.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include "InputFile.hh"
+#include <time.h>
+
+UsageEnvironment* env;
+char const* progName;
+unsigned numPasses = 10;
+unsigned maxReadSize = 0; // no limit
+Boolean computeChecksum = False;
+double numInputBytes = 0;
+struct timeval startTime;
+clock_t startClock;
+
+// A source that delivers an in-memory copy of the file (as a byte stream), "numPasses" times:
+class InMemoryByteStreamSource: public FramedSource {
+public:
+  InMemoryByteStreamSource(UsageEnvironment& env, u_int8_t const* data, unsigned dataSize, unsigned numPasses)
+    : FramedSource(env), fData(data), fDataSize(dataSize),
+      fNumPassesRemaining(numPasses), fCurOffset(0), fNumBytesDelivered(0) {
+  }
+
+  double numBytesDelivered() const { return fNumBytesDelivered; }
+
+private:
+  virtual void doGetNextFrame() {
+    if (fCurOffset == fDataSize && fNumPassesRemaining > 0) {
+      fCurOffset = 0;
+      --fNumPassesRemaining;
+    }
+    if (fNumPassesRemaining == 0) {
+      handleClosure(this);
+      return;
+    }
+
+    fFrameSize = fDataSize - fCurOffset;
+    if (fFrameSize > fMaxSize) fFrameSize = fMaxSize;
+    if (maxReadSize > 0 && fFrameSize > maxReadSize) fFrameSize = maxReadSize;
+    fNumTruncatedBytes = 0;
+    memmove(fTo, &fData[fCurOffset], fFrameSize);
+    fCurOffset += fFrameSize;
+    fNumBytesDelivered += fFrameSize;
+
+    fPresentationTime.tv_sec = fPresentationTime.tv_usec = 0;
+    fDurationInMicroseconds = 0;
+
+    // Deliver the data via the event loop (as a file source would), to avoid unbounded recursion:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  u_int8_t const* fData;
+  unsigned fDataSize;
+  unsigned fNumPassesRemaining;
+  unsigned fCurOffset;
+  double fNumBytesDelivered;
+};
+
+// A sink that requests each frame as soon as it has received the previous one, and computes a checksum of them:
+class ChecksummingSink: public MediaSink {
+public:
+  ChecksummingSink(UsageEnvironment& env)
+    : MediaSink(env), fNumFrames(0), fNumFrameBytes(0), fNumTruncatedBytes(0), fChecksum(0) {
+  }
+  virtual ~ChecksummingSink() {
+  }
+
+  unsigned numFrames() const { return fNumFrames; }
+  double numFrameBytes() const { return fNumFrameBytes; }
+  double numTruncatedBytes() const { return fNumTruncatedBytes; }
+  u_int32_t checksum() const { return fChecksum; }
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    ChecksummingSink* sink = (ChecksummingSink*)clientData;
+    ++sink->fNumFrames;
+    sink->fNumFrameBytes += frameSize;
+    sink->fNumTruncatedBytes += numTruncatedBytes;
+    if (computeChecksum) {
+      u_int32_t checksum = sink->fChecksum;
+      for (unsigned i = 0; i < frameSize; ++i) checksum = checksum*31 + sink->fBuffer[i];
+      sink->fChecksum = checksum*31 + frameSize;
+    }
+
+    sink->continuePlaying();
+  }
+
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+private:
+  u_int8_t fBuffer[1000000];
+  unsigned fNumFrames;
+  double fNumFrameBytes, fNumTruncatedBytes;
+  u_int32_t fChecksum;
+};
+
+InMemoryByteStreamSource* byteStreamSource = NULL;
+ChecksummingSink* sink;
+
+void usage() {
+  *env << "usage: " << progName << " [-h264|-mpeg2|-mpeg4|-mkv] [-r <read-size>] [-c] <input-file> [<num-passes>]\n";
+  *env << "\t(If no stream type is given, it is guessed from the file name suffix.  \"-r\" feeds the data to the framer at most\n";
+  *env << "\t<read-size> bytes at a time.  \"-c\" computes a checksum of the frames.  Matroska files are read just once.)\n";
+  exit(1);
+}
+
+void afterPlaying(void* clientData); // forward
+void onMatroskaFileCreation(MatroskaFile* newFile, void* clientData); // forward
+void startParsing(FramedSource* framer); // forward
+
+static Boolean hasSuffix(char const* fileName, char const* suffix) {
+  size_t len = strlen(fileName), suffixLen = strlen(suffix);
+  return len >= suffixLen && strcmp(&fileName[len - suffixLen], suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  enum { H264, MPEG1or2, MPEG4, MATROSKA, UNKNOWN } streamType = UNKNOWN;
+  while (argc > 1 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-h264") == 0) streamType = H264;
+    else if (strcmp(argv[1], "-mpeg2") == 0) streamType = MPEG1or2;
+    else if (strcmp(argv[1], "-mpeg4") == 0) streamType = MPEG4;
+    else if (strcmp(argv[1], "-mkv") == 0) streamType = MATROSKA;
+    else if (strcmp(argv[1], "-c") == 0) computeChecksum = True;
+    else if (strcmp(argv[1], "-r") == 0) {
+      if (argc < 3 || sscanf(argv[2], "%u", &maxReadSize) != 1 || maxReadSize == 0) usage();
+      ++argv; --argc;
+    }
+    else usage();
+    ++argv; --argc;
+  }
+  if (argc != 2 && argc != 3) usage();
+  char const* inputFileName = argv[1];
+  if (argc == 3 && (sscanf(argv[2], "%u", &numPasses) != 1 || numPasses == 0)) usage();
+  if (streamType == UNKNOWN) {
+    if (hasSuffix(inputFileName, ".264") || hasSuffix(inputFileName, ".h264")) streamType = H264;
+    else if (hasSuffix(inputFileName, ".mpg") || hasSuffix(inputFileName, ".m1v") || hasSuffix(inputFileName, ".m2v")) streamType = MPEG1or2;
+    else if (hasSuffix(inputFileName, ".m4e") || hasSuffix(inputFileName, ".m4v")) streamType = MPEG4;
+    else if (hasSuffix(inputFileName, ".mkv") || hasSuffix(inputFileName, ".webm")) streamType = MATROSKA;
+    else usage();
+  }
+  sink = new ChecksummingSink(*env);
+
+  if (streamType == MATROSKA) {
+    // Parse the Matroska file's headers.  We continue when this is done (in "onMatroskaFileCreation()"):
+    FILE* fid = OpenInputFile(*env, inputFileName);
+    if (fid == NULL) {
+      *env << "Unable to open file \"" << inputFileName << "\"\n";
+      exit(1);
+    }
+    numInputBytes = (double)GetFileSize(inputFileName, fid);
+    CloseInputFile(fid);
+
+    *env << "Demultiplexing \"" << inputFileName << "\" (" << numInputBytes << " bytes)...\n";
+    gettimeofday(&startTime, NULL);
+    startClock = clock();
+    MatroskaFile::createNew(*env, inputFileName, onMatroskaFileCreation, NULL);
+
+    env->taskScheduler().doEventLoop(); // does not return
+  }
+
+  // Read the whole input file into memory:
+  FILE* fid = OpenInputFile(*env, inputFileName);
+  if (fid == NULL) {
+    *env << "Unable to open file \"" << inputFileName << "\"\n";
+    exit(1);
+  }
+  u_int64_t fileSize = GetFileSize(inputFileName, fid);
+  if (fileSize == 0 || fileSize > 0x7FFFFFFF) {
+    *env << "Input file \"" << inputFileName << "\" is empty, or too large\n";
+    exit(1);
+  }
+  u_int8_t* data = new u_int8_t[(unsigned)fileSize];
+  if (fread(data, 1, (size_t)fileSize, fid) != (size_t)fileSize) {
+    *env << "Failed to read input file \"" << inputFileName << "\"\n";
+    exit(1);
+  }
+  CloseInputFile(fid);
+
+  // Create a framer for the stream, and a sink that consumes its frames:
+  byteStreamSource = new InMemoryByteStreamSource(*env, data, (unsigned)fileSize, numPasses);
+  FramedSource* framer;
+  switch (streamType) {
+    case H264: {
+      framer = H264VideoStreamFramer::createNew(*env, byteStreamSource);
+      break;
+    }
+    case MPEG1or2: {
+      framer = MPEG1or2VideoStreamFramer::createNew(*env, byteStreamSource);
+      break;
+    }
+    default: {
+      framer = MPEG4VideoStreamFramer::createNew(*env, byteStreamSource);
+      break;
+    }
+  }
+
+  *env << "Parsing \"" << inputFileName << "\" (" << (unsigned)fileSize << " bytes; " << numPasses << " passes)...\n";
+  gettimeofday(&startTime, NULL);
+  startClock = clock();
+  startParsing(framer);
+
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+}
+
+void onMatroskaFileCreation(MatroskaFile* newFile, void* /*clientData*/) {
+  unsigned trackNumber = newFile->chosenVideoTrackNumber();
+  if (trackNumber == 0) {
+    *env << "No video track was found in the Matroska file\n";
+    exit(1);
+  }
+
+  MatroskaDemux* demux = newFile->newDemux();
+  startParsing(demux->newDemuxedTrack(trackNumber));
+}
+
+void startParsing(FramedSource* framer) {
+  sink->startPlaying(*framer, afterPlaying, NULL);
+}
+
+void afterPlaying(void* /*clientData*/) {
+  struct timeval endTime;
+  gettimeofday(&endTime, NULL);
+  double elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+  double cpuTime = (clock() - startClock)/(double)CLOCKS_PER_SEC;
+  if (elapsed <= 0.0) elapsed = 0.000001;
+
+  double numBytes = byteStreamSource != NULL ? byteStreamSource->numBytesDelivered() : numInputBytes;
+  if (numBytes <= 0.0) numBytes = 1;
+  char buf[300];
+  sprintf(buf, "%.0f input bytes => %u frames (%.0f bytes; %.0f truncated) in %.3f seconds (%.3f CPU seconds)\n",
+	  numBytes, sink->numFrames(), sink->numFrameBytes(), sink->numTruncatedBytes(), elapsed, cpuTime);
+  *env << buf;
+  sprintf(buf, "Throughput: %.1f MBytes/second (%.0f frames/second); %.2f CPU nanoseconds per input byte\n",
+	  numBytes/elapsed/1000000.0, sink->numFrames()/elapsed, cpuTime*1000000000.0/numBytes);
+  *env << buf;
+  if (computeChecksum) {
+    sprintf(buf, "Frame checksum: 0x%08x\n", sink->checksum());
+    *env << buf;
+  }
+
+  exit(0);
+}